@@ -15,6 +15,7 @@
 #define DEBUG 1
 #endif
 
+#if DEBUG
 #define TRACEVAR(v) \
     if (DEBUG)      \
         trace_num((uint32_t)(#v), (uint32_t)(sizeof(#v) - 1), (int64_t)v);
@@ -27,6 +28,13 @@
 #define TRACESTR(v) \
     if (DEBUG)      \
         trace((uint32_t)(#v), (uint32_t)(sizeof(#v) - 1), (uint32_t)(v), sizeof(v), 0);
+#else
+// release builds: no trace call or name literal is left in the binary, even at -O0
+#define TRACEVAR(v) (void)0
+#define TRACEHEX(v) (void)0
+#define TRACEXFL(v) (void)0
+#define TRACESTR(v) (void)0
+#endif
 
 // hook developers should use this guard macro, simply GUARD(<maximum iterations>)
 #define GUARD(maxiter) _g((1ULL << 31U) + __LINE__, (maxiter) + 1)
@@ -552,4 +560,98 @@
         _06_08_ENCODE_DROPS_FEE(fee_ptr, fee);                                                           \
     }
 
+/**
+ * Per-transaction callback control
+ *
+ * etxn_details appends sfEmitCallback (22 bytes, last field before the end
+ * marker) whenever the hook exports cbak. The _CB variants take a callback
+ * flag: with callback == 0 the field is dropped again so the emitted txn is
+ * shorter and does not come back through cbak. Use the matching _CB_SIZE
+ * macro as emit length.
+ **/
+
+#ifdef HAS_CALLBACK
+#define EMIT_CALLBACK_SIZE 22U
+#else
+#define EMIT_CALLBACK_SIZE 0U
+#endif
+#define EMIT_DETAILS_SIZE 138U
+#define EMIT_DETAILS_CALLBACK_OFFSET 115U
+
+#define ETXN_DETAILS_STRIP_CALLBACK(buf_out, edlen)          \
+    {                                                        \
+        if ((edlen) == EMIT_DETAILS_SIZE)                    \
+        {                                                    \
+            (buf_out)[EMIT_DETAILS_CALLBACK_OFFSET] = 0xE1U; \
+            (edlen) -= EMIT_CALLBACK_SIZE;                   \
+        }                                                    \
+    }
+
+// decodes the drops written by ENCODE_DROPS, buf points at the field header
+#define DROPS_FROM_BUF(buf) \
+    (UINT64_FROM_BUF((buf) + 1) & 0x3FFFFFFFFFFFFFFFULL)
+
+#define PREPARE_PAYMENT_SIMPLE_FEE_OFFSET 44U
+#define PREPARE_PAYMENT_SIMPLE_CB_SIZE(callback) \
+    (PREPARE_PAYMENT_SIMPLE_SIZE - ((callback) ? 0U : EMIT_CALLBACK_SIZE))
+#define PREPARE_PAYMENT_SIMPLE_CB(buf_out_master, drops_amount_raw, to_address, dest_tag_raw, src_tag_raw, callback) \
+    {                                                                                                                \
+        uint8_t *buf_out = buf_out_master;                                                                           \
+        uint8_t acc[20];                                                                                             \
+        uint64_t drops_amount = (drops_amount_raw);                                                                  \
+        uint32_t dest_tag = (dest_tag_raw);                                                                          \
+        uint32_t src_tag = (src_tag_raw);                                                                            \
+        uint32_t cls = (uint32_t)ledger_seq();                                                                       \
+        hook_account(SBUF(acc));                                                                                     \
+        _01_02_ENCODE_TT(buf_out, ttPAYMENT);              /* uint16  | size   3 */                                  \
+        _02_02_ENCODE_FLAGS(buf_out, tfCANONICAL);         /* uint32  | size   5 */                                  \
+        _02_03_ENCODE_TAG_SRC(buf_out, src_tag);           /* uint32  | size   5 */                                  \
+        _02_04_ENCODE_SEQUENCE(buf_out, 0);                /* uint32  | size   5 */                                  \
+        _02_14_ENCODE_TAG_DST(buf_out, dest_tag);          /* uint32  | size   5 */                                  \
+        _02_26_ENCODE_FLS(buf_out, cls + 1);               /* uint32  | size   6 */                                  \
+        _02_27_ENCODE_LLS(buf_out, cls + 5);               /* uint32  | size   6 */                                  \
+        _06_01_ENCODE_DROPS_AMOUNT(buf_out, drops_amount); /* amount  | size   9 */                                  \
+        uint8_t *fee_ptr = buf_out;                                                                                  \
+        _06_08_ENCODE_DROPS_FEE(buf_out, 0);                                          /* amount  | size   9 */       \
+        _07_03_ENCODE_SIGNING_PUBKEY_NULL(buf_out);                                   /* pk      | size  35 */       \
+        _08_01_ENCODE_ACCOUNT_SRC(buf_out, acc);                                      /* account | size  22 */       \
+        _08_03_ENCODE_ACCOUNT_DST(buf_out, to_address);                               /* account | size  22 */       \
+        int64_t edlen = etxn_details((uint32_t)buf_out, PREPARE_PAYMENT_SIMPLE_SIZE); /* emitdet | size 1?? */       \
+        if (!(callback))                                                                                             \
+            ETXN_DETAILS_STRIP_CALLBACK(buf_out, edlen);                                                             \
+        int64_t fee = etxn_fee_base(buf_out_master, PREPARE_PAYMENT_SIMPLE_CB_SIZE(callback));                       \
+        _06_08_ENCODE_DROPS_FEE(fee_ptr, fee);                                                                       \
+    }
+
+#define PREPARE_PAYMENT_SIMPLE_TRUSTLINE_FEE_OFFSET 84U
+#define PREPARE_PAYMENT_SIMPLE_TRUSTLINE_CB_SIZE(callback) \
+    (PREPARE_PAYMENT_SIMPLE_TRUSTLINE_SIZE - ((callback) ? 0U : EMIT_CALLBACK_SIZE))
+#define PREPARE_PAYMENT_SIMPLE_TRUSTLINE_CB(buf_out_master, tlamt, to_address, dest_tag_raw, src_tag_raw, callback) \
+    {                                                                                                              \
+        uint8_t *buf_out = buf_out_master;                                                                         \
+        uint8_t acc[20];                                                                                           \
+        uint32_t dest_tag = (dest_tag_raw);                                                                        \
+        uint32_t src_tag = (src_tag_raw);                                                                          \
+        uint32_t cls = (uint32_t)ledger_seq();                                                                     \
+        hook_account(SBUF(acc));                                                                                   \
+        _01_02_ENCODE_TT(buf_out, ttPAYMENT);      /* uint16  | size   3 */                                        \
+        _02_02_ENCODE_FLAGS(buf_out, tfCANONICAL); /* uint32  | size   5 */                                        \
+        _02_03_ENCODE_TAG_SRC(buf_out, src_tag);   /* uint32  | size   5 */                                        \
+        _02_04_ENCODE_SEQUENCE(buf_out, 0);        /* uint32  | size   5 */                                        \
+        _02_14_ENCODE_TAG_DST(buf_out, dest_tag);  /* uint32  | size   5 */                                        \
+        _02_26_ENCODE_FLS(buf_out, cls + 1);       /* uint32  | size   6 */                                        \
+        _02_27_ENCODE_LLS(buf_out, cls + 5);       /* uint32  | size   6 */                                        \
+        _06_01_ENCODE_TL_AMOUNT(buf_out, tlamt);   /* amount  | size  48 */                                        \
+        uint8_t *fee_ptr = buf_out;                                                                                \
+        _06_08_ENCODE_DROPS_FEE(buf_out, 0);                                                     /* amount  | size   9 */ \
+        _07_03_ENCODE_SIGNING_PUBKEY_NULL(buf_out);                                              /* pk      | size  35 */ \
+        _08_01_ENCODE_ACCOUNT_SRC(buf_out, acc);                                                 /* account | size  22 */ \
+        _08_03_ENCODE_ACCOUNT_DST(buf_out, to_address);                                          /* account | size  22 */ \
+        int64_t edlen = etxn_details((uint32_t)buf_out, PREPARE_PAYMENT_SIMPLE_TRUSTLINE_SIZE); /* emitdet | size 1?? */ \
+        if (!(callback))                                                                                           \
+            ETXN_DETAILS_STRIP_CALLBACK(buf_out, edlen);                                                           \
+        int64_t fee = etxn_fee_base(buf_out_master, PREPARE_PAYMENT_SIMPLE_TRUSTLINE_CB_SIZE(callback));           \
+        _06_08_ENCODE_DROPS_FEE(fee_ptr, fee);                                                                     \
+    }
+
 #endif
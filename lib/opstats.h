@@ -0,0 +1,109 @@
+/**
+ * Operational counters
+ *
+ * Build with -DOPSTATS to keep one packed counters record per hook in its own
+ * state, readable by anyone watching the hook account:
+ *
+ *   counters  0..  | OPSC  ->  count * OPSTATS_ACTIONS (4 each) | failures (4) | retries (4) | emitted drops (8)
+ *
+ * count[a] is the number of executions that got past validation with action a
+ * (index 0 is left for actions out of range), failures the number of emitted
+ * txs that came back failed and were stored for later, retries the number of
+ * stored txs handed out again and emitted drops the XRP sent by emits.
+ * All fields are big endian and wrap on overflow.
+ *
+ * The OPSTATS_* calls only add to locals declared by OPSTATS_BEGIN(), the record
+ * is read and written once in OPSTATS_END() right before the hook accepts, so
+ * counting costs one state read and one state write per execution and nothing on
+ * paths that roll back. A failed write is ignored, counters never block a tx.
+ *
+ * Those two calls are paid by every accepted tx: the extra state() and state_set()
+ * raise its execution fee, and the first write creates the record, one more
+ * state entry held against the hook account's owner reserve. This is why the
+ * flag is off by default and tools/build_hooks.sh never sets it in the release
+ * profile; without -DOPSTATS every call expands to nothing.
+ *
+ * Define OPSTATS_ACTIONS before including to override.
+ */
+
+#include <stdint.h>
+#include "hookapi.h"
+
+#ifndef OPSTATS_INCLUDED
+#define OPSTATS_INCLUDED 1
+
+#ifndef OPSTATS_ACTIONS
+#define OPSTATS_ACTIONS 8
+#endif
+
+#define OPSTATS_SIZE (4 * OPSTATS_ACTIONS + 16)
+
+#ifdef OPSTATS
+
+#define OPSTATS_KEY(key)               \
+    {                                  \
+        *(uint64_t *)((key) + 0) = 0;  \
+        *(uint64_t *)((key) + 8) = 0;  \
+        *(uint64_t *)((key) + 16) = 0; \
+        *(uint32_t *)((key) + 24) = 0; \
+        (key)[28] = 'O';               \
+        (key)[29] = 'P';               \
+        (key)[30] = 'S';               \
+        (key)[31] = 'C';               \
+    }
+
+#define OPSTATS_BEGIN()                       \
+    uint8_t opstats_action = OPSTATS_ACTIONS; \
+    uint32_t opstats_failures = 0;            \
+    uint32_t opstats_retries = 0;             \
+    uint64_t opstats_drops = 0
+
+#define OPSTATS_ACTION(a) \
+    opstats_action = (a) < OPSTATS_ACTIONS ? (a) : 0
+
+#define OPSTATS_FAILURE() \
+    ++opstats_failures
+
+#define OPSTATS_RETRY(n) \
+    opstats_retries += (n)
+
+#define OPSTATS_EMITTED(drops) \
+    opstats_drops += (drops)
+
+#define OPSTATS_END()                                                                        \
+    {                                                                                        \
+        uint8_t os_key[32];                                                                  \
+        uint8_t os_record[OPSTATS_SIZE];                                                     \
+        OPSTATS_KEY(os_key);                                                                 \
+        if (state(SBUF(os_record), SBUF(os_key)) != OPSTATS_SIZE)                            \
+            for (int os_i = 0; GUARDM(OPSTATS_SIZE / 4, 1), os_i < OPSTATS_SIZE / 4; ++os_i) \
+                *(uint32_t *)(os_record + 4 * os_i) = 0;                                     \
+        uint8_t *os_field = os_record + 4 * opstats_action;                                  \
+        uint32_t os_count = 0;                                                               \
+        if (opstats_action < OPSTATS_ACTIONS)                                                \
+        {                                                                                    \
+            os_count = UINT32_FROM_BUF(os_field) + 1;                                        \
+            UINT32_TO_BUF(os_field, os_count);                                               \
+        }                                                                                    \
+        os_field = os_record + 4 * OPSTATS_ACTIONS;                                          \
+        os_count = UINT32_FROM_BUF(os_field) + opstats_failures;                             \
+        UINT32_TO_BUF(os_field, os_count);                                                   \
+        os_field += 4;                                                                       \
+        os_count = UINT32_FROM_BUF(os_field) + opstats_retries;                              \
+        UINT32_TO_BUF(os_field, os_count);                                                   \
+        os_field += 4;                                                                       \
+        uint64_t os_drops = UINT64_FROM_BUF(os_field) + opstats_drops;                       \
+        UINT64_TO_BUF(os_field, os_drops);                                                   \
+        state_set(SBUF(os_record), SBUF(os_key));                                            \
+    }
+
+#else
+#define OPSTATS_BEGIN()
+#define OPSTATS_ACTION(a)
+#define OPSTATS_FAILURE()
+#define OPSTATS_RETRY(n)
+#define OPSTATS_EMITTED(drops)
+#define OPSTATS_END()
+#endif
+
+#endif
@@ -0,0 +1,212 @@
+/**
+ * Outbox for failed emitted payments
+ *
+ * Amounts owed are aggregated per account in one record holding one uint64
+ * per currency index (drops for XRP, 1e-6 units for IOUs). Every record is
+ * also queued so an operator action can flush the outbox in bounded pages.
+ *
+ * State layout (all keys end with "OBX" + tag):
+ *   record  accid | 0.. | OBXR  ->  queue seq (8) | amount * OUTBOX_CURRENCIES
+ *   queue   seq   | 0.. | OBXQ  ->  accid (20)
+ *   meta    0..         | OBXM  ->  head (8) | tail (8)
+ *
+ * An owed account holds two state entries (record and queue entry), plus the
+ * meta entry shared by all of them. The macros report how many entries they
+ * created or deleted so hooks that count their state can keep it exact.
+ *
+ * Define OUTBOX_CURRENCIES, OUTBOX_FLUSH_PAGE and OUTBOX_FLUSH_SCAN before
+ * including to override.
+ */
+
+#include <stdint.h>
+#include "hookapi.h"
+
+#ifndef OUTBOX_INCLUDED
+#define OUTBOX_INCLUDED 1
+
+#ifndef OUTBOX_CURRENCIES
+#define OUTBOX_CURRENCIES 1
+#endif
+#ifndef OUTBOX_FLUSH_PAGE
+#define OUTBOX_FLUSH_PAGE 2
+#endif
+#ifndef OUTBOX_FLUSH_SCAN
+#define OUTBOX_FLUSH_SCAN (4 * OUTBOX_FLUSH_PAGE)
+#endif
+
+#define OUTBOX_RECORD_SIZE (8 + 8 * OUTBOX_CURRENCIES)
+#define OUTBOX_QUEUE_SIZE 20
+#define OUTBOX_META_SIZE 16
+
+#define OUTBOX_KEY_TAG(key, tag) \
+    {                            \
+        (key)[28] = 'O';         \
+        (key)[29] = 'B';         \
+        (key)[30] = 'X';         \
+        (key)[31] = tag;         \
+    }
+
+#define OUTBOX_RECORD_KEY(key, account)                            \
+    {                                                              \
+        *(uint64_t *)((key) + 0) = *(uint64_t *)((account) + 0);   \
+        *(uint64_t *)((key) + 8) = *(uint64_t *)((account) + 8);   \
+        *(uint32_t *)((key) + 16) = *(uint32_t *)((account) + 16); \
+        *(uint32_t *)((key) + 20) = 0;                             \
+        *(uint32_t *)((key) + 24) = 0;                             \
+        OUTBOX_KEY_TAG(key, 'R');                                  \
+    }
+
+#define OUTBOX_QUEUE_KEY(key, seq)     \
+    {                                  \
+        UINT64_TO_BUF(key, seq);       \
+        *(uint64_t *)((key) + 8) = 0;  \
+        *(uint64_t *)((key) + 16) = 0; \
+        *(uint32_t *)((key) + 24) = 0; \
+        OUTBOX_KEY_TAG(key, 'Q');      \
+    }
+
+#define OUTBOX_META_KEY(key)           \
+    {                                  \
+        *(uint64_t *)((key) + 0) = 0;  \
+        *(uint64_t *)((key) + 8) = 0;  \
+        *(uint64_t *)((key) + 16) = 0; \
+        *(uint32_t *)((key) + 24) = 0; \
+        OUTBOX_KEY_TAG(key, 'M');      \
+    }
+
+// adds amount to what account is owed in currency
+// created is set to the number of state entries added: 0 when the account had a
+// record, 2 for a new record and its queue entry, 3 when the meta entry is new too
+#define OUTBOX_ADD(account, currency, amount, created)                                                      \
+    {                                                                                                       \
+        uint8_t ob_key[32];                                                                                 \
+        uint8_t ob_record[OUTBOX_RECORD_SIZE];                                                              \
+        OUTBOX_RECORD_KEY(ob_key, account);                                                                 \
+        created = state(SBUF(ob_record), SBUF(ob_key)) == OUTBOX_RECORD_SIZE ? 0 : 2;                       \
+        if (created)                                                                                        \
+        {                                                                                                   \
+            uint8_t ob_meta_key[32];                                                                        \
+            uint8_t ob_meta[OUTBOX_META_SIZE];                                                              \
+            OUTBOX_META_KEY(ob_meta_key);                                                                   \
+            if (state(SBUF(ob_meta), SBUF(ob_meta_key)) != OUTBOX_META_SIZE)                                \
+            {                                                                                               \
+                *(uint64_t *)(ob_meta + 0) = 0;                                                             \
+                *(uint64_t *)(ob_meta + 8) = 0;                                                             \
+                ++created;                                                                                  \
+            }                                                                                               \
+            uint64_t ob_tail = UINT64_FROM_BUF(ob_meta + 8);                                                \
+            uint8_t ob_queue_key[32];                                                                       \
+            OUTBOX_QUEUE_KEY(ob_queue_key, ob_tail);                                                        \
+            if (state_set((uint32_t)(account), OUTBOX_QUEUE_SIZE, SBUF(ob_queue_key)) != OUTBOX_QUEUE_SIZE) \
+                rollback(SBUF("Outbox: could not write queue entry"), INTERNAL_ERROR);                      \
+            UINT64_TO_BUF(ob_record, ob_tail);                                                              \
+            for (int ob_c = 0; GUARDM(OUTBOX_CURRENCIES, 1), ob_c < OUTBOX_CURRENCIES; ++ob_c)              \
+                *(uint64_t *)(ob_record + 8 + 8 * ob_c) = 0;                                                \
+            ++ob_tail;                                                                                      \
+            UINT64_TO_BUF(ob_meta + 8, ob_tail);                                                            \
+            if (state_set(SBUF(ob_meta), SBUF(ob_meta_key)) != OUTBOX_META_SIZE)                            \
+                rollback(SBUF("Outbox: could not write meta"), INTERNAL_ERROR);                             \
+        }                                                                                                   \
+        uint8_t *ob_amount = ob_record + 8 + 8 * (currency);                                                \
+        uint64_t ob_owed = UINT64_FROM_BUF(ob_amount) + (amount);                                           \
+        UINT64_TO_BUF(ob_amount, ob_owed);                                                                  \
+        if (state_set(SBUF(ob_record), SBUF(ob_key)) != OUTBOX_RECORD_SIZE)                                 \
+            rollback(SBUF("Outbox: could not write record"), INTERNAL_ERROR);                               \
+    }
+
+// moves everything account is owed into amounts_out[OUTBOX_CURRENCIES] and
+// deletes the record, freed is set to the number of state entries deleted: 0
+// when account has no record, 2 for the record and its queue entry, 3 when the
+// queue drains and the meta entry goes too. A taken entry at either end of the
+// queue shrinks it, one in the middle leaves a hole for OUTBOX_FLUSH to skip
+#define OUTBOX_TAKE(account, amounts_out, freed)                                                              \
+    {                                                                                                         \
+        uint8_t ob_key[32];                                                                                   \
+        uint8_t ob_record[OUTBOX_RECORD_SIZE];                                                                \
+        OUTBOX_RECORD_KEY(ob_key, account);                                                                   \
+        freed = state(SBUF(ob_record), SBUF(ob_key)) == OUTBOX_RECORD_SIZE ? 2 : 0;                           \
+        if (freed)                                                                                            \
+        {                                                                                                     \
+            for (int ob_c = 0; GUARDM(OUTBOX_CURRENCIES, 1), ob_c < OUTBOX_CURRENCIES; ++ob_c)                \
+                (amounts_out)[ob_c] = UINT64_FROM_BUF(ob_record + 8 + 8 * ob_c);                              \
+            uint64_t ob_seq = UINT64_FROM_BUF(ob_record);                                                     \
+            uint8_t ob_queue_key[32];                                                                         \
+            OUTBOX_QUEUE_KEY(ob_queue_key, ob_seq);                                                           \
+            if (state_set(0, 0, SBUF(ob_queue_key)) < 0 || state_set(0, 0, SBUF(ob_key)) < 0)                 \
+                rollback(SBUF("Outbox: could not delete record"), INTERNAL_ERROR);                            \
+            uint8_t ob_meta_key[32];                                                                          \
+            uint8_t ob_meta[OUTBOX_META_SIZE];                                                                \
+            OUTBOX_META_KEY(ob_meta_key);                                                                     \
+            if (state(SBUF(ob_meta), SBUF(ob_meta_key)) == OUTBOX_META_SIZE)                                  \
+            {                                                                                                 \
+                uint64_t ob_head = UINT64_FROM_BUF(ob_meta);                                                  \
+                uint64_t ob_tail = UINT64_FROM_BUF(ob_meta + 8);                                              \
+                if (ob_seq == ob_head || ob_seq + 1 == ob_tail)                                               \
+                {                                                                                             \
+                    ob_head += ob_seq == ob_head ? 1 : 0;                                                     \
+                    ob_tail -= ob_seq + 1 == ob_tail && ob_head < ob_tail ? 1 : 0;                            \
+                    UINT64_TO_BUF(ob_meta, ob_head);                                                          \
+                    UINT64_TO_BUF(ob_meta + 8, ob_tail);                                                      \
+                    if (ob_head >= ob_tail ? state_set(0, 0, SBUF(ob_meta_key)) < 0                           \
+                                           : state_set(SBUF(ob_meta), SBUF(ob_meta_key)) != OUTBOX_META_SIZE) \
+                        rollback(SBUF("Outbox: could not write meta"), INTERNAL_ERROR);                       \
+                    freed += ob_head >= ob_tail ? 1 : 0;                                                      \
+                }                                                                                             \
+            }                                                                                                 \
+        }                                                                                                     \
+    }
+
+// pays out up to OUTBOX_FLUSH_PAGE accounts from the head of the queue, every
+// account still owed something is copied to accounts_out[n][20] /
+// amounts_out[n][OUTBOX_CURRENCIES] and its record deleted. Holes left by
+// OUTBOX_TAKE are skipped without taking a page slot, at most OUTBOX_FLUSH_SCAN
+// queue positions are visited. passed is set to the number of positions the
+// head moved, 0 only when the queue is empty, so a call that found nothing but
+// holes still has progress to keep. freed is set to the number of state
+// entries deleted, the meta entry included once the queue is empty
+#define OUTBOX_FLUSH(accounts_out, amounts_out, n_out, passed, freed)                                          \
+    {                                                                                                          \
+        uint8_t ob_meta_key[32];                                                                               \
+        uint8_t ob_meta[OUTBOX_META_SIZE];                                                                     \
+        OUTBOX_META_KEY(ob_meta_key);                                                                          \
+        n_out = 0;                                                                                             \
+        passed = 0;                                                                                            \
+        freed = 0;                                                                                             \
+        if (state(SBUF(ob_meta), SBUF(ob_meta_key)) == OUTBOX_META_SIZE)                                       \
+        {                                                                                                      \
+            uint64_t ob_head = UINT64_FROM_BUF(ob_meta);                                                       \
+            uint64_t ob_tail = UINT64_FROM_BUF(ob_meta + 8);                                                   \
+            for (int ob_s = 0; GUARDM(OUTBOX_FLUSH_SCAN, 1),                                                   \
+                     ob_s < OUTBOX_FLUSH_SCAN && n_out < OUTBOX_FLUSH_PAGE && ob_head < ob_tail;               \
+                 ++ob_s, ++ob_head, ++passed)                                                                  \
+            {                                                                                                  \
+                uint8_t ob_queue_key[32];                                                                      \
+                OUTBOX_QUEUE_KEY(ob_queue_key, ob_head);                                                       \
+                uint8_t *ob_account = (accounts_out)[n_out];                                                   \
+                if (state((uint32_t)ob_account, OUTBOX_QUEUE_SIZE, SBUF(ob_queue_key)) != OUTBOX_QUEUE_SIZE)   \
+                    continue;                                                                                  \
+                if (state_set(0, 0, SBUF(ob_queue_key)) < 0)                                                   \
+                    rollback(SBUF("Outbox: could not delete queue entry"), INTERNAL_ERROR);                    \
+                ++freed;                                                                                       \
+                uint8_t ob_key[32];                                                                            \
+                uint8_t ob_record[OUTBOX_RECORD_SIZE];                                                         \
+                OUTBOX_RECORD_KEY(ob_key, ob_account);                                                         \
+                if (state(SBUF(ob_record), SBUF(ob_key)) != OUTBOX_RECORD_SIZE)                                \
+                    continue;                                                                                  \
+                for (int ob_c = 0; GUARDM(OUTBOX_FLUSH_SCAN * OUTBOX_CURRENCIES, 2), ob_c < OUTBOX_CURRENCIES; \
+                     ++ob_c)                                                                                   \
+                    (amounts_out)[n_out][ob_c] = UINT64_FROM_BUF(ob_record + 8 + 8 * ob_c);                    \
+                if (state_set(0, 0, SBUF(ob_key)) < 0)                                                         \
+                    rollback(SBUF("Outbox: could not delete record"), INTERNAL_ERROR);                         \
+                ++freed;                                                                                       \
+                ++n_out;                                                                                       \
+            }                                                                                                  \
+            UINT64_TO_BUF(ob_meta, ob_head);                                                                   \
+            if (ob_head >= ob_tail ? state_set(0, 0, SBUF(ob_meta_key)) < 0                                    \
+                                   : state_set(SBUF(ob_meta), SBUF(ob_meta_key)) != OUTBOX_META_SIZE)          \
+                rollback(SBUF("Outbox: could not write meta"), INTERNAL_ERROR);                                \
+            freed += ob_head >= ob_tail ? 1 : 0;                                                               \
+        }                                                                                                      \
+    }
+
+#endif
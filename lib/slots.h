@@ -0,0 +1,64 @@
+/**
+ * Slot recycling
+ *
+ * Every slot_subfield/slot_subarray call with new_slot 0 takes a fresh slot from
+ * the host. Scans that slot per iteration run out of slots on large metadata, so
+ * these helpers keep a scratch slot number per temporary and pass it back as
+ * new_slot: the first successful call allocates it, every later call overwrites it.
+ * On failure the scratch slot is left as it was and result holds the error.
+ *
+ * Build with -DSLOT_STATS (native runs against a host implementation of extern.h)
+ * to record the highest slot number handed out in slot_high_water.
+ */
+
+#include <stdint.h>
+#include "hookapi.h"
+
+#ifndef SLOTS_INCLUDED
+#define SLOTS_INCLUDED 1
+
+#ifdef SLOT_STATS
+int64_t slot_high_water = 0;
+#define SLOT_TRACK(s)              \
+    {                              \
+        if ((s) > slot_high_water) \
+            slot_high_water = (s); \
+    }
+#define SLOT_REPORT() \
+    trace_num(SBUF("Slot high water"), slot_high_water);
+#else
+#define SLOT_TRACK(s)
+#define SLOT_REPORT()
+#endif
+
+#define SLOT_SUBFIELD_INTO(result, scratch, parent, field)          \
+    {                                                               \
+        result = slot_subfield((uint32_t)(parent), field, scratch); \
+        if (result > 0)                                             \
+        {                                                           \
+            scratch = (uint32_t)result;                             \
+            SLOT_TRACK(result);                                     \
+        }                                                           \
+    }
+
+#define SLOT_SUBARRAY_INTO(result, scratch, parent, index)          \
+    {                                                               \
+        result = slot_subarray((uint32_t)(parent), index, scratch); \
+        if (result > 0)                                             \
+        {                                                           \
+            scratch = (uint32_t)result;                             \
+            SLOT_TRACK(result);                                     \
+        }                                                           \
+    }
+
+// hands a scratch slot back to the host once the temporary is no longer needed
+#define SLOT_RELEASE(scratch)    \
+    {                            \
+        if (scratch > 0)         \
+        {                        \
+            slot_clear(scratch); \
+            scratch = 0;         \
+        }                        \
+    }
+
+#endif
@@ -17,9 +17,14 @@
  */
 
 #define HAS_CALLBACK
+#define OUTBOX_CURRENCIES MAX_CURRENCIES
+#define OUTBOX_FLUSH_PAGE 2
 
 #include <stdint.h>
 #include "hookapi.h"
+#include "opstats.h"
+#include "outbox.h"
+#include "slots.h"
 
 // Instead of PREPARE_PAYMENT_SIMPLE_TRUSTLINE_LOOP
 #undef ENCODE_TL
@@ -38,10 +43,17 @@
 
 #define MAX_MEMO_SIZE 4096
 #define STATE_DATA_SIZE 85
+// MemoData, text/plain:
+//   make            action '1' | role | loan currency (3) | loan amount (20) | collateral currency (3)
+//                   | collateral amount (20) | interest (5) | period (5)
+//   cancel .. close action | loan ID (64 hex)
+//   resend          action '6', or '6' | ID (64 hex) of a failed tx record stored before the outbox
+//   flush           action '7'
 #define MEMO_DATA_SIZE_OPEN 58
 #define MEMO_DATA_SIZE 65
+#define MEMO_DATA_SIZE_OUTBOX 1
 #define MAX_CURRENCIES 6
-#define MAX_TRANSACTIONS 3
+#define MAX_TRANSACTIONS (OUTBOX_FLUSH_PAGE * MAX_CURRENCIES)
 #define MAX_STATES 1000
 #define STATE_COUNTER_KEY_END 7
 #define FEE_STATE_KEY_END 8
@@ -77,32 +89,14 @@
 
 int64_t cbak(uint32_t reserved)
 {
-    // Originating tx
-    int64_t oslot = otxn_slot(0);
-    if (oslot < 0)
-        rollback(SBUF("Loan CB: Could not slot originating txn."), NO_FREE_SLOTS);
-
-    // Add fee paid
-    uint8_t fee_state_key[KEY_SIZE];
-    fee_state_key[31] = FEE_STATE_KEY_END;
-    int8_t fee_state_data[8];
-    int64_t fee_slot = slot_subfield(oslot, sfFee, 0);
-    if (fee_slot < 0)
-        rollback(SBUF("Loan CB: Could not slot otxn.sfFee"), NO_FREE_SLOTS);
-    int64_t fee = slot_float(fee_slot);
-    state(SBUF(fee_state_data), SBUF(fee_state_key));
-    int64_t fee_sum = float_sto_set(SBUF(fee_state_data));
-    fee_sum = float_sum(fee_sum, fee);
-    if (float_sto(SBUF(fee_state_data), 0, 0, 0, 0, fee_sum, -1) < 0)
-        rollback(SBUF("Loan CB: Could not dump fee_sum into sto"), NOT_AN_AMOUNT);
-    if (state_set(SBUF(fee_state_data), SBUF(fee_state_key)) != 8)
-        rollback(SBUF("Loan CB: could not write fee_state"), INTERNAL_ERROR);
-
-    // Tx result
+    OPSTATS_BEGIN();
+    // Tx result, fees are booked on emission so only failures need work
+    uint32_t field_slot = 0;
     int64_t mslot = meta_slot(0);
     if (mslot < 0)
         rollback(SBUF("Loan CB: Could not slot meta data."), NO_FREE_SLOTS);
-    int64_t tx_slot = slot_subfield(mslot, sfTransactionResult, 0);
+    int64_t tx_slot;
+    SLOT_SUBFIELD_INTO(tx_slot, field_slot, mslot, sfTransactionResult);
     if (tx_slot < 0)
         rollback(SBUF("Loan CB: Could not slot meta.sfTransactionResult"), NO_FREE_SLOTS);
     uint8_t res_buffer[1];
@@ -110,62 +104,79 @@ int64_t cbak(uint32_t reserved)
     TRACEHEX(res_buffer);
     if (res_buffer[0] == 0)
         accept(SBUF("Loan CB: Emitted Tx was tesSUCCESS."), 1);
+    slot_clear(mslot);
 
-    // Failed Tx
-    uint8_t failed_state_key[KEY_SIZE];
-    ledger_nonce(SBUF(failed_state_key));
-    failed_state_key[31] = FAILED_STATE_KEY_END;
-    uint8_t failed_state_data[STATE_DATA_SIZE];
-    uint8_t *failed_state_data_ptr = failed_state_data;
+    // Originating tx, takes the slot the meta data held
+    int64_t oslot = otxn_slot(0);
+    if (oslot < 0)
+        rollback(SBUF("Loan CB: Could not slot originating txn."), NO_FREE_SLOTS);
+
+    // Failed Tx, the amount is owed to the receiver
     uint8_t destination_accid[ACCID_SIZE];
     int32_t destination_accid_len = otxn_field(SBUF(destination_accid), sfDestination);
     if (destination_accid_len < ACCID_SIZE)
         rollback(SBUF("Loan CB: sfDestination field missing."), DOESNT_EXIST);
-    int64_t amt_slot = slot_subfield(oslot, sfAmount, 0);
+    int64_t amt_slot;
+    SLOT_SUBFIELD_INTO(amt_slot, field_slot, oslot, sfAmount);
     if (amt_slot < 0)
         rollback(SBUF("Loan CB: Could not slot otxn.sfAmount"), NO_FREE_SLOTS);
-    uint8_t otxn_buffer[48];
-    slot(SBUF(otxn_buffer), amt_slot);
+    int64_t amt = slot_float(amt_slot);
+    if (amt < 0)
+        rollback(SBUF("Loan CB: Could not parse amount."), PARSE_ERROR);
     int64_t is_xrp = slot_type(amt_slot, 1);
     if (is_xrp < 0)
         rollback(SBUF("Loan CB: Could not determine sent amount type"), PARSE_ERROR);
-    for (int i = 0; GUARD(ACCID_SIZE), i < ACCID_SIZE; i++)
-        failed_state_data[i] = destination_accid[i];
-    failed_state_data[20] = is_xrp == 1 ? 1 : 0;
-    if (is_xrp == 1)
+
+    // Currency index, IOUs emitted by this version carry it as source tag,
+    // those of the previous version have no tag and are looked up by code
+    uint32_t currency = 0;
+    if (is_xrp != 1)
     {
-        int64_t amt = slot_float(amt_slot);
-        if (amt < 0)
-            rollback(SBUF("Loan: Could not parse amount."), PARSE_ERROR);
-        if (float_sto((failed_state_data_ptr + 21), 8, 0, 0, 0, 0, amt, -1) != 8)
-            rollback(SBUF("Loan CB: Could not dump sfAmount-XRP"), NOT_AN_AMOUNT);
+        uint8_t src_tag_buf[4];
+        if (otxn_field(SBUF(src_tag_buf), sfSourceTag) == 4)
+            currency = UINT32_FROM_BUF(src_tag_buf);
+        if (currency == 0 || currency >= MAX_CURRENCIES)
+        {
+            uint8_t amount_buffer[48];
+            if (slot(SBUF(amount_buffer), amt_slot) < 48)
+                rollback(SBUF("Loan CB: Could not dump sfAmount"), NOT_AN_AMOUNT);
+            // the ISO code sits at bytes 12..14 of the currency after the 8 byte amount
+            uint8_t codes[] = "XRPGBPEURUSDCHFCNH";
+            currency = 0;
+            for (int c = 1; GUARD(MAX_CURRENCIES), c < MAX_CURRENCIES && currency == 0; ++c)
+                if (amount_buffer[20] == codes[3 * c] && amount_buffer[21] == codes[3 * c + 1] &&
+                    amount_buffer[22] == codes[3 * c + 2])
+                    currency = c;
+            if (currency == 0)
+                rollback(SBUF("Loan CB: IOU not supported."), INVALID_ARGUMENT);
+        }
     }
-    else
+    SLOT_REPORT();
+    uint8_t created = 0;
+    OUTBOX_ADD(destination_accid, currency, float_int(amt, 6, 0), created);
+    OPSTATS_FAILURE();
+
+    // Amount of stored states, the outbox entries it created
+    if (created)
     {
-        if (slot((failed_state_data_ptr + 21), 48, amt_slot) != 48)
-            rollback(SBUF("Loan CB: Could not dump sfAmount-IOU"), NOT_AN_AMOUNT);
+        uint8_t state_counter_key[KEY_SIZE];
+        state_counter_key[31] = STATE_COUNTER_KEY_END;
+        uint8_t state_counter_data[8];
+        state(SBUF(state_counter_data), SBUF(state_counter_key));
+        uint64_t state_counter = UINT64_FROM_BUF(state_counter_data) + created;
+        UINT64_TO_BUF(state_counter_data, state_counter);
+        if (state_set(SBUF(state_counter_data), SBUF(state_counter_key)) != 8)
+            rollback(SBUF("Loan CB: could not write state_counter"), INTERNAL_ERROR);
     }
 
-    if (state_set(SBUF(failed_state_data), SBUF(failed_state_key)) != STATE_DATA_SIZE)
-        rollback(SBUF("Loan CB: could not write state"), INTERNAL_ERROR);
-
-    // Amount of stored states
-    uint8_t state_counter_key[KEY_SIZE];
-    state_counter_key[31] = STATE_COUNTER_KEY_END;
-    uint8_t state_counter_data[8];
-    state(SBUF(state_counter_data), SBUF(state_counter_key));
-    uint64_t state_counter = UINT64_FROM_BUF(state_counter_data);
-    ++state_counter;
-    UINT64_TO_BUF(state_counter_data, state_counter);
-    if (state_set(SBUF(state_counter_data), SBUF(state_counter_key)) != 8)
-        rollback(SBUF("Loan CB: could not write state_counter"), INTERNAL_ERROR);
-
+    OPSTATS_END();
     accept(SBUF("Loan CB: Stored failed Tx."), 1);
     return 0;
 }
 
 int64_t hook(uint32_t reserved)
 {
+    OPSTATS_BEGIN();
     enum OfferState
     {
         waiting = 1,
@@ -183,7 +194,8 @@ int64_t hook(uint32_t reserved)
         take = 3,
         repay = 4,
         close = 5,
-        resend = 6
+        resend = 6,
+        flush = 7
     };
     enum Role
     {
@@ -222,6 +234,7 @@ int64_t hook(uint32_t reserved)
     {
         uint8_t *receiver;
         uint8_t currency;
+        uint8_t callback;
         uint64_t amount;
     };
     struct tx txs[MAX_TRANSACTIONS];
@@ -244,12 +257,17 @@ int64_t hook(uint32_t reserved)
     uint64_t interest = 0;
     uint64_t timestamp_end = 0;
     uint64_t fee = 0;
+    uint64_t emitted_fee = 0;
+    uint8_t failed_record = 0;
 
     uint8_t state_counter_key[KEY_SIZE];
     state_counter_key[31] = STATE_COUNTER_KEY_END;
     uint8_t state_counter_data[8];
     state(SBUF(state_counter_data), SBUF(state_counter_key));
     uint64_t state_counter = UINT64_FROM_BUF(state_counter_data);
+    uint8_t fee_state_key[KEY_SIZE];
+    fee_state_key[31] = FEE_STATE_KEY_END;
+    int8_t fee_state_data[8];
 
     unsigned char hook_accid[ACCID_SIZE];
     hook_account((uint32_t)hook_accid, ACCID_SIZE);
@@ -323,13 +341,17 @@ int64_t hook(uint32_t reserved)
     uint8_t *data_ptr = SUB_OFFSET(data_lookup) + memo_ptr;
     uint32_t data_len = SUB_LENGTH(data_lookup);
     action = data_ptr[MEMO_ACTION_OFFSET] - '0';
-    if (action < make || action > resend)
+    if (action < make || action > flush)
         rollback(SBUF("Loan: Invalid action."), OUT_OF_BOUNDS);
-    if ((action == make && data_len != MEMO_DATA_SIZE_OPEN) || (action != make && data_len != MEMO_DATA_SIZE))
+    if ((action == make && data_len != MEMO_DATA_SIZE_OPEN) ||
+        (action > make && action < resend && data_len != MEMO_DATA_SIZE) ||
+        (action == resend && data_len != MEMO_DATA_SIZE && data_len != MEMO_DATA_SIZE_OUTBOX) ||
+        (action == flush && data_len != MEMO_DATA_SIZE_OUTBOX))
         rollback(SBUF("Loan: Invalid memo data length."), TOO_BIG);
+    OPSTATS_ACTION(action);
 
-    // Parse memo if not "make"
-    if (action != make)
+    // Parse the ID of the offer, or of the failed tx record to resend
+    if (data_len == MEMO_DATA_SIZE)
     {
         int x = 0;
         for (int i = 0; GUARD(KEY_SIZE), i < KEY_SIZE && x < KEY_SIZE * 2; ++i)
@@ -337,9 +359,13 @@ int64_t hook(uint32_t reserved)
             loan_id[i] = ((data_ptr[x + 1] - (data_ptr[x + 1] >= 65 ? '7' : '0')) * 16) + (data_ptr[x + 2] - (data_ptr[x + 2] >= 65 ? '7' : '0'));
             x += 2;
         }
-        if (state(SBUF(state_data), SBUF(loan_id)) != STATE_DATA_SIZE)
+        int64_t loan_len = state(SBUF(state_data), SBUF(loan_id));
+        if (loan_len != STATE_DATA_SIZE)
             rollback(SBUF("Loan: Loan does not exist"), DOESNT_EXIST);
-        if (loan_id[31] == 0)
+        failed_record = action == resend;
+        if (failed_record && loan_id[31] != FAILED_STATE_KEY_END)
+            rollback(SBUF("Loan: No failed tx record."), DOESNT_EXIST);
+        if (!failed_record && loan_id[31] == 0)
         {
             role = state_data_ptr[ROLE_OFFSET];
             if (role < borrower || role > lender)
@@ -469,12 +495,10 @@ int64_t hook(uint32_t reserved)
         txs[0].receiver = earnings_accid;
         txs[0].amount = fee;
         txs[0].currency = role == borrower ? collateral_currency : loan_currency;
+        txs[0].callback = 0;
         txq = 1;
         if (txs[0].currency == 0)
         {
-            uint8_t fee_state_key[KEY_SIZE];
-            fee_state_key[31] = FEE_STATE_KEY_END;
-            int8_t fee_state_data[8];
             state(SBUF(fee_state_data), SBUF(fee_state_key));
             int64_t fee_sum = float_sto_set(SBUF(fee_state_data));
             if (float_compare(fee_sum, float_set(6, 10), COMPARE_GREATER) == 1)
@@ -514,6 +538,7 @@ int64_t hook(uint32_t reserved)
         collateral_amount = UINT64_FROM_BUF(state_data_ptr + (role == borrower ? COLLATERAL_AMOUNT_OFFSET : LOAN_AMOUNT_OFFSET));
         txs[0].amount = collateral_amount;
         txs[0].currency = state_data_ptr[(role == borrower ? COLLATERAL_CURRENCY_OFFSET : LOAN_CURRENCY_OFFSET)];
+        txs[0].callback = 1;
         txq = 1;
         if (state_set(0, 0, SBUF(loan_id)) < 0)
             rollback(SBUF("Loan: Could not reset loan"), INTERNAL_ERROR);
@@ -554,6 +579,7 @@ int64_t hook(uint32_t reserved)
         txs[0].receiver = role == borrower ? maker_accid : sender_accid;
         txs[0].amount = UINT64_FROM_BUF(state_data_ptr + LOAN_AMOUNT_OFFSET);
         txs[0].currency = state_data_ptr[LOAN_CURRENCY_OFFSET];
+        txs[0].callback = 1;
         txq = 1;
 
         TRACESTR("Loan: Take");
@@ -588,12 +614,15 @@ int64_t hook(uint32_t reserved)
         txs[0].receiver = role == borrower ? maker_accid : taker_accid;
         txs[0].amount = collateral_amount - interest;
         txs[0].currency = state_data_ptr[COLLATERAL_CURRENCY_OFFSET];
+        txs[0].callback = 1;
         txs[1].receiver = role == borrower ? taker_accid : maker_accid;
         txs[1].amount = interest;
         txs[1].currency = state_data_ptr[COLLATERAL_CURRENCY_OFFSET];
+        txs[1].callback = 1;
         txs[2].receiver = role == borrower ? taker_accid : maker_accid;
         txs[2].amount = loan_amount;
         txs[2].currency = state_data_ptr[LOAN_CURRENCY_OFFSET];
+        txs[2].callback = 1;
         txq = 3;
 
         if (state_set(0, 0, SBUF(loan_id)) < 0)
@@ -628,6 +657,7 @@ int64_t hook(uint32_t reserved)
         txs[0].receiver = role == borrower ? taker_accid : maker_accid;
         txs[0].amount = UINT64_FROM_BUF(state_data_ptr + COLLATERAL_AMOUNT_OFFSET);
         txs[0].currency = state_data_ptr[COLLATERAL_CURRENCY_OFFSET];
+        txs[0].callback = 1;
         txq = 1;
 
         if (state_set(0, 0, SBUF(loan_id)) < 0)
@@ -636,45 +666,107 @@ int64_t hook(uint32_t reserved)
         TRACESTR("Loan: Close");
         break;
     case resend:
-        // Resend failed tx
-        state_counter -= state_counter > 0 ? 1 : 0;
+        // Resend failed tx(s)
+        if (amount_in > 1000000)
+            rollback(SBUF("Loan: Too much currency sent!"), TOO_BIG);
+        if (failed_record)
+        {
+            // Record stored by cbak before the outbox
+            for (int i = 0; GUARD(ACCID_SIZE), i < ACCID_SIZE; ++i)
+                maker_accid[i] = state_data_ptr[i];
+            txs[0].receiver = maker_accid;
+            uint64_t a = float_sto_set((state_data_ptr + 21), 8);
+            txs[0].amount = float_int(a, 6, 0);
+            if (state_data[20] == 1)
+                txs[0].currency = 0;
+            else
+            {
+                equal = 0;
+                int c;
+                for (c = 0; GUARD(MAX_CURRENCIES), c < MAX_CURRENCIES && equal != 1; ++c)
+                    BUFFER_EQUAL_GUARD(equal, state_data_ptr + 29, ACCID_SIZE, currencies[c], ACCID_SIZE, MAX_CURRENCIES);
+                if (equal == 1)
+                    txs[0].currency = c - 1;
+                else
+                    rollback(SBUF("Loan: IOU not supported."), INVALID_ARGUMENT);
+            }
+            txs[0].callback = 1;
+            txq = 1;
+            if (state_set(0, 0, SBUF(loan_id)) < 0)
+                rollback(SBUF("Loan: Could not reset loan"), INTERNAL_ERROR);
+            state_counter -= state_counter > 0 ? 1 : 0;
+        }
+        else
+        {
+            // Everything owed to the sender, one tx per currency
+            uint64_t owed[MAX_CURRENCIES];
+            uint8_t outbox_freed = 0;
+            OUTBOX_TAKE(sender_accid, owed, outbox_freed);
+            if (outbox_freed == 0)
+                rollback(SBUF("Loan: No open payments."), DOESNT_EXIST);
+            state_counter -= state_counter > outbox_freed ? outbox_freed : state_counter;
+            for (int c = 0; GUARD(MAX_CURRENCIES), c < MAX_CURRENCIES; ++c)
+            {
+                if (owed[c] == 0)
+                    continue;
+                txs[txq].receiver = sender_accid;
+                txs[txq].amount = owed[c];
+                txs[txq].currency = c;
+                txs[txq].callback = 1;
+                ++txq;
+            }
+        }
         UINT64_TO_BUF(state_counter_data, state_counter);
         if (state_set(SBUF(state_counter_data), SBUF(state_counter_key)) != 8)
             rollback(SBUF("Loan: could not write state_counter"), INTERNAL_ERROR);
+        OPSTATS_RETRY(txq);
+
+        TRACESTR("Loan: Resend");
+        break;
+    case flush:
+        // Operator pays out one page of the outbox
+        equal = 0;
+        BUFFER_EQUAL(equal, sender_accid, earnings_accid, ACCID_SIZE);
+        if (equal != 1)
+            rollback(SBUF("Loan: Only the operator can flush the outbox"), INVALID_ARGUMENT);
         if (amount_in > 1000000)
             rollback(SBUF("Loan: Too much currency sent!"), TOO_BIG);
-        for (int i = 0; GUARD(ACCID_SIZE), i < ACCID_SIZE; ++i)
-            maker_accid[i] = state_data_ptr[i];
-
-        // Prepare tx
-        txs[0].receiver = maker_accid;
-        uint64_t a = float_sto_set((state_data_ptr + 21), 8);
-        txs[0].amount = float_int(a, 6, 0);
-        if (state_data[20] == 1)
-            txs[0].currency = 0;
-        else
+        uint8_t outbox_accids[OUTBOX_FLUSH_PAGE][ACCID_SIZE];
+        uint64_t outbox_owed[OUTBOX_FLUSH_PAGE][MAX_CURRENCIES];
+        uint8_t outbox_n = 0;
+        uint8_t outbox_passed = 0;
+        uint8_t outbox_freed = 0;
+        OUTBOX_FLUSH(outbox_accids, outbox_owed, outbox_n, outbox_passed, outbox_freed);
+        // a page of holes still moves the head, so it is kept even with nothing to emit
+        if (outbox_passed == 0)
+            rollback(SBUF("Loan: Outbox is empty."), DOESNT_EXIST);
+        for (int p = 0; GUARD(OUTBOX_FLUSH_PAGE), p < outbox_n; ++p)
         {
-            equal = 0;
-            int c;
-            for (c = 0; GUARD(MAX_CURRENCIES), c < MAX_CURRENCIES && equal != 1; ++c)
-                BUFFER_EQUAL_GUARD(equal, state_data_ptr + 29, ACCID_SIZE, currencies[c], ACCID_SIZE, MAX_CURRENCIES);
-            if (equal == 1)
-                txs[0].currency = c - 1;
-            else
-                rollback(SBUF("Loan: IOU not supported."), INVALID_ARGUMENT);
+            for (int c = 0; GUARD(OUTBOX_FLUSH_PAGE * MAX_CURRENCIES), c < MAX_CURRENCIES; ++c)
+            {
+                if (outbox_owed[p][c] == 0)
+                    continue;
+                txs[txq].receiver = outbox_accids[p];
+                txs[txq].amount = outbox_owed[p][c];
+                txs[txq].currency = c;
+                txs[txq].callback = 1;
+                ++txq;
+            }
         }
-        txq = 1;
-        if (state_set(0, 0, SBUF(loan_id)) < 0)
-            rollback(SBUF("Loan: Could not reset loan"), INTERNAL_ERROR);
+        state_counter -= state_counter > outbox_freed ? outbox_freed : state_counter;
+        UINT64_TO_BUF(state_counter_data, state_counter);
+        if (state_set(SBUF(state_counter_data), SBUF(state_counter_key)) != 8)
+            rollback(SBUF("Loan: could not write state_counter"), INTERNAL_ERROR);
+        OPSTATS_RETRY(txq);
 
-        TRACESTR("Loan: Resend");
+        TRACESTR("Loan: Flush");
         break;
     default:
         rollback(SBUF("Loan: Switch default..."), INVALID_ARGUMENT);
         break;
     }
 
-    // Submit tx(s)
+    // Submit tx(s), the source tag carries the currency index for cbak
     etxn_reserve(txq);
     uint8_t emithash[KEY_SIZE];
     for (int i = 0; GUARD(MAX_TRANSACTIONS), i < txq; ++i)
@@ -682,10 +774,12 @@ int64_t hook(uint32_t reserved)
         if (txs[i].currency == 0) // Send XRP
         {
             unsigned char tx[PREPARE_PAYMENT_SIMPLE_SIZE];
-            PREPARE_PAYMENT_SIMPLE(tx, txs[i].amount, txs[i].receiver, 10 + i, 0);
-            int64_t e = emit(SBUF(emithash), SBUF(tx));
+            PREPARE_PAYMENT_SIMPLE_CB(tx, txs[i].amount, txs[i].receiver, 10 + i, txs[i].currency, txs[i].callback);
+            int64_t e = emit(SBUF(emithash), (uint32_t)tx, PREPARE_PAYMENT_SIMPLE_CB_SIZE(txs[i].callback));
             if (e < 0)
                 rollback(SBUF("Loan: Failed to emit XRP!"), e);
+            emitted_fee += DROPS_FROM_BUF(tx + PREPARE_PAYMENT_SIMPLE_FEE_OFFSET);
+            OPSTATS_EMITTED(txs[i].amount);
         }
         else // Send IOU
         {
@@ -694,13 +788,27 @@ int64_t hook(uint32_t reserved)
             if (float_sto(SBUF(amt_out), SBUF(currencies[txs[i].currency]), SBUF(issuer_accids[txs[i].currency]), float_set(-6, txs[i].amount), amAMOUNT) < 0)
                 rollback(SBUF("Loan: Could not dump IOU amount into sto"), NOT_AN_AMOUNT);
             uint8_t tx[PREPARE_PAYMENT_SIMPLE_TRUSTLINE_SIZE];
-            PREPARE_PAYMENT_SIMPLE_TRUSTLINE(tx, (amt_out_ptr + 1), txs[i].receiver, 20 + i, 0);
-            int64_t e = emit(SBUF(emithash), SBUF(tx));
+            PREPARE_PAYMENT_SIMPLE_TRUSTLINE_CB(tx, (amt_out_ptr + 1), txs[i].receiver, 20 + i, txs[i].currency, txs[i].callback);
+            int64_t e = emit(SBUF(emithash), (uint32_t)tx, PREPARE_PAYMENT_SIMPLE_TRUSTLINE_CB_SIZE(txs[i].callback));
             if (e < 0)
                 rollback(SBUF("Loan: Failed to emit IOU!"), e);
+            emitted_fee += DROPS_FROM_BUF(tx + PREPARE_PAYMENT_SIMPLE_TRUSTLINE_FEE_OFFSET);
         }
     }
 
+    // Add fees paid, emitted txs without callback never reach cbak
+    if (emitted_fee > 0)
+    {
+        state(SBUF(fee_state_data), SBUF(fee_state_key));
+        int64_t fee_sum = float_sto_set(SBUF(fee_state_data));
+        fee_sum = float_sum(fee_sum, float_set(-6, emitted_fee));
+        if (float_sto(SBUF(fee_state_data), 0, 0, 0, 0, fee_sum, -1) < 0)
+            rollback(SBUF("Loan: Could not dump fee_sum into sto"), NOT_AN_AMOUNT);
+        if (state_set(SBUF(fee_state_data), SBUF(fee_state_key)) != 8)
+            rollback(SBUF("Loan: could not write fee_state"), INTERNAL_ERROR);
+    }
+
+    OPSTATS_END();
     accept(SBUF("Loan: Everything worked as expected."), 1);
     return 0;
 }
@@ -20,13 +20,24 @@
 
 #include <stdint.h>
 #include "hookapi.h"
+#include "opstats.h"
+#include "outbox.h"
 
 #define KEY_SIZE 32
 #define ACCID_SIZE 20
 #define ACC_DATA_SIZE 8
+// a win, retry or payout emits one tx, a flush one page of the outbox
+#define MAX_TXS (OUTBOX_FLUSH_PAGE > 1 ? OUTBOX_FLUSH_PAGE : 1)
+
+// operational counter slots, see opstats.h
+#define ACTION_PLAY 1
+#define ACTION_RETRY 2
+#define ACTION_FLUSH 3
+#define ACTION_PAYOUT 4
 
 int64_t cbak(uint32_t reserved)
 {
+    OPSTATS_BEGIN();
     uint8_t tx_failed = 1;
     TRACESTR("CBAK:");
 
@@ -61,26 +72,26 @@ int64_t cbak(uint32_t reserved)
     int64_t amt = slot_float(amt_slot);
     if (amt < 0)
         rollback(SBUF("Lottery CB: Could not parse amount."), PARSE_ERROR);
-    uint64_t amount = float_int(amt, 6, 0);
-    uint8_t amount_buf[8];
-    UINT64_TO_BUF(amount_buf, amount);
-    uint8_t acc[KEY_SIZE];
-    for (int i = 0; GUARD(ACCID_SIZE), i < ACCID_SIZE; ++i)
-        acc[i] = destination[i];
-    if (state_set(SBUF(amount_buf), SBUF(acc)) != sizeof(amount_buf))
-        rollback(SBUF("Lottery CB: could not write state_data_account"), INTERNAL_ERROR);
+    uint8_t created = 0;
+    OUTBOX_ADD(destination, 0, float_int(amt, 6, 0), created);
+    OPSTATS_FAILURE();
+    OPSTATS_END();
     accept(SBUF("Lottery CB: Stored failed Tx."), SUCCESS);
     return 0;
 }
 
 int64_t hook(uint32_t reserved)
 {
+    OPSTATS_BEGIN();
     typedef struct
     {
         uint8_t *receiver;
         uint64_t amount;
+        uint8_t callback;
     } Tx;
-    Tx txs[2];
+    Tx txs[MAX_TXS];
+    uint8_t outbox_accids[OUTBOX_FLUSH_PAGE][ACCID_SIZE];
+    uint64_t outbox_owed[OUTBOX_FLUSH_PAGE][OUTBOX_CURRENCIES];
     uint8_t payout_address[] = "r9BjimZAz1a84k9eHnkRpPbv2aE6p1DThL";
     uint8_t payout_accid[ACCID_SIZE];
     util_accid(SBUF(payout_accid), SBUF(payout_address));
@@ -123,37 +134,76 @@ int64_t hook(uint32_t reserved)
     uint32_t destination_tag = UINT32_FROM_BUF(dest_tag_buf);
     if (destination_tag == 0) // gamble
     {
+        OPSTATS_ACTION(ACTION_PLAY);
         uint8_t nonce[KEY_SIZE];
         etxn_nonce(SBUF(nonce));
         uint8_t p_random_number = nonce[15];
         TRACEVAR(p_random_number);
         if (p_random_number % 10 < 6)
+        {
+            OPSTATS_END();
             accept(SBUF("Lottery: You lost."), SUCCESS);
+        }
 
         txs[0].receiver = sender_accid;
         txs[0].amount = amount_in * 2;
+        txs[0].callback = 1;
         ++num_of_txs;
     }
     else if (destination_tag == 255) // retry
     {
-        for (int i = 0; GUARD(ACCID_SIZE), i < ACCID_SIZE; ++i)
-            state_key_accid[i] = sender_accid[i];
-        if (state(SBUF(state_data_accid), SBUF(state_key_accid)) != sizeof(state_data_accid))
-            rollback(SBUF("Lottery: No open payments."), DOESNT_EXIST);
+        OPSTATS_ACTION(ACTION_RETRY);
+        uint64_t owed[OUTBOX_CURRENCIES];
+        uint8_t found = 0;
+        OUTBOX_TAKE(sender_accid, owed, found);
+        if (found == 0)
+        {
+            // Record stored by cbak before the outbox
+            for (int i = 0; GUARD(ACCID_SIZE), i < ACCID_SIZE; ++i)
+                state_key_accid[i] = sender_accid[i];
+            if (state(SBUF(state_data_accid), SBUF(state_key_accid)) != sizeof(state_data_accid))
+                rollback(SBUF("Lottery: No open payments."), DOESNT_EXIST);
+            owed[0] = UINT64_FROM_BUF(state_data_accid);
+            if (state_set(0, 0, SBUF(state_key_accid)) < 0)
+                rollback(SBUF("Lottery: could not delete state_data_accid"), INTERNAL_ERROR);
+        }
         txs[0].receiver = sender_accid;
-        txs[0].amount = UINT64_FROM_BUF(state_data_accid);
+        txs[0].amount = owed[0];
+        txs[0].callback = 1;
         ++num_of_txs;
-        if (state_set(0, 0, SBUF(state_key_accid)) < 0)
-            rollback(SBUF("Lottery: could not delete state_data_accid"), INTERNAL_ERROR);
+        OPSTATS_RETRY(1);
+    }
+    else if (destination_tag == 254) // flush
+    {
+        OPSTATS_ACTION(ACTION_FLUSH);
+        uint8_t equal = 0;
+        BUFFER_EQUAL(equal, sender_accid, payout_accid, ACCID_SIZE);
+        if (equal != 1)
+            rollback(SBUF("Lottery: Wrong account"), INVALID_ARGUMENT);
+        uint8_t outbox_passed = 0;
+        uint8_t outbox_freed = 0;
+        OUTBOX_FLUSH(outbox_accids, outbox_owed, num_of_txs, outbox_passed, outbox_freed);
+        // a page of holes still moves the head, so it is kept even with nothing to emit
+        if (outbox_passed == 0)
+            rollback(SBUF("Lottery: Outbox is empty."), DOESNT_EXIST);
+        for (int i = 0; GUARD(OUTBOX_FLUSH_PAGE), i < num_of_txs; ++i)
+        {
+            txs[i].receiver = outbox_accids[i];
+            txs[i].amount = outbox_owed[i][0];
+            txs[i].callback = 1;
+        }
+        OPSTATS_RETRY(num_of_txs);
     }
     else if (destination_tag > 255) // payout
     {
+        OPSTATS_ACTION(ACTION_PAYOUT);
         uint8_t equal = 0;
         BUFFER_EQUAL(equal, sender_accid, payout_accid, ACCID_SIZE);
         if (equal != 1)
             rollback(SBUF("Lottery: Wrong account"), INVALID_ARGUMENT);
         txs[0].receiver = payout_accid;
         txs[0].amount = (uint64_t)destination_tag * 1000000;
+        txs[0].callback = 0;
         ++num_of_txs;
     }
     else
@@ -163,15 +213,17 @@ int64_t hook(uint32_t reserved)
     etxn_reserve(num_of_txs);
     uint8_t emithash[32];
     int64_t e = 0;
-    for (int i = 0; GUARD(2), i < num_of_txs; ++i)
+    for (int i = 0; GUARD(MAX_TXS), i < num_of_txs; ++i)
     {
         unsigned char tx[PREPARE_PAYMENT_SIMPLE_SIZE];
-        PREPARE_PAYMENT_SIMPLE(tx, txs[i].amount, txs[i].receiver, i + 1, 0);
-        e = emit(SBUF(emithash), SBUF(tx));
+        PREPARE_PAYMENT_SIMPLE_CB(tx, txs[i].amount, txs[i].receiver, i + 1, 0, txs[i].callback);
+        e = emit(SBUF(emithash), (uint32_t)tx, PREPARE_PAYMENT_SIMPLE_CB_SIZE(txs[i].callback));
         if (e < 0)
             rollback(SBUF("Lottery: Failed to emit XRP!"), e);
+        OPSTATS_EMITTED(txs[i].amount);
     }
 
+    OPSTATS_END();
     accept(SBUF("Lottery: Everything worked as expected."), 1);
     return 0;
 }
\ No newline at end of file
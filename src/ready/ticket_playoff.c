@@ -20,6 +20,8 @@
 
 #include <stdint.h>
 #include "hookapi.h"
+#include "opstats.h"
+#include "slots.h"
 
 #define ttNFT_MINT 25
 #define ttNFT_CREATE_OFFER 27
@@ -177,6 +179,8 @@ uint8_t state_data_paid[1];
 
 int64_t cbak(uint32_t reserved)
 {
+    // every scalar field is read through the same scratch slot
+    uint32_t field_slot = 0;
     uint8_t tx_failed = 1;
     TRACESTR("CBAK:");
     // // Originating tx
@@ -190,7 +194,8 @@ int64_t cbak(uint32_t reserved)
         rollback(SBUF("Ticket CB: Could not slot meta data."), mslot);
 
     // Tx success
-    int64_t tx_res_slot = slot_subfield(mslot, sfTransactionResult, 0);
+    int64_t tx_res_slot;
+    SLOT_SUBFIELD_INTO(tx_res_slot, field_slot, mslot, sfTransactionResult);
     if (tx_res_slot < 0)
         rollback(SBUF("Ticket CB: Could not slot meta.sfTransactionResult"), tx_res_slot);
     uint8_t tx_res_buffer[1];
@@ -200,7 +205,8 @@ int64_t cbak(uint32_t reserved)
         rollback(SBUF("Ticket CB: Emitted Tx was not tesSUCCESSful."), INVALID_TXN);
 
     // Tx type
-    int64_t tx_type_slot = slot_subfield(oslot, sfTransactionType, 0);
+    int64_t tx_type_slot;
+    SLOT_SUBFIELD_INTO(tx_type_slot, field_slot, oslot, sfTransactionType);
     if (tx_type_slot < 0)
         rollback(SBUF("Ticket CB: Could not slot otxn.sfTransactionType"), tx_type_slot);
     uint8_t tx_type_buf[2];
@@ -208,7 +214,8 @@ int64_t cbak(uint32_t reserved)
     uint16_t tx_type = UINT16_FROM_BUF(tx_type_buf);
 
     uint8_t account[ACCID_SIZE];
-    int64_t account_slot = slot_subfield(oslot, sfAccount, 0);
+    int64_t account_slot;
+    SLOT_SUBFIELD_INTO(account_slot, field_slot, oslot, sfAccount);
     if (account_slot < 0)
         rollback(SBUF("Ticket CB: Could not slot otxn.sfAccount"), account_slot);
     bw = slot(SBUF(account), account_slot);
@@ -221,20 +228,23 @@ int64_t cbak(uint32_t reserved)
         TRACESTR("CB ttNFT_MINT");
         if (tx_failed != 0)
             rollback(SBUF("Ticket CB: Could not mint NFT."), tx_failed);
-        int64_t taxon_slot = slot_subfield(oslot, sfNFTokenTaxon, 0);
+        int64_t taxon_slot;
+        SLOT_SUBFIELD_INTO(taxon_slot, field_slot, oslot, sfNFTokenTaxon);
         if (taxon_slot < 0)
             rollback(SBUF("Ticket CB: Could not slot otxn.sfNFTokenTaxon"), taxon_slot);
         uint8_t taxon_buf[4];
         int64_t bw = slot(SBUF(taxon_buf), taxon_slot);
         uint32_t taxon = UINT32_FROM_BUF(taxon_buf);
         state_key_nftid[(uint8_t)taxon] = ++state_data_idx[(uint8_t)taxon];
-        int64_t flag_slot = slot_subfield(oslot, sfFlags, 0);
+        int64_t flag_slot;
+        SLOT_SUBFIELD_INTO(flag_slot, field_slot, oslot, sfFlags);
         if (flag_slot < 0)
             rollback(SBUF("Ticket CB: Could not slot otxn.sfFlags"), flag_slot);
         uint8_t flag_buf[4];
         bw = slot(SBUF(flag_buf), flag_slot);
         uint32_t flag = UINT32_FROM_BUF(flag_buf);
-        int64_t fee_slot = slot_subfield(oslot, sfTransferFee, 0);
+        int64_t fee_slot;
+        SLOT_SUBFIELD_INTO(fee_slot, field_slot, oslot, sfTransferFee);
         if (fee_slot < 0)
             rollback(SBUF("Ticket CB: Could not slot otxn.sfTransferFee"), fee_slot);
         uint8_t transfer_fee_buf[2];
@@ -245,14 +255,20 @@ int64_t cbak(uint32_t reserved)
             rollback(SBUF("Ticket CB: Could not slot otxn.sfAffectedNodes"), affected_nodes_slot);
         uint8_t found = 0;
         int64_t minted_nftokens_slot = 0;
+        uint32_t node_slot = 0;
+        uint32_t final_fields_scratch = 0;
         for (int i = 0; GUARD(8), i < 8 && found == 0; ++i)
         {
-            int64_t subslot = slot_subarray(affected_nodes_slot, i, 0);
-            int64_t final_fields_slot = slot_subfield(subslot, sfFinalFields, 0);
-            minted_nftokens_slot = slot_subfield(final_fields_slot, sfMintedNFTokens, 0);
+            int64_t subslot, final_fields_slot;
+            SLOT_SUBARRAY_INTO(subslot, node_slot, affected_nodes_slot, i);
+            SLOT_SUBFIELD_INTO(final_fields_slot, final_fields_scratch, subslot, sfFinalFields);
+            SLOT_SUBFIELD_INTO(minted_nftokens_slot, field_slot, final_fields_slot, sfMintedNFTokens);
             if (minted_nftokens_slot >= 0)
                 found = 1;
         }
+        SLOT_RELEASE(node_slot);
+        SLOT_RELEASE(final_fields_scratch);
+        SLOT_REPORT();
         if (found == 0)
             rollback(SBUF("Ticket CB: Could not slot otxn.sfMintedNFTokens"), minted_nftokens_slot);
         uint8_t minted_nftokens_buf[4];
@@ -269,7 +285,8 @@ int64_t cbak(uint32_t reserved)
         break;
     case ttNFT_CREATE_OFFER:
         TRACESTR("CB ttNFT_CREATE_OFFER");
-        int64_t destination_slot = slot_subfield(oslot, sfDestination, 0);
+        int64_t destination_slot;
+        SLOT_SUBFIELD_INTO(destination_slot, field_slot, oslot, sfDestination);
         if (destination_slot < 0)
             rollback(SBUF("Ticket CB: Could not slot otxn.sfDestination"), destination_slot);
         bw = slot(SBUF(state_key_account), destination_slot);
@@ -281,7 +298,7 @@ int64_t cbak(uint32_t reserved)
         TRACESTR("CB ttPAYMENT");
         uint8_t project_accid[ACCID_SIZE];
         util_accid(SBUF(project_accid), SBUF(project_address));
-        destination_slot = slot_subfield(oslot, sfDestination, 0);
+        SLOT_SUBFIELD_INTO(destination_slot, field_slot, oslot, sfDestination);
         if (destination_slot < 0)
             rollback(SBUF("Ticket CB: Could not slot otxn.sfDestination"), destination_slot);
         bw = slot(SBUF(state_key_account), destination_slot);
@@ -305,6 +322,7 @@ int64_t cbak(uint32_t reserved)
 
 int64_t hook(uint32_t reserved)
 {
+    OPSTATS_BEGIN();
     enum Action
     {
         setup = 1,
@@ -327,6 +345,7 @@ int64_t hook(uint32_t reserved)
         char *uri;
         uint8_t taxon;
         uint16_t flags;
+        uint8_t callback;
     } Tx;
     Tx txs[NUMBER_OF_CATEGORIES];
     uint8_t project_accid[ACCID_SIZE];
@@ -377,6 +396,7 @@ int64_t hook(uint32_t reserved)
     if (destination_tag == 0)
         rollback(SBUF("Ticket: Destination tag must not be 0."), TOO_SMALL);
     action = destination_tag > retry ? payout : destination_tag;
+    OPSTATS_ACTION(action);
     if (action == buy && (amount_in > nft_price[NUMBER_OF_CATEGORIES - 1] || amount_in < nft_price[0]))
         rollback(SBUF("Ticket: Invalid amount."), INVALID_ARGUMENT);
     else if (action == buy)
@@ -456,6 +476,7 @@ int64_t hook(uint32_t reserved)
         break;
     case retry:
         TRACESTR("retry");
+        OPSTATS_RETRY(1);
         for (int i = 0; GUARD(ACCID_SIZE), i < ACCID_SIZE; ++i)
             state_key_account[i] = sender_accid[i];
         if (state(SBUF(state_data_account), SBUF(state_key_account)) != sizeof(state_data_account) || state_data_account[ACC_DATA_RESULT_OFFSET] == 1)
@@ -488,6 +509,7 @@ int64_t hook(uint32_t reserved)
             txs[num_of_txs].tx_type = payment;
             txs[num_of_txs].amount = total_amount - total_amount * COMMISSION;
             txs[num_of_txs].receiver = project_accid;
+            txs[num_of_txs].callback = 1;
             ++num_of_txs;
         }
         else
@@ -495,6 +517,7 @@ int64_t hook(uint32_t reserved)
             txs[num_of_txs].tx_type = payment;
             txs[num_of_txs].amount = (uint64_t)destination_tag * 1000000;
             txs[num_of_txs].receiver = payout_accid;
+            txs[num_of_txs].callback = 0;
             ++num_of_txs;
         }
         break;
@@ -528,13 +551,15 @@ int64_t hook(uint32_t reserved)
         else if (txs[i].tx_type == payment)
         {
             unsigned char tx[PREPARE_PAYMENT_SIMPLE_SIZE];
-            PREPARE_PAYMENT_SIMPLE(tx, txs[i].amount, txs[i].receiver, i + 1, 0);
-            e = emit(SBUF(emithash), SBUF(tx));
+            PREPARE_PAYMENT_SIMPLE_CB(tx, txs[i].amount, txs[i].receiver, i + 1, 0, txs[i].callback);
+            e = emit(SBUF(emithash), (uint32_t)tx, PREPARE_PAYMENT_SIMPLE_CB_SIZE(txs[i].callback));
             if (e < 0)
                 rollback(SBUF("Loan: Failed to emit XRP!"), e);
+            OPSTATS_EMITTED(txs[i].amount);
         }
     }
 
+    OPSTATS_END();
     accept(SBUF("Ticket: Everything worked as expected."), 1);
     return 0;
 }
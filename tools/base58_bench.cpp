@@ -0,0 +1,190 @@
+/**
+ * base58_bench - cross-checks and times the r-address codec in tools/host/base58
+ *
+ * Checks known addresses, then converts N random account IDs both ways with the
+ * generic token codec, the 20 byte fast path and the batch functions, verifies
+ * that all three agree (corrupted addresses included) and prints conversions
+ * per second for each. The "token" lines time the fixed width conversion with
+ * the checksum left out, which is what bounds a hardware SHA-256 build.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/base58_bench.cpp tools/host/base58.cpp tools/host/sha256.cpp tools/host/util.cpp -o build/base58_bench
+ * Usage: base58_bench [-n COUNT] [-s SEED]
+ *
+ * Exit status is 0 when every check passes, 1 otherwise.
+ */
+
+#include "host/base58.h"
+#include "host/sha256.h"
+#include "host/util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace base58;
+
+namespace
+{
+
+struct Known
+{
+    const char *hex;
+    const char *raddr;
+};
+
+const Known KNOWN[] = {
+    {"0000000000000000000000000000000000000000", "rrrrrrrrrrrrrrrrrrrrrhoLvTp"},
+    {"0000000000000000000000000000000000000001", "rrrrrrrrrrrrrrrrrrrrBZbvji"},
+    {"B5F762798A53D543A014CAF8B297CFF8F2F937E8", "rHb9CJAWyB4rj91VRWn96DkukG4bwdtyTh"},
+};
+
+void from_hex(const char *hex, uint8_t *out)
+{
+    for (size_t i = 0; i < ACCOUNT_ID_SIZE; ++i)
+        out[i] = (uint8_t)std::strtoul(std::string(hex + 2 * i, 2).c_str(), nullptr, 16);
+}
+
+void report(const char *name, size_t n, double secs)
+{
+    std::printf("%-24s %10.2f M/s %10.1f ns\n", name, n / secs / 1e6, secs * 1e9 / n);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t n = 1000000;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "-n") && i + 1 < argc)
+            n = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-s") && i + 1 < argc)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [-n COUNT] [-s SEED]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int failures = 0;
+    for (const Known &k : KNOWN)
+    {
+        uint8_t id[ACCOUNT_ID_SIZE], back[ACCOUNT_ID_SIZE];
+        from_hex(k.hex, id);
+        char text[RADDR_MAX];
+        std::string raddr(text, encode_account(id, text));
+        if (raddr != k.raddr || !decode_account(k.raddr, std::strlen(k.raddr), back) ||
+            std::memcmp(id, back, ACCOUNT_ID_SIZE))
+        {
+            std::printf("known address mismatch: %s -> %s, expected %s\n", k.hex, raddr.c_str(), k.raddr);
+            ++failures;
+        }
+    }
+
+    // random IDs, every 16th with a run of leading zero bytes
+    std::mt19937_64 rng(seed);
+    std::vector<uint8_t> ids(n * ACCOUNT_ID_SIZE);
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint8_t *id = &ids[i * ACCOUNT_ID_SIZE];
+        for (size_t b = 0; b < ACCOUNT_ID_SIZE; ++b)
+            id[b] = (uint8_t)rng();
+        if (i % 16 == 0)
+            std::memset(id, 0, 1 + rng() % 4);
+    }
+
+    std::vector<std::string> generic(n);
+    std::vector<char> fast(n * RADDR_STRIDE), batch(n * RADDR_STRIDE);
+    std::vector<uint8_t> decoded(n * ACCOUNT_ID_SIZE), batch_ids(n * ACCOUNT_ID_SIZE), valid(n);
+
+    std::printf("sha256: %s, %zu accounts\n", sha256::implementation(), n);
+    report("encode generic", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+                   generic[i] = encode_token(TOKEN_ACCOUNT_ID, &ids[i * ACCOUNT_ID_SIZE], ACCOUNT_ID_SIZE);
+           }));
+    report("encode_account", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+               {
+                   char *dst = &fast[i * RADDR_STRIDE];
+                   dst[encode_account(&ids[i * ACCOUNT_ID_SIZE], dst)] = 0;
+               }
+           }));
+    report("batch_raddr", n, util::seconds([&] { batch_raddr(ids.data(), batch.data(), n); }));
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < n; ++i)
+        mismatches += generic[i] != &fast[i * RADDR_STRIDE] || generic[i] != &batch[i * RADDR_STRIDE];
+
+    std::vector<uint8_t> out;
+    size_t generic_ok = 0;
+    report("decode generic", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+                   generic_ok += decode_token(generic[i].data(), generic[i].size(), TOKEN_ACCOUNT_ID, out) &&
+                                 out.size() == ACCOUNT_ID_SIZE;
+           }));
+    size_t fast_ok = 0;
+    report("decode_account", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+               {
+                   const char *text = &fast[i * RADDR_STRIDE];
+                   fast_ok += decode_account(text, std::strlen(text), &decoded[i * ACCOUNT_ID_SIZE]);
+               }
+           }));
+    size_t batch_ok = 0;
+    report("batch_accid", n, util::seconds([&] {
+               batch_ok = batch_accid(fast.data(), RADDR_STRIDE, batch_ids.data(), valid.data(), n);
+           }));
+    std::vector<uint8_t> tokens(n * ACCOUNT_TOKEN_SIZE);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const char *text = &fast[i * RADDR_STRIDE];
+        fast_ok += decode_account_token(text, std::strlen(text), &tokens[i * ACCOUNT_TOKEN_SIZE]);
+    }
+    std::vector<char> token_text(n * RADDR_STRIDE);
+    report("encode_account_token", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+               {
+                   char *dst = &token_text[i * RADDR_STRIDE];
+                   dst[encode_account_token(&tokens[i * ACCOUNT_TOKEN_SIZE], dst)] = 0;
+               }
+           }));
+    size_t token_ok = 0;
+    report("decode_account_token", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+               {
+                   const char *text = &token_text[i * RADDR_STRIDE];
+                   token_ok += decode_account_token(text, std::strlen(text), &tokens[i * ACCOUNT_TOKEN_SIZE]);
+               }
+           }));
+    if (token_text != fast || token_ok != n)
+        ++mismatches;
+    if (generic_ok != n || fast_ok != 2 * n || batch_ok != n || decoded != ids || batch_ids != ids)
+        ++mismatches;
+
+    // one changed character must fail the checksum (or the range) on every path
+    size_t accepted = 0;
+    for (size_t i = 0; i < n; i += 97)
+    {
+        char *text = &fast[i * RADDR_STRIDE];
+        size_t len = std::strlen(text);
+        size_t pos = 1 + rng() % (len - 1);
+        const char *p = std::strchr(ALPHABET, text[pos]);
+        text[pos] = ALPHABET[(p - ALPHABET + 1 + rng() % 57) % 58];
+        uint8_t id[ACCOUNT_ID_SIZE];
+        accepted += decode_account(text, len, id);
+        accepted += decode_token(text, len, TOKEN_ACCOUNT_ID, out);
+    }
+    accepted += batch_accid(fast.data(), RADDR_STRIDE * 97, batch_ids.data(), valid.data(), (n + 96) / 97);
+
+    if (mismatches || accepted)
+    {
+        std::printf("FAILED: %zu mismatching runs, %zu corrupted addresses accepted\n", mismatches, accepted);
+        ++failures;
+    }
+    return failures ? 1 : 0;
+}
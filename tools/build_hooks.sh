@@ -0,0 +1,149 @@
+#!/usr/bin/env bash
+#
+# Builds every hook in src/ready in a debug and a release profile and reports
+# the WASM size of each.
+#
+# release: -DNDEBUG compiles the TRACE* macros out, and every rollback/accept
+#          message is replaced by a short numeric code. The codes are written
+#          to build/release/<hook>.codes (code<TAB>message) for decoding
+#          return strings off-chain. Operational counters (lib/opstats.h)
+#          are always off: -UOPSTATS follows CFLAGS, so a -DOPSTATS there
+#          only reaches the debug build. Counting costs every accepted tx an
+#          extra state read and write.
+#
+# Usage: tools/build_hooks.sh [debug|release|all] [hook.c ...]
+#   CC        wasm C compiler (default: wasmcc, falls back to clang)
+#   CFLAGS    extra compiler flags (a --sysroot goes here), used for the
+#             release preprocess too
+#   CLEANER   post-link step run on each .wasm (default: build/hook_opt if it
+#             has been built, see tools/hook_opt.cpp)
+
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+PROFILE="${1:-all}"
+shift || true
+HOOKS=("$@")
+if [ ${#HOOKS[@]} -eq 0 ]; then
+    HOOKS=("$ROOT"/src/ready/*.c)
+fi
+
+if [ -z "${CC:-}" ]; then
+    if command -v wasmcc >/dev/null; then
+        CC=wasmcc
+    else
+        CC=clang
+    fi
+fi
+if [ -z "${CLEANER:-}" ] && [ -x "$ROOT/build/hook_opt" ]; then
+    CLEANER="$ROOT/build/hook_opt"
+fi
+# WASMFLAGS are given to the release preprocess as well, so it sees the wasm32
+# target's headers and type sizes and not the host's
+WASMFLAGS=(-Oz -I"$ROOT/lib")
+LINKFLAGS=(-Wl,--allow-undefined -Wl,--no-entry -Wl,--export=hook -Wl,--export=cbak)
+if [ "$CC" != "wasmcc" ]; then
+    WASMFLAGS=(--target=wasm32 "${WASMFLAGS[@]}")
+    LINKFLAGS=(-nostdlib "${LINKFLAGS[@]}")
+fi
+
+# Rewrites rollback/accept literals in preprocessed source to numeric codes.
+# Identical messages share a code; the table goes to $2.
+compact_messages()
+{
+    awk -v table="$2" '
+    function message_code(msg)
+    {
+        if (!(msg in codes))
+        {
+            codes[msg] = ++n;
+            print n "\t" msg > table;
+        }
+        return codes[msg];
+    }
+    {
+        out = "";
+        line = $0;
+        while (match(line, /(rollback|accept)\(\(uint32_t\)\("([^"\\]|\\.)*"\), sizeof\("([^"\\]|\\.)*"\)/))
+        {
+            call = substr(line, RSTART, RLENGTH);
+            name = substr(call, 1, index(call, "(") - 1);
+            start = index(call, "(\"") + 2;
+            msg = substr(call, start);
+            msg = substr(msg, 1, index(msg, "\"), sizeof") - 1);
+            code = message_code(msg);
+            out = out substr(line, 1, RSTART - 1) name "((uint32_t)(\"" code "\"), sizeof(\"" code "\")";
+            line = substr(line, RSTART + RLENGTH);
+        }
+        print out line;
+    }' "$1"
+    touch "$2"
+}
+
+build_profile()
+{
+    local profile="$1"
+    local out="$ROOT/build/$profile"
+    mkdir -p "$out"
+    if [ "$profile" = "release" ] && [[ " ${CFLAGS:-} " == *" -DOPSTATS"* ]]; then
+        echo "$0: OPSTATS is not built into release hooks, only into debug" >&2
+    fi
+    for src in "${HOOKS[@]}"; do
+        local name
+        name="$(basename "$src" .c)"
+        if [ "$profile" = "release" ]; then
+            rm -f "$out/$name.codes"
+            "$CC" -E -DNDEBUG ${CFLAGS:-} -UOPSTATS "${WASMFLAGS[@]}" "$src" -o "$out/$name.i"
+            compact_messages "$out/$name.i" "$out/$name.codes" >"$out/$name.c"
+            "$CC" -DNDEBUG ${CFLAGS:-} -UOPSTATS "${WASMFLAGS[@]}" "${LINKFLAGS[@]}" "$out/$name.c" -o "$out/$name.wasm"
+            rm -f "$out/$name.i" "$out/$name.c"
+        else
+            "$CC" ${CFLAGS:-} "${WASMFLAGS[@]}" "${LINKFLAGS[@]}" "$src" -o "$out/$name.wasm"
+        fi
+        if [ "${CLEANER:-}" = "$ROOT/build/hook_opt" ]; then
+            "$CLEANER" -q "$out/$name.wasm" -o "$out/$name.wasm"
+        elif [ -n "${CLEANER:-}" ]; then
+            "$CLEANER" "$out/$name.wasm"
+        fi
+    done
+}
+
+wasm_size()
+{
+    if [ -f "$1" ]; then
+        wc -c <"$1" | tr -d ' '
+    else
+        echo "-"
+    fi
+}
+
+report()
+{
+    printf '%-20s %10s %10s %8s\n' hook debug release saved
+    for src in "${HOOKS[@]}"; do
+        local name debug release
+        name="$(basename "$src" .c)"
+        debug="$(wasm_size "$ROOT/build/debug/$name.wasm")"
+        release="$(wasm_size "$ROOT/build/release/$name.wasm")"
+        if [ "$debug" != "-" ] && [ "$release" != "-" ]; then
+            printf '%-20s %10s %10s %7s%%\n' "$name" "$debug" "$release" $(((debug - release) * 100 / debug))
+        else
+            printf '%-20s %10s %10s %8s\n' "$name" "$debug" "$release" "-"
+        fi
+    done
+}
+
+case "$PROFILE" in
+debug | release)
+    build_profile "$PROFILE"
+    ;;
+all)
+    build_profile debug
+    build_profile release
+    ;;
+*)
+    echo "usage: $0 [debug|release|all] [hook.c ...]" >&2
+    exit 1
+    ;;
+esac
+report
@@ -0,0 +1,174 @@
+/**
+ * emit_check - checks the host emit() in tools/host/hostapi against the ledger's
+ * sfEmitDetails rules
+ *
+ * Calls the bound host functions directly on an instance of a module that only
+ * has a memory: etxn_reserve and etxn_details build the details of a Payment,
+ * which emit() must accept as they are, with a nonce from etxn_nonce and without
+ * sfEmitCallback. Each field changed in turn (generation, burden, parent
+ * transaction, nonce, hook hash, callback account) must be refused with
+ * EMISSION_FAILURE, as xahaud refuses it.
+ *
+ * Build: g++ -std=c++17 -O2 -Ilib -Itools tools/emit_check.cpp tools/wasm/module.cpp tools/wasm/instr.cpp
+ *        tools/wasm/interp.cpp tools/host/hostapi.cpp tools/host/hookstate.cpp tools/host/snapshot.cpp
+ *        tools/host/stobject.cpp tools/host/xfl.cpp tools/host/base58.cpp tools/host/sha256.cpp
+ *        tools/host/keylet.cpp tools/host/sha512.cpp -o build/emit_check
+ * Usage: emit_check
+ *
+ * Exit status is 0 when every check passes, 1 otherwise.
+ */
+
+#include "host/hostapi.h"
+#include "host/stobject.h"
+#include "wasm/interp.h"
+#include "wasm/module.h"
+
+#include "error.h"
+#include "sfcodes.h"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace
+{
+
+using hostapi::ACCOUNT_ID_SIZE;
+using hostapi::EMIT_DETAILS_SIZE;
+using hostapi::HASH_SIZE;
+
+constexpr uint16_t ttPAYMENT = 0;
+
+// where the calls below put their buffers in guest memory
+constexpr uint32_t DETAILS = 0;
+constexpr uint32_t NONCE = 256;
+constexpr uint32_t HASH = 512;
+constexpr uint32_t TX = 1024;
+
+// offsets of the values in the etxn_details output, after each field header
+constexpr size_t GENERATION = 3;
+constexpr size_t BURDEN = 8;
+constexpr size_t PARENT = 17;
+constexpr size_t EMIT_NONCE = 50;
+constexpr size_t HOOK_HASH = 83;
+constexpr size_t CALLBACK = 115; // the field header, the account follows its length byte
+
+// a module with one page of memory and nothing else
+const std::vector<uint8_t> MEMORY_ONLY = {0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00,
+                                          0x05, 0x03, 0x01, 0x00, 0x01};
+
+std::vector<uint8_t> bytes(uint8_t fill, size_t n) { return std::vector<uint8_t>(n, fill); }
+
+class Host
+{
+public:
+    Host() : module_(wasm::Module::parse(MEMORY_ONLY))
+    {
+        std::memset(ctx.hook_account, 0xA1, ACCOUNT_ID_SIZE);
+        std::memset(ctx.hook_hash, 0xB2, HASH_SIZE);
+        ctx.has_callback = true;
+        sto::Writer w;
+        w.uint(sfTransactionType, ttPAYMENT, 2);
+        w.uint(sfSequence, 1, 4);
+        w.drops(sfAmount, 1000000);
+        w.drops(sfFee, 12);
+        std::vector<uint8_t> from = bytes(0xC3, ACCOUNT_ID_SIZE);
+        w.vl(sfAccount, from.data(), from.size());
+        w.vl(sfDestination, ctx.hook_account, ACCOUNT_ID_SIZE);
+        ctx.set_otxn(w.out);
+        hostapi::bind(imports_, ctx);
+        instance_ = std::make_unique<wasm::Instance>(module_, imports_);
+        ctx.begin();
+    }
+
+    int64_t call(const char *name, std::vector<uint64_t> args)
+    {
+        const wasm::HostBinding *b = imports_.find("env", name);
+        return b->func(*instance_, b->user, args.data());
+    }
+
+    uint8_t *memory() { return instance_->memory(); }
+
+    // a Payment from the hook account carrying details, emitted
+    int64_t emit(const std::vector<uint8_t> &details)
+    {
+        sto::Writer w;
+        w.uint(sfTransactionType, ttPAYMENT, 2);
+        w.uint(sfFlags, 0, 4);
+        w.uint(sfSequence, 0, 4);
+        w.drops(sfAmount, 1000000);
+        w.drops(sfFee, 12);
+        w.vl(sfAccount, ctx.hook_account, ACCOUNT_ID_SIZE);
+        std::vector<uint8_t> to = bytes(0xD4, ACCOUNT_ID_SIZE);
+        w.vl(sfDestination, to.data(), to.size());
+        w.out.insert(w.out.end(), details.begin(), details.end());
+        std::memcpy(memory() + TX, w.out.data(), w.out.size());
+        return call("emit", {HASH, HASH_SIZE, TX, w.out.size()});
+    }
+
+    hostapi::Context ctx;
+
+private:
+    wasm::Module module_;
+    wasm::Imports imports_;
+    std::unique_ptr<wasm::Instance> instance_;
+};
+
+struct Check
+{
+    const char *name;
+    std::function<void(std::vector<uint8_t> &details, Host &host)> change;
+    bool accepted;
+};
+
+const Check CHECKS[] = {
+    {"as etxn_details gives them", [](std::vector<uint8_t> &, Host &) {}, true},
+    {"nonce from etxn_nonce",
+     [](std::vector<uint8_t> &d, Host &h) {
+         h.call("etxn_nonce", {NONCE, HASH_SIZE});
+         std::memcpy(d.data() + EMIT_NONCE, h.memory() + NONCE, HASH_SIZE);
+     },
+     true},
+    {"without sfEmitCallback",
+     [](std::vector<uint8_t> &d, Host &) { d.erase(d.begin() + CALLBACK, d.end() - 1); }, true},
+    {"generation + 1", [](std::vector<uint8_t> &d, Host &) { ++d[GENERATION + 3]; }, false},
+    {"burden + 1", [](std::vector<uint8_t> &d, Host &) { ++d[BURDEN + 7]; }, false},
+    {"other parent", [](std::vector<uint8_t> &d, Host &) { d[PARENT] ^= 1; }, false},
+    {"nonce not issued", [](std::vector<uint8_t> &d, Host &) { d[EMIT_NONCE] ^= 1; }, false},
+    {"other hook hash", [](std::vector<uint8_t> &d, Host &) { d[HOOK_HASH] ^= 1; }, false},
+    {"callback to another account", [](std::vector<uint8_t> &d, Host &) { d[CALLBACK + 2] ^= 1; }, false},
+};
+
+} // namespace
+
+int main()
+{
+    int failures = 0;
+    for (const Check &c : CHECKS)
+    {
+        Host host;
+        int64_t r = host.call("etxn_reserve", {1});
+        if (r == 1)
+            r = host.call("etxn_details", {DETAILS, EMIT_DETAILS_SIZE});
+        if (r != EMIT_DETAILS_SIZE)
+        {
+            std::printf("%s: etxn_details returned %lld\n", c.name, (long long)r);
+            ++failures;
+            continue;
+        }
+        std::vector<uint8_t> details(host.memory() + DETAILS, host.memory() + DETAILS + EMIT_DETAILS_SIZE);
+        c.change(details, host);
+        r = host.emit(details);
+        bool accepted = r == HASH_SIZE;
+        if (accepted != c.accepted || (!accepted && r != EMISSION_FAILURE))
+        {
+            std::printf("%s: emit returned %lld, expected %s\n", c.name, (long long)r,
+                        c.accepted ? "the hash" : "EMISSION_FAILURE");
+            ++failures;
+        }
+    }
+    std::printf("%zu emit checks, %d failed\n", sizeof(CHECKS) / sizeof(CHECKS[0]), failures);
+    return failures ? 1 : 0;
+}
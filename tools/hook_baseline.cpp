@@ -0,0 +1,443 @@
+/**
+ * hook_baseline - benchmark baselines of the hooks and the cost changes between two of them
+ *
+ * record runs every hook_bench case (tools/host/actions) and writes a
+ * baseline: the WASM size of each hook, and per case the path it took, the
+ * exact metrics of its action (instructions, host calls, guard iterations,
+ * state bytes and writes, emitted transactions and bytes), the hits of every
+ * guard, the calls and bytes of every lib/extern.h API (tools/host/census)
+ * and the median wall time of RUNS runs, repeated REPEATS times. The format
+ * is one record per line, first word the kind:
+ *
+ *   size HOOK BYTES
+ *   case HOOK/CASE EXIT CODE
+ *   metric HOOK/CASE NAME VALUE
+ *   time HOOK/CASE REPEATS MEAN_NS STDDEV_NS
+ *   guard HOOK/CASE ID HITS
+ *   api HOOK/CASE NAME CALLS BYTES_IN BYTES_OUT
+ *
+ * compare prints one row per change between OLD and NEW: any change of a
+ * size or exact metric (the interpreter is deterministic), and time changes
+ * larger than PCT percent (5 by default) whose Welch t statistic exceeds T
+ * (4 by default). The first row of a case names the causes: the guards
+ * (source line, and .n for GUARDM) whose hits changed and the APIs whose
+ * calls or bytes changed.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/hook_baseline.cpp tools/host/actions.cpp
+ *        tools/host/census.cpp tools/wasm/module.cpp tools/wasm/instr.cpp tools/wasm/interp.cpp
+ *        tools/host/hostapi.cpp tools/host/hookstate.cpp tools/host/snapshot.cpp tools/host/stobject.cpp
+ *        tools/host/xfl.cpp tools/host/base58.cpp tools/host/sha256.cpp tools/host/keylet.cpp
+ *        tools/host/sha512.cpp tools/host/util.cpp -o build/hook_baseline
+ * Usage: hook_baseline record [-d DIR] [-n RUNS] [-r REPEATS] [FILTER]...
+ *        hook_baseline compare [-p PCT] [-t T] OLD NEW
+ *
+ * Exit status is 0 on success (for compare: nothing got worse), 1 when a case
+ * missed its path or compare found a case or hook gone, a path changed or a
+ * cost increased, 2 on usage or load errors.
+ */
+
+#include "host/actions.h"
+#include "host/census.h"
+#include "host/util.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using namespace actions;
+
+// the exact metrics, in the order they are written and compared
+const char *const METRICS[] = {"instructions",        "host_calls",   "guard_iterations", "state_read_bytes",
+                               "state_written_bytes", "state_writes", "emitted",          "emitted_bytes"};
+
+void usage()
+{
+    fprintf(stderr, "usage: hook_baseline record [-d DIR] [-n RUNS] [-r REPEATS] [FILTER]...\n"
+                    "       hook_baseline compare [-p PCT] [-t T] OLD NEW\n");
+}
+
+int record(int argc, char **argv)
+{
+    std::string dir = "build/release";
+    int runs = 20, repeats = 10;
+    std::vector<std::string> filters;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-d" && i + 1 < argc)
+            dir = argv[++i];
+        else if (arg == "-n" && i + 1 < argc)
+            runs = std::max(1, atoi(argv[++i]));
+        else if (arg == "-r" && i + 1 < argc)
+            repeats = std::max(2, atoi(argv[++i]));
+        else if (!arg.empty() && arg[0] != '-')
+            filters.push_back(arg);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    printf("# hook_baseline 1: %d runs, %d repeats\n", runs, repeats);
+    size_t ran = 0, failed = 0;
+    for (const Hook &hook : hooks())
+    {
+        std::vector<const Case *> chosen;
+        for (const Case &c : cases())
+            if ((c.families & hook.family) && util::selected(std::string(hook.name) + "/" + c.name, filters))
+                chosen.push_back(&c);
+        if (chosen.empty())
+            continue;
+        std::string path = dir + "/" + hook.name + ".wasm";
+        std::vector<uint8_t> wasm;
+        if (!util::read_file(path, wasm))
+        {
+            fprintf(stderr, "hook_baseline: %s not found, skipping %s\n", path.c_str(), hook.name);
+            continue;
+        }
+        printf("size %s %zu\n", hook.name, wasm.size());
+        for (const Case *c : chosen)
+        {
+            // times come from a bench without the census trampolines
+            census::Census counts;
+            std::unique_ptr<Bench> bench, counted;
+            Step step, same;
+            try
+            {
+                bench = std::make_unique<Bench>(hook, wasm);
+                counted = std::make_unique<Bench>(hook, wasm,
+                                                  [&](wasm::Imports &imports) { counts.interpose(imports); });
+                step = c->prepare(*bench);
+                same = c->prepare(*counted);
+            }
+            catch (const std::exception &e)
+            {
+                fprintf(stderr, "hook_baseline: %s: %s\n", path.c_str(), e.what());
+                return 2;
+            }
+            counts.clear();
+            Sample s = counted->measure(same, 1);
+            if (!took_path(*c, s))
+            {
+                fprintf(stderr, "hook_baseline: %s/%s did not take its path: %s (code %" PRId64 ") \"%s\"\n",
+                        hook.name, c->name, hostapi::exit_name(s.out.exit), s.out.code, s.message.c_str());
+                ++failed;
+            }
+
+            double sum = 0, squares = 0;
+            for (int r = 0; r < repeats; ++r)
+            {
+                double ns = bench->measure(step, runs).median_ns;
+                sum += ns;
+                squares += ns * ns;
+            }
+            double mean = sum / repeats;
+            double sd = std::sqrt(std::max(0.0, (squares - repeats * mean * mean) / (repeats - 1)));
+
+            std::string name = std::string(hook.name) + "/" + c->name;
+            const uint64_t values[] = {s.out.instructions, s.out.host_calls, s.guard_iterations, s.state_read_bytes,
+                                       s.state_written_bytes, s.state_writes, s.emitted, s.emitted_bytes};
+            printf("case %s %s %" PRId64 "\n", name.c_str(), hostapi::exit_name(s.out.exit), s.out.code);
+            for (size_t m = 0; m < std::size(METRICS); ++m)
+                printf("metric %s %s %" PRIu64 "\n", name.c_str(), METRICS[m], values[m]);
+            printf("time %s %d %.1f %.1f\n", name.c_str(), repeats, mean, sd);
+            std::map<uint32_t, uint32_t> guards(counted->ctx.guards.begin(), counted->ctx.guards.end());
+            for (const auto &g : guards)
+                printf("guard %s %u %u\n", name.c_str(), g.first, g.second);
+            for (const auto &kv : counts.stats())
+                printf("api %s %s %" PRIu64 " %" PRIu64 " %" PRIu64 "\n", name.c_str(), kv.first.c_str(),
+                       kv.second.calls, kv.second.bytes_in, kv.second.bytes_out);
+            ++ran;
+        }
+    }
+    if (ran == 0)
+    {
+        fprintf(stderr, "hook_baseline: no cases ran\n");
+        return 2;
+    }
+    return failed ? 1 : 0;
+}
+
+struct Timing
+{
+    int repeats = 0;
+    double mean = 0;
+    double sd = 0;
+};
+
+struct Entry
+{
+    std::string exit;
+    int64_t code = 0;
+    std::map<std::string, uint64_t> metrics;
+    Timing time;
+    std::map<uint32_t, uint64_t> guards;
+    std::map<std::string, census::Stat> apis;
+};
+
+// cases and hooks in file order
+struct Baseline
+{
+    std::vector<std::string> hooks, order;
+    std::map<std::string, uint64_t> sizes;
+    std::map<std::string, Entry> cases;
+};
+
+bool load(const std::string &path, Baseline &b)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        fprintf(stderr, "hook_baseline: cannot read %s\n", path.c_str());
+        return false;
+    }
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number)
+    {
+        std::istringstream fields(line);
+        std::string kind, name, word, extra;
+        if (!(fields >> kind) || kind[0] == '#')
+            continue;
+        bool ok = (bool)(fields >> name);
+        if (ok && kind == "size")
+        {
+            uint64_t bytes = 0;
+            ok = (bool)(fields >> bytes);
+            if (ok && !b.sizes.count(name))
+                b.hooks.push_back(name);
+            b.sizes[name] = bytes;
+        }
+        else if (ok)
+        {
+            if (!b.cases.count(name))
+                b.order.push_back(name);
+            Entry &e = b.cases[name];
+            uint64_t value = 0;
+            uint32_t id = 0;
+            census::Stat st;
+            if (kind == "case")
+                ok = (bool)(fields >> e.exit >> e.code);
+            else if (kind == "metric")
+                ok = fields >> word >> value && (e.metrics[word] = value, true);
+            else if (kind == "time")
+                ok = (bool)(fields >> e.time.repeats >> e.time.mean >> e.time.sd);
+            else if (kind == "guard")
+                ok = fields >> id >> value && (e.guards[id] = value, true);
+            else if (kind == "api")
+                ok = fields >> word >> st.calls >> st.bytes_in >> st.bytes_out && (e.apis[word] = st, true);
+            else
+                ok = false;
+        }
+        if (!ok || (fields >> extra))
+        {
+            fprintf(stderr, "%s:%zu: malformed baseline line\n", path.c_str(), number);
+            return false;
+        }
+    }
+    return true;
+}
+
+// GUARD ids are 2^31 + line, GUARDM ids 2^31 + (line << 16) + n
+std::string guard_name(uint32_t id)
+{
+    uint32_t v = id & 0x7FFFFFFF;
+    char text[32];
+    if (v > 0xFFFF)
+        snprintf(text, sizeof(text), "%u.%u", v >> 16, v & 0xFFFF);
+    else
+        snprintf(text, sizeof(text), "%u", v);
+    return text;
+}
+
+// the guards and APIs that account for a case's changes, largest first
+std::string causes(const Entry &a, const Entry &b)
+{
+    std::vector<std::pair<int64_t, std::string>> guards, apis;
+    std::set<uint32_t> ids;
+    for (const auto &g : a.guards)
+        ids.insert(g.first);
+    for (const auto &g : b.guards)
+        ids.insert(g.first);
+    for (uint32_t id : ids)
+    {
+        auto x = a.guards.find(id), y = b.guards.find(id);
+        int64_t d = (int64_t)(y == b.guards.end() ? 0 : y->second) - (int64_t)(x == a.guards.end() ? 0 : x->second);
+        if (d)
+            guards.push_back({d, guard_name(id) + (d > 0 ? " +" : " ") + std::to_string(d)});
+    }
+    std::set<std::string> names;
+    for (const auto &kv : a.apis)
+        names.insert(kv.first);
+    for (const auto &kv : b.apis)
+        names.insert(kv.first);
+    for (const std::string &api : names)
+    {
+        static const census::Stat none;
+        auto x = a.apis.find(api), y = b.apis.find(api);
+        const census::Stat &s = x == a.apis.end() ? none : x->second, &t = y == b.apis.end() ? none : y->second;
+        int64_t calls = (int64_t)t.calls - (int64_t)s.calls;
+        int64_t bytes = (int64_t)(t.bytes_in + t.bytes_out) - (int64_t)(s.bytes_in + s.bytes_out);
+        if (!calls && !bytes)
+            continue;
+        std::string text = api;
+        if (calls)
+            text += (calls > 0 ? " +" : " ") + std::to_string(calls);
+        if (bytes)
+            text += (bytes > 0 ? " +" : " ") + std::to_string(bytes) + "B";
+        apis.push_back({calls ? calls : bytes, text});
+    }
+    auto largest = [](const std::pair<int64_t, std::string> &x, const std::pair<int64_t, std::string> &y) {
+        return std::llabs(x.first) > std::llabs(y.first);
+    };
+    std::stable_sort(guards.begin(), guards.end(), largest);
+    std::stable_sort(apis.begin(), apis.end(), largest);
+    std::string out;
+    for (size_t i = 0; i < guards.size() && i < 4; ++i)
+        out += (out.empty() ? "guards " : ", ") + guards[i].second;
+    if (guards.size() > 4)
+        out += ", ...";
+    std::string calls;
+    for (size_t i = 0; i < apis.size() && i < 4; ++i)
+        calls += (calls.empty() ? "" : ", ") + apis[i].second;
+    if (apis.size() > 4)
+        calls += ", ...";
+    if (!calls.empty())
+        out += (out.empty() ? "" : "; ") + calls;
+    return out;
+}
+
+void row(const std::string &name, const char *metric, double x, double y, const std::string &cause)
+{
+    double change = x != 0 ? 100 * (y - x) / x : (y != 0 ? 100 : 0);
+    printf("%-32s %-20s %12.0f %12.0f %+7.1f%%%s%s\n", name.c_str(), metric, x, y, change, cause.empty() ? "" : "  ",
+           cause.c_str());
+}
+
+int compare(int argc, char **argv)
+{
+    double pct = 5, threshold = 4;
+    std::vector<std::string> paths;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-p" && i + 1 < argc)
+            pct = strtod(argv[++i], nullptr);
+        else if (arg == "-t" && i + 1 < argc)
+            threshold = strtod(argv[++i], nullptr);
+        else if (!arg.empty() && arg[0] != '-')
+            paths.push_back(arg);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    Baseline a, b;
+    if (paths.size() != 2)
+    {
+        usage();
+        return 2;
+    }
+    if (!load(paths[0], a) || !load(paths[1], b))
+        return 2;
+
+    size_t worse = 0, better = 0;
+    printf("%-32s %-20s %12s %12s %8s  %s\n", "case", "metric", "old", "new", "change", "cause");
+    std::vector<std::string> hooks = a.hooks;
+    for (const std::string &h : b.hooks)
+        if (!a.sizes.count(h))
+            hooks.push_back(h);
+    for (const std::string &h : hooks)
+    {
+        if (!a.sizes.count(h) || !b.sizes.count(h))
+        {
+            printf("%-32s only in %s\n", h.c_str(), (a.sizes.count(h) ? paths[0] : paths[1]).c_str());
+            worse += a.sizes.count(h);
+            continue;
+        }
+        if (a.sizes[h] != b.sizes[h])
+        {
+            row(h, "wasm_bytes", (double)a.sizes[h], (double)b.sizes[h], "");
+            (b.sizes[h] > a.sizes[h] ? worse : better)++;
+        }
+    }
+
+    std::vector<std::string> order = a.order;
+    for (const std::string &name : b.order)
+        if (!a.cases.count(name))
+            order.push_back(name);
+    for (const std::string &name : order)
+    {
+        if (!a.cases.count(name) || !b.cases.count(name))
+        {
+            printf("%-32s only in %s\n", name.c_str(), (a.cases.count(name) ? paths[0] : paths[1]).c_str());
+            worse += a.cases.count(name);
+            continue;
+        }
+        const Entry &x = a.cases[name], &y = b.cases[name];
+        std::string cause = causes(x, y);
+        auto take_cause = [&]() {
+            std::string c = cause;
+            cause.clear();
+            return c;
+        };
+        if (x.exit != y.exit || x.code != y.code)
+        {
+            std::string from = x.exit + " " + std::to_string(x.code), to = y.exit + " " + std::to_string(y.code);
+            printf("%-32s %-20s %12s %12s %8s  %s\n", name.c_str(), "path", from.c_str(), to.c_str(), "",
+                   take_cause().c_str());
+            ++worse;
+        }
+        for (const char *metric : METRICS)
+        {
+            auto i = x.metrics.find(metric), j = y.metrics.find(metric);
+            uint64_t u = i == x.metrics.end() ? 0 : i->second, v = j == y.metrics.end() ? 0 : j->second;
+            if (u == v)
+                continue;
+            row(name, metric, (double)u, (double)v, take_cause());
+            (v > u ? worse : better)++;
+        }
+
+        // Welch's t on the per-repeat medians
+        const Timing &s = x.time, &t = y.time;
+        if (s.repeats < 2 || t.repeats < 2 || s.mean <= 0)
+            continue;
+        double se = std::sqrt(s.sd * s.sd / s.repeats + t.sd * t.sd / t.repeats);
+        double diff = t.mean - s.mean;
+        double tv = se > 0 ? diff / se : (diff != 0 ? HUGE_VAL : 0);
+        if (std::fabs(tv) <= threshold || std::fabs(100 * diff / s.mean) <= pct)
+            continue;
+        char text[32];
+        snprintf(text, sizeof(text), "t %.1f", tv);
+        std::string c = take_cause();
+        row(name, "median_ns", s.mean, t.mean, c.empty() ? text : std::string(text) + "; " + c);
+        (diff > 0 ? worse : better)++;
+    }
+    printf("%zu worse, %zu better\n", worse, better);
+    return worse ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "record")
+        return record(argc, argv);
+    if (command == "compare")
+        return compare(argc, argv);
+    usage();
+    return 2;
+}
@@ -0,0 +1,165 @@
+/**
+ * hook_bench - per-action benchmarks of the hooks in src/ready
+ *
+ * A case (tools/host/actions) drives one hook through the transactions that
+ * lead to one of its paths (an offer made and taken before it is repaid, a
+ * sale set up and its mints called back before a buy ...) and then measures
+ * that action: hook or cbak runs RUNS times on the same state, every run discarded, so each takes
+ * the same path. Per case it reports the median and fastest wall time, the
+ * metered instructions, host calls, guard iterations, state bytes read and
+ * written and the emitted transactions and their bytes, as one JSON object
+ * per line (or CSV with -f csv) to keep and compare across builds.
+ *
+ * Hooks are read from DIR/<hook>.wasm (build/release by default, see
+ * tools/build_hooks.sh); missing ones are skipped with a note. FILTER
+ * arguments keep the cases whose hook/case name starts with one of them, -l
+ * lists the cases.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/hook_bench.cpp tools/host/actions.cpp
+ *        tools/wasm/module.cpp tools/wasm/instr.cpp tools/wasm/interp.cpp tools/host/hostapi.cpp
+ *        tools/host/hookstate.cpp tools/host/snapshot.cpp tools/host/stobject.cpp tools/host/xfl.cpp
+ *        tools/host/base58.cpp tools/host/sha256.cpp tools/host/keylet.cpp tools/host/sha512.cpp tools/host/util.cpp
+ *        -o build/hook_bench
+ * Usage: hook_bench [-d DIR] [-n RUNS] [-f json|csv] [-l] [FILTER]...
+ *
+ * The operator payout cases also check that their payout is emitted without
+ * sfEmitCallback and accepted by the host's emit(), which applies the ledger's
+ * sfEmitDetails rules.
+ *
+ * Exit status is 0 when every case took the path it is named for, 1 otherwise,
+ * 2 on usage or load errors.
+ */
+
+#include "host/actions.h"
+#include "host/util.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using namespace actions;
+
+void usage()
+{
+    fprintf(stderr, "usage: hook_bench [-d DIR] [-n RUNS] [-f json|csv] [-l] [FILTER]...\n");
+}
+
+void print(const Hook &hook, const Case &c, const Sample &s, bool ok, int runs, bool csv)
+{
+    const char *format = csv ? "%s,%s,%s,%" PRId64 ",%d,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                               ",%u,%zu,%" PRIu64 ",%.0f,%.0f,%d\n"
+                             : "{\"hook\":\"%s\",\"case\":\"%s\",\"exit\":\"%s\",\"code\":%" PRId64
+                               ",\"ok\":%s,\"instructions\":%" PRIu64 ",\"host_calls\":%" PRIu64
+                               ",\"guard_iterations\":%" PRIu64 ",\"state_read_bytes\":%" PRIu64
+                               ",\"state_written_bytes\":%" PRIu64 ",\"state_writes\":%u,\"emitted\":%zu"
+                               ",\"emitted_bytes\":%" PRIu64 ",\"median_ns\":%.0f,\"min_ns\":%.0f,\"runs\":%d}\n";
+    if (csv)
+        printf(format, hook.name, c.name, hostapi::exit_name(s.out.exit), s.out.code, ok, s.out.instructions,
+               s.out.host_calls, s.guard_iterations, s.state_read_bytes, s.state_written_bytes, s.state_writes,
+               s.emitted, s.emitted_bytes, s.median_ns, s.min_ns, runs);
+    else
+        printf(format, hook.name, c.name, hostapi::exit_name(s.out.exit), s.out.code, ok ? "true" : "false",
+               s.out.instructions, s.out.host_calls, s.guard_iterations, s.state_read_bytes, s.state_written_bytes,
+               s.state_writes, s.emitted, s.emitted_bytes, s.median_ns, s.min_ns, runs);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string dir = "build/release", format = "json";
+    int runs = 100;
+    bool list = false;
+    std::vector<std::string> filters;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-d" && i + 1 < argc)
+            dir = argv[++i];
+        else if (arg == "-n" && i + 1 < argc)
+            runs = std::max(1, atoi(argv[++i]));
+        else if (arg == "-f" && i + 1 < argc)
+            format = argv[++i];
+        else if (arg == "-l")
+            list = true;
+        else if (!arg.empty() && arg[0] != '-')
+            filters.push_back(arg);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (format != "json" && format != "csv")
+    {
+        usage();
+        return 2;
+    }
+    bool csv = format == "csv";
+
+    if (csv && !list)
+        printf("hook,case,exit,code,ok,instructions,host_calls,guard_iterations,state_read_bytes,"
+               "state_written_bytes,state_writes,emitted,emitted_bytes,median_ns,min_ns,runs\n");
+    size_t ran = 0, failed = 0;
+    for (const Hook &hook : hooks())
+    {
+        std::vector<const Case *> chosen;
+        for (const Case &c : cases())
+            if ((c.families & hook.family) && util::selected(std::string(hook.name) + "/" + c.name, filters))
+                chosen.push_back(&c);
+        if (chosen.empty())
+            continue;
+        if (list)
+        {
+            for (const Case *c : chosen)
+                printf("%s/%s\n", hook.name, c->name);
+            continue;
+        }
+
+        std::string path = dir + "/" + hook.name + ".wasm";
+        std::vector<uint8_t> wasm;
+        if (!util::read_file(path, wasm))
+        {
+            fprintf(stderr, "hook_bench: %s not found, skipping %s\n", path.c_str(), hook.name);
+            continue;
+        }
+        for (const Case *c : chosen)
+        {
+            // every case starts from a freshly installed hook
+            std::unique_ptr<Bench> bench;
+            Step step;
+            try
+            {
+                bench = std::make_unique<Bench>(hook, wasm);
+                step = c->prepare(*bench);
+            }
+            catch (const std::exception &e)
+            {
+                fprintf(stderr, "hook_bench: %s: %s\n", path.c_str(), e.what());
+                return 2;
+            }
+            Sample s = bench->measure(step, runs);
+            bool ok = took_path(*c, s);
+            if (!ok)
+            {
+                fprintf(stderr, "hook_bench: %s/%s did not take its path: %s (code %" PRId64 ") \"%s\", %zu emitted\n",
+                        hook.name, c->name, hostapi::exit_name(s.out.exit), s.out.code, s.message.c_str(), s.emitted);
+                ++failed;
+            }
+            print(hook, *c, s, ok, runs, csv);
+            ++ran;
+        }
+    }
+    if (!list && ran == 0)
+    {
+        fprintf(stderr, "hook_bench: no cases ran\n");
+        return 2;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,337 @@
+/**
+ * hook_census - which lib/extern.h calls each hook action makes, and what they cost
+ *
+ * run drives every hook_bench case (tools/host/actions) to its action and
+ * runs it RUNS times through a tools/host/census that wraps every import.
+ * It prints one line per case and API called: the case, the API, and per run
+ * the calls, bytes passed in, bytes written back and nanoseconds spent in the
+ * host function. A (run) line per case gives the host calls, emitted bytes and
+ * median wall time of the whole run, trampolines included. Keep the output
+ * of two builds to compare them.
+ *
+ * report reads run output and prints each case with its APIs sorted by time
+ * (-s calls or -s bytes to sort by those), the share of the run spent in
+ * them, and then every API summed over all cases. diff prints the case and
+ * API pairs whose calls or bytes changed between OLD and NEW, and those whose
+ * time changed by more than PCT percent (20 by default).
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/hook_census.cpp tools/host/census.cpp
+ *        tools/host/actions.cpp tools/wasm/module.cpp tools/wasm/instr.cpp tools/wasm/interp.cpp
+ *        tools/host/hostapi.cpp tools/host/hookstate.cpp tools/host/snapshot.cpp tools/host/stobject.cpp
+ *        tools/host/xfl.cpp tools/host/base58.cpp tools/host/sha256.cpp tools/host/keylet.cpp
+ *        tools/host/sha512.cpp tools/host/util.cpp -o build/hook_census
+ * Usage: hook_census run [-d DIR] [-n RUNS] [FILTER]...
+ *        hook_census report [-s time|calls|bytes] FILE
+ *        hook_census diff [-t PCT] OLD NEW
+ *
+ * Exit status is 0 on success (for diff: no calls or bytes changed), 1 when a
+ * case missed its path or diff found changes, 2 on usage or load errors.
+ */
+
+#include "host/actions.h"
+#include "host/census.h"
+#include "host/util.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using namespace actions;
+
+// the API name of a case's whole-run line
+const char RUN[] = "(run)";
+
+void usage()
+{
+    fprintf(stderr, "usage: hook_census run [-d DIR] [-n RUNS] [FILTER]...\n"
+                    "       hook_census report [-s time|calls|bytes] FILE\n"
+                    "       hook_census diff [-t PCT] OLD NEW\n");
+}
+
+int run(int argc, char **argv)
+{
+    std::string dir = "build/release";
+    int runs = 100;
+    std::vector<std::string> filters;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-d" && i + 1 < argc)
+            dir = argv[++i];
+        else if (arg == "-n" && i + 1 < argc)
+            runs = std::max(1, atoi(argv[++i]));
+        else if (!arg.empty() && arg[0] != '-')
+            filters.push_back(arg);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    printf("# case api calls bytes_in bytes_out ns, per run of %d\n", runs);
+    size_t ran = 0, failed = 0;
+    for (const Hook &hook : hooks())
+    {
+        std::vector<const Case *> chosen;
+        for (const Case &c : cases())
+            if ((c.families & hook.family) && util::selected(std::string(hook.name) + "/" + c.name, filters))
+                chosen.push_back(&c);
+        if (chosen.empty())
+            continue;
+        std::string path = dir + "/" + hook.name + ".wasm";
+        std::vector<uint8_t> wasm;
+        if (!util::read_file(path, wasm))
+        {
+            fprintf(stderr, "hook_census: %s not found, skipping %s\n", path.c_str(), hook.name);
+            continue;
+        }
+        for (const Case *c : chosen)
+        {
+            census::Census counts;
+            std::unique_ptr<Bench> bench;
+            Step step;
+            try
+            {
+                bench = std::make_unique<Bench>(hook, wasm,
+                                                [&](wasm::Imports &imports) { counts.interpose(imports); });
+                step = c->prepare(*bench);
+            }
+            catch (const std::exception &e)
+            {
+                fprintf(stderr, "hook_census: %s: %s\n", path.c_str(), e.what());
+                return 2;
+            }
+            // only the measured runs are counted
+            counts.clear();
+            Sample s = bench->measure(step, runs);
+            if (!took_path(*c, s))
+            {
+                fprintf(stderr, "hook_census: %s/%s did not take its path: %s (code %" PRId64 ") \"%s\"\n",
+                        hook.name, c->name, hostapi::exit_name(s.out.exit), s.out.code, s.message.c_str());
+                ++failed;
+            }
+            std::string name = std::string(hook.name) + "/" + c->name;
+            for (const auto &kv : counts.stats())
+            {
+                const census::Stat &st = kv.second;
+                printf("%s %s %" PRIu64 " %" PRIu64 " %" PRIu64 " %.0f\n", name.c_str(), kv.first.c_str(),
+                       st.calls / runs, st.bytes_in / runs, st.bytes_out / runs, st.ns / runs);
+            }
+            printf("%s %s %" PRIu64 " 0 %" PRIu64 " %.0f\n", name.c_str(), RUN, s.out.host_calls, s.emitted_bytes,
+                   s.median_ns);
+            ++ran;
+        }
+    }
+    if (ran == 0)
+    {
+        fprintf(stderr, "hook_census: no cases ran\n");
+        return 2;
+    }
+    return failed ? 1 : 0;
+}
+
+struct Row
+{
+    std::string api;
+    census::Stat stat;
+};
+
+// cases in file order, each with its rows
+struct Table
+{
+    std::vector<std::string> order;
+    std::map<std::string, std::vector<Row>> cases;
+
+    const Row *find(const std::string &name, const std::string &api) const
+    {
+        auto it = cases.find(name);
+        if (it == cases.end())
+            return nullptr;
+        for (const Row &r : it->second)
+            if (r.api == api)
+                return &r;
+        return nullptr;
+    }
+};
+
+bool load(const std::string &path, Table &t)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        fprintf(stderr, "hook_census: cannot read %s\n", path.c_str());
+        return false;
+    }
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number)
+    {
+        std::istringstream fields(line);
+        std::string name, extra;
+        Row r;
+        if (!(fields >> name) || name[0] == '#')
+            continue;
+        if (!(fields >> r.api >> r.stat.calls >> r.stat.bytes_in >> r.stat.bytes_out >> r.stat.ns) ||
+            (fields >> extra))
+        {
+            fprintf(stderr, "%s:%zu: malformed census line\n", path.c_str(), number);
+            return false;
+        }
+        if (!t.cases.count(name))
+            t.order.push_back(name);
+        t.cases[name].push_back(r);
+    }
+    return true;
+}
+
+double key(const census::Stat &s, const std::string &by)
+{
+    if (by == "calls")
+        return (double)s.calls;
+    if (by == "bytes")
+        return (double)(s.bytes_in + s.bytes_out);
+    return s.ns;
+}
+
+void print_row(const std::string &api, const census::Stat &s, double total_ns)
+{
+    printf("  %-20s %8" PRIu64 " calls %9" PRIu64 " in %9" PRIu64 " out %11.0f ns", api.c_str(), s.calls, s.bytes_in,
+           s.bytes_out, s.ns);
+    if (total_ns > 0)
+        printf(" %5.1f%%", 100 * s.ns / total_ns);
+    printf("\n");
+}
+
+int report(const std::string &path, const std::string &by)
+{
+    Table t;
+    if (!load(path, t))
+        return 2;
+    std::map<std::string, census::Stat> all;
+    double all_ns = 0;
+    for (const std::string &name : t.order)
+    {
+        std::vector<Row> rows;
+        census::Stat host, whole;
+        for (const Row &r : t.cases[name])
+        {
+            if (r.api == RUN)
+            {
+                whole = r.stat;
+                continue;
+            }
+            rows.push_back(r);
+            host.calls += r.stat.calls;
+            host.bytes_in += r.stat.bytes_in;
+            host.bytes_out += r.stat.bytes_out;
+            host.ns += r.stat.ns;
+            census::Stat &a = all[r.api];
+            a.calls += r.stat.calls;
+            a.bytes_in += r.stat.bytes_in;
+            a.bytes_out += r.stat.bytes_out;
+            a.ns += r.stat.ns;
+        }
+        all_ns += host.ns;
+        std::stable_sort(rows.begin(), rows.end(),
+                         [&](const Row &a, const Row &b) { return key(a.stat, by) > key(b.stat, by); });
+        printf("%s: %" PRIu64 " host calls, %.0f of %.0f ns in the host", name.c_str(), host.calls, host.ns,
+               whole.ns);
+        if (whole.ns > 0)
+            printf(" (%.1f%%)", 100 * host.ns / whole.ns);
+        printf("\n");
+        for (const Row &r : rows)
+            print_row(r.api, r.stat, host.ns);
+    }
+
+    std::vector<Row> rows;
+    for (const auto &kv : all)
+        rows.push_back(Row{kv.first, kv.second});
+    std::stable_sort(rows.begin(), rows.end(),
+                     [&](const Row &a, const Row &b) { return key(a.stat, by) > key(b.stat, by); });
+    printf("all %zu cases:\n", t.order.size());
+    for (const Row &r : rows)
+        print_row(r.api, r.stat, all_ns);
+    return 0;
+}
+
+int diff(const std::string &old_path, const std::string &new_path, double pct)
+{
+    Table a, b;
+    if (!load(old_path, a) || !load(new_path, b))
+        return 2;
+    std::vector<std::string> order = a.order;
+    for (const std::string &name : b.order)
+        if (!a.cases.count(name))
+            order.push_back(name);
+
+    size_t changed = 0;
+    for (const std::string &name : order)
+    {
+        if (!a.cases.count(name) || !b.cases.count(name))
+        {
+            printf("%s: only in %s\n", name.c_str(), a.cases.count(name) ? old_path.c_str() : new_path.c_str());
+            ++changed;
+            continue;
+        }
+        std::set<std::string> apis;
+        for (const Row &r : a.cases[name])
+            apis.insert(r.api);
+        for (const Row &r : b.cases[name])
+            apis.insert(r.api);
+        // the whole run last
+        std::vector<std::string> list(apis.begin(), apis.end());
+        std::stable_partition(list.begin(), list.end(), [](const std::string &api) { return api != RUN; });
+        for (const std::string &api : list)
+        {
+            static const census::Stat none;
+            const Row *ra = a.find(name, api), *rb = b.find(name, api);
+            const census::Stat &x = ra ? ra->stat : none, &y = rb ? rb->stat : none;
+            bool counts = x.calls != y.calls || x.bytes_in != y.bytes_in || x.bytes_out != y.bytes_out;
+            double change = x.ns > 0 ? 100 * (y.ns - x.ns) / x.ns : (y.ns > 0 ? 100 : 0);
+            if (!counts && std::fabs(change) <= pct)
+                continue;
+            // times alone are too noisy to fail on
+            if (counts && api != RUN)
+                ++changed;
+            printf("%-32s %-20s calls %" PRIu64 " -> %" PRIu64 "  in %" PRIu64 " -> %" PRIu64 "  out %" PRIu64
+                   " -> %" PRIu64 "  %.0f -> %.0f ns (%+.0f%%)\n",
+                   name.c_str(), api.c_str(), x.calls, y.calls, x.bytes_in, y.bytes_in, x.bytes_out, y.bytes_out,
+                   x.ns, y.ns, change);
+        }
+    }
+    return changed ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "run")
+        return run(argc, argv);
+    if (command == "report" && argc == 3)
+        return report(argv[2], "time");
+    if (command == "report" && argc == 5 && std::string(argv[2]) == "-s")
+    {
+        std::string by = argv[3];
+        if (by == "time" || by == "calls" || by == "bytes")
+            return report(argv[4], by);
+    }
+    if (command == "diff" && argc == 4)
+        return diff(argv[2], argv[3], 20);
+    if (command == "diff" && argc == 6 && std::string(argv[2]) == "-t")
+        return diff(argv[4], argv[5], strtod(argv[3], nullptr));
+    usage();
+    return 2;
+}
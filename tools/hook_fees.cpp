@@ -0,0 +1,367 @@
+/**
+ * hook_fees - projected XRP cost of every hook action, with what-if parameters
+ *
+ * Each hook_bench case (tools/host/actions) is run once and priced: the base
+ * fee of the transaction (not for cbak, whose cost travels in the emitted
+ * transaction's fee), the hook execution fee per instruction, the fees the
+ * hook wrote into the transactions it emitted (etxn_fee_base, so they follow
+ * base_fee and the burden of the originating transaction) and the owner
+ * reserve locked or released by the state entries it created or deleted.
+ * Executed instructions are priced unless -w gives the worst case hook_opt
+ * reports for the hook (and for cbak after a comma), which is what the ledger
+ * charges. Installing a hook is priced from its size.
+ *
+ * The what-if section projects what the hooks would cost compiled otherwise:
+ * a sale with `categories` categories of `supply` NFTs (setup scaled linearly
+ * from the hook's own categories), lottery_random bought `tickets` at a time
+ * (measured), and the loan outbox flushed `batch` accounts at a time (fitted
+ * from flush and flush_page, which pays OUTBOX_FLUSH_PAGE accounts).
+ *
+ * Parameters (-p NAME=VALUE, drops unless noted): base_fee 10,
+ * instruction_drops 1, byte_drops 500 (per byte of SetHook code),
+ * owner_reserve 200000, categories 0 (as compiled), supply 100, tickets 9,
+ * batch 2.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/hook_fees.cpp tools/host/actions.cpp
+ *        tools/wasm/module.cpp tools/wasm/instr.cpp tools/wasm/interp.cpp tools/host/hostapi.cpp
+ *        tools/host/hookstate.cpp tools/host/snapshot.cpp tools/host/stobject.cpp tools/host/xfl.cpp
+ *        tools/host/base58.cpp tools/host/sha256.cpp tools/host/keylet.cpp tools/host/sha512.cpp tools/host/util.cpp
+ *        -o build/hook_fees
+ * Usage: hook_fees [-d DIR] [-p NAME=VALUE]... [-w HOOK=N[,M]]... [FILTER]...
+ *
+ * Exit status is 0 when every case took the path it is named for, 1 otherwise,
+ * 2 on usage or load errors.
+ */
+
+#include "host/actions.h"
+#include "host/util.h"
+#include "sfcodes.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using namespace actions;
+
+void usage()
+{
+    fprintf(stderr, "usage: hook_fees [-d DIR] [-p NAME=VALUE]... [-w HOOK=N[,M]]... [FILTER]...\n");
+}
+
+struct Model
+{
+    uint64_t base_fee = 10;
+    uint64_t instruction_drops = 1;
+    uint64_t byte_drops = 500;
+    uint64_t owner_reserve = 200000;
+    uint64_t categories = 0;
+    uint64_t supply = 100;
+    uint64_t tickets = 9;
+    uint64_t batch = 2;
+};
+
+bool set_param(Model &m, const std::string &name, uint64_t value)
+{
+    const struct
+    {
+        const char *name;
+        uint64_t Model::*field;
+    } params[] = {
+        {"base_fee", &Model::base_fee},     {"instruction_drops", &Model::instruction_drops},
+        {"byte_drops", &Model::byte_drops}, {"owner_reserve", &Model::owner_reserve},
+        {"categories", &Model::categories}, {"supply", &Model::supply},
+        {"tickets", &Model::tickets},       {"batch", &Model::batch},
+    };
+    for (const auto &p : params)
+        if (name == p.name)
+        {
+            m.*p.field = value;
+            return true;
+        }
+    return false;
+}
+
+// worst-case instructions of hook and cbak, 0 when not given
+struct Worst
+{
+    uint64_t hook = 0;
+    uint64_t cbak = 0;
+};
+
+struct Cost
+{
+    Sample sample;
+    bool accepted = false;
+    uint64_t instructions = 0; // priced: executed or worst case
+    uint64_t fee = 0;          // base fee, 0 for cbak
+    uint64_t execution = 0;
+    size_t emitted = 0;
+    uint64_t emitted_bytes = 0;
+    uint64_t emitted_fees = 0;
+    int created = 0, modified = 0, deleted = 0;
+    int64_t state_bytes = 0; // change in stored value bytes
+
+    uint64_t total() const { return fee + execution + emitted_fees; }
+    int64_t reserve(const Model &m) const { return (int64_t)(created - deleted) * (int64_t)m.owner_reserve; }
+};
+
+uint64_t fee_of(const std::vector<uint8_t> &tx)
+{
+    sto::Index index;
+    if (!index.parse(tx.data(), tx.size()))
+        return 0;
+    uint32_t n = index.find(sto::Index::ROOT, sfFee);
+    if (n == sto::Index::NOT_FOUND || index.field(n).payload_size != 8)
+        return 0;
+    uint64_t v = 0;
+    const uint8_t *p = index.payload(n);
+    for (int i = 0; i < 8; ++i)
+        v = v << 8 | p[i];
+    // native amounts: the sign bit is set for positive values
+    return v & 0x3FFFFFFFFFFFFFFFULL;
+}
+
+// runs the step once for its metrics, then applies it for its effects
+Cost price(Bench &b, const Step &step, const Model &m, const Worst &worst)
+{
+    bool callback = !step.meta.empty();
+    Cost c;
+    c.sample = b.measure(step, 1);
+    c.instructions = c.sample.out.instructions;
+    if (uint64_t w = callback ? worst.cbak : worst.hook)
+        c.instructions = w;
+    c.fee = callback ? 0 : m.base_fee;
+    c.execution = c.instructions * m.instruction_drops;
+
+    hookstate::Map before, after;
+    b.ctx.state.flatten(before);
+    c.accepted = b.apply(step);
+    b.ctx.state.flatten(after);
+    for (const std::vector<uint8_t> &tx : b.emitted())
+    {
+        ++c.emitted;
+        c.emitted_bytes += tx.size();
+        c.emitted_fees += fee_of(tx);
+    }
+    for (const auto &kv : after)
+    {
+        auto it = before.find(kv.first);
+        if (it == before.end())
+            ++c.created;
+        else if (it->second != kv.second)
+            ++c.modified;
+        c.state_bytes += (int64_t)kv.second.size() - (it == before.end() ? 0 : (int64_t)it->second.size());
+    }
+    for (const auto &kv : before)
+        if (!after.count(kv.first))
+        {
+            ++c.deleted;
+            c.state_bytes -= (int64_t)kv.second.size();
+        }
+    return c;
+}
+
+double xrp(double drops) { return drops / XRP; }
+
+void print(const std::string &name, const Cost &c, const Model &m)
+{
+    printf("%-34s %9" PRIu64 " %5" PRIu64 " %9" PRIu64 " %3zu %5" PRIu64 " %8" PRIu64 " %+3d %3d %+3d %+6" PRId64
+           " %+9" PRId64 " %12.6f\n",
+           name.c_str(), c.instructions, c.fee, c.execution, c.emitted, c.emitted_bytes, c.emitted_fees, c.created,
+           c.modified, -c.deleted, c.state_bytes, c.reserve(m), xrp((double)c.total()));
+}
+
+std::unique_ptr<Bench> install(const Hook &hook, const std::vector<uint8_t> &wasm, const Model &m)
+{
+    auto b = std::make_unique<Bench>(hook, wasm);
+    b->ctx.fee_base = (int64_t)m.base_fee;
+    return b;
+}
+
+// what-if projections from the priced cases of one hook
+void project(const Hook &hook, const std::vector<uint8_t> &wasm, const std::map<std::string, Cost> &costs,
+             const Model &m, const Worst &worst)
+{
+    auto total = [&](const char *name) -> double {
+        auto it = costs.find(name);
+        return it == costs.end() ? 0 : (double)it->second.total();
+    };
+    auto emitted = [&](const char *name) -> double {
+        auto it = costs.find(name);
+        return it == costs.end() ? 0 : (double)it->second.emitted;
+    };
+    auto reserve = [&](const char *name) -> double {
+        auto it = costs.find(name);
+        return it == costs.end() ? 0 : (double)it->second.reserve(m);
+    };
+
+    if (hook.family & SALE)
+    {
+        if (!costs.count("setup") || !costs.count("buy"))
+            return;
+        double own = (double)hook.prices.size(), categories = m.categories ? (double)m.categories : own;
+        double setup = total("setup") * categories / own + total("cbak_mint") * categories;
+        double per_nft = total("buy") + total("cbak_mint") + total("cbak_offer");
+        double close = total("payout") + total("cbak_project");
+        double sale = setup + categories * m.supply * per_nft + close;
+        double held = reserve("setup") * categories / own + reserve("cbak_mint") * categories +
+                      categories * m.supply * (reserve("buy") + reserve("cbak_mint") + reserve("cbak_offer"));
+        printf("  %s: %.0f categories x %" PRIu64 ": setup %.6f XRP, per NFT %.6f XRP, sale %.6f XRP, "
+               "reserve %.6f XRP\n",
+               hook.name, categories, m.supply, xrp(setup), xrp(per_nft), xrp(sale), xrp(held));
+    }
+    if (hook.family == LOTTERY_RANDOM && m.tickets)
+    {
+        // measured: the hook takes any number of tickets paid in one payment
+        std::unique_ptr<Bench> b = install(hook, wasm, m);
+        Cost c = price(*b, b->pay(account(5), drops(hook.prices[0] * m.tickets), 0), m, worst);
+        if (c.accepted)
+            printf("  %s: %" PRIu64 " tickets per purchase: %.6f XRP per purchase, %.6f XRP per ticket\n",
+                   hook.name, m.tickets, xrp((double)c.total()), xrp((double)c.total() / m.tickets));
+        else
+            printf("  %s: %" PRIu64 " tickets per purchase are refused\n", hook.name, m.tickets);
+    }
+    if (hook.family == LOTTERY_NUMBER && costs.count("buy_1"))
+        printf("  %s: one ticket per purchase: %.6f XRP per ticket\n", hook.name, xrp(total("buy_1")));
+    if (hook.family == LOAN && costs.count("flush") && costs.count("flush_page") && m.batch)
+    {
+        // flush pays one owed account, flush_page two
+        double per = total("flush_page") - total("flush"), fixed = total("flush") - per;
+        double flush = fixed + per * m.batch;
+        // every transaction the three emit is called back
+        double lifecycle = total("cbak_success") * (emitted("make_xrp") + emitted("take") + emitted("repay"));
+        lifecycle += total("make_xrp") + total("take") + total("repay");
+        printf("  %s: outbox batch of %" PRIu64 ": %.6f XRP per flush, %.6f XRP per owed account\n", hook.name,
+               m.batch, xrp(flush), xrp(flush / m.batch));
+        printf("  %s: loan made, taken and repaid: %.6f XRP\n", hook.name, xrp(lifecycle));
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string dir = "build/release";
+    Model model;
+    std::map<std::string, Worst> worst;
+    std::vector<std::string> filters;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        std::string name, value;
+        if (arg == "-d" && i + 1 < argc)
+            dir = argv[++i];
+        else if (arg == "-p" && i + 1 < argc)
+        {
+            char *end = nullptr;
+            if (!util::split(argv[++i], name, value) ||
+                !set_param(model, name, strtoull(value.c_str(), &end, 0)) || *end)
+            {
+                fprintf(stderr, "hook_fees: bad parameter %s\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (arg == "-w" && i + 1 < argc)
+        {
+            char *end = nullptr;
+            Worst w;
+            if (util::split(argv[++i], name, value))
+            {
+                w.hook = strtoull(value.c_str(), &end, 10);
+                if (*end == ',')
+                    w.cbak = strtoull(end + 1, &end, 10);
+            }
+            if (!end || *end || !w.hook)
+            {
+                fprintf(stderr, "hook_fees: bad worst case %s, expected HOOK=N[,M]\n", argv[i]);
+                return 2;
+            }
+            worst[name] = w;
+        }
+        else if (!arg.empty() && arg[0] != '-')
+            filters.push_back(arg);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    printf("%-34s %9s %5s %9s %3s %5s %8s %3s %3s %3s %6s %9s %12s\n", "hook/case", "instr", "fee", "execution",
+           "emt", "bytes", "emt fees", "new", "mod", "del", "bytes", "reserve", "XRP");
+    size_t ran = 0, failed = 0;
+    struct Priced
+    {
+        const Hook *hook;
+        std::vector<uint8_t> wasm;
+        std::map<std::string, Cost> costs;
+    };
+    std::vector<Priced> priced;
+    for (const Hook &hook : hooks())
+    {
+        std::vector<const Case *> chosen;
+        for (const Case &c : cases())
+            if ((c.families & hook.family) && util::selected(std::string(hook.name) + "/" + c.name, filters))
+                chosen.push_back(&c);
+        if (chosen.empty())
+            continue;
+        std::string path = dir + "/" + hook.name + ".wasm";
+        std::vector<uint8_t> wasm;
+        if (!util::read_file(path, wasm))
+        {
+            fprintf(stderr, "hook_fees: %s not found, skipping %s\n", path.c_str(), hook.name);
+            continue;
+        }
+        const Worst &w = worst[hook.name];
+        std::map<std::string, Cost> costs;
+        for (const Case *c : chosen)
+        {
+            std::unique_ptr<Bench> b;
+            Step step;
+            try
+            {
+                b = install(hook, wasm, model);
+                step = c->prepare(*b);
+            }
+            catch (const std::exception &e)
+            {
+                fprintf(stderr, "hook_fees: %s: %s\n", path.c_str(), e.what());
+                return 2;
+            }
+            Cost cost = price(*b, step, model, w);
+            if (!took_path(*c, cost.sample))
+            {
+                fprintf(stderr, "hook_fees: %s/%s did not take its path: %s \"%s\"\n", hook.name, c->name,
+                        hostapi::exit_name(cost.sample.out.exit), cost.sample.message.c_str());
+                ++failed;
+            }
+            print(std::string(hook.name) + "/" + c->name, cost, model);
+            costs[c->name] = cost;
+            ++ran;
+        }
+
+        priced.push_back(Priced{&hook, std::move(wasm), std::move(costs)});
+    }
+    if (ran == 0)
+    {
+        fprintf(stderr, "hook_fees: no cases ran\n");
+        return 2;
+    }
+
+    printf("\ninstall\n");
+    for (const Priced &p : priced)
+        printf("  %-16s %7zu bytes: SetHook fee %.6f XRP\n", p.hook->name, p.wasm.size(),
+               xrp((double)(model.base_fee + p.wasm.size() * model.byte_drops)));
+    printf("\nwhat-if\n");
+    for (const Priced &p : priced)
+        project(*p.hook, p.wasm, p.costs, model, worst[p.hook->name]);
+    return failed ? 1 : 0;
+}
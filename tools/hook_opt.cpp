@@ -0,0 +1,524 @@
+/**
+ * hook_opt - post-link optimizer and guard verifier for hook WASM modules
+ *
+ * Strips custom/debug sections, every export other than hook and cbak, and
+ * every function or import not reachable from them, then checks the guard
+ * rules: the first call in each loop must be _g with literal id and bound
+ * arguments. From the guard bounds it computes the worst-case instruction
+ * count of hook and cbak and prints a size/cost report.
+ *
+ * Build: g++ -std=c++17 -O2 -Itools tools/hook_opt.cpp tools/wasm/module.cpp tools/wasm/instr.cpp -o build/hook_opt
+ * Usage: hook_opt [-o out.wasm] [--keep-export NAME]... [--max-wce N] [--verify-only] [-q] in.wasm
+ *
+ * The minimized module is only written when verification passes. Exit status is
+ * 0 on success, 1 on guard violations or an exceeded budget, 2 on usage or parse errors.
+ */
+
+#include "wasm/instr.h"
+#include "wasm/module.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace wasm;
+
+namespace
+{
+
+// rippled rejects hooks whose worst-case execution exceeds this many instructions
+constexpr uint64_t DEFAULT_MAX_WCE = 65535;
+constexpr uint64_t UNBOUNDED = UINT64_MAX;
+
+struct Loop
+{
+    uint32_t func = 0;
+    size_t offset = 0;
+    int parent = -1;
+    bool checked = false; // first call seen
+    bool guarded = false;
+    uint32_t guard_id = 0;
+    uint32_t bound = 0;
+    uint64_t direct = 0; // instructions directly in the loop, callees included later
+    std::vector<uint32_t> calls;
+};
+
+struct FuncCost
+{
+    uint64_t straight = 0; // instructions outside loops, callees included later
+    std::vector<uint32_t> calls;
+    std::vector<int> loops;
+    int state = 0; // 0 unvisited, 1 in progress, 2 done
+};
+
+struct Analysis
+{
+    std::vector<Loop> loops;
+    std::vector<FuncCost> funcs; // indexed by function index, imports cost nothing
+    std::vector<std::string> errors;
+};
+
+uint64_t sat_add(uint64_t a, uint64_t b)
+{
+    return a > UNBOUNDED - b ? UNBOUNDED : a + b;
+}
+
+uint64_t sat_mul(uint64_t a, uint64_t b)
+{
+    return a != 0 && b > UNBOUNDED / a ? UNBOUNDED : a * b;
+}
+
+std::string guard_name(uint32_t id)
+{
+    if ((id & 0x80000000U) == 0)
+        return "id " + std::to_string(id);
+    uint32_t rest = id & 0x7FFFFFFFU;
+    if (rest >= 0x10000)
+        return "line " + std::to_string(rest >> 16) + "." + std::to_string(rest & 0xFFFF);
+    return "line " + std::to_string(rest);
+}
+
+std::string hex(size_t v)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "0x%zx", v);
+    return buf;
+}
+
+// walks every defined function, checks the guard rule and collects costs
+Analysis analyse(const Module &m)
+{
+    Analysis a;
+    a.funcs.resize(m.func_count());
+    std::optional<uint32_t> g = m.find_import("_g");
+    uint32_t first = m.imported_funcs();
+    for (uint32_t i = 0; i < m.functions.size(); ++i)
+    {
+        uint32_t func = first + i;
+        FuncCost &fc = a.funcs[func];
+        std::vector<Instr> code = decode(m.functions[i].body);
+        struct Frame
+        {
+            int loop;     // innermost enclosing loop, -1 for none
+            bool is_loop; // this frame is that loop
+        };
+        std::vector<Frame> frames{{-1, false}};
+        for (size_t k = 0; k < code.size(); ++k)
+        {
+            const Instr &in = code[k];
+            int cur = frames.back().loop;
+            Loop *loop = cur >= 0 ? &a.loops[cur] : nullptr;
+            bool awaiting = loop && !loop->checked;
+            auto where = [&]() { return m.func_name(func) + " loop at " + hex(m.functions[i].offset + loop->offset); };
+
+            if (loop)
+                ++loop->direct;
+            else
+                ++fc.straight;
+
+            switch (in.op)
+            {
+            case OP_LOOP:
+            {
+                if (awaiting)
+                {
+                    a.errors.push_back(where() + ": nested loop before the _g call");
+                    loop->checked = true;
+                }
+                Loop l;
+                l.func = func;
+                l.offset = in.offset;
+                l.parent = cur;
+                a.loops.push_back(l);
+                fc.loops.push_back((int)a.loops.size() - 1);
+                frames.push_back({(int)a.loops.size() - 1, true});
+                break;
+            }
+            case OP_BLOCK:
+            case OP_IF:
+                frames.push_back({cur, false});
+                break;
+            case OP_END:
+                if (frames.size() > 1)
+                {
+                    if (frames.back().is_loop && awaiting)
+                        a.errors.push_back(where() + ": loop without a _g call");
+                    frames.pop_back();
+                }
+                break;
+            case OP_CALL:
+            {
+                uint32_t callee = (uint32_t)in.imm;
+                if (awaiting)
+                {
+                    loop->checked = true;
+                    if (!g || callee != *g)
+                        a.errors.push_back(where() + ": first call is " + m.func_name(callee) + ", not _g");
+                    else if (k < 2 || code[k - 1].op != OP_I32_CONST || code[k - 2].op != OP_I32_CONST)
+                        a.errors.push_back(where() + ": _g id and bound are not literals");
+                    else
+                    {
+                        loop->guarded = true;
+                        loop->guard_id = (uint32_t)code[k - 2].imm;
+                        loop->bound = (uint32_t)code[k - 1].imm;
+                    }
+                }
+                if (loop)
+                    loop->calls.push_back(callee);
+                else
+                    fc.calls.push_back(callee);
+                break;
+            }
+            case OP_CALL_INDIRECT:
+                if (awaiting)
+                {
+                    loop->checked = true;
+                    a.errors.push_back(where() + ": first call is indirect, not _g");
+                }
+                else
+                    a.errors.push_back(m.func_name(func) + " at " + hex(m.functions[i].offset + in.offset) +
+                                       ": indirect calls cannot be costed");
+                break;
+            }
+        }
+    }
+    return a;
+}
+
+// instructions executed per call of func outside its loops, callees included
+uint64_t straight_cost(Analysis &a, const Module &m, uint32_t func)
+{
+    FuncCost &fc = a.funcs[func];
+    if (m.is_import(func) || fc.state == 2)
+        return fc.straight;
+    if (fc.state == 1)
+    {
+        a.errors.push_back(m.func_name(func) + ": recursive call chain, worst case is unbounded");
+        fc.straight = UNBOUNDED;
+        return UNBOUNDED;
+    }
+    fc.state = 1;
+    for (uint32_t callee : fc.calls)
+        fc.straight = sat_add(fc.straight, straight_cost(a, m, callee));
+    for (int l : fc.loops)
+        for (uint32_t callee : a.loops[l].calls)
+            a.loops[l].direct = sat_add(a.loops[l].direct, straight_cost(a, m, callee));
+    fc.state = 2;
+    return fc.straight;
+}
+
+// guards count total hits, so every loop body runs at most bound times per execution
+// no matter how often its function is called or how deeply it is nested
+uint64_t loop_cost(const Loop &l)
+{
+    return l.guarded ? sat_mul(l.bound, l.direct) : UNBOUNDED;
+}
+
+void reachable(const Module &m, uint32_t func, std::set<uint32_t> &seen)
+{
+    std::vector<uint32_t> todo{func};
+    while (!todo.empty())
+    {
+        uint32_t f = todo.back();
+        todo.pop_back();
+        if (!seen.insert(f).second || m.is_import(f))
+            continue;
+        for (const Instr &in : decode(m.functions[f - m.imported_funcs()].body))
+            if (in.op == OP_CALL || in.op == OP_REF_FUNC)
+                todo.push_back((uint32_t)in.imm);
+    }
+}
+
+uint64_t worst_case(Analysis &a, const Module &m, uint32_t root)
+{
+    std::set<uint32_t> funcs;
+    reachable(m, root, funcs);
+    uint64_t total = straight_cost(a, m, root);
+    for (uint32_t f : funcs)
+        straight_cost(a, m, f);
+    for (const Loop &l : a.loops)
+        if (funcs.count(l.func))
+            total = sat_add(total, loop_cost(l));
+    return total;
+}
+
+size_t leb_length(const std::vector<uint8_t> &body, size_t offset)
+{
+    size_t n = 1;
+    while (body[offset + n - 1] & 0x80)
+        ++n;
+    return n;
+}
+
+// rewrites function, type and block type indices in a body
+std::vector<uint8_t> remap_body(const std::vector<uint8_t> &body, const std::vector<int64_t> &funcs,
+                                const std::vector<int64_t> &types)
+{
+    Writer w;
+    size_t copied = 0;
+    for (const Instr &in : decode(body))
+    {
+        bool func_index = in.op == OP_CALL || in.op == OP_REF_FUNC;
+        bool type_index = in.op == OP_CALL_INDIRECT || (in.is_block_start() && in.imm >= 0);
+        if (!func_index && !type_index)
+            continue;
+        w.bytes(body.data() + copied, in.imm_offset - copied);
+        if (func_index)
+            w.u32((uint32_t)funcs[in.imm]);
+        else if (in.op == OP_CALL_INDIRECT)
+            w.u32((uint32_t)types[in.imm]);
+        else
+            w.s64(types[in.imm]);
+        copied = in.imm_offset + leb_length(body, in.imm_offset);
+    }
+    w.bytes(body.data() + copied, body.size() - copied);
+    return w.out;
+}
+
+struct Removed
+{
+    std::vector<std::string> customs;
+    std::vector<std::string> exports;
+    std::vector<std::string> functions;
+    std::vector<std::string> imports;
+    size_t types = 0;
+};
+
+Removed minimize(Module &m, const std::set<std::string> &keep)
+{
+    Removed removed;
+    std::vector<Export> exports;
+    for (Export &e : m.exports)
+    {
+        if (keep.count(e.name))
+            exports.push_back(e);
+        else
+            removed.exports.push_back(e.name);
+    }
+    m.exports = exports;
+
+    std::set<uint32_t> live;
+    for (const Export &e : m.exports)
+        if (e.kind == KIND_FUNC)
+            reachable(m, e.index, live);
+    if (m.start)
+        reachable(m, *m.start, live);
+    for (const Element &e : m.elements)
+        for (uint32_t f : e.funcs)
+            reachable(m, f, live);
+
+    uint32_t imported = m.imported_funcs();
+    std::vector<int64_t> func_map(m.func_count(), -1);
+    uint32_t next = 0;
+    for (uint32_t f = 0; f < m.func_count(); ++f)
+    {
+        if (live.count(f))
+            func_map[f] = next++;
+        else if (f < imported)
+            removed.imports.push_back(m.func_name(f));
+        else
+            removed.functions.push_back(m.func_name(f));
+    }
+
+    std::set<uint32_t> used_types;
+    for (uint32_t f : live)
+        used_types.insert(m.func_type_index(f));
+    for (uint32_t f : live)
+        if (f >= imported)
+            for (const Instr &in : decode(m.functions[f - imported].body))
+                if (in.op == OP_CALL_INDIRECT || (in.is_block_start() && in.imm >= 0))
+                    used_types.insert((uint32_t)in.imm);
+    std::vector<int64_t> type_map(m.types.size(), -1);
+    std::vector<FuncType> types;
+    for (uint32_t t = 0; t < m.types.size(); ++t)
+        if (used_types.count(t))
+        {
+            type_map[t] = (int64_t)types.size();
+            types.push_back(m.types[t]);
+        }
+    removed.types = m.types.size() - types.size();
+    m.types = types;
+
+    std::vector<Import> imports;
+    uint32_t f = 0;
+    for (Import &im : m.imports)
+    {
+        if (im.kind == KIND_FUNC)
+        {
+            if (func_map[f++] < 0)
+                continue;
+            im.type = (uint32_t)type_map[im.type];
+        }
+        imports.push_back(im);
+    }
+    m.imports = imports;
+
+    std::vector<Function> functions;
+    for (uint32_t i = 0; i < m.functions.size(); ++i)
+    {
+        if (func_map[imported + i] < 0)
+            continue;
+        Function fn = m.functions[i];
+        fn.type = (uint32_t)type_map[fn.type];
+        fn.body = remap_body(fn.body, func_map, type_map);
+        functions.push_back(std::move(fn));
+    }
+    m.functions = functions;
+
+    for (Export &e : m.exports)
+        if (e.kind == KIND_FUNC)
+            e.index = (uint32_t)func_map[e.index];
+    if (m.start)
+        m.start = (uint32_t)func_map[*m.start];
+    for (Element &e : m.elements)
+        for (uint32_t &fi : e.funcs)
+            fi = (uint32_t)func_map[fi];
+
+    // last, the name section is used above
+    for (const Custom &c : m.customs)
+        removed.customs.push_back(c.name);
+    m.customs.clear();
+    return removed;
+}
+
+std::string join(const std::vector<std::string> &v)
+{
+    std::string s;
+    for (const std::string &x : v)
+        s += (s.empty() ? "" : ", ") + x;
+    return s;
+}
+
+void usage()
+{
+    fprintf(stderr, "usage: hook_opt [-o out.wasm] [--keep-export NAME]... [--max-wce N] [--verify-only] [-q] in.wasm\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string in_path, out_path;
+    std::set<std::string> keep{"hook", "cbak"};
+    uint64_t max_wce = DEFAULT_MAX_WCE;
+    bool verify_only = false, quiet = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            out_path = argv[++i];
+        else if (arg == "--keep-export" && i + 1 < argc)
+            keep.insert(argv[++i]);
+        else if (arg == "--max-wce" && i + 1 < argc)
+            max_wce = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "--verify-only")
+            verify_only = true;
+        else if (arg == "-q")
+            quiet = true;
+        else if (!arg.empty() && arg[0] != '-' && in_path.empty())
+            in_path = arg;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (in_path.empty())
+    {
+        usage();
+        return 2;
+    }
+
+    std::ifstream file(in_path, std::ios::binary);
+    if (!file)
+    {
+        fprintf(stderr, "hook_opt: cannot read %s\n", in_path.c_str());
+        return 2;
+    }
+    std::vector<uint8_t> bin((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Module m, check;
+    Analysis a;
+    std::vector<std::pair<std::string, uint64_t>> budgets;
+    Removed removed;
+    std::vector<uint8_t> out_bin;
+    try
+    {
+        m = Module::parse(bin);
+        a = analyse(m);
+        if (!m.find_export("hook"))
+            a.errors.push_back("module does not export hook");
+        for (const char *entry : {"hook", "cbak"})
+            if (std::optional<uint32_t> f = m.find_export(entry))
+                budgets.emplace_back(entry, worst_case(a, m, *f));
+
+        Module out = m;
+        removed = minimize(out, keep);
+        out_bin = out.serialize();
+        check = Module::parse(out_bin);
+    }
+    catch (const ParseError &e)
+    {
+        fprintf(stderr, "hook_opt: %s: %s\n", in_path.c_str(), e.what());
+        return 2;
+    }
+
+    for (const auto &[entry, wce] : budgets)
+        if (wce > max_wce)
+            a.errors.push_back(entry + ": worst case " + (wce == UNBOUNDED ? std::string("is unbounded") : std::to_string(wce) + " instructions") +
+                               " exceeds " + std::to_string(max_wce));
+
+    if (!quiet)
+    {
+        printf("%s: %zu -> %zu bytes (-%.1f%%)\n\n", in_path.c_str(), bin.size(), out_bin.size(),
+               bin.empty() ? 0.0 : 100.0 * (double)(bin.size() - out_bin.size()) / (double)bin.size());
+        printf("%-10s %10s %10s\n", "section", "before", "after");
+        for (uint8_t id = 0; id <= SEC_DATA_COUNT; ++id)
+            if (m.section_sizes[id] || check.section_sizes[id])
+                printf("%-10s %10zu %10zu\n", section_name(id), m.section_sizes[id], check.section_sizes[id]);
+        printf("\n");
+        if (!removed.customs.empty())
+            printf("removed custom sections: %s\n", join(removed.customs).c_str());
+        if (!removed.exports.empty())
+            printf("removed exports: %s\n", join(removed.exports).c_str());
+        if (!removed.imports.empty())
+            printf("removed imports: %s\n", join(removed.imports).c_str());
+        if (!removed.functions.empty())
+            printf("removed functions: %s\n", join(removed.functions).c_str());
+        if (removed.types)
+            printf("removed types: %zu\n", removed.types);
+
+        printf("\n%-24s %8s %-12s %8s %8s %10s\n", "guards", "offset", "guard", "bound", "body", "cost");
+        for (const Loop &l : a.loops)
+        {
+            std::string cost = l.guarded && loop_cost(l) != UNBOUNDED ? std::to_string(loop_cost(l)) : "-";
+            std::string body = l.direct != UNBOUNDED ? std::to_string(l.direct) : "-";
+            printf("%-24s %8s %-12s %8" PRIu32 " %8s %10s\n", m.func_name(l.func).c_str(), hex(l.offset).c_str(),
+                   l.guarded ? guard_name(l.guard_id).c_str() : "none", l.bound, body.c_str(), cost.c_str());
+        }
+        printf("\nworst case instructions (limit %" PRIu64 ")\n", max_wce);
+        for (const auto &[entry, wce] : budgets)
+            printf("%-10s %10s\n", entry.c_str(), wce == UNBOUNDED ? "unbounded" : std::to_string(wce).c_str());
+    }
+
+    for (const std::string &e : a.errors)
+        fprintf(stderr, "hook_opt: %s: %s\n", in_path.c_str(), e.c_str());
+    if (!a.errors.empty())
+        return 1;
+
+    if (!verify_only && !out_path.empty())
+    {
+        std::ofstream of(out_path, std::ios::binary);
+        of.write((const char *)out_bin.data(), (std::streamsize)out_bin.size());
+        if (!of)
+        {
+            fprintf(stderr, "hook_opt: cannot write %s\n", out_path.c_str());
+            return 2;
+        }
+    }
+    return 0;
+}
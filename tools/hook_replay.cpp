@@ -0,0 +1,224 @@
+/**
+ * hook_replay - replays a workload through hooks on several threads, one shard per hook account
+ *
+ * Loads the hooks and a workload as ledger_sim does and closes ledgers through
+ * a tools/host/replay Engine with THREADS workers until every shard is idle
+ * (or -l ledgers have closed). Prints per-shard transaction counts, hook runs
+ * and busy time, the combined totals and the throughput. With --scaling the
+ * replay is repeated from the same start with 1, 2, 4 ... THREADS workers and
+ * the speedup over one worker is printed.
+ *
+ * A workload line is: LEDGER HEX, the ledger as an offset from the first one
+ * and the serialized transaction in hex. Blank lines and lines starting with #
+ * are skipped; transactions that touch no hook account are counted and
+ * dropped. A tools/host/corpus file is read as ledger_sim reads it.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -pthread -Ilib -Itools tools/hook_replay.cpp tools/host/replay.cpp
+ *        tools/host/ledger.cpp tools/wasm/module.cpp tools/wasm/instr.cpp tools/wasm/interp.cpp
+ *        tools/host/hostapi.cpp tools/host/hookstate.cpp tools/host/snapshot.cpp tools/host/stobject.cpp
+ *        tools/host/xfl.cpp tools/host/base58.cpp tools/host/sha256.cpp tools/host/keylet.cpp
+ *        tools/host/sha512.cpp tools/host/corpus.cpp tools/host/util.cpp tools/host/workload.cpp -o build/hook_replay
+ * Usage: hook_replay [-j THREADS] [--scaling] --hook RADDR=FILE [--param NAME=HEX]... [--hook ...]...
+ *                    [-l LEDGERS] [--capacity N] [--fail RATE] [--time T] [--fuel N] [-s SEED] [WORKLOAD]
+ *
+ * Exit status is 0 when every shard went idle, 1 otherwise, 2 on usage or load errors.
+ */
+
+#include "host/base58.h"
+#include "host/replay.h"
+#include "host/util.h"
+#include "host/workload.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: hook_replay [-j THREADS] [--scaling] --hook RADDR=FILE [--param NAME=HEX]... [--hook ...]...\n"
+            "                   [-l LEDGERS] [--capacity N] [--fail RATE] [--time T] [--fuel N] [-s SEED] [WORKLOAD]\n");
+}
+
+struct Hook
+{
+    uint8_t account[ledger::ACCOUNT_ID_SIZE];
+    std::string path;
+    std::vector<uint8_t> wasm;
+    std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>> params;
+};
+
+using workload::Item;
+
+struct Run
+{
+    double seconds;
+    uint32_t ledgers;
+    size_t dropped;
+    bool idle;
+    ledger::Stats stats;
+};
+
+// one replay from the start, false when a hook does not load
+bool replay_once(const ledger::Options &options, unsigned threads, const std::vector<Hook> &hooks,
+                 const std::vector<Item> &items, uint32_t max_ledgers, bool print_shards, Run &run)
+{
+    replay::Engine engine(options, threads);
+    for (const Hook &h : hooks)
+    {
+        std::string error;
+        hostapi::Context *ctx = engine.add_hook(h.account, h.wasm, error);
+        if (!ctx)
+        {
+            fprintf(stderr, "hook_replay: %s: %s\n", h.path.c_str(), error.c_str());
+            return false;
+        }
+        for (const auto &p : h.params)
+            ctx->params[p.first] = p.second;
+    }
+    run.dropped = 0;
+    for (const Item &item : items)
+        run.dropped += !engine.submit(item.blob, options.first_ledger + item.offset);
+
+    run.ledgers = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (; run.ledgers < max_ledgers && !engine.idle(); ++run.ledgers)
+        engine.close();
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    run.idle = engine.idle();
+    run.stats = engine.stats();
+
+    if (print_shards)
+        for (size_t i = 0; i < engine.shard_count(); ++i)
+        {
+            const replay::Shard &shard = engine.shard(i);
+            const ledger::Stats &s = shard.sim->stats();
+            char raddr[base58::RADDR_MAX + 1];
+            raddr[base58::encode_account(shard.account.data(), raddr)] = 0;
+            printf("shard %-35s %10" PRIu64 " txns %10" PRIu64 " runs %8" PRIu64 " received %9.3f s busy\n", raddr,
+                   s.transactions, s.hook_runs, shard.received, shard.busy);
+        }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ledger::Options options;
+    uint32_t max_ledgers = 100000;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    bool scaling = false;
+    std::string workload_path;
+    std::vector<Hook> hooks;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        std::string name, value;
+        if (arg == "--hook" && i + 1 < argc && util::split(argv[i + 1], name, value))
+        {
+            ++i;
+            Hook h;
+            if (!base58::decode_account(name.data(), name.size(), h.account))
+            {
+                fprintf(stderr, "hook_replay: bad account %s\n", name.c_str());
+                return 2;
+            }
+            h.path = value;
+            if (!util::read_file(h.path, h.wasm))
+            {
+                fprintf(stderr, "hook_replay: cannot read %s\n", h.path.c_str());
+                return 2;
+            }
+            hooks.push_back(std::move(h));
+        }
+        else if (arg == "--param" && i + 1 < argc && !hooks.empty())
+        {
+            std::vector<uint8_t> bin;
+            if (!util::split(argv[++i], name, value) || !util::from_hex(value, bin))
+            {
+                fprintf(stderr, "hook_replay: bad parameter %s, expected NAME=HEX\n", argv[i]);
+                return 2;
+            }
+            hooks.back().params.emplace_back(std::vector<uint8_t>(name.begin(), name.end()), bin);
+        }
+        else if (arg == "-j" && i + 1 < argc)
+            threads = (unsigned)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "--scaling")
+            scaling = true;
+        else if (arg == "-l" && i + 1 < argc)
+            max_ledgers = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "--capacity" && i + 1 < argc)
+            options.capacity = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "--fail" && i + 1 < argc)
+            options.fail_rate = strtod(argv[++i], nullptr);
+        else if (arg == "--time" && i + 1 < argc)
+            options.close_time = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "--fuel" && i + 1 < argc)
+            options.fuel = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "-s" && i + 1 < argc)
+            options.seed = strtoull(argv[++i], nullptr, 0);
+        else if (!arg.empty() && (arg[0] != '-' || arg == "-") && workload_path.empty())
+            workload_path = arg;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (hooks.empty() || threads == 0)
+    {
+        usage();
+        return 2;
+    }
+
+    std::vector<Item> items;
+    std::string error;
+    if (!workload::load(workload_path, items, error))
+    {
+        fprintf(stderr, "hook_replay: %s\n", error.c_str());
+        return 2;
+    }
+
+    Run run;
+    if (!replay_once(options, threads, hooks, items, max_ledgers, true, run))
+        return 2;
+    const ledger::Stats &s = run.stats;
+    printf("threads       %u, %zu shards\n", threads, hooks.size());
+    printf("ledgers       %u in %.3f s, %.0f transactions/s\n", run.ledgers, run.seconds,
+           s.transactions / run.seconds);
+    printf("transactions  %" PRIu64 " applied, %" PRIu64 " emitted, %" PRIu64 " rejected, %" PRIu64
+           " failed, %" PRIu64 " expired, %zu dropped\n",
+           s.transactions, s.emitted, s.rejected, s.failed, s.expired, run.dropped);
+    printf("hooks         %" PRIu64 " runs, %" PRIu64 " callbacks, %" PRIu64 " errors, %" PRIu64 " instructions\n",
+           s.hook_runs, s.callbacks, s.errors, s.instructions);
+    printf("backlog       max %zu\n", s.max_backlog);
+    if (!run.idle)
+        printf("incomplete after %u ledgers\n", run.ledgers);
+
+    if (scaling)
+    {
+        double base = 0;
+        for (unsigned t = 1;; t = t * 2 < threads ? t * 2 : threads)
+        {
+            Run r;
+            if (!replay_once(options, t, hooks, items, max_ledgers, false, r))
+                return 2;
+            if (t == 1)
+                base = r.seconds;
+            printf("%3u threads %9.3f s %12.0f transactions/s  speedup %.2f\n", t, r.seconds,
+                   r.stats.transactions / r.seconds, base / r.seconds);
+            if (t == threads)
+                break;
+        }
+    }
+    return run.idle ? 0 : 1;
+}
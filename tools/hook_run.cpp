@@ -0,0 +1,172 @@
+/**
+ * hook_run - runs a compiled hook in the embedded interpreter
+ *
+ * Loads the module, binds the lib/extern.h imports to tools/host/hostapi and
+ * executes hook (or cbak) on the given transaction, printing the exit, the
+ * metered instruction count, emitted transactions, state writes and any
+ * imports the host does not implement. With -n the execution is repeated and
+ * timed; state accepted by one run is seen by the next, as on the ledger.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/hook_run.cpp tools/wasm/module.cpp
+ *        tools/wasm/instr.cpp tools/wasm/interp.cpp tools/host/hostapi.cpp tools/host/hookstate.cpp
+ *        tools/host/snapshot.cpp tools/host/stobject.cpp tools/host/xfl.cpp tools/host/base58.cpp
+ *        tools/host/sha256.cpp tools/host/keylet.cpp tools/host/sha512.cpp tools/host/util.cpp -o build/hook_run
+ * Usage: hook_run [-n COUNT] [--cbak] [--otxn FILE] [--meta FILE] [--account RADDR]
+ *                 [--param NAME=HEX]... [--fuel N] [--trace] hook.wasm
+ *
+ * Transaction and metadata files hold a serialized object, raw or as hex.
+ * Exit status is 0 when the hook accepts, 1 otherwise, 2 on usage or load errors.
+ */
+
+#include "host/base58.h"
+#include "host/hostapi.h"
+#include "host/util.h"
+#include "wasm/interp.h"
+#include "wasm/module.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+void usage()
+{
+    fprintf(stderr, "usage: hook_run [-n COUNT] [--cbak] [--otxn FILE] [--meta FILE] [--account RADDR]\n"
+                    "                [--param NAME=HEX]... [--fuel N] [--trace] hook.wasm\n");
+}
+
+// a serialized object file, converted when it is hex (whitespace ignored)
+bool read_object(const std::string &path, std::vector<uint8_t> &out)
+{
+    if (!util::read_file(path, out))
+        return false;
+    std::string text;
+    for (uint8_t c : out)
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+            text.push_back((char)c);
+    std::vector<uint8_t> bin;
+    if (!text.empty() && util::from_hex(text, bin))
+        out.swap(bin);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string wasm_path, otxn_path, meta_path, account = "rHb9CJAWyB4rj91VRWn96DkukG4bwdtyTh";
+    std::vector<std::string> params;
+    uint64_t count = 0, fuel = UINT64_MAX;
+    bool callback = false, trace = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc)
+            count = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "--cbak")
+            callback = true;
+        else if (arg == "--otxn" && i + 1 < argc)
+            otxn_path = argv[++i];
+        else if (arg == "--meta" && i + 1 < argc)
+            meta_path = argv[++i];
+        else if (arg == "--account" && i + 1 < argc)
+            account = argv[++i];
+        else if (arg == "--param" && i + 1 < argc)
+            params.push_back(argv[++i]);
+        else if (arg == "--fuel" && i + 1 < argc)
+            fuel = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "--trace")
+            trace = true;
+        else if (!arg.empty() && arg[0] != '-' && wasm_path.empty())
+            wasm_path = arg;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (wasm_path.empty())
+    {
+        usage();
+        return 2;
+    }
+
+    hostapi::Context ctx;
+    if (!base58::decode_account(account.data(), account.size(), ctx.hook_account))
+    {
+        fprintf(stderr, "hook_run: bad account %s\n", account.c_str());
+        return 2;
+    }
+    for (const std::string &p : params)
+    {
+        size_t eq = p.find('=');
+        std::vector<uint8_t> value;
+        if (eq == std::string::npos || eq == 0 || !util::from_hex(p.data() + eq + 1, p.size() - eq - 1, value))
+        {
+            fprintf(stderr, "hook_run: bad parameter %s, expected NAME=HEX\n", p.c_str());
+            return 2;
+        }
+        ctx.params[std::vector<uint8_t>(p.begin(), p.begin() + eq)] = value;
+    }
+    std::vector<uint8_t> bin, otxn;
+    if (!util::read_file(wasm_path, bin) || (!otxn_path.empty() && !read_object(otxn_path, otxn)) ||
+        (!meta_path.empty() && !read_object(meta_path, ctx.meta)))
+    {
+        fprintf(stderr, "hook_run: cannot read input files\n");
+        return 2;
+    }
+    ctx.set_otxn(std::move(otxn));
+    ctx.trace = trace ? stdout : nullptr;
+
+    wasm::Module module;
+    wasm::Imports imports;
+    hostapi::bind(imports, ctx);
+    std::unique_ptr<wasm::Instance> inst;
+    try
+    {
+        module = wasm::Module::parse(bin);
+        inst = std::make_unique<wasm::Instance>(module, imports);
+    }
+    catch (const std::exception &e)
+    {
+        fprintf(stderr, "hook_run: %s: %s\n", wasm_path.c_str(), e.what());
+        return 2;
+    }
+
+    hostapi::Outcome out = hostapi::execute(*inst, ctx, callback, fuel);
+    printf("exit          %s", hostapi::exit_name(out.exit));
+    if (out.exit == hostapi::Exit::ERROR)
+        printf(" (%s)\n", out.trap.c_str());
+    else
+        printf(" (code %" PRId64 ") \"%s\"\n", out.code, ctx.message.c_str());
+    printf("instructions  %" PRIu64 "\n", out.instructions);
+    printf("host calls    %" PRIu64 "\n", out.host_calls);
+    printf("emitted       %zu\n", ctx.emitted.size());
+    printf("state writes  %u (%" PRIu64 " bytes, %" PRIu64 " read)\n", ctx.state_writes, ctx.state_written_bytes,
+           ctx.state_read_bytes);
+    if (!ctx.unimplemented.empty())
+    {
+        printf("unimplemented");
+        for (const std::string &name : ctx.unimplemented)
+            printf(" %s", name.c_str());
+        printf("\n");
+    }
+
+    if (count > 0)
+    {
+        ctx.trace = nullptr;
+        uint64_t instructions = 0;
+        double t = util::seconds([&] {
+            for (uint64_t i = 0; i < count; ++i)
+                instructions += hostapi::execute(*inst, ctx, callback, fuel).instructions;
+        });
+        printf("%" PRIu64 " runs in %.3f s: %.0f runs/s, %.1f M instructions/s\n", count, t, count / t,
+               instructions / t / 1e6);
+    }
+    return out.exit == hostapi::Exit::ACCEPT ? 0 : 1;
+}
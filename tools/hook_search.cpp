@@ -0,0 +1,699 @@
+/**
+ * hook_search - coverage and cost guided search for the most expensive inputs of each hook
+ *
+ * search starts from the hook_bench cases (tools/host/actions): the state a
+ * case reaches and the transaction it ends with. It then mutates destination
+ * tags, amounts, memos, source accounts, sequences, the ledger time, callback
+ * results and the pre-existing hook state, and runs every candidate once.
+ * A candidate joins the corpus when it reaches a guard, or a guard iteration
+ * count (by powers of two), or an exit code no earlier one did; parents are
+ * drawn from the corpus, half the time from the costliest so far. Cost is the
+ * metered instructions plus WEIGHT per host call. Runs that trap or run out of
+ * fuel are counted apart; they are bugs rather than costs.
+ *
+ * The N costliest inputs per hook (one per distinct path) are printed and,
+ * with -o, written as fixtures: text files holding the hook, ledger time,
+ * transaction, metadata, state and ledger entries, and the metrics they
+ * produced. replay runs fixtures again, prints them as hook_bench JSON lines
+ * and checks the metrics, so they can be kept as benchmark inputs.
+ *
+ * The hooks run in the embedded interpreter (tools/wasm) against the
+ * tools/host/hostapi implementation of lib/extern.h, read from DIR/<hook>.wasm.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/hook_search.cpp tools/host/actions.cpp
+ *        tools/wasm/module.cpp tools/wasm/instr.cpp tools/wasm/interp.cpp tools/host/hostapi.cpp
+ *        tools/host/hookstate.cpp tools/host/snapshot.cpp tools/host/stobject.cpp tools/host/xfl.cpp
+ *        tools/host/base58.cpp tools/host/sha256.cpp tools/host/keylet.cpp tools/host/sha512.cpp
+ *        tools/host/util.cpp -o build/hook_search
+ * Usage: hook_search search [-d DIR] [-i ITERATIONS] [-t N] [-w WEIGHT] [-s SEED] [-o OUTDIR] [HOOK]...
+ *        hook_search replay [-d DIR] [-n RUNS] FIXTURE...
+ *
+ * Exit status is 0 on success, 1 when a fixture does not reproduce, 2 on
+ * usage or load errors.
+ */
+
+#include "host/actions.h"
+#include "host/util.h"
+#include "sfcodes.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using namespace actions;
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: hook_search search [-d DIR] [-i ITERATIONS] [-t N] [-w WEIGHT] [-s SEED] [-o OUTDIR] [HOOK]...\n"
+            "       hook_search replay [-d DIR] [-n RUNS] FIXTURE...\n");
+}
+
+const Hook *find_hook(const std::string &name)
+{
+    for (const Hook &h : hooks())
+        if (name == h.name)
+            return &h;
+    return nullptr;
+}
+
+// one candidate: a payment taken apart so its fields can be mutated, or a
+// callback, with the state and ledger it runs on
+struct Input
+{
+    std::string origin; // the case it descends from
+    std::vector<std::string> mutations;
+
+    bool payment = false;
+    AccountID from{};
+    std::vector<uint8_t> amount; // sfAmount payload
+    uint32_t tag = 0;
+    uint32_t sequence = 0;
+    std::string memo;
+
+    std::vector<uint8_t> otxn, meta; // as run; payments are rebuilt from the fields
+    uint32_t time = OPEN_TIME;
+    hookstate::Map state;
+    std::map<hostapi::Keylet, std::vector<uint8_t>> ledger;
+
+    void rebuild(const AccountID &hook)
+    {
+        if (payment)
+            otxn = actions::payment(from, hook, amount, tag, sequence, memo);
+    }
+};
+
+// reads the mutable fields of a payment, false for anything else
+bool take_apart(Input &in)
+{
+    sto::Index index;
+    if (in.meta.size() || transaction_type(in.otxn) != ttPAYMENT || !index.parse(in.otxn.data(), in.otxn.size()))
+        return false;
+    uint32_t account = index.find(sto::Index::ROOT, sfAccount), amount = index.find(sto::Index::ROOT, sfAmount);
+    uint32_t tag = index.find(sto::Index::ROOT, sfDestinationTag), seq = index.find(sto::Index::ROOT, sfSequence);
+    if (account == sto::Index::NOT_FOUND || amount == sto::Index::NOT_FOUND || tag == sto::Index::NOT_FOUND ||
+        seq == sto::Index::NOT_FOUND || index.field(account).payload_size != ACCOUNT_ID_SIZE)
+        return false;
+    auto u32 = [&](uint32_t n) {
+        const uint8_t *p = index.payload(n);
+        return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+    };
+    std::memcpy(in.from.data(), index.payload(account), ACCOUNT_ID_SIZE);
+    in.amount.assign(index.payload(amount), index.payload(amount) + index.field(amount).payload_size);
+    in.tag = u32(tag);
+    in.sequence = u32(seq);
+    in.memo.clear();
+    uint32_t memos = index.find(sto::Index::ROOT, sfMemos);
+    uint32_t memo = memos == sto::Index::NOT_FOUND ? memos : index.at(memos, 0);
+    uint32_t data = memo == sto::Index::NOT_FOUND ? memo : index.find(memo, sfMemoData);
+    if (data != sto::Index::NOT_FOUND)
+        in.memo.assign((const char *)index.payload(data), index.field(data).payload_size);
+    in.payment = true;
+    return true;
+}
+
+struct Result
+{
+    Sample sample;
+    uint64_t cost = 0;
+    std::vector<uint64_t> features; // guard id and log2 of its hits, exit and code
+};
+
+Result evaluate(Bench &b, const Input &in, uint64_t weight)
+{
+    b.ctx.state.base() = in.state;
+    b.ctx.ledger = in.ledger;
+    b.ctx.ledger_last_time = in.time;
+    Result r;
+    r.sample = b.measure(Step{in.otxn, in.meta}, 1);
+    r.cost = r.sample.out.instructions + weight * r.sample.out.host_calls;
+    for (const auto &g : b.ctx.guards)
+    {
+        uint64_t bucket = 0;
+        for (uint32_t hits = g.second; hits; hits >>= 1)
+            ++bucket;
+        r.features.push_back((uint64_t)g.first << 8 | bucket);
+    }
+    r.features.push_back(1ULL << 63 | (uint64_t)r.sample.out.exit << 40 | (uint32_t)r.sample.out.code);
+    std::sort(r.features.begin(), r.features.end());
+    return r;
+}
+
+// values the hooks compare against: tags, counts, limits and their neighbours
+const uint32_t TAGS[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 99, 100, 101, 254, 255, 256, 999, 1000, 1001, 0xFFFFFFFF};
+const uint64_t COUNTS[] = {0, 1, 2, 7, 8, 9, 99, 100, 101, 255, 256, 999, 1000, 1001, 0xFFFFFFFF};
+const int64_t TIME_STEPS[] = {-31 * 86400, -86400, -3600, -1, 1, 3600, 86400, 31 * 86400, 62 * 86400};
+const uint8_t RESULTS[] = {tesSUCCESS, 100, 104, tecPATH_DRY, 153};
+
+class Mutator
+{
+public:
+    Mutator(const Hook &hook, uint64_t seed, std::vector<AccountID> sources)
+        : hook_(hook), rng_(seed), sources_(std::move(sources))
+    {
+    }
+
+    // one to three mutations; donors give memos and state entries to splice in
+    void mutate(Input &in, const std::vector<Input> &donors)
+    {
+        for (int n = 1 + (int)pick(3); n > 0; --n)
+            mutate_once(in, donors[pick(donors.size())]);
+    }
+
+    size_t pick(size_t n) { return n ? (size_t)(rng_() % n) : 0; }
+
+private:
+    template <class T, size_t N>
+    T any(const T (&values)[N])
+    {
+        return values[pick(N)];
+    }
+
+    void mutate_once(Input &in, const Input &donor)
+    {
+        switch (pick(in.payment ? 8 : 4))
+        {
+        case 0:
+            mutate_state(in, donor);
+            return;
+        case 1:
+            in.time = (uint32_t)((int64_t)in.time + any(TIME_STEPS));
+            if (pick(4) == 0)
+                in.time = pick(2) ? OPEN_TIME : CLOSED_TIME;
+            in.mutations.push_back("time");
+            return;
+        case 2:
+        case 3:
+            if (!in.payment)
+            {
+                mutate_result(in);
+                return;
+            }
+            in.tag = pick(4) ? any(TAGS) : in.tag + (pick(2) ? 1 : -1);
+            in.mutations.push_back("tag");
+            return;
+        case 4:
+            mutate_amount(in);
+            return;
+        case 5:
+            mutate_memo(in, donor);
+            return;
+        case 6:
+            in.from = sources_[pick(sources_.size())];
+            in.mutations.push_back("account");
+            return;
+        default:
+            in.sequence = pick(2) ? (uint32_t)rng_() : in.sequence + 1;
+            in.mutations.push_back("sequence");
+            return;
+        }
+    }
+
+    void mutate_result(Input &in)
+    {
+        sto::Index index;
+        if (!index.parse(in.meta.data(), in.meta.size()))
+            return;
+        uint32_t n = index.find(sto::Index::ROOT, sfTransactionResult);
+        if (n == sto::Index::NOT_FOUND)
+            return;
+        in.meta[index.field(n).payload_offset] = any(RESULTS);
+        in.mutations.push_back("result");
+    }
+
+    void mutate_amount(Input &in)
+    {
+        // IOU amounts keep their value, only XRP is varied
+        if (in.amount.size() != 8)
+            return;
+        uint64_t drops = 0;
+        for (uint8_t b : in.amount)
+            drops = drops << 8 | b;
+        drops &= 0x3FFFFFFFFFFFFFFFULL;
+        uint64_t price = hook_.prices.empty() ? 100 * XRP : hook_.prices[pick(hook_.prices.size())];
+        switch (pick(5))
+        {
+        case 0:
+            drops = price * (1 + pick(100));
+            break;
+        case 1:
+            drops = price + (pick(2) ? 1 : -1);
+            break;
+        case 2:
+            drops = any(COUNTS) * XRP;
+            break;
+        case 3:
+            drops = pick(2) ? drops * 2 : drops / 2;
+            break;
+        default:
+            drops = rng_() % (100000 * XRP);
+            break;
+        }
+        drops = 0x4000000000000000ULL | (drops & 0x3FFFFFFFFFFFFFFFULL);
+        for (int i = 7; i >= 0; --i, drops >>= 8)
+            in.amount[i] = (uint8_t)drops;
+        in.mutations.push_back("amount");
+    }
+
+    void mutate_memo(Input &in, const Input &donor)
+    {
+        std::string &m = in.memo;
+        switch (pick(6))
+        {
+        case 0:
+            if (!m.empty())
+                m[pick(m.size())] = (char)('0' + pick(10));
+            break;
+        case 1:
+            if (!m.empty())
+                m[0] = (char)('0' + pick(10));
+            break;
+        case 2:
+            if (!m.empty())
+                m.erase(pick(m.size()), 1);
+            break;
+        case 3:
+            m.insert(pick(m.size() + 1), 1, (char)('0' + pick(10)));
+            break;
+        case 4:
+            m = donor.payment ? donor.memo : m;
+            break;
+        default:
+            m = m.substr(0, pick(m.size() + 1));
+            break;
+        }
+        in.mutations.push_back("memo");
+    }
+
+    void mutate_state(Input &in, const Input &donor)
+    {
+        if (pick(4) == 0 && !donor.state.empty())
+        {
+            auto it = std::next(donor.state.begin(), (long)pick(donor.state.size()));
+            in.state[it->first] = it->second;
+            in.mutations.push_back("state splice");
+            return;
+        }
+        if (in.state.empty())
+            return;
+        auto it = std::next(in.state.begin(), (long)pick(in.state.size()));
+        hookstate::Value &v = it->second;
+        switch (pick(5))
+        {
+        case 0:
+            v[pick(v.size())] ^= (uint8_t)(1 << pick(8));
+            break;
+        case 1:
+            // counters are 8 bytes big endian
+            if (v.size() >= 8)
+            {
+                uint64_t c = any(COUNTS);
+                size_t at = v.size() == 8 ? 0 : pick(v.size() - 7);
+                for (int i = 7; i >= 0; --i, c >>= 8)
+                    v[at + i] = (uint8_t)c;
+            }
+            break;
+        case 2:
+        {
+            // the same value under a neighbouring key, as key-end tags are
+            hookstate::Key k = it->first;
+            k[k.size() - 1] = (uint8_t)pick(16);
+            in.state[k] = v;
+            break;
+        }
+        case 3:
+            in.state.erase(it);
+            break;
+        default:
+            v[pick(v.size())] = pick(2) ? 0 : 0xFF;
+            break;
+        }
+        in.mutations.push_back("state");
+    }
+
+    const Hook &hook_;
+    std::mt19937_64 rng_;
+    std::vector<AccountID> sources_;
+};
+
+struct Found
+{
+    Input input;
+    Result result;
+};
+
+bool write_fixture(const std::string &path, const Hook &hook, const Found &f)
+{
+    FILE *out = fopen(path.c_str(), "w");
+    if (!out)
+        return false;
+    const Sample &s = f.result.sample;
+    std::string mutations;
+    for (const std::string &m : f.input.mutations)
+        mutations += (mutations.empty() ? "" : ", ") + m;
+    fprintf(out, "# hook_search fixture from %s/%s: %s\n", hook.name, f.input.origin.c_str(),
+            mutations.empty() ? "unmutated" : mutations.c_str());
+    fprintf(out, "hook %s\n", hook.name);
+    fprintf(out, "case %s\n", f.input.origin.c_str());
+    fprintf(out, "time %u\n", f.input.time);
+    fprintf(out, "otxn %s\n", util::to_hex(f.input.otxn.data(), f.input.otxn.size()).c_str());
+    if (!f.input.meta.empty())
+        fprintf(out, "meta %s\n", util::to_hex(f.input.meta.data(), f.input.meta.size()).c_str());
+    // sorted, so fixtures of the same input compare equal
+    std::map<hookstate::Key, hookstate::Value> state(f.input.state.begin(), f.input.state.end());
+    for (const auto &kv : state)
+        fprintf(out, "state %s %s\n", util::to_hex(kv.first.data(), kv.first.size()).c_str(),
+                util::to_hex(kv.second.data(), kv.second.size()).c_str());
+    for (const auto &kv : f.input.ledger)
+        fprintf(out, "ledger %s %s\n", util::to_hex(kv.first.data(), kv.first.size()).c_str(),
+                util::to_hex(kv.second.data(), kv.second.size()).c_str());
+    fprintf(out, "expect %s %" PRId64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n", hostapi::exit_name(s.out.exit),
+            s.out.code, s.out.instructions, s.out.host_calls, s.guard_iterations);
+    return fclose(out) == 0;
+}
+
+int search(int argc, char **argv)
+{
+    std::string dir = "build/release", outdir;
+    uint64_t iterations = 5000, top = 5, weight = 100, seed = 1;
+    std::vector<std::string> names;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-d" && i + 1 < argc)
+            dir = argv[++i];
+        else if (arg == "-i" && i + 1 < argc)
+            iterations = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "-t" && i + 1 < argc)
+            top = std::max(1ULL, strtoull(argv[++i], nullptr, 0));
+        else if (arg == "-w" && i + 1 < argc)
+            weight = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "-s" && i + 1 < argc)
+            seed = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "-o" && i + 1 < argc)
+            outdir = argv[++i];
+        else if (!arg.empty() && arg[0] != '-' && find_hook(arg))
+            names.push_back(arg);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    size_t searched = 0;
+    for (const Hook &hook : hooks())
+    {
+        if (!names.empty() && std::find(names.begin(), names.end(), hook.name) == names.end())
+            continue;
+        std::string path = dir + "/" + hook.name + ".wasm";
+        std::vector<uint8_t> wasm;
+        if (!util::read_file(path, wasm))
+        {
+            fprintf(stderr, "hook_search: %s not found, skipping %s\n", path.c_str(), hook.name);
+            continue;
+        }
+
+        // the seeds: every case of the hook as it stands before its action
+        std::vector<Input> corpus;
+        std::vector<AccountID> sources;
+        for (uint32_t n = 0; n < 8; ++n)
+            sources.push_back(account(n));
+        std::unique_ptr<Bench> bench;
+        try
+        {
+            for (const Case &c : cases())
+            {
+                if (!(c.families & hook.family))
+                    continue;
+                Bench b(hook, wasm);
+                Step step = c.prepare(b);
+                Input in;
+                in.origin = c.name;
+                in.otxn = step.otxn;
+                in.meta = step.meta;
+                in.time = b.ctx.ledger_last_time;
+                b.ctx.state.flatten(in.state);
+                in.ledger = b.ctx.ledger;
+                if (take_apart(in) && std::find(sources.begin(), sources.end(), in.from) == sources.end())
+                    sources.push_back(in.from);
+                corpus.push_back(std::move(in));
+            }
+            bench = std::make_unique<Bench>(hook, wasm);
+        }
+        catch (const std::exception &e)
+        {
+            fprintf(stderr, "hook_search: %s: %s\n", path.c_str(), e.what());
+            return 2;
+        }
+
+        std::set<uint64_t> coverage;
+        std::vector<Found> best; // costliest first, one per feature set
+        uint64_t traps = 0, runs = 0;
+        auto consider = [&](const Input &in) -> bool {
+            Result r = evaluate(*bench, in, weight);
+            ++runs;
+            if (r.sample.out.exit == Exit::ERROR)
+            {
+                ++traps;
+                return false;
+            }
+            bool fresh = false;
+            for (uint64_t f : r.features)
+                fresh |= coverage.insert(f).second;
+            auto same = std::find_if(best.begin(), best.end(),
+                                     [&](const Found &f) { return f.result.features == r.features; });
+            if (same == best.end() || same->result.cost < r.cost)
+            {
+                if (same != best.end())
+                    best.erase(same);
+                best.push_back(Found{in, r});
+                std::stable_sort(best.begin(), best.end(),
+                                 [](const Found &a, const Found &b) { return a.result.cost > b.result.cost; });
+                if (best.size() > top)
+                    best.pop_back();
+            }
+            return fresh;
+        };
+        for (const Input &in : corpus)
+            consider(in);
+
+        Mutator mutator(hook, seed, sources);
+        for (uint64_t i = 0; i < iterations && !corpus.empty(); ++i)
+        {
+            const Input &parent = mutator.pick(2) || best.empty() ? corpus[mutator.pick(corpus.size())]
+                                                                  : best[mutator.pick(best.size())].input;
+            Input child = parent;
+            mutator.mutate(child, corpus);
+            child.rebuild(bench->id);
+            if (consider(child))
+                corpus.push_back(std::move(child));
+        }
+
+        printf("%s: %" PRIu64 " runs, %zu in corpus, %zu features, %" PRIu64 " traps\n", hook.name, runs,
+               corpus.size(), coverage.size(), traps);
+        for (size_t i = 0; i < best.size(); ++i)
+        {
+            const Found &f = best[i];
+            const Sample &s = f.result.sample;
+            std::string mutations;
+            for (const std::string &m : f.input.mutations)
+                mutations += (mutations.empty() ? "" : ",") + m;
+            printf("  %2zu cost %9" PRIu64 " instructions %9" PRIu64 " guards %7" PRIu64 " host %4" PRIu64
+                   " %-8s %6" PRId64 "  %s%s%s\n",
+                   i + 1, f.result.cost, s.out.instructions, s.guard_iterations, s.out.host_calls,
+                   hostapi::exit_name(s.out.exit), s.out.code, f.input.origin.c_str(), mutations.empty() ? "" : " + ",
+                   mutations.c_str());
+            if (!outdir.empty())
+            {
+                std::string file = outdir + "/" + hook.name + "-" + std::to_string(i + 1) + ".fixture";
+                if (!write_fixture(file, hook, f))
+                {
+                    fprintf(stderr, "hook_search: cannot write %s\n", file.c_str());
+                    return 2;
+                }
+            }
+        }
+        ++searched;
+    }
+    if (searched == 0)
+    {
+        fprintf(stderr, "hook_search: no hooks searched\n");
+        return 2;
+    }
+    return 0;
+}
+
+struct Fixture
+{
+    std::string hook, origin;
+    Input input;
+    std::string exit;
+    int64_t code = 0;
+    uint64_t instructions = 0, host_calls = 0, guard_iterations = 0;
+};
+
+bool load_fixture(const std::string &path, Fixture &f)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        fprintf(stderr, "hook_search: cannot read %s\n", path.c_str());
+        return false;
+    }
+    std::string line;
+    bool expect = false;
+    for (size_t number = 1; std::getline(in, line); ++number)
+    {
+        std::istringstream fields(line);
+        std::string kind, a, b;
+        if (!(fields >> kind) || kind[0] == '#')
+            continue;
+        std::vector<uint8_t> x, y;
+        bool ok = true;
+        if (kind == "hook")
+            ok = (bool)(fields >> f.hook);
+        else if (kind == "case")
+            ok = (bool)(fields >> f.origin);
+        else if (kind == "time")
+            ok = (bool)(fields >> f.input.time);
+        else if (kind == "otxn")
+            ok = fields >> a && util::from_hex(a, f.input.otxn);
+        else if (kind == "meta")
+            ok = fields >> a && util::from_hex(a, f.input.meta);
+        else if (kind == "state" || kind == "ledger")
+        {
+            ok = fields >> a >> b && util::from_hex(a, x) && util::from_hex(b, y);
+            if (ok && kind == "state" && x.size() == std::tuple_size<hookstate::Key>::value)
+            {
+                hookstate::Key k;
+                std::copy(x.begin(), x.end(), k.begin());
+                f.input.state[k] = y;
+            }
+            else if (ok && kind == "ledger" && x.size() == hostapi::KEYLET_SIZE)
+            {
+                hostapi::Keylet k;
+                std::copy(x.begin(), x.end(), k.begin());
+                f.input.ledger[k] = y;
+            }
+            else
+                ok = false;
+        }
+        else if (kind == "expect")
+            ok = expect = (bool)(fields >> f.exit >> f.code >> f.instructions >> f.host_calls >> f.guard_iterations);
+        else
+            ok = false;
+        if (!ok)
+        {
+            fprintf(stderr, "%s:%zu: malformed fixture line\n", path.c_str(), number);
+            return false;
+        }
+    }
+    if (f.hook.empty() || f.input.otxn.empty() || !expect)
+    {
+        fprintf(stderr, "%s: incomplete fixture\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+int replay(int argc, char **argv)
+{
+    std::string dir = "build/release";
+    int runs = 100;
+    std::vector<std::string> paths;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-d" && i + 1 < argc)
+            dir = argv[++i];
+        else if (arg == "-n" && i + 1 < argc)
+            runs = std::max(1, atoi(argv[++i]));
+        else if (!arg.empty() && arg[0] != '-')
+            paths.push_back(arg);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (paths.empty())
+    {
+        usage();
+        return 2;
+    }
+
+    size_t differ = 0;
+    for (const std::string &path : paths)
+    {
+        Fixture f;
+        if (!load_fixture(path, f))
+            return 2;
+        const Hook *hook = find_hook(f.hook);
+        std::vector<uint8_t> wasm;
+        if (!hook || !util::read_file(dir + "/" + f.hook + ".wasm", wasm))
+        {
+            fprintf(stderr, "hook_search: %s: no hook %s in %s\n", path.c_str(), f.hook.c_str(), dir.c_str());
+            return 2;
+        }
+        std::unique_ptr<Bench> b;
+        try
+        {
+            b = std::make_unique<Bench>(*hook, wasm);
+        }
+        catch (const std::exception &e)
+        {
+            fprintf(stderr, "hook_search: %s: %s\n", f.hook.c_str(), e.what());
+            return 2;
+        }
+        b->ctx.state.base() = f.input.state;
+        b->ctx.ledger = f.input.ledger;
+        b->ctx.ledger_last_time = f.input.time;
+        Sample s = b->measure(Step{f.input.otxn, f.input.meta}, runs);
+        bool same = f.exit == hostapi::exit_name(s.out.exit) && f.code == s.out.code &&
+                    f.instructions == s.out.instructions && f.host_calls == s.out.host_calls &&
+                    f.guard_iterations == s.guard_iterations;
+        if (!same)
+        {
+            fprintf(stderr, "hook_search: %s does not reproduce: %s %" PRId64 ", %" PRIu64 " instructions\n",
+                    path.c_str(), hostapi::exit_name(s.out.exit), s.out.code, s.out.instructions);
+            ++differ;
+        }
+        std::string name = path.substr(path.find_last_of('/') + 1);
+        printf("{\"hook\":\"%s\",\"case\":\"%s\",\"exit\":\"%s\",\"code\":%" PRId64
+               ",\"ok\":%s,\"instructions\":%" PRIu64 ",\"host_calls\":%" PRIu64 ",\"guard_iterations\":%" PRIu64
+               ",\"state_read_bytes\":%" PRIu64
+               ",\"state_written_bytes\":%" PRIu64 ",\"state_writes\":%u,\"emitted\":%zu,\"emitted_bytes\":%" PRIu64
+               ",\"median_ns\":%.0f,\"min_ns\":%.0f,\"runs\":%d}\n",
+               f.hook.c_str(), name.c_str(), hostapi::exit_name(s.out.exit), s.out.code, same ? "true" : "false",
+               s.out.instructions, s.out.host_calls, s.guard_iterations, s.state_read_bytes, s.state_written_bytes,
+               s.state_writes, s.emitted, s.emitted_bytes, s.median_ns, s.min_ns, runs);
+    }
+    return differ ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "search")
+        return search(argc, argv);
+    if (command == "replay")
+        return replay(argc, argv);
+    usage();
+    return 2;
+}
@@ -0,0 +1,955 @@
+/**
+ * hook_stack - static stack and linear-memory usage of hook WASM modules
+ *
+ * Reads the stack frame of every function from its prologue (clang moves the
+ * __stack_pointer global down by the frame size), follows direct calls from
+ * the exports for the deepest call path, and sums the data segments and the
+ * stack the linker left below the initial stack pointer. Bytes zeroed with
+ * memory.fill or memset of a constant length count as initialization.
+ *
+ * The frame is split at the offsets the function takes addresses of (frame
+ * pointer plus a constant: buffers handed to the host API). With the C source,
+ * given with -s or found as src/ready/<module>.c, the array declarations of
+ * each function, including those in the macros it invokes, are evaluated with
+ * the #defines of the source and its includes and matched by size to those
+ * regions. The match is a heuristic: clang may share one slot between buffers
+ * of disjoint scopes, or drop a buffer it keeps in locals.
+ *
+ * Build: g++ -std=c++17 -O2 -Itools tools/hook_stack.cpp tools/wasm/module.cpp tools/wasm/instr.cpp
+ *        -o build/hook_stack
+ * Usage: hook_stack [-s SOURCE] [-I DIR]... [--max-stack BYTES] [-q] in.wasm...
+ *
+ * Exit status is 0 on success, 1 when a call path is unbounded or deeper than
+ * the stack (or --max-stack), 2 on usage or parse errors.
+ */
+
+#include "wasm/instr.h"
+#include "wasm/module.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace wasm;
+
+namespace
+{
+
+constexpr uint64_t PAGE_SIZE = 65536;
+constexpr uint64_t UNBOUNDED = UINT64_MAX;
+constexpr int64_t UNKNOWN = -1;
+// a buffer matches a frame region this much smaller than it at most
+constexpr int64_t SLACK = 16;
+
+void usage()
+{
+    fprintf(stderr, "usage: hook_stack [-s SOURCE] [-I DIR]... [--max-stack BYTES] [-q] in.wasm...\n");
+}
+
+bool read_text(const std::string &path, std::string &out)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+std::string base_name(const std::string &path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+std::string dir_name(const std::string &path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+// --- the C source ---
+
+struct Macro
+{
+    std::string body;
+    std::string file;
+    int line = 0;
+};
+
+struct Array
+{
+    std::string decl; // name and dimensions as written
+    int64_t size = UNKNOWN;
+    int line = 0;
+    std::string macro; // declared in, empty when in the function itself
+    std::string file;  // of the macro
+    bool in_loop = false;
+};
+
+struct Source
+{
+    std::string path;
+    std::map<std::string, std::string> objects; // object-like #defines
+    std::map<std::string, Macro> macros;        // function-like ones
+    std::map<std::string, int64_t> structs;     // sizes on wasm32
+    std::map<std::string, int64_t> aligns;
+    std::map<std::string, std::vector<Array>> functions;
+};
+
+// comments replaced by spaces, newlines kept; with literals, also their contents
+std::string strip(const std::string &text, bool literals)
+{
+    std::string out = text;
+    for (size_t i = 0; i < out.size(); ++i)
+    {
+        if (out[i] == '/' && i + 1 < out.size() && out[i + 1] == '/')
+            for (; i < out.size() && out[i] != '\n'; ++i)
+                out[i] = ' ';
+        else if (out[i] == '/' && i + 1 < out.size() && out[i + 1] == '*')
+        {
+            size_t end = out.find("*/", i + 2);
+            end = end == std::string::npos ? out.size() : end + 2;
+            for (; i < end; ++i)
+                if (out[i] != '\n')
+                    out[i] = ' ';
+            --i;
+        }
+        else if (out[i] == '"' || out[i] == '\'')
+        {
+            char quote = out[i];
+            for (++i; i < out.size() && out[i] != quote && out[i] != '\n'; ++i)
+            {
+                if (out[i] == '\\' && i + 1 < out.size())
+                {
+                    if (literals)
+                        out[i] = ' ';
+                    ++i;
+                }
+                if (literals)
+                    out[i] = ' ';
+            }
+        }
+    }
+    return out;
+}
+
+int line_at(const std::string &text, size_t pos)
+{
+    return 1 + (int)std::count(text.begin(), text.begin() + (std::ptrdiff_t)std::min(pos, text.size()), '\n');
+}
+
+class Evaluator
+{
+public:
+    Evaluator(const Source &src, const std::string &text) : src_(src), text_(text) {}
+
+    std::optional<int64_t> run(int depth = 0)
+    {
+        depth_ = depth;
+        std::optional<int64_t> v = shift();
+        skip();
+        return pos_ == text_.size() ? v : std::nullopt;
+    }
+
+private:
+    void skip()
+    {
+        while (pos_ < text_.size() && isspace((unsigned char)text_[pos_]))
+            ++pos_;
+    }
+
+    bool eat(const char *op)
+    {
+        skip();
+        size_t n = strlen(op);
+        if (text_.compare(pos_, n, op) != 0)
+            return false;
+        // not the first half of << or >> when a single one is wanted
+        if (n == 1 && (op[0] == '<' || op[0] == '>') && pos_ + 1 < text_.size() && text_[pos_ + 1] == op[0])
+            return false;
+        pos_ += n;
+        return true;
+    }
+
+    std::string word()
+    {
+        skip();
+        size_t start = pos_;
+        while (pos_ < text_.size() && (isalnum((unsigned char)text_[pos_]) || text_[pos_] == '_'))
+            ++pos_;
+        return text_.substr(start, pos_ - start);
+    }
+
+    std::optional<int64_t> shift()
+    {
+        std::optional<int64_t> v = add();
+        while (v)
+        {
+            if (eat("<<"))
+            {
+                std::optional<int64_t> r = add();
+                v = r ? std::optional<int64_t>(*v << *r) : std::nullopt;
+            }
+            else if (eat(">>"))
+            {
+                std::optional<int64_t> r = add();
+                v = r ? std::optional<int64_t>(*v >> *r) : std::nullopt;
+            }
+            else
+                break;
+        }
+        return v;
+    }
+
+    std::optional<int64_t> add()
+    {
+        std::optional<int64_t> v = mul();
+        while (v)
+        {
+            if (eat("+"))
+            {
+                std::optional<int64_t> r = mul();
+                v = r ? std::optional<int64_t>(*v + *r) : std::nullopt;
+            }
+            else if (eat("-"))
+            {
+                std::optional<int64_t> r = mul();
+                v = r ? std::optional<int64_t>(*v - *r) : std::nullopt;
+            }
+            else
+                break;
+        }
+        return v;
+    }
+
+    std::optional<int64_t> mul()
+    {
+        std::optional<int64_t> v = unary();
+        while (v)
+        {
+            char op = eat("*") ? '*' : eat("/") ? '/' : eat("%") ? '%' : 0;
+            if (!op)
+                break;
+            std::optional<int64_t> r = unary();
+            if (!r || (op != '*' && *r == 0))
+                return std::nullopt;
+            v = op == '*' ? *v * *r : op == '/' ? *v / *r : *v % *r;
+        }
+        return v;
+    }
+
+    std::optional<int64_t> unary()
+    {
+        if (eat("-"))
+        {
+            std::optional<int64_t> v = unary();
+            return v ? std::optional<int64_t>(-*v) : std::nullopt;
+        }
+        if (eat("("))
+        {
+            // a cast to a scalar type is skipped
+            size_t at = pos_;
+            std::string type = word();
+            if (!type.empty() && eat(")") && scalar_size(type) > 0)
+                return unary();
+            pos_ = at;
+            std::optional<int64_t> v = shift();
+            return v && eat(")") ? v : std::nullopt;
+        }
+        skip();
+        if (pos_ < text_.size() && isdigit((unsigned char)text_[pos_]))
+        {
+            const char *start = text_.c_str() + pos_;
+            char *end;
+            int64_t v = (int64_t)strtoull(start, &end, 0);
+            pos_ += (size_t)(end - start);
+            while (pos_ < text_.size() && strchr("uUlL", text_[pos_]))
+                ++pos_;
+            return v;
+        }
+        std::string name = word();
+        if (name.empty())
+            return std::nullopt;
+        if (name == "sizeof" && eat("("))
+        {
+            std::string type = word();
+            if (type == "struct")
+            {
+                auto it = src_.structs.find(word());
+                return eat(")") && it != src_.structs.end() ? std::optional<int64_t>(it->second) : std::nullopt;
+            }
+            int64_t size = scalar_size(type);
+            return eat(")") && size > 0 ? std::optional<int64_t>(size) : std::nullopt;
+        }
+        auto it = src_.objects.find(name);
+        if (it == src_.objects.end() || depth_ > 16)
+            return std::nullopt;
+        return Evaluator(src_, it->second).run(depth_ + 1);
+    }
+
+public:
+    static int64_t scalar_size(const std::string &type)
+    {
+        static const std::map<std::string, int64_t> sizes = {
+            {"char", 1},     {"int8_t", 1},   {"uint8_t", 1},  {"int16_t", 2},  {"uint16_t", 2},
+            {"short", 2},    {"int", 4},      {"unsigned", 4}, {"int32_t", 4},  {"uint32_t", 4},
+            {"float", 4},    {"long", 4},     {"int64_t", 8},  {"uint64_t", 8}, {"double", 8},
+        };
+        auto it = sizes.find(type);
+        return it == sizes.end() ? UNKNOWN : it->second;
+    }
+
+private:
+    const Source &src_;
+    std::string text_;
+    size_t pos_ = 0;
+    int depth_ = 0;
+};
+
+std::optional<int64_t> evaluate(const Source &src, const std::string &expr)
+{
+    return Evaluator(src, expr).run();
+}
+
+// the element size of a declared type on wasm32, UNKNOWN when not known
+int64_t type_size(const Source &src, std::string type, int64_t *align = nullptr)
+{
+    type = std::regex_replace(type, std::regex("\\b(const|volatile|static|signed)\\b"), "");
+    type = std::regex_replace(type, std::regex("\\s+"), " ");
+    type = std::regex_replace(type, std::regex("^ | $"), "");
+    if (type.rfind("unsigned ", 0) == 0)
+        type = type.substr(9);
+    int64_t size = UNKNOWN, a = UNKNOWN;
+    if (!type.empty() && type.back() == '*')
+        size = a = 4;
+    else if (type.rfind("struct ", 0) == 0)
+    {
+        auto it = src.structs.find(type.substr(7));
+        if (it != src.structs.end())
+        {
+            size = it->second;
+            a = src.aligns.at(type.substr(7));
+        }
+    }
+    else
+        size = a = Evaluator::scalar_size(type);
+    if (align)
+        *align = a;
+    return size;
+}
+
+const char *const ELEMENT_TYPE = "((?:const\\s+)?(?:unsigned\\s+char|signed\\s+char|unsigned\\s+int|unsigned|char|int|"
+                                 "short|long|float|double|u?int(?:8|16|32|64)_t|struct\\s+\\w+))";
+
+// size of dims ("[A][B]") times the element, UNKNOWN when a dimension does not evaluate
+int64_t array_size(const Source &src, int64_t element, const std::string &dims)
+{
+    if (element == UNKNOWN)
+        return UNKNOWN;
+    int64_t size = element;
+    static const std::regex dim("\\[([^\\]]*)\\]");
+    for (std::sregex_iterator it(dims.begin(), dims.end(), dim), end; it != end; ++it)
+    {
+        std::optional<int64_t> n = evaluate(src, (*it)[1].str());
+        if (!n || *n < 0)
+            return UNKNOWN;
+        size *= *n;
+    }
+    return size;
+}
+
+// struct NAME { fields }; laid out with natural alignment
+void parse_structs(Source &src, const std::string &code)
+{
+    static const std::regex def("struct\\s+(\\w+)\\s*\\{([^{}]*)\\}");
+    static const std::regex member(std::string(ELEMENT_TYPE) + "\\s*(\\*?)\\s*(\\w+)\\s*((?:\\[[^\\]]*\\]\\s*)*)");
+    for (std::sregex_iterator it(code.begin(), code.end(), def), end; it != end; ++it)
+    {
+        std::string fields = (*it)[2].str();
+        int64_t offset = 0, max_align = 1;
+        bool known = true;
+        std::istringstream in(fields);
+        std::string field;
+        while (known && std::getline(in, field, ';'))
+        {
+            std::smatch m;
+            if (!std::regex_search(field, m, member))
+                continue;
+            int64_t a;
+            int64_t size = type_size(src, m[1].str() + m[2].str(), &a);
+            size = array_size(src, size, m[4].str());
+            if (size == UNKNOWN || a == UNKNOWN)
+                known = false;
+            else
+            {
+                offset = (offset + a - 1) / a * a + size;
+                max_align = std::max(max_align, a);
+            }
+        }
+        if (!known)
+            continue;
+        src.structs[(*it)[1].str()] = (offset + max_align - 1) / max_align * max_align;
+        src.aligns[(*it)[1].str()] = max_align;
+    }
+}
+
+// the array declarations in text, each at its line in file text
+std::vector<Array> arrays_in(const Source &src, const std::string &text, size_t base, const std::string &file)
+{
+    static const std::regex decl(std::string("(^|[;:{}(])\\s*") + ELEMENT_TYPE +
+                                 "\\s+(\\w+)\\s*((?:\\[[^\\]]+\\]\\s*)+)");
+    static const std::regex loop_head("\\b(for|while)\\s*\\([^{};]*(;[^{}]*)?\\)\\s*$|\\bdo\\s*$");
+    std::vector<Array> out;
+    for (std::sregex_iterator it(text.begin(), text.end(), decl), end; it != end; ++it)
+    {
+        const std::smatch &m = *it;
+        Array a;
+        a.decl = m[3].str() + std::regex_replace(m[4].str(), std::regex("\\s+"), "");
+        a.size = array_size(src, type_size(src, m[2].str()), m[4].str());
+        size_t at = (size_t)m.position(3);
+        a.line = line_at(file, base + at);
+        // inside a loop when an enclosing brace opens a for, while or do body
+        int depth = 0;
+        for (size_t p = at; p-- > 0;)
+        {
+            if (text[p] == '}')
+                ++depth;
+            else if (text[p] == '{' && depth-- == 0)
+            {
+                std::string head = text.substr(p > 200 ? p - 200 : 0, p > 200 ? 200 : p);
+                if (std::regex_search(head, loop_head))
+                {
+                    a.in_loop = true;
+                    break;
+                }
+                depth = 0;
+            }
+        }
+        out.push_back(a);
+    }
+    return out;
+}
+
+// the macros invoked in text, and in their bodies, down to depth 4
+void invoked(const Source &src, const std::string &text, std::set<std::string> &seen, int depth = 0)
+{
+    static const std::regex call("\\b([A-Z_][A-Z0-9_]*)\\s*\\(");
+    if (depth > 4)
+        return;
+    for (std::sregex_iterator it(text.begin(), text.end(), call), end; it != end; ++it)
+    {
+        std::string name = (*it)[1].str();
+        auto m = src.macros.find(name);
+        if (m != src.macros.end() && seen.insert(name).second)
+            invoked(src, m->second.body, seen, depth + 1);
+    }
+}
+
+void preprocess(Source &src, const std::string &path, const std::vector<std::string> &includes,
+                std::set<std::string> &visited, std::string *main_code)
+{
+    std::string raw;
+    if (!visited.insert(path).second || !read_text(path, raw))
+        return;
+    std::string text = strip(raw, false);
+    std::string code = strip(raw, true);
+    static const std::regex include("^\\s*#\\s*include\\s*\"([^\"]+)\"");
+    static const std::regex object("^\\s*#\\s*define\\s+(\\w+)(?:\\s+(.*))?$");
+    static const std::regex function("^\\s*#\\s*define\\s+(\\w+)\\(([^)]*)\\)\\s*(.*)$");
+    static const std::regex undef("^\\s*#\\s*undef\\s+(\\w+)");
+    size_t pos = 0;
+    int line = 1;
+    while (pos < text.size())
+    {
+        size_t end = text.find('\n', pos);
+        end = end == std::string::npos ? text.size() : end;
+        std::string l = text.substr(pos, end - pos);
+        int first = line;
+        // continuation lines, blanked in code like the directive itself
+        bool directive = l.find_first_not_of(" \t") != std::string::npos && l[l.find_first_not_of(" \t")] == '#';
+        while (directive && !l.empty() && l.back() == '\\' && end < text.size())
+        {
+            size_t next = text.find('\n', end + 1);
+            next = next == std::string::npos ? text.size() : next;
+            l = l.substr(0, l.size() - 1) + " " + text.substr(end + 1, next - end - 1);
+            ++line;
+            end = next;
+        }
+        if (directive)
+            for (size_t p = pos; p < end; ++p)
+                if (code[p] != '\n')
+                    code[p] = ' ';
+        std::smatch m;
+        if (directive && std::regex_search(l, m, include))
+        {
+            std::string name = m[1].str();
+            std::string found = dir_name(path) + "/" + name;
+            for (size_t i = 0; i < includes.size() && !std::ifstream(found); ++i)
+                found = includes[i] + "/" + name;
+            preprocess(src, found, includes, visited, nullptr);
+        }
+        else if (directive && std::regex_match(l, m, function))
+        {
+            if (!src.macros.count(m[1].str()))
+                src.macros[m[1].str()] = Macro{m[3].str(), base_name(path), first};
+        }
+        else if (directive && std::regex_match(l, m, object))
+        {
+            if (!src.objects.count(m[1].str()))
+                src.objects[m[1].str()] = m[2].matched ? m[2].str() : "";
+        }
+        else if (directive && std::regex_search(l, m, undef))
+        {
+            src.objects.erase(m[1].str());
+            src.macros.erase(m[1].str());
+        }
+        pos = end + 1;
+        ++line;
+    }
+    parse_structs(src, code);
+    if (main_code)
+        *main_code = code;
+}
+
+bool load_source(Source &src, const std::string &path, const std::vector<std::string> &includes)
+{
+    std::string raw, code;
+    if (!read_text(path, raw))
+        return false;
+    src.path = path;
+    std::set<std::string> visited;
+    preprocess(src, path, includes, visited, &code);
+
+    // function definitions at file level: NAME(...) followed by a body
+    static const std::regex head("(\\w+)\\s*\\([^()]*\\)\\s*$");
+    int depth = 0;
+    size_t stmt = 0;
+    for (size_t i = 0; i < code.size(); ++i)
+    {
+        if (code[i] == '{' && depth++ == 0)
+        {
+            std::string before = code.substr(stmt, i - stmt);
+            std::smatch m;
+            size_t close = i;
+            for (int d = 0; close < code.size(); ++close)
+            {
+                d += code[close] == '{';
+                if (code[close] == '}' && --d == 0)
+                    break;
+            }
+            if (before.find('=') == std::string::npos && std::regex_search(before, m, head))
+            {
+                std::string body = code.substr(i, close - i + 1);
+                std::vector<Array> arrays = arrays_in(src, body, i, raw);
+                std::set<std::string> macros;
+                invoked(src, body, macros);
+                for (const std::string &name : macros)
+                {
+                    const Macro &mac = src.macros.at(name);
+                    for (Array a : arrays_in(src, mac.body, 0, ""))
+                    {
+                        a.line = mac.line;
+                        a.macro = name;
+                        a.file = mac.file;
+                        arrays.push_back(a);
+                    }
+                }
+                src.functions[m[1].str()] = arrays;
+            }
+        }
+        else if (code[i] == '}' && depth > 0 && --depth == 0)
+            stmt = i + 1;
+        else if (code[i] == ';' && depth == 0)
+            stmt = i + 1;
+    }
+    return true;
+}
+
+// --- the module ---
+
+struct Frame
+{
+    uint64_t size = 0;
+    uint64_t zeroed = 0; // constant-length memory.fill and memset
+    std::vector<uint32_t> calls;
+    size_t indirect = 0;
+    std::set<int64_t> offsets; // taken from the frame pointer
+};
+
+struct Layout
+{
+    std::optional<uint32_t> stack_pointer; // global index
+    uint64_t sp_init = 0;
+    uint64_t data_start = UINT64_MAX;
+    uint64_t data_end = 0;
+    uint64_t data_bytes = 0;
+    uint64_t memory = 0; // initial bytes
+    uint64_t stack = 0;  // below the initial stack pointer
+};
+
+// the __stack_pointer global: read, lowered by a constant and written back
+std::optional<uint32_t> find_stack_pointer(const Module &m)
+{
+    for (const Function &f : m.functions)
+    {
+        std::vector<Instr> code = decode(f.body);
+        for (size_t k = 0; k + 2 < code.size() && k < 8; ++k)
+            if (code[k].op == OP_GLOBAL_GET && code[k + 1].op == OP_I32_CONST && code[k + 2].op == 0x6B)
+                return (uint32_t)code[k].imm;
+    }
+    return std::nullopt;
+}
+
+Frame frame_of(const Module &m, const Function &f, std::optional<uint32_t> sp)
+{
+    Frame fr;
+    std::vector<Instr> code = decode(f.body);
+    std::optional<uint32_t> memset = m.find_import("memset");
+    int64_t fp = -1;
+    for (size_t k = 0; k < code.size(); ++k)
+    {
+        const Instr &in = code[k];
+        const Instr *next = k + 1 < code.size() ? &code[k + 1] : nullptr;
+        const Instr *prev = k > 0 ? &code[k - 1] : nullptr;
+        // global.get sp; i32.const N; i32.sub; local.tee/set fp
+        if (fp < 0 && sp && in.op == OP_GLOBAL_GET && in.imm == *sp && k + 3 < code.size() &&
+            code[k + 1].op == OP_I32_CONST && code[k + 2].op == 0x6B &&
+            (code[k + 3].op == OP_LOCAL_TEE || code[k + 3].op == OP_LOCAL_SET))
+        {
+            fr.size = (uint64_t)(uint32_t)code[k + 1].imm;
+            fp = code[k + 3].imm;
+            k += 3;
+            continue;
+        }
+        if (in.op == OP_LOCAL_GET && fp >= 0 && in.imm == fp && next)
+        {
+            if (next->is_load() || next->is_store())
+                continue;
+            if (next->op == OP_I32_CONST && k + 2 < code.size() && code[k + 2].op == 0x6A)
+                fr.offsets.insert(next->imm);
+            else if (prev && prev->op == OP_I32_CONST && next->op == 0x6A)
+                fr.offsets.insert(prev->imm);
+            else if (next->op != OP_I32_CONST && next->op != OP_GLOBAL_SET)
+                fr.offsets.insert(0);
+        }
+        else if (in.op == OP_MEMORY_FILL && prev && prev->op == OP_I32_CONST)
+            fr.zeroed += (uint64_t)(uint32_t)prev->imm;
+        else if (in.op == OP_CALL)
+        {
+            if (memset && in.imm == *memset && prev && prev->op == OP_I32_CONST)
+                fr.zeroed += (uint64_t)(uint32_t)prev->imm;
+            if (!m.is_import((uint32_t)in.imm))
+                fr.calls.push_back((uint32_t)in.imm);
+        }
+        else if (in.op == OP_CALL_INDIRECT)
+            ++fr.indirect;
+    }
+    for (auto it = fr.offsets.begin(); it != fr.offsets.end();)
+        it = *it < 0 || (uint64_t)*it >= fr.size ? fr.offsets.erase(it) : std::next(it);
+    return fr;
+}
+
+Layout layout_of(const Module &m)
+{
+    Layout l;
+    l.stack_pointer = find_stack_pointer(m);
+    if (!m.memories.empty())
+        l.memory = m.memories[0].min * PAGE_SIZE;
+    for (const Import &im : m.imports)
+        if (im.kind == KIND_MEMORY)
+            l.memory = im.memory.min * PAGE_SIZE;
+    for (const Data &d : m.data)
+    {
+        l.data_bytes += d.bytes.size();
+        std::vector<Instr> offset = d.offset.empty() ? std::vector<Instr>() : decode(d.offset);
+        if (d.passive || offset.empty() || offset[0].op != OP_I32_CONST)
+            continue;
+        uint64_t at = (uint64_t)(uint32_t)offset[0].imm;
+        l.data_start = std::min(l.data_start, at);
+        l.data_end = std::max(l.data_end, at + d.bytes.size());
+    }
+    uint32_t imported = m.imported_globals();
+    if (l.stack_pointer && *l.stack_pointer >= imported)
+    {
+        std::vector<Instr> init = decode(m.globals.at(*l.stack_pointer - imported).init);
+        if (!init.empty() && init[0].op == OP_I32_CONST)
+            l.sp_init = (uint64_t)(uint32_t)init[0].imm;
+    }
+    // stack after the data by default, before it with --stack-first
+    if (l.sp_init && l.data_end && l.sp_init > l.data_end)
+        l.stack = l.sp_init - l.data_end;
+    else
+        l.stack = l.sp_init;
+    return l;
+}
+
+// deepest stack along direct calls from func, UNBOUNDED through recursion
+uint64_t depth(const Module &m, const std::vector<Frame> &frames, uint32_t func, std::vector<int> &state,
+               std::vector<uint64_t> &memo, std::vector<int64_t> &via)
+{
+    if (m.is_import(func))
+        return 0;
+    uint32_t i = func - m.imported_funcs();
+    if (state[i] == 2)
+        return memo[i];
+    if (state[i] == 1)
+        return UNBOUNDED;
+    state[i] = 1;
+    uint64_t deepest = 0;
+    for (uint32_t callee : frames[i].calls)
+    {
+        uint64_t d = depth(m, frames, callee, state, memo, via);
+        if (d > deepest || via[i] < 0)
+        {
+            deepest = std::max(deepest, d);
+            via[i] = callee;
+        }
+    }
+    state[i] = 2;
+    memo[i] = deepest == UNBOUNDED ? UNBOUNDED : frames[i].size + deepest;
+    return memo[i];
+}
+
+std::string size_text(uint64_t v)
+{
+    return v == UNBOUNDED ? "unbounded" : std::to_string(v);
+}
+
+// frame regions with the buffers matched to them
+void attribute(const Frame &fr, const std::vector<Array> &arrays, const std::string &source)
+{
+    struct Region
+    {
+        int64_t offset;
+        int64_t size;
+        std::vector<const Array *> buffers;
+    };
+    std::vector<Region> regions;
+    for (auto it = fr.offsets.begin(); it != fr.offsets.end(); ++it)
+    {
+        auto next = std::next(it);
+        regions.push_back({*it, (next == fr.offsets.end() ? (int64_t)fr.size : *next) - *it, {}});
+    }
+    std::vector<const Array *> order;
+    for (const Array &a : arrays)
+        order.push_back(&a);
+    std::stable_sort(order.begin(), order.end(), [](const Array *a, const Array *b) { return a->size > b->size; });
+    std::vector<const Array *> missing;
+    for (const Array *a : order)
+    {
+        // best fit, preferring a region no buffer took yet
+        Region *best = nullptr;
+        for (Region &r : regions)
+        {
+            if (a->size == UNKNOWN || r.size < a->size || r.size - a->size >= SLACK)
+                continue;
+            // slots are shared by buffers of one size, as stack coloring does for disjoint scopes
+            if (!r.buffers.empty() && r.buffers[0]->size != a->size)
+                continue;
+            if (!best || (best->buffers.empty() != r.buffers.empty() ? r.buffers.empty() : r.size < best->size))
+                best = &r;
+        }
+        if (best)
+            best->buffers.push_back(a);
+        else
+            missing.push_back(a);
+    }
+
+    std::string file = base_name(source);
+    auto where = [&](const Array *a) {
+        std::string s = (a->file.empty() ? file : a->file) + ":" + std::to_string(a->line);
+        if (!a->macro.empty())
+            s += " in " + a->macro;
+        if (a->in_loop)
+            s += ", in a loop";
+        return s;
+    };
+    int64_t attributed = 0;
+    for (const Region &r : regions)
+    {
+        if (r.buffers.empty())
+        {
+            printf("    %8" PRId64 " %8" PRId64 "  %s\n", r.offset, r.size, "-");
+            continue;
+        }
+        attributed += r.size;
+        for (size_t i = 0; i < r.buffers.size(); ++i)
+        {
+            const Array *a = r.buffers[i];
+            if (i == 0)
+                printf("    %8" PRId64 " %8" PRId64 "  %-40s %6" PRId64 "  %s\n", r.offset, r.size, a->decl.c_str(),
+                       a->size, where(a).c_str());
+            else
+                printf("    %8s %8s  %-40s %6" PRId64 "  %s, shares the slot\n", "", "", a->decl.c_str(), a->size,
+                       where(a).c_str());
+        }
+    }
+    printf("    %" PRId64 " of %" PRIu64 " bytes attributed\n", attributed, fr.size);
+    for (const Array *a : missing)
+        printf("    not in the frame: %s (%s bytes) %s\n", a->decl.c_str(),
+               a->size == UNKNOWN ? "?" : std::to_string(a->size).c_str(), where(a).c_str());
+}
+
+// reports one module, false when a path is unbounded or too deep
+bool report(const std::string &path, const std::string &source_path, const std::vector<std::string> &includes,
+            uint64_t max_stack, bool quiet, bool &failed)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        fprintf(stderr, "hook_stack: cannot read %s\n", path.c_str());
+        failed = true;
+        return false;
+    }
+    std::vector<uint8_t> bin((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    Module m;
+    std::vector<Frame> frames;
+    Layout l;
+    try
+    {
+        m = Module::parse(bin);
+        l = layout_of(m);
+        for (const Function &f : m.functions)
+            frames.push_back(frame_of(m, f, l.stack_pointer));
+    }
+    catch (const ParseError &e)
+    {
+        fprintf(stderr, "hook_stack: %s: %s\n", path.c_str(), e.what());
+        failed = true;
+        return false;
+    }
+
+    Source src;
+    std::string guess = source_path;
+    if (guess.empty())
+    {
+        std::string name = base_name(path);
+        guess = "src/ready/" + name.substr(0, name.rfind('.')) + ".c";
+    }
+    bool have_source = load_source(src, guess, includes);
+    if (!have_source && !source_path.empty())
+    {
+        fprintf(stderr, "hook_stack: cannot read %s\n", source_path.c_str());
+        failed = true;
+        return false;
+    }
+
+    size_t n = m.functions.size();
+    std::vector<int> state(n, 0);
+    std::vector<uint64_t> memo(n, 0);
+    std::vector<int64_t> via(n, -1);
+    uint64_t limit = max_stack ? max_stack : l.stack;
+    bool ok = true;
+
+    printf("%s: data %" PRIu64 " bytes in %zu segments, stack %" PRIu64 " bytes below %#" PRIx64
+           ", memory %" PRIu64 " pages\n",
+           path.c_str(), l.data_bytes, m.data.size(), l.stack, l.sp_init, l.memory / PAGE_SIZE);
+    if (!l.stack_pointer)
+        printf("  no stack pointer: every function keeps its state in locals\n");
+    printf("  %-24s %8s %8s %8s  %s\n", "function", "frame", "zeroed", "path", "deepest call path");
+    std::vector<std::pair<std::string, uint32_t>> roots;
+    for (const Export &e : m.exports)
+        if (e.kind == KIND_FUNC && !m.is_import(e.index))
+            roots.emplace_back(e.name, e.index);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        uint32_t func = m.imported_funcs() + i;
+        uint64_t d = depth(m, frames, func, state, memo, via);
+        if (quiet && !frames[i].size && !frames[i].zeroed)
+            continue;
+        std::string chain = m.func_name(func);
+        std::set<int64_t> seen{func};
+        for (int64_t f = via[i]; f >= 0 && !m.is_import((uint32_t)f); f = via[f - m.imported_funcs()])
+        {
+            chain += " > " + m.func_name((uint32_t)f);
+            if (!seen.insert(f).second)
+                break;
+        }
+        printf("  %-24s %8" PRIu64 " %8" PRIu64 " %8s  %s%s\n", m.func_name(func).c_str(), frames[i].size,
+               frames[i].zeroed, size_text(d).c_str(), chain.c_str(),
+               frames[i].indirect ? " (indirect calls not followed)" : "");
+    }
+    for (const auto &[name, func] : roots)
+    {
+        uint64_t d = memo[func - m.imported_funcs()];
+        bool over = d == UNBOUNDED || (limit && d > limit);
+        printf("  %-8s deepest %s of %" PRIu64 " bytes%s\n", name.c_str(), size_text(d).c_str(), limit,
+               over ? ", over the limit" : "");
+        ok = ok && !over;
+    }
+
+    if (!quiet)
+    {
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            uint32_t func = m.imported_funcs() + i;
+            if (!frames[i].size)
+                continue;
+            // exports by their export name, others by the name section
+            std::string name = m.func_name(func);
+            for (const auto &[export_name, index] : roots)
+                if (index == func)
+                    name = export_name;
+            auto it = src.functions.find(name);
+            printf("\n  %s: frame %" PRIu64 " bytes, %zu address-taken offsets\n", name.c_str(), frames[i].size,
+                   frames[i].offsets.size());
+            printf("    %8s %8s  %-40s %6s  %s\n", "offset", "region", "buffer", "bytes", "declared");
+            attribute(frames[i], it == src.functions.end() ? std::vector<Array>() : it->second, src.path);
+        }
+        if (!have_source)
+            printf("\n  no source at %s for attribution (-s)\n", guess.c_str());
+    }
+    printf("\n");
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string source;
+    std::vector<std::string> includes, paths;
+    uint64_t max_stack = 0;
+    bool quiet = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-s" && i + 1 < argc)
+            source = argv[++i];
+        else if (arg == "-I" && i + 1 < argc)
+            includes.push_back(argv[++i]);
+        else if (arg == "--max-stack" && i + 1 < argc)
+            max_stack = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "-q")
+            quiet = true;
+        else if (!arg.empty() && arg[0] != '-')
+            paths.push_back(arg);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (paths.empty() || (!source.empty() && paths.size() > 1))
+    {
+        usage();
+        return 2;
+    }
+    includes.push_back("lib");
+
+    bool ok = true, failed = false;
+    for (const std::string &path : paths)
+        ok = report(path, source, includes, max_stack, quiet, failed) && ok;
+    return failed ? 2 : ok ? 0 : 1;
+}
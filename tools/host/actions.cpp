@@ -0,0 +1,734 @@
+#include "actions.h"
+
+#include "base58.h"
+#include "keylet.h"
+#include "sfcodes.h"
+#include "sha512.h"
+#include "stobject.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace actions
+{
+
+namespace
+{
+
+void amount_field(sto::Writer &w, uint32_t code, const Amount &a)
+{
+    if (!a.currency)
+    {
+        w.drops(code, a.value);
+        return;
+    }
+    uint64_t mantissa = a.value;
+    int exponent = -6;
+    for (; mantissa < 1000000000000000ULL; mantissa *= 10)
+        --exponent;
+    for (; mantissa >= 10000000000000000ULL; mantissa /= 10)
+        ++exponent;
+    w.iou(code, mantissa, exponent, a.currency, a.issuer.data());
+}
+
+} // namespace
+
+const std::vector<Hook> &hooks()
+{
+    static const std::vector<Hook> list = {
+        {"loan", LOAN, {}, 0},
+        {"launchpad_meme", LAUNCHPAD, {100 * XRP, 270 * XRP, 400 * XRP}, 5},
+        {"launchpad_sec", LAUNCHPAD, {500 * XRP, 950 * XRP}, 5},
+        {"ticket_flight", TICKET, {50 * XRP, 250 * XRP, 750 * XRP}, 4},
+        {"ticket_playoff", TICKET, {50 * XRP, 150 * XRP, 500 * XRP}, 4},
+        {"lottery_number", LOTTERY_NUMBER, {10 * XRP, 100 * XRP, 1000 * XRP}, 0},
+        {"lottery_random", LOTTERY_RANDOM, {10 * XRP, 100 * XRP, 1000 * XRP}, 0},
+        {"lottery_doubler", DOUBLER, {10 * XRP, 100 * XRP, 1000 * XRP}, 0},
+    };
+    return list;
+}
+
+AccountID account(uint32_t n)
+{
+    uint8_t seed[4] = {(uint8_t)(n >> 24), (uint8_t)(n >> 16), (uint8_t)(n >> 8), (uint8_t)n};
+    uint8_t digest[sha512::HALF_SIZE];
+    sha512::half(seed, sizeof(seed), digest);
+    AccountID id;
+    std::memcpy(id.data(), digest, ACCOUNT_ID_SIZE);
+    id[0] |= 1;
+    return id;
+}
+
+AccountID named(const char *raddr)
+{
+    AccountID id{};
+    base58::decode_account(raddr, std::strlen(raddr), id.data());
+    return id;
+}
+
+Amount drops(uint64_t value) { return Amount{value}; }
+
+Amount iou(uint64_t units, const char *currency, const AccountID &issuer)
+{
+    return Amount{units * XRP, currency, issuer};
+}
+
+std::vector<uint8_t> payment(const AccountID &from, const AccountID &to, const Amount &amount, uint32_t tag,
+                             uint32_t sequence, const std::string &memo)
+{
+    sto::Writer w;
+    amount_field(w, sfAmount, amount);
+    // the field header is one byte
+    return payment(from, to, std::vector<uint8_t>(w.out.begin() + 1, w.out.end()), tag, sequence, memo);
+}
+
+std::vector<uint8_t> payment(const AccountID &from, const AccountID &to, const std::vector<uint8_t> &amount,
+                             uint32_t tag, uint32_t sequence, const std::string &memo)
+{
+    static const uint8_t pubkey[33] = {0x02};
+    static const char type[] = "Description", format[] = "text/plain";
+    sto::Writer w;
+    w.uint(sfTransactionType, ttPAYMENT, 2);
+    w.uint(sfFlags, 0, 4);
+    w.uint(sfSequence, sequence, 4);
+    w.uint(sfDestinationTag, tag, 4);
+    w.bytes(sfAmount, amount.data(), amount.size());
+    w.drops(sfFee, 12);
+    w.vl(sfSigningPubKey, pubkey, sizeof(pubkey));
+    w.vl(sfAccount, from.data(), ACCOUNT_ID_SIZE);
+    w.vl(sfDestination, to.data(), ACCOUNT_ID_SIZE);
+    if (!memo.empty())
+    {
+        w.begin(sfMemos);
+        w.begin(sfMemo);
+        w.vl(sfMemoType, (const uint8_t *)type, sizeof(type) - 1);
+        w.vl(sfMemoData, (const uint8_t *)memo.data(), memo.size());
+        w.vl(sfMemoFormat, (const uint8_t *)format, sizeof(format) - 1);
+        w.end_object();
+        w.end_array();
+    }
+    return w.out;
+}
+
+uint16_t transaction_type(const std::vector<uint8_t> &tx)
+{
+    sto::Index index;
+    if (!index.parse(tx.data(), tx.size()))
+        return 0xFFFF;
+    uint32_t n = index.find(sto::Index::ROOT, sfTransactionType);
+    if (n == sto::Index::NOT_FOUND || index.field(n).payload_size != 2)
+        return 0xFFFF;
+    const uint8_t *p = index.payload(n);
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+Bench::Bench(const Hook &hook, const std::vector<uint8_t> &wasm,
+             const std::function<void(wasm::Imports &)> &interpose)
+    : hook(hook), id(account(0))
+{
+    hostapi::bind(imports_, ctx);
+    if (interpose)
+        interpose(imports_);
+    module_ = wasm::Module::parse(wasm);
+    instance_ = std::make_unique<wasm::Instance>(module_, imports_);
+    std::memcpy(ctx.hook_account, id.data(), ACCOUNT_ID_SIZE);
+    sha512::half(wasm.data(), wasm.size(), ctx.hook_hash);
+    ctx.ledger_seq = 2;
+    ctx.ledger_last_time = OPEN_TIME;
+}
+
+Step Bench::pay(const AccountID &from, const Amount &amount, uint32_t tag, const std::string &memo)
+{
+    return Step{payment(from, id, amount, tag, sequence_++, memo), {}};
+}
+
+Step Bench::callback(const std::vector<uint8_t> &emitted, uint8_t result)
+{
+    if (result == tesSUCCESS && transaction_type(emitted) == ttNFTOKEN_MINT)
+        ++minted_;
+    sto::Writer meta;
+    meta.uint(sfTransactionIndex, 0, 4);
+    meta.begin(sfAffectedNodes);
+    meta.begin(sfModifiedNode);
+    meta.uint(sfLedgerEntryType, keylet::LT_ACCOUNT_ROOT, 2);
+    meta.bytes(sfLedgerIndex, keylet::account(id.data()).key, hostapi::HASH_SIZE);
+    meta.begin(sfFinalFields);
+    meta.uint(sfFlags, 0, 4);
+    meta.uint(sfSequence, 1, 4);
+    meta.uint(sfOwnerCount, minted_, 4);
+    if (minted_)
+        meta.uint(sfMintedNFTokens, minted_, 4);
+    meta.drops(sfBalance, 100000 * XRP);
+    meta.vl(sfAccount, id.data(), ACCOUNT_ID_SIZE);
+    meta.end_object();
+    meta.end_object();
+    meta.end_array();
+    meta.uint(sfTransactionResult, result, 1);
+    return Step{emitted, std::move(meta.out)};
+}
+
+bool Bench::apply(const Step &step)
+{
+    prepare(step);
+    hostapi::run(*instance_, ctx, !step.meta.empty());
+    bool accepted = ctx.exit == Exit::ACCEPT;
+    emitted_ = ctx.emitted;
+    hostapi::finish(ctx, accepted);
+    return accepted;
+}
+
+void Bench::mint_callbacks()
+{
+    std::vector<std::vector<uint8_t>> pending = emitted_;
+    for (const std::vector<uint8_t> &tx : pending)
+        if (transaction_type(tx) == ttNFTOKEN_MINT)
+            apply(callback(tx, tesSUCCESS));
+}
+
+size_t Bench::trial(const Step &step)
+{
+    prepare(step);
+    hostapi::run(*instance_, ctx, !step.meta.empty());
+    size_t n = ctx.exit == Exit::ACCEPT ? ctx.emitted.size() : 0;
+    hostapi::finish(ctx, false);
+    return n;
+}
+
+bool Bench::accepts(const Step &step)
+{
+    prepare(step);
+    hostapi::run(*instance_, ctx, !step.meta.empty());
+    bool accepted = ctx.exit == Exit::ACCEPT;
+    hostapi::finish(ctx, false);
+    return accepted;
+}
+
+Sample Bench::measure(const Step &step, int runs)
+{
+    Sample s{};
+    std::vector<double> ns;
+    prepare(step);
+    for (int i = 0; i < runs; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        hostapi::Outcome out = hostapi::run(*instance_, ctx, !step.meta.empty());
+        ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        if (i == 0)
+        {
+            s.out = out;
+            s.message = ctx.message;
+            for (const auto &g : ctx.guards)
+                s.guard_iterations += g.second;
+            s.state_read_bytes = ctx.state_read_bytes;
+            s.state_written_bytes = ctx.state_written_bytes;
+            s.state_writes = ctx.state_writes;
+            s.emitted = ctx.emitted.size();
+            for (const std::vector<uint8_t> &tx : ctx.emitted)
+            {
+                s.emitted_bytes += tx.size();
+                sto::Index index;
+                if (index.parse(tx.data(), tx.size()))
+                {
+                    uint32_t details = index.find(sto::Index::ROOT, sfEmitDetails);
+                    if (details != sto::Index::NOT_FOUND &&
+                        index.find(details, sfEmitCallback) == sto::Index::NOT_FOUND)
+                        ++s.uncalled;
+                }
+            }
+        }
+        hostapi::finish(ctx, false);
+    }
+    std::sort(ns.begin(), ns.end());
+    s.median_ns = ns[ns.size() / 2];
+    s.min_ns = ns[0];
+    return s;
+}
+
+void Bench::prepare(const Step &step)
+{
+    ctx.set_otxn(step.otxn);
+    ctx.meta = step.meta;
+}
+
+// loan.c
+
+std::string loan_offer(int role, int loan_currency, uint64_t loan_amount, int collateral_currency,
+                       uint64_t collateral_amount, uint32_t interest, uint32_t period)
+{
+    char memo[64];
+    snprintf(memo, sizeof(memo), "1%d%03d%020" PRIu64 "%03d%020" PRIu64 "%05u%05u", role, loan_currency, loan_amount,
+             collateral_currency, collateral_amount, interest, period);
+    return memo;
+}
+
+std::string loan_action(int action, const LoanID &loan)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    std::string memo(1, (char)('0' + action));
+    for (uint8_t b : loan)
+    {
+        memo.push_back(digits[b >> 4]);
+        memo.push_back(digits[b & 15]);
+    }
+    return memo;
+}
+
+std::string loan_outbox_action(int action) { return std::string(1, (char)('0' + action)); }
+
+namespace
+{
+
+const AccountID PAYOUT = named("r9BjimZAz1a84k9eHnkRpPbv2aE6p1DThL");
+const AccountID LOAN_OPERATOR = named("rfohbAu5HbCT2PMnu1Nu3fNmTK9ZodBoSW");
+const AccountID USD_ISSUER = named("rajuXb5NwEyRZSKUzNLaevMwo8hmzVQQNS");
+const AccountID EUR_ISSUER = named("r43MzJE8EPcb2hLJjh1aGR2pFwjc6T9czo");
+
+const AccountID MAKER = account(1);
+const AccountID TAKER = account(2);
+
+// a lender offering 100 XRP against 150 XRP
+Step loan_make_xrp(Bench &b, const AccountID &maker)
+{
+    return b.pay(maker, drops(110 * XRP), 0, loan_offer(2, 0, 100 * XRP, 0, 150 * XRP, 5000, 30));
+}
+
+Step loan_make_xrp(Bench &b) { return loan_make_xrp(b, MAKER); }
+
+// the offer made, returns its ID
+LoanID loan_make(Bench &b, const AccountID &maker = MAKER)
+{
+    uint32_t time = b.ctx.ledger_last_time, seq = b.sequence();
+    LoanID id{};
+    if (!b.apply(loan_make_xrp(b, maker)))
+        return id;
+    // the key is the ledger time and the sequence, the rest is what was on the stack
+    for (const auto &kv : b.ctx.state.base())
+    {
+        const uint8_t *key = kv.first.data() + ACCOUNT_ID_SIZE + hookstate::NAMESPACE_SIZE;
+        uint8_t prefix[12] = {0, 0, 0, 0, (uint8_t)(time >> 24), (uint8_t)(time >> 16), (uint8_t)(time >> 8),
+                              (uint8_t)time, (uint8_t)(seq >> 24), (uint8_t)(seq >> 16), (uint8_t)(seq >> 8),
+                              (uint8_t)seq};
+        if (kv.second.size() == 85 && std::memcmp(key, prefix, sizeof(prefix)) == 0)
+            std::memcpy(id.data(), key, id.size());
+    }
+    return id;
+}
+
+// a refund to the maker that failed, so the maker is owed it
+void loan_failed_refund(Bench &b, const AccountID &maker = MAKER)
+{
+    LoanID loan = loan_make(b, maker);
+    b.apply(b.pay(maker, drops(XRP), 0, loan_action(2, loan)));
+    b.apply(b.callback(b.emitted()[0], tecPATH_DRY));
+}
+
+// a USD offer against EUR collateral: a trustline check and an IOU fee
+Step loan_make_iou(Bench &b)
+{
+    uint8_t eur[20] = {0};
+    std::memcpy(eur + 12, "EUR", 3);
+    sto::Writer line;
+    line.uint(sfLedgerEntryType, keylet::LT_RIPPLE_STATE, 2);
+    line.uint(sfFlags, 0, 4);
+    line.iou(sfLowLimit, 1000000000000000ULL, -9, "EUR", EUR_ISSUER.data());
+    line.iou(sfHighLimit, 1000000000000000ULL, -9, "EUR", MAKER.data());
+    hostapi::Keylet k;
+    keylet::line(EUR_ISSUER.data(), MAKER.data(), eur).serialize(k.data());
+    b.ctx.ledger[k] = line.out;
+    return b.pay(MAKER, iou(110, "USD", USD_ISSUER), 0, loan_offer(2, 3, 100 * XRP, 2, 150 * XRP, 5000, 30));
+}
+
+Step loan_cancel(Bench &b)
+{
+    LoanID loan = loan_make(b);
+    return b.pay(MAKER, drops(XRP), 0, loan_action(2, loan));
+}
+
+Step loan_take(Bench &b)
+{
+    LoanID loan = loan_make(b);
+    return b.pay(TAKER, drops(150 * XRP), 0, loan_action(3, loan));
+}
+
+Step loan_repay(Bench &b)
+{
+    LoanID loan = loan_make(b);
+    b.apply(b.pay(TAKER, drops(150 * XRP), 0, loan_action(3, loan)));
+    return b.pay(TAKER, drops(100 * XRP), 0, loan_action(4, loan));
+}
+
+Step loan_close(Bench &b)
+{
+    LoanID loan = loan_make(b);
+    b.apply(b.pay(TAKER, drops(150 * XRP), 0, loan_action(3, loan)));
+    b.ctx.ledger_last_time += 31 * 24 * 60 * 60;
+    return b.pay(MAKER, drops(XRP), 0, loan_action(5, loan));
+}
+
+Step loan_resend(Bench &b)
+{
+    loan_failed_refund(b);
+    return b.pay(MAKER, drops(XRP), 0, loan_outbox_action(6));
+}
+
+Step loan_flush(Bench &b)
+{
+    loan_failed_refund(b);
+    return b.pay(LOAN_OPERATOR, drops(XRP), 0, loan_outbox_action(7));
+}
+
+// a full page of OUTBOX_FLUSH_PAGE (2) owed accounts
+Step loan_flush_page(Bench &b)
+{
+    loan_failed_refund(b);
+    loan_failed_refund(b, TAKER);
+    return b.pay(LOAN_OPERATOR, drops(XRP), 0, loan_outbox_action(7));
+}
+
+// four accounts owed, the middle two resend and then the first, so the head
+// of the outbox queue sits on two holes in front of the last one
+void loan_outbox_holes(Bench &b)
+{
+    const AccountID owed[] = {MAKER, TAKER, account(3), account(4)};
+    for (const AccountID &a : owed)
+        loan_failed_refund(b, a);
+    for (int i : {1, 2, 0})
+        b.apply(b.pay(owed[i], drops(XRP), 0, loan_outbox_action(6)));
+}
+
+// the holes are skipped without taking a page slot, the last account is paid
+Step loan_resend_flush(Bench &b)
+{
+    loan_outbox_holes(b);
+    return b.pay(LOAN_OPERATOR, drops(XRP), 0, loan_outbox_action(7));
+}
+
+// nothing but holes left: the head still moves and the queue drains
+Step loan_flush_holes(Bench &b)
+{
+    loan_outbox_holes(b);
+    b.apply(b.pay(account(4), drops(XRP), 0, loan_outbox_action(6)));
+    return b.pay(LOAN_OPERATOR, drops(XRP), 0, loan_outbox_action(7));
+}
+
+Step loan_cbak_success(Bench &b)
+{
+    LoanID loan = loan_make(b);
+    b.apply(b.pay(MAKER, drops(XRP), 0, loan_action(2, loan)));
+    return b.callback(b.emitted()[0], tesSUCCESS);
+}
+
+// the first failure owed to an account creates its outbox entry
+Step loan_cbak_failed(Bench &b)
+{
+    LoanID loan = loan_make(b);
+    b.apply(b.pay(MAKER, drops(XRP), 0, loan_action(2, loan)));
+    return b.callback(b.emitted()[0], tecPATH_DRY);
+}
+
+// later ones add to it
+Step loan_cbak_failed_again(Bench &b)
+{
+    loan_failed_refund(b);
+    LoanID loan = loan_make(b);
+    b.apply(b.pay(MAKER, drops(XRP), 0, loan_action(2, loan)));
+    return b.callback(b.emitted()[0], tecPATH_DRY);
+}
+
+// an IOU refund emitted by the previous loan.c, which set no source tag, so
+// cbak takes the currency from the amount
+Step loan_cbak_failed_legacy_iou(Bench &b)
+{
+    return b.callback(payment(b.id, MAKER, iou(150, "EUR", EUR_ISSUER), 20, 0, ""), tecPATH_DRY);
+}
+
+// the prices of hooks() against the installed hook: every price is accepted
+// on tag, one drop below the cheapest is refused (lottery_doubler takes any amount)
+void expect_prices(Bench &b, const AccountID &from, uint32_t tag)
+{
+    char what[96];
+    for (uint64_t price : b.hook.prices)
+        if (!b.accepts(b.pay(from, drops(price), tag)))
+        {
+            snprintf(what, sizeof(what), "%s refuses %" PRIu64 " drops, its prices differ from hooks()", b.hook.name,
+                     price);
+            throw std::runtime_error(what);
+        }
+    if (b.hook.family != DOUBLER && b.accepts(b.pay(from, drops(b.hook.prices[0] - 1), tag)))
+    {
+        snprintf(what, sizeof(what), "%s accepts %" PRIu64 " drops, its prices differ from hooks()", b.hook.name,
+                 b.hook.prices[0] - 1);
+        throw std::runtime_error(what);
+    }
+}
+
+// launchpad_*.c and ticket_*.c
+
+const AccountID BUYER = account(3);
+
+Step sale_setup(Bench &b) { return b.pay(account(4), drops(XRP), 1); }
+
+// set up with the first NFT of every category minted, prices checked
+void sale_ready(Bench &b)
+{
+    b.apply(sale_setup(b));
+    b.mint_callbacks();
+    expect_prices(b, BUYER, 2);
+}
+
+// bought in the cheapest category, with the next NFT minted
+void sale_bought(Bench &b)
+{
+    sale_ready(b);
+    b.apply(b.pay(BUYER, drops(b.hook.prices[0]), 2));
+    b.mint_callbacks();
+}
+
+// every category bought until the hook refuses
+void sale_sell_out(Bench &b)
+{
+    uint32_t buyer = 1000;
+    for (uint64_t price : b.hook.prices)
+        for (int i = 0; i < 256 && b.apply(b.pay(account(buyer++), drops(price), 2)); ++i)
+            b.mint_callbacks();
+}
+
+Step sale_cbak_mint(Bench &b)
+{
+    b.apply(sale_setup(b));
+    return b.callback(b.emitted()[0], tesSUCCESS);
+}
+
+Step sale_buy(Bench &b)
+{
+    sale_ready(b);
+    return b.pay(BUYER, drops(b.hook.prices[0]), 2);
+}
+
+Step sale_retry(Bench &b)
+{
+    sale_bought(b);
+    return b.pay(BUYER, drops(XRP), 3);
+}
+
+Step sale_cbak_offer(Bench &b)
+{
+    sale_ready(b);
+    b.apply(b.pay(BUYER, drops(b.hook.prices[0]), 2));
+    return b.callback(b.emitted().back(), tesSUCCESS);
+}
+
+Step sale_refund(Bench &b)
+{
+    sale_bought(b);
+    b.ctx.ledger_last_time = CLOSED_TIME;
+    return b.pay(BUYER, drops(XRP), 4);
+}
+
+Step sale_cbak_refund(Bench &b)
+{
+    b.apply(sale_refund(b));
+    return b.callback(b.emitted()[0], tesSUCCESS);
+}
+
+Step sale_payout(Bench &b)
+{
+    sale_ready(b);
+    b.ctx.ledger_last_time = CLOSED_TIME;
+    return b.pay(PAYOUT, drops(XRP), b.hook.payout_tag);
+}
+
+// the proceeds paid to the project: launchpads only pay them when sold out
+Step sale_cbak_project(Bench &b)
+{
+    sale_ready(b);
+    if (b.hook.family == LAUNCHPAD)
+        sale_sell_out(b);
+    b.ctx.ledger_last_time = CLOSED_TIME;
+    b.apply(b.pay(PAYOUT, drops(XRP), b.hook.payout_tag));
+    return b.callback(b.emitted()[0], tesSUCCESS);
+}
+
+Step sale_cbak_failed(Bench &b)
+{
+    b.apply(sale_setup(b));
+    return b.callback(b.emitted()[0], tecPATH_DRY);
+}
+
+// lottery_*.c
+
+const AccountID PLAYER = account(5);
+
+// lottery_number sells on the ticket number, 1 is free before lottery_fill
+void lottery_prices(Bench &b) { expect_prices(b, PLAYER, b.hook.family == LOTTERY_NUMBER ? 1 : 0); }
+
+// lottery_number takes the number as destination tag, lottery_random tag 0
+Step lottery_buy(Bench &b, uint32_t tickets, uint32_t number, const AccountID &player = PLAYER)
+{
+    return b.pay(player, drops(b.hook.prices[0] * tickets), b.hook.family == LOTTERY_NUMBER ? number : 0);
+}
+
+// 99 of the 100 tickets of the smallest size sold, all to player
+void lottery_fill(Bench &b, const AccountID &player = PLAYER)
+{
+    lottery_prices(b);
+    if (b.hook.family == LOTTERY_NUMBER)
+        for (uint32_t n = 1; n < 100; ++n)
+            b.apply(lottery_buy(b, 1, n, player));
+    else
+        for (int i = 0; i < 11; ++i)
+            b.apply(lottery_buy(b, 9, 0, player));
+}
+
+// a gamble of lottery_doubler that wins or loses, found by trying sequences
+Step doubler_gamble(Bench &b, bool win, const AccountID &player = PLAYER)
+{
+    lottery_prices(b);
+    Step s;
+    for (int i = 0; i < 256; ++i)
+    {
+        s = b.pay(player, drops(b.hook.prices[0]), 0);
+        if ((b.trial(s) > 0) == win)
+            break;
+    }
+    return s;
+}
+
+// the winnings paid to player, whose payment has a callback
+void lottery_won(Bench &b, const AccountID &player = PLAYER)
+{
+    if (b.hook.family == DOUBLER)
+        b.apply(doubler_gamble(b, true, player));
+    else
+    {
+        lottery_fill(b, player);
+        b.apply(lottery_buy(b, 1, 100, player));
+    }
+}
+
+void lottery_failed_payment(Bench &b, const AccountID &player = PLAYER)
+{
+    lottery_won(b, player);
+    b.apply(b.callback(b.emitted()[0], tecPATH_DRY));
+}
+
+Step lottery_buy_1(Bench &b)
+{
+    lottery_prices(b);
+    return lottery_buy(b, 1, 1);
+}
+
+Step lottery_buy_9(Bench &b)
+{
+    lottery_prices(b);
+    return lottery_buy(b, 9, 0);
+}
+
+Step lottery_buy_last(Bench &b)
+{
+    lottery_fill(b);
+    return lottery_buy(b, 1, 100);
+}
+
+Step doubler_win(Bench &b) { return doubler_gamble(b, true); }
+Step doubler_loss(Bench &b) { return doubler_gamble(b, false); }
+Step doubler_payout(Bench &b)
+{
+    lottery_prices(b);
+    return b.pay(PAYOUT, drops(b.hook.prices[0]), 1000);
+}
+
+Step lottery_retry(Bench &b)
+{
+    lottery_failed_payment(b);
+    return b.pay(PLAYER, drops(b.hook.prices[0]), 255);
+}
+
+Step lottery_flush(Bench &b)
+{
+    lottery_failed_payment(b);
+    return b.pay(PAYOUT, drops(b.hook.prices[0]), 254);
+}
+
+// as loan_resend_flush: four players owed, the middle two and then the first
+// retry, the flush skips the two holes at the head and pays the last one
+Step lottery_retry_flush(Bench &b)
+{
+    const AccountID owed[] = {PLAYER, account(6), account(7), account(8)};
+    for (const AccountID &a : owed)
+        lottery_failed_payment(b, a);
+    for (int i : {1, 2, 0})
+        b.apply(b.pay(owed[i], drops(b.hook.prices[0]), 255));
+    return b.pay(PAYOUT, drops(b.hook.prices[0]), 254);
+}
+
+Step lottery_cbak_success(Bench &b)
+{
+    lottery_won(b);
+    return b.callback(b.emitted()[0], tesSUCCESS);
+}
+
+Step lottery_cbak_failed(Bench &b)
+{
+    lottery_won(b);
+    return b.callback(b.emitted()[0], tecPATH_DRY);
+}
+
+} // namespace
+
+const std::vector<Case> &cases()
+{
+    static const std::vector<Case> list = {
+        {LOAN, "make_xrp", loan_make_xrp, Exit::ACCEPT, -1},
+        {LOAN, "make_iou", loan_make_iou, Exit::ACCEPT, -1},
+        {LOAN, "cancel", loan_cancel, Exit::ACCEPT, 1},
+        {LOAN, "take", loan_take, Exit::ACCEPT, 1},
+        {LOAN, "repay", loan_repay, Exit::ACCEPT, 3},
+        {LOAN, "close", loan_close, Exit::ACCEPT, 1},
+        {LOAN, "resend", loan_resend, Exit::ACCEPT, 1},
+        {LOAN, "flush", loan_flush, Exit::ACCEPT, 1},
+        {LOAN, "flush_page", loan_flush_page, Exit::ACCEPT, 2},
+        {LOAN, "resend_flush", loan_resend_flush, Exit::ACCEPT, 1},
+        {LOAN, "flush_holes", loan_flush_holes, Exit::ACCEPT, 0},
+        {LOAN, "cbak_success", loan_cbak_success, Exit::ACCEPT, 0},
+        {LOAN, "cbak_failed", loan_cbak_failed, Exit::ACCEPT, 0},
+        {LOAN, "cbak_failed_again", loan_cbak_failed_again, Exit::ACCEPT, 0},
+        {LOAN, "cbak_failed_legacy_iou", loan_cbak_failed_legacy_iou, Exit::ACCEPT, 0},
+
+        {SALE, "setup", sale_setup, Exit::ACCEPT, -1},
+        {SALE, "buy", sale_buy, Exit::ACCEPT, 2},
+        {SALE, "retry", sale_retry, Exit::ACCEPT, -1},
+        {LAUNCHPAD, "refund", sale_refund, Exit::ACCEPT, 1},
+        {SALE, "payout", sale_payout, Exit::ACCEPT, 1, 1},
+        {SALE, "cbak_mint", sale_cbak_mint, Exit::ACCEPT, 0},
+        {SALE, "cbak_offer", sale_cbak_offer, Exit::ACCEPT, 0},
+        {LAUNCHPAD, "cbak_refund", sale_cbak_refund, Exit::ACCEPT, 0},
+        {SALE, "cbak_project", sale_cbak_project, Exit::ACCEPT, 0},
+        {SALE, "cbak_failed", sale_cbak_failed, Exit::ROLLBACK, 0},
+
+        {LOTTERY, "buy_1", lottery_buy_1, Exit::ACCEPT, 0},
+        {LOTTERY_RANDOM, "buy_9", lottery_buy_9, Exit::ACCEPT, 0},
+        {LOTTERY, "buy_last", lottery_buy_last, Exit::ACCEPT, 2, 1},
+        {DOUBLER, "win", doubler_win, Exit::ACCEPT, 1},
+        {DOUBLER, "loss", doubler_loss, Exit::ACCEPT, 0},
+        {DOUBLER, "payout", doubler_payout, Exit::ACCEPT, 1, 1},
+        {LOTTERY | DOUBLER, "retry", lottery_retry, Exit::ACCEPT, 1},
+        {LOTTERY | DOUBLER, "flush", lottery_flush, Exit::ACCEPT, 1},
+        {LOTTERY | DOUBLER, "retry_flush", lottery_retry_flush, Exit::ACCEPT, 1},
+        {LOTTERY | DOUBLER, "cbak_success", lottery_cbak_success, Exit::ACCEPT, 0},
+        {LOTTERY | DOUBLER, "cbak_failed", lottery_cbak_failed, Exit::ACCEPT, 0},
+    };
+    return list;
+}
+
+bool took_path(const Case &c, const Sample &s)
+{
+    return s.out.exit == c.exit && (c.emitted < 0 || s.emitted == (size_t)c.emitted) &&
+           (c.uncalled < 0 || s.uncalled == (size_t)c.uncalled);
+}
+
+} // namespace actions
@@ -0,0 +1,205 @@
+/**
+ * The actions of the hooks in src/ready and the transactions that reach them,
+ * shared by the tools that measure hooks per action.
+ *
+ * A Bench is one hook installed on its own ledger, fed payments and callbacks
+ * as the ledger would apply them: the effects of a run are kept when the hook
+ * accepts. A Case names one path of a hook (an offer taken, a sale bought, the
+ * last lottery ticket ...); its prepare function drives a fresh Bench through
+ * the transactions that lead there and returns the Step that takes the path,
+ * which measure() then runs as often as asked on the same state, discarding
+ * every run. hooks() knows the constants each hook is compiled with (prices,
+ * categories, payout tags). The prepare functions of the cases that use the
+ * prices first check them against the installed hook, every price bought and
+ * one drop below the cheapest refused, and throw std::runtime_error when the
+ * hook disagrees; the payout cases check the tag by taking their path.
+ *
+ * Build: g++ -std=c++17 -O2 -Ilib -Itools -c tools/host/actions.cpp
+ */
+
+#ifndef HOST_ACTIONS_H
+#define HOST_ACTIONS_H
+
+#include "host/hostapi.h"
+#include "wasm/interp.h"
+#include "wasm/module.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace actions
+{
+
+constexpr size_t ACCOUNT_ID_SIZE = hostapi::ACCOUNT_ID_SIZE;
+constexpr uint64_t XRP = 1000000;
+
+// ledger close times around the sales' close_time of 725842799
+constexpr uint32_t OPEN_TIME = 725800000;
+constexpr uint32_t CLOSED_TIME = 725900000;
+
+constexpr uint8_t tesSUCCESS = 0;
+constexpr uint8_t tecPATH_DRY = 128;
+constexpr uint16_t ttPAYMENT = 0;
+constexpr uint16_t ttNFTOKEN_MINT = 25;
+
+using AccountID = std::array<uint8_t, ACCOUNT_ID_SIZE>;
+using Exit = hostapi::Exit;
+
+// hook families, a case runs on the hooks of its families
+enum Family : unsigned
+{
+    LOAN = 1,
+    LAUNCHPAD = 2,
+    TICKET = 4,
+    LOTTERY_NUMBER = 8,
+    LOTTERY_RANDOM = 16,
+    DOUBLER = 32,
+    SALE = LAUNCHPAD | TICKET,
+    LOTTERY = LOTTERY_NUMBER | LOTTERY_RANDOM,
+};
+
+struct Hook
+{
+    const char *name;
+    Family family;
+    std::vector<uint64_t> prices; // sale categories or ticket sizes, drops
+    uint32_t payout_tag;          // sales
+};
+
+const std::vector<Hook> &hooks();
+
+// a test account: hooks read a zero first byte as a missing account
+AccountID account(uint32_t n);
+// decodes an r-address, zero when malformed
+AccountID named(const char *raddr);
+
+struct Amount
+{
+    uint64_t value;                 // drops, or millionths of an IOU
+    const char *currency = nullptr; // XRP when null
+    AccountID issuer{};
+};
+
+Amount drops(uint64_t value);
+Amount iou(uint64_t units, const char *currency, const AccountID &issuer);
+
+// a Payment, with one text/plain Description memo when memo is not empty
+std::vector<uint8_t> payment(const AccountID &from, const AccountID &to, const Amount &amount, uint32_t tag,
+                             uint32_t sequence, const std::string &memo);
+// the same with the sfAmount payload as serialized, 8 or 48 bytes
+std::vector<uint8_t> payment(const AccountID &from, const AccountID &to, const std::vector<uint8_t> &amount,
+                             uint32_t tag, uint32_t sequence, const std::string &memo);
+// sfTransactionType of a serialized transaction, 0xFFFF when unreadable
+uint16_t transaction_type(const std::vector<uint8_t> &tx);
+
+// what a hook runs on: cbak when there is metadata
+struct Step
+{
+    std::vector<uint8_t> otxn;
+    std::vector<uint8_t> meta;
+};
+
+struct Sample
+{
+    hostapi::Outcome out;
+    std::string message;
+    uint64_t guard_iterations;
+    uint64_t state_read_bytes;
+    uint64_t state_written_bytes;
+    uint32_t state_writes;
+    size_t emitted;
+    size_t uncalled; // of those emitted, without sfEmitCallback
+    uint64_t emitted_bytes;
+    double median_ns;
+    double min_ns;
+};
+
+// one hook on its own ledger: transactions are applied as they would be,
+// keeping the effects of a hook that accepts
+class Bench
+{
+public:
+    // interpose, when given, may rebind the imports before the module is
+    // instantiated; throws what wasm::Instance throws for a bad module
+    Bench(const Hook &hook, const std::vector<uint8_t> &wasm,
+          const std::function<void(wasm::Imports &)> &interpose = nullptr);
+
+    const Hook &hook;
+    const AccountID id;
+    hostapi::Context ctx;
+
+    // a payment to the hook with the next sequence
+    Step pay(const AccountID &from, const Amount &amount, uint32_t tag, const std::string &memo = std::string());
+
+    // cbak for a transaction the hook emitted, with the metadata the ledger
+    // gives it: the hook's account root, counting the NFTokens it minted
+    Step callback(const std::vector<uint8_t> &emitted, uint8_t result);
+
+    // runs the step and keeps its effects when the hook accepts
+    bool apply(const Step &step);
+
+    // of the next pay()
+    uint32_t sequence() const { return sequence_; }
+
+    // what the last apply() emitted
+    const std::vector<std::vector<uint8_t>> &emitted() const { return emitted_; }
+
+    // the mints of the last apply() succeed and are called back
+    void mint_callbacks();
+
+    // transactions the step would emit, discarding its effects
+    size_t trial(const Step &step);
+
+    // whether the hook accepts the step, discarding its effects
+    bool accepts(const Step &step);
+
+    // runs the step RUNS times, metrics from the first run
+    Sample measure(const Step &step, int runs);
+
+private:
+    void prepare(const Step &step);
+
+    wasm::Module module_;
+    wasm::Imports imports_;
+    std::unique_ptr<wasm::Instance> instance_;
+    std::vector<std::vector<uint8_t>> emitted_;
+    uint32_t sequence_ = 1;
+    uint32_t minted_ = 0;
+};
+
+// loan.c
+
+using LoanID = std::array<uint8_t, 32>;
+
+// the memo of make: role, loan and collateral currency index and amount, interest and period
+std::string loan_offer(int role, int loan_currency, uint64_t loan_amount, int collateral_currency,
+                       uint64_t collateral_amount, uint32_t interest, uint32_t period);
+// the memo of the other actions: the action and the loan ID in hex
+std::string loan_action(int action, const LoanID &loan);
+// the memo of resend and flush, which name no offer: the action alone
+std::string loan_outbox_action(int action);
+
+struct Case
+{
+    unsigned families;
+    const char *name;
+    Step (*prepare)(Bench &b);
+    Exit exit;   // of the path the case is named for
+    int emitted; // transactions it emits, -1 when that depends on earlier fees
+    // of those, emitted without sfEmitCallback by a hook that has a cbak (the
+    // operator payouts), -1 when not checked
+    int uncalled = -1;
+};
+
+const std::vector<Case> &cases();
+
+// the sample shows the path the case is named for
+bool took_path(const Case &c, const Sample &s);
+
+} // namespace actions
+
+#endif
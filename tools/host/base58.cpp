@@ -0,0 +1,389 @@
+#include "base58.h"
+
+#include "error.h"
+#include "sha256.h"
+
+#include <cstring>
+
+namespace base58
+{
+
+const char ALPHABET[59] = "rpshnaf39wBUDNEGHJKLM4PQRST7VWXYZ2bcdeCg65jkm8oFqi1tuvAxyz";
+
+namespace
+{
+
+// 58^5, five digits per limb
+constexpr uint32_t LIMB_BASE = 656356768;
+constexpr int LIMB_DIGITS = 5;
+// 24 bytes after the version byte need 33 digits: 7 limbs
+constexpr int ENCODE_LIMBS = 7;
+// the 25 byte token as 32 bit words, one spare to catch overflow
+constexpr int DECODE_WORDS = 7;
+
+struct DigitTable
+{
+    int8_t value[256];
+
+    DigitTable()
+    {
+        std::memset(value, -1, sizeof(value));
+        for (int i = 0; i < 58; ++i)
+            value[(uint8_t)ALPHABET[i]] = (int8_t)i;
+    }
+};
+
+const DigitTable DIGITS;
+
+// two digit characters per lookup
+struct PairTable
+{
+    char pair[58 * 58][2];
+
+    PairTable()
+    {
+        for (int i = 0; i < 58 * 58; ++i)
+        {
+            pair[i][0] = ALPHABET[i / 58];
+            pair[i][1] = ALPHABET[i % 58];
+        }
+    }
+};
+
+const PairTable PAIRS;
+
+constexpr uint32_t POW58[LIMB_DIGITS + 1] = {1, 58, 3364, 195112, 11316496, 656356768};
+
+inline bool checksum_matches(const uint8_t *token, const uint8_t digest[sha256::DIGEST_SIZE])
+{
+    return std::memcmp(token + 1 + ACCOUNT_ID_SIZE, digest, 4) == 0;
+}
+
+void make_token(const uint8_t id[ACCOUNT_ID_SIZE], uint8_t token[ACCOUNT_TOKEN_SIZE])
+{
+    token[0] = TOKEN_ACCOUNT_ID;
+    std::memcpy(token + 1, id, ACCOUNT_ID_SIZE);
+}
+
+// NUL terminated input with the surrounding white space rippled's decoder skips
+void trim(const uint8_t *&text, size_t &len)
+{
+    size_t end = 0;
+    while (end < len && text[end])
+        ++end;
+    len = end;
+    auto space = [](uint8_t c) { return c == ' ' || (c >= '\t' && c <= '\r'); };
+    while (len && space(*text))
+    {
+        ++text;
+        --len;
+    }
+    while (len && space(text[len - 1]))
+        --len;
+}
+
+} // namespace
+
+std::string encode(const uint8_t *data, size_t len)
+{
+    size_t zeros = 0;
+    while (zeros < len && data[zeros] == 0)
+        ++zeros;
+    // log(256) / log(58), rounded up
+    std::vector<uint8_t> digits((len - zeros) * 138 / 100 + 1);
+    size_t used = 0;
+    for (size_t i = zeros; i < len; ++i)
+    {
+        uint32_t carry = data[i];
+        size_t j = 0;
+        for (; j < used || carry; ++j)
+        {
+            carry += (uint32_t)digits[j] * 256;
+            digits[j] = (uint8_t)(carry % 58);
+            carry /= 58;
+        }
+        used = j;
+    }
+    std::string out(zeros, ALPHABET[0]);
+    for (size_t j = used; j-- > 0;)
+        out += ALPHABET[digits[j]];
+    return out;
+}
+
+bool decode(const char *text, size_t len, std::vector<uint8_t> &out)
+{
+    size_t zeros = 0;
+    while (zeros < len && text[zeros] == ALPHABET[0])
+        ++zeros;
+    // log(58) / log(256), rounded up
+    std::vector<uint8_t> bytes((len - zeros) * 733 / 1000 + 1);
+    size_t used = 0;
+    for (size_t i = zeros; i < len; ++i)
+    {
+        int8_t d = DIGITS.value[(uint8_t)text[i]];
+        if (d < 0)
+            return false;
+        uint32_t carry = (uint32_t)d;
+        size_t j = 0;
+        for (; j < used || carry; ++j)
+        {
+            carry += (uint32_t)bytes[j] * 58;
+            bytes[j] = (uint8_t)carry;
+            carry >>= 8;
+        }
+        used = j;
+    }
+    out.assign(zeros, 0);
+    for (size_t j = used; j-- > 0;)
+        out.push_back(bytes[j]);
+    return true;
+}
+
+std::string encode_token(uint8_t type, const uint8_t *data, size_t len)
+{
+    std::vector<uint8_t> buf;
+    buf.reserve(len + 5);
+    buf.push_back(type);
+    buf.insert(buf.end(), data, data + len);
+    uint8_t digest[sha256::DIGEST_SIZE];
+    sha256::double_hash(buf.data(), buf.size(), digest);
+    buf.insert(buf.end(), digest, digest + 4);
+    return encode(buf.data(), buf.size());
+}
+
+bool decode_token(const char *text, size_t len, uint8_t type, std::vector<uint8_t> &out)
+{
+    std::vector<uint8_t> buf;
+    if (!decode(text, len, buf) || buf.size() < 5 || buf[0] != type)
+        return false;
+    uint8_t digest[sha256::DIGEST_SIZE];
+    sha256::double_hash(buf.data(), buf.size() - 4, digest);
+    if (std::memcmp(buf.data() + buf.size() - 4, digest, 4) != 0)
+        return false;
+    out.assign(buf.begin() + 1, buf.end() - 4);
+    return true;
+}
+
+// token (version 0, id, checksum) to text, the digits of everything after the
+// version byte are produced by pushing six 32 bit words through the limbs
+size_t encode_account_token(const uint8_t token[ACCOUNT_TOKEN_SIZE], char out[RADDR_MAX])
+{
+    uint32_t limbs[ENCODE_LIMBS] = {0};
+    for (int w = 0; w < 6; ++w)
+    {
+        const uint8_t *p = token + 1 + 4 * w;
+        uint64_t carry = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+        // after w + 1 words the value is below 2^(32(w + 1)), which fits w + 2 limbs
+        for (int j = 0; j < w + 2; ++j)
+        {
+            uint64_t t = ((uint64_t)limbs[j] << 32) + carry;
+            limbs[j] = (uint32_t)(t % LIMB_BASE);
+            carry = t / LIMB_BASE;
+        }
+    }
+
+    char digits[ENCODE_LIMBS * LIMB_DIGITS];
+    for (int j = 0; j < ENCODE_LIMBS; ++j)
+    {
+        char *dst = digits + sizeof(digits) - (j + 1) * LIMB_DIGITS;
+        uint32_t limb = limbs[j];
+        uint32_t low = limb % (58 * 58 * 58);
+        std::memcpy(dst, PAIRS.pair[limb / (58 * 58 * 58)], 2);
+        dst[2] = ALPHABET[low / (58 * 58)];
+        std::memcpy(dst + 3, PAIRS.pair[low % (58 * 58)], 2);
+    }
+
+    size_t zeros = 1;
+    while (zeros < ACCOUNT_TOKEN_SIZE && token[zeros] == 0)
+        ++zeros;
+    size_t skip = 0;
+    while (skip < sizeof(digits) && digits[skip] == ALPHABET[0])
+        ++skip;
+    size_t len = 0;
+    for (size_t i = 0; i < zeros; ++i)
+        out[len++] = ALPHABET[0];
+    for (size_t i = skip; i < sizeof(digits); ++i)
+        out[len++] = digits[i];
+    return len;
+}
+
+// text to token bytes, checks digits, range and leading zeros but not the checksum
+bool decode_account_token(const char *text, size_t len, uint8_t token[ACCOUNT_TOKEN_SIZE])
+{
+    size_t zeros = 0;
+    while (zeros < len && text[zeros] == ALPHABET[0])
+        ++zeros;
+    if (zeros == 0 || zeros > ACCOUNT_TOKEN_SIZE)
+        return false;
+
+    // little endian 32 bit words, each step multiplies by 58^g and adds g digits
+    uint32_t words[DECODE_WORDS] = {0};
+    int used = 0;
+    size_t i = zeros;
+    size_t first = (len - zeros) % LIMB_DIGITS;
+    size_t group = first ? first : LIMB_DIGITS;
+    while (i < len)
+    {
+        uint64_t carry = 0;
+        int8_t invalid = 0;
+        for (size_t k = 0; k < group; ++k)
+        {
+            int8_t d = DIGITS.value[(uint8_t)text[i + k]];
+            invalid |= d;
+            carry = carry * 58 + (uint8_t)d;
+        }
+        if (invalid < 0)
+            return false;
+        uint64_t mul = POW58[group];
+        for (int j = 0; j < used; ++j)
+        {
+            uint64_t t = (uint64_t)words[j] * mul + carry;
+            words[j] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        if (carry)
+        {
+            if (used == DECODE_WORDS)
+                return false;
+            words[used++] = (uint32_t)carry;
+        }
+        i += group;
+        group = LIMB_DIGITS;
+    }
+
+    // 25 bytes are 200 bits
+    if (words[6] >> 8)
+        return false;
+    for (int b = 0; b < (int)ACCOUNT_TOKEN_SIZE; ++b)
+    {
+        int pos = (int)ACCOUNT_TOKEN_SIZE - 1 - b;
+        token[pos] = (uint8_t)(words[b / 4] >> (8 * (b % 4)));
+    }
+    // every leading zero byte must be spelled as an 'r' and nothing more
+    size_t zero_bytes = 0;
+    while (zero_bytes < ACCOUNT_TOKEN_SIZE && token[zero_bytes] == 0)
+        ++zero_bytes;
+    return zero_bytes == zeros;
+}
+
+size_t encode_account(const uint8_t id[ACCOUNT_ID_SIZE], char out[RADDR_MAX])
+{
+    uint8_t token[ACCOUNT_TOKEN_SIZE];
+    make_token(id, token);
+    uint8_t digest[sha256::DIGEST_SIZE];
+    sha256::double_hash(token, 1 + ACCOUNT_ID_SIZE, digest);
+    std::memcpy(token + 1 + ACCOUNT_ID_SIZE, digest, 4);
+    return encode_account_token(token, out);
+}
+
+bool decode_account(const char *text, size_t len, uint8_t id[ACCOUNT_ID_SIZE])
+{
+    uint8_t token[ACCOUNT_TOKEN_SIZE];
+    if (!decode_account_token(text, len, token))
+        return false;
+    uint8_t digest[sha256::DIGEST_SIZE];
+    sha256::double_hash(token, 1 + ACCOUNT_ID_SIZE, digest);
+    if (!checksum_matches(token, digest))
+        return false;
+    std::memcpy(id, token + 1, ACCOUNT_ID_SIZE);
+    return true;
+}
+
+int64_t util_raddr(uint8_t *write, uint32_t write_len, const uint8_t *read, uint32_t read_len)
+{
+    if (read_len != ACCOUNT_ID_SIZE)
+        return INVALID_ARGUMENT;
+    char text[RADDR_MAX];
+    size_t len = encode_account(read, text);
+    if (write_len < len)
+        return TOO_SMALL;
+    std::memcpy(write, text, len);
+    return (int64_t)len;
+}
+
+int64_t util_accid(uint8_t *write, uint32_t write_len, const uint8_t *read, uint32_t read_len)
+{
+    if (write_len < ACCOUNT_ID_SIZE)
+        return TOO_SMALL;
+    if (read_len > 49)
+        return TOO_BIG;
+    size_t len = read_len;
+    trim(read, len);
+    if (!decode_account((const char *)read, len, write))
+        return INVALID_ARGUMENT;
+    return ACCOUNT_ID_SIZE;
+}
+
+void batch_raddr(const uint8_t *ids, char *out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        uint8_t tokens[8][ACCOUNT_TOKEN_SIZE];
+        const uint8_t *msgs[8];
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            make_token(ids + (i + lane) * ACCOUNT_ID_SIZE, tokens[lane]);
+            msgs[lane] = tokens[lane];
+        }
+        uint8_t digests[8][sha256::DIGEST_SIZE];
+        sha256::double_hash_x8(msgs, 1 + ACCOUNT_ID_SIZE, digests);
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            std::memcpy(tokens[lane] + 1 + ACCOUNT_ID_SIZE, digests[lane], 4);
+            char *dst = out + (i + lane) * RADDR_STRIDE;
+            dst[encode_account_token(tokens[lane], dst)] = 0;
+        }
+    }
+    for (; i < n; ++i)
+    {
+        char *dst = out + i * RADDR_STRIDE;
+        dst[encode_account(ids + i * ACCOUNT_ID_SIZE, dst)] = 0;
+    }
+}
+
+size_t batch_accid(const char *addrs, size_t stride, uint8_t *ids, uint8_t *valid, size_t n)
+{
+    size_t decoded = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        uint8_t tokens[8][ACCOUNT_TOKEN_SIZE];
+        const uint8_t *msgs[8];
+        bool parsed[8];
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            const char *text = addrs + (i + lane) * stride;
+            parsed[lane] = decode_account_token(text, strnlen(text, stride), tokens[lane]);
+            if (!parsed[lane])
+                std::memset(tokens[lane], 0, ACCOUNT_TOKEN_SIZE);
+            msgs[lane] = tokens[lane];
+        }
+        uint8_t digests[8][sha256::DIGEST_SIZE];
+        sha256::double_hash_x8(msgs, 1 + ACCOUNT_ID_SIZE, digests);
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            uint8_t *id = ids + (i + lane) * ACCOUNT_ID_SIZE;
+            bool ok = parsed[lane] && checksum_matches(tokens[lane], digests[lane]);
+            if (ok)
+                std::memcpy(id, tokens[lane] + 1, ACCOUNT_ID_SIZE);
+            else
+                std::memset(id, 0, ACCOUNT_ID_SIZE);
+            valid[i + lane] = ok;
+            decoded += ok;
+        }
+    }
+    for (; i < n; ++i)
+    {
+        const char *text = addrs + i * stride;
+        uint8_t *id = ids + i * ACCOUNT_ID_SIZE;
+        bool ok = decode_account(text, strnlen(text, stride), id);
+        if (!ok)
+            std::memset(id, 0, ACCOUNT_ID_SIZE);
+        valid[i] = ok;
+        decoded += ok;
+    }
+    return decoded;
+}
+
+} // namespace base58
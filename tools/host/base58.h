@@ -0,0 +1,67 @@
+/**
+ * XRPL base58 codec, matching util_raddr and util_accid in lib/extern.h.
+ *
+ * Tokens are a version byte, the payload and the first four bytes of the
+ * double SHA-256 of both, written in the XRPL alphabet (zero is 'r'). The
+ * generic encode/decode work on any length; the account functions are a fixed
+ * width path for 20 byte account IDs that converts between 32 bit words and
+ * base 58^5 limbs with multiply-accumulate loops instead of bignum division.
+ * The batch functions also hash checksums eight at a time (sha256::double_hash_x8).
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools -c tools/host/base58.cpp tools/host/sha256.cpp
+ */
+
+#ifndef HOST_BASE58_H
+#define HOST_BASE58_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace base58
+{
+
+extern const char ALPHABET[59];
+
+constexpr size_t ACCOUNT_ID_SIZE = 20;
+// an encoded account ID is at most 35 characters, batch output adds a NUL
+constexpr size_t RADDR_MAX = 35;
+constexpr size_t RADDR_STRIDE = 36;
+// version byte, account ID and checksum
+constexpr size_t ACCOUNT_TOKEN_SIZE = 1 + ACCOUNT_ID_SIZE + 4;
+
+// XRPL token types (version bytes)
+constexpr uint8_t TOKEN_ACCOUNT_ID = 0;
+constexpr uint8_t TOKEN_NODE_PUBLIC = 28;
+constexpr uint8_t TOKEN_FAMILY_SEED = 33;
+constexpr uint8_t TOKEN_ACCOUNT_PUBLIC = 35;
+
+// plain base58, leading zero bytes become leading 'r'
+std::string encode(const uint8_t *data, size_t len);
+bool decode(const char *text, size_t len, std::vector<uint8_t> &out);
+
+// version byte, payload and checksum
+std::string encode_token(uint8_t type, const uint8_t *data, size_t len);
+bool decode_token(const char *text, size_t len, uint8_t type, std::vector<uint8_t> &out);
+
+// fixed width account ID path, returns the number of characters written
+size_t encode_account(const uint8_t id[ACCOUNT_ID_SIZE], char out[RADDR_MAX]);
+bool decode_account(const char *text, size_t len, uint8_t id[ACCOUNT_ID_SIZE]);
+// the fixed width conversion alone, the caller computes or verifies the checksum
+size_t encode_account_token(const uint8_t token[ACCOUNT_TOKEN_SIZE], char out[RADDR_MAX]);
+bool decode_account_token(const char *text, size_t len, uint8_t token[ACCOUNT_TOKEN_SIZE]);
+
+// hook API semantics: byte count written or an error code from lib/error.h
+int64_t util_raddr(uint8_t *write, uint32_t write_len, const uint8_t *read, uint32_t read_len);
+int64_t util_accid(uint8_t *write, uint32_t write_len, const uint8_t *read, uint32_t read_len);
+
+// n account IDs (n * 20 bytes) to n NUL terminated r-addresses, RADDR_STRIDE apart
+void batch_raddr(const uint8_t *ids, char *out, size_t n);
+// n NUL terminated r-addresses, `stride` apart, to n account IDs; valid[i] is 1
+// when addrs[i] decoded (ids[i] is zeroed otherwise), returns the number decoded
+size_t batch_accid(const char *addrs, size_t stride, uint8_t *ids, uint8_t *valid, size_t n);
+
+} // namespace base58
+
+#endif
@@ -0,0 +1,127 @@
+#include "census.h"
+
+#include <chrono>
+#include <vector>
+
+namespace census
+{
+
+namespace
+{
+
+#define A(i) (1u << (i))
+
+struct Api
+{
+    const char *name;
+    uint16_t reads;
+    bool writes;
+};
+
+// the lib/extern.h functions that move bytes, by their parameter names
+const Api APIS[] = {
+    {"accept", A(1), false},
+    {"emit", A(3), true},
+    {"etxn_details", 0, true},
+    {"etxn_fee_base", A(1), false},
+    {"etxn_nonce", 0, true},
+    {"float_sto", A(3) | A(5), true},
+    {"float_sto_set", A(1), false},
+    {"hook_account", 0, true},
+    {"hook_hash", 0, true},
+    {"hook_param", A(3), true},
+    {"hook_param_set", A(1) | A(3) | A(5), false},
+    {"hook_skip", A(1), false},
+    {"ledger_keylet", A(3) | A(5), true},
+    {"ledger_last_hash", 0, true},
+    {"ledger_nonce", 0, true},
+    {"otxn_field", 0, true},
+    {"otxn_field_txt", 0, true},
+    {"otxn_id", 0, true},
+    {"rollback", A(1), false},
+    {"slot", 0, true},
+    {"slot_id", 0, true},
+    {"slot_set", A(1), false},
+    {"state", A(3), true},
+    {"state_foreign", A(3) | A(5) | A(7), true},
+    {"state_foreign_set", A(1) | A(3) | A(5) | A(7), false},
+    {"state_set", A(1) | A(3), false},
+    {"sto_emplace", A(3) | A(5), true},
+    {"sto_erase", A(3), true},
+    {"sto_subarray", A(1), false},
+    {"sto_subfield", A(1), false},
+    {"sto_validate", A(1), false},
+    {"trace", A(1) | A(3), false},
+    {"trace_float", A(1), false},
+    {"trace_num", A(1), false},
+    {"trace_slot", A(1), false},
+    {"util_accid", A(3), true},
+    {"util_keylet", 0, true},
+    {"util_raddr", A(3), true},
+    {"util_sha512h", A(3), true},
+    {"util_verify", A(1) | A(3) | A(5), false},
+};
+
+#undef A
+
+const Api *find_api(const std::string &name)
+{
+    for (const Api &a : APIS)
+        if (name == a.name)
+            return &a;
+    return nullptr;
+}
+
+} // namespace
+
+void Census::interpose(wasm::Imports &imports)
+{
+    // bind() may grow the vector being walked
+    std::vector<wasm::HostBinding> bindings = imports.bindings();
+    for (const wasm::HostBinding &b : bindings)
+    {
+        const Api *api = find_api(b.name);
+        entries_.push_back(Entry{this, b, api ? api->reads : (uint16_t)0, api && api->writes, &stats_[b.name]});
+        imports.bind(b.module, b.name, trampoline, &entries_.back());
+    }
+    if (imports.fallback().func)
+    {
+        entries_.push_back(Entry{this, imports.fallback(), 0, false, nullptr});
+        imports.fallback(trampoline, &entries_.back());
+    }
+}
+
+void Census::clear()
+{
+    for (auto &kv : stats_)
+        kv.second = Stat{};
+}
+
+std::map<std::string, Stat> Census::stats() const
+{
+    std::map<std::string, Stat> out;
+    for (const auto &kv : stats_)
+        if (kv.second.calls)
+            out.insert(kv);
+    return out;
+}
+
+int64_t Census::trampoline(wasm::Instance &instance, void *user, const uint64_t *args)
+{
+    Entry &e = *static_cast<Entry *>(user);
+    auto start = std::chrono::steady_clock::now();
+    int64_t v = e.inner.func(instance, e.inner.user, args);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    Stat &s = e.stat ? *e.stat : e.census->stats_[instance.import_name(instance.current_import())];
+    ++s.calls;
+    s.ns += ns;
+    for (uint16_t reads = e.reads, i = 0; reads; reads >>= 1, ++i)
+        if (reads & 1)
+            s.bytes_in += (uint32_t)args[i];
+    if (e.writes && v > 0 && (uint32_t)args[0])
+        s.bytes_out += (uint64_t)v < (uint32_t)args[1] ? (uint64_t)v : (uint32_t)args[1];
+    return v;
+}
+
+} // namespace census
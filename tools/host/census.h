@@ -0,0 +1,67 @@
+/**
+ * Host-call census: counts and times every lib/extern.h call a hook makes.
+ *
+ * interpose() rebinds each import of a wasm::Imports (and its fallback) to a
+ * trampoline that calls the original binding and records, per API, the calls,
+ * the bytes the hook passed in (the *read_len arguments), the bytes written
+ * back (a positive result up to write_len, when write_ptr is set) and the
+ * wall time of the host function itself. The census must outlive the
+ * instances made from those imports. clear() starts a new count, so one
+ * census attributes calls to whichever action ran since.
+ *
+ * Build: g++ -std=c++17 -O2 -Ilib -Itools -c tools/host/census.cpp
+ */
+
+#ifndef HOST_CENSUS_H
+#define HOST_CENSUS_H
+
+#include "wasm/interp.h"
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+
+namespace census
+{
+
+struct Stat
+{
+    uint64_t calls = 0;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    double ns = 0;
+};
+
+class Census
+{
+public:
+    Census() = default;
+    Census(const Census &) = delete;
+    Census &operator=(const Census &) = delete;
+
+    void interpose(wasm::Imports &imports);
+    void clear();
+
+    // by API name, only those called since clear()
+    std::map<std::string, Stat> stats() const;
+
+private:
+    struct Entry
+    {
+        Census *census;
+        wasm::HostBinding inner;
+        uint16_t reads; // bit i: argument i is a *read_len
+        bool writes;    // arguments 0 and 1 are write_ptr and write_len
+        Stat *stat;     // nullptr for the fallback, counted by import name
+    };
+
+    static int64_t trampoline(wasm::Instance &instance, void *user, const uint64_t *args);
+
+    std::deque<Entry> entries_;
+    std::map<std::string, Stat> stats_;
+};
+
+} // namespace census
+
+#endif
@@ -0,0 +1,184 @@
+#include "corpus.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace corpus
+{
+
+namespace
+{
+
+uint64_t align8(uint64_t v) { return (v + 7) & ~7ULL; }
+
+} // namespace
+
+void Corpus::Iterator::check()
+{
+    if (at_ == end_)
+        return;
+    const RecordHeader *h = (const RecordHeader *)at_;
+    if ((size_t)(end_ - at_) < sizeof(RecordHeader) ||
+        align8(h->size) > (uint64_t)(end_ - at_) - sizeof(RecordHeader))
+        at_ = end_;
+}
+
+Record Corpus::Iterator::operator*() const
+{
+    const RecordHeader *h = (const RecordHeader *)at_;
+    return Record{at_ + sizeof(RecordHeader), h->size, h->ledger_seq, h->close_time, h->index, h->result, h->flags};
+}
+
+Corpus::Iterator &Corpus::Iterator::operator++()
+{
+    at_ += sizeof(RecordHeader) + align8(((const RecordHeader *)at_)->size);
+    check();
+    return *this;
+}
+
+Corpus::~Corpus() { close(); }
+
+void Corpus::close()
+{
+    if (map_)
+        munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+    data_ = nullptr;
+    data_size_ = 0;
+    record_count_ = 0;
+}
+
+bool Corpus::open(const std::string &path, std::string &error)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header))
+    {
+        ::close(fd);
+        error = path + ": not a corpus";
+        return false;
+    }
+    map_size_ = (size_t)st.st_size;
+    map_ = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map_ == MAP_FAILED)
+    {
+        map_ = nullptr;
+        error = "cannot map " + path;
+        return false;
+    }
+    // records are read front to back
+    madvise(map_, map_size_, MADV_SEQUENTIAL);
+
+    const Header *h = (const Header *)map_;
+    if (std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 || h->version != VERSION ||
+        h->data_size > map_size_ - sizeof(Header) || h->record_count > h->data_size / sizeof(RecordHeader))
+    {
+        close();
+        error = path + ": malformed corpus";
+        return false;
+    }
+    data_ = (const uint8_t *)map_ + sizeof(Header);
+    data_size_ = h->data_size;
+    record_count_ = h->record_count;
+    return true;
+}
+
+bool Corpus::check(std::string &error) const
+{
+    uint64_t n = 0, bytes = 0;
+    for (Record r : *this)
+    {
+        ++n;
+        bytes += sizeof(RecordHeader) + align8(r.size);
+    }
+    if (n != record_count_ || bytes != data_size_)
+    {
+        error = "corpus holds " + std::to_string(n) + " readable records of " + std::to_string(record_count_);
+        return false;
+    }
+    return true;
+}
+
+bool is_corpus(const std::string &path)
+{
+    char magic[sizeof(MAGIC)];
+    FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    bool ok = std::fread(magic, 1, sizeof(magic), f) == sizeof(magic) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+    std::fclose(f);
+    return ok;
+}
+
+Writer::~Writer()
+{
+    if (file_)
+    {
+        std::fclose(file_);
+        std::remove(tmp_.c_str());
+    }
+}
+
+bool Writer::open(const std::string &path, std::string &error)
+{
+    path_ = path;
+    tmp_ = path + ".tmp";
+    file_ = std::fopen(tmp_.c_str(), "wb");
+    if (!file_)
+    {
+        error = "cannot write " + tmp_;
+        return false;
+    }
+    header_ = Header{};
+    std::memcpy(header_.magic, MAGIC, sizeof(MAGIC));
+    header_.version = VERSION;
+    // the counts are patched in by finish()
+    return std::fwrite(&header_, sizeof(header_), 1, file_) == 1;
+}
+
+bool Writer::add(const Record &r)
+{
+    static const uint8_t zeros[8] = {0};
+    RecordHeader h{r.size, r.ledger_seq, r.close_time, r.index, r.result, r.flags, 0, 0};
+    size_t pad = align8(r.size) - r.size;
+    if (!file_ || std::fwrite(&h, sizeof(h), 1, file_) != 1 || std::fwrite(r.blob, 1, r.size, file_) != r.size ||
+        std::fwrite(zeros, 1, pad, file_) != pad)
+        return false;
+    ++header_.record_count;
+    header_.data_size += sizeof(h) + r.size + pad;
+    return true;
+}
+
+bool Writer::finish(std::string &error)
+{
+    if (!file_)
+    {
+        error = "corpus not open";
+        return false;
+    }
+    bool ok = std::fseek(file_, 0, SEEK_SET) == 0 && std::fwrite(&header_, sizeof(header_), 1, file_) == 1;
+    ok = std::fclose(file_) == 0 && ok;
+    file_ = nullptr;
+    // an open corpus is never truncated
+    if (!ok || std::rename(tmp_.c_str(), path_.c_str()) != 0)
+    {
+        std::remove(tmp_.c_str());
+        error = "cannot write " + path_;
+        return false;
+    }
+    return true;
+}
+
+} // namespace corpus
@@ -0,0 +1,147 @@
+/**
+ * Binary transaction corpora, opened with mmap.
+ *
+ * A corpus is a header and a sequence of records, each a fixed RecordHeader
+ * (blob size, ledger sequence, close time, transaction index, expected result
+ * and flags) followed by the serialized transaction, padded to 8 bytes. All
+ * integers are little endian. open() only maps the file and checks the
+ * header; iteration reads the records in place and bounds checks each one
+ * before returning it, so a truncated file ends early instead of faulting
+ * (check() tells the two apart). Nothing is copied or parsed, which leaves
+ * replaying a large corpus bound by reading it from disk.
+ *
+ * POSIX only (mmap).
+ *
+ * Build: g++ -std=c++17 -O2 -Itools -c tools/host/corpus.cpp
+ */
+
+#ifndef HOST_CORPUS_H
+#define HOST_CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace corpus
+{
+
+constexpr char MAGIC[8] = {'H', 'K', 'C', 'O', 'R', 'P', 'U', 'S'};
+constexpr uint32_t VERSION = 1;
+
+// result is the sfTransactionResult code of the metadata, or this when unknown
+constexpr uint8_t RESULT_UNKNOWN = 0xFF;
+constexpr uint32_t INDEX_UNKNOWN = ~0U;
+// flags
+constexpr uint8_t EMITTED = 0x01; // the transaction has sfEmitDetails
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t record_count;
+    uint64_t data_size; // bytes of records after the header
+};
+
+struct RecordHeader
+{
+    uint32_t size; // of the blob, the padding is not counted
+    uint32_t ledger_seq;
+    uint32_t close_time; // seconds since the XRPL epoch
+    uint32_t index;      // sfTransactionIndex in the ledger
+    uint8_t result;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t reserved2;
+};
+
+static_assert(sizeof(Header) == 32 && sizeof(RecordHeader) == 24, "corpus layout");
+
+// a record as iterated: blob points into the mapping
+struct Record
+{
+    const uint8_t *blob;
+    uint32_t size;
+    uint32_t ledger_seq;
+    uint32_t close_time;
+    uint32_t index;
+    uint8_t result;
+    uint8_t flags;
+
+    bool emitted() const { return flags & EMITTED; }
+};
+
+class Corpus
+{
+public:
+    class Iterator
+    {
+    public:
+        Iterator(const uint8_t *at, const uint8_t *end) : at_(at), end_(end) { check(); }
+
+        Record operator*() const;
+        Iterator &operator++();
+        bool operator==(const Iterator &o) const { return at_ == o.at_; }
+        bool operator!=(const Iterator &o) const { return at_ != o.at_; }
+
+    private:
+        // moves to the end when the record at at_ does not fit
+        void check();
+
+        const uint8_t *at_;
+        const uint8_t *end_;
+    };
+
+    Corpus() = default;
+    ~Corpus();
+    Corpus(const Corpus &) = delete;
+    Corpus &operator=(const Corpus &) = delete;
+
+    // false with a message when the file cannot be mapped or is not a corpus
+    bool open(const std::string &path, std::string &error);
+    void close();
+    // walks every record, false when they do not match the header's count and size
+    bool check(std::string &error) const;
+
+    Iterator begin() const { return Iterator(data_, data_ + data_size_); }
+    Iterator end() const { return Iterator(data_ + data_size_, data_ + data_size_); }
+    uint64_t record_count() const { return record_count_; }
+    uint64_t data_size() const { return data_size_; }
+
+private:
+    void *map_ = nullptr;
+    size_t map_size_ = 0;
+    const uint8_t *data_ = nullptr;
+    uint64_t data_size_ = 0;
+    uint64_t record_count_ = 0;
+};
+
+// true when the file starts with the corpus magic
+bool is_corpus(const std::string &path);
+
+// appends records to a new corpus, written next to the target and renamed by finish()
+class Writer
+{
+public:
+    Writer() = default;
+    ~Writer();
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    bool open(const std::string &path, std::string &error);
+    // r.blob holds r.size bytes
+    bool add(const Record &r);
+    bool finish(std::string &error);
+
+    uint64_t record_count() const { return header_.record_count; }
+
+private:
+    std::string path_, tmp_;
+    FILE *file_ = nullptr;
+    Header header_{};
+};
+
+} // namespace corpus
+
+#endif
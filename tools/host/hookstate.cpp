@@ -0,0 +1,156 @@
+#include "hookstate.h"
+
+#include "snapshot.h"
+
+#include <algorithm>
+
+namespace hookstate
+{
+
+namespace
+{
+
+constexpr size_t MIN_SLOTS = 64;
+
+} // namespace
+
+Key make_key(const uint8_t account[ACCOUNT_ID_SIZE], const uint8_t ns[NAMESPACE_SIZE],
+             const uint8_t key[KEY_SIZE])
+{
+    Key k;
+    std::memcpy(k.data(), account, ACCOUNT_ID_SIZE);
+    std::memcpy(k.data() + ACCOUNT_ID_SIZE, ns, NAMESPACE_SIZE);
+    std::memcpy(k.data() + ACCOUNT_ID_SIZE + NAMESPACE_SIZE, key, KEY_SIZE);
+    return k;
+}
+
+Store::Entry *Store::find(const Key &key, size_t hash) const
+{
+    if (used_ == 0)
+        return nullptr;
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask; stamps_[i] == generation_; i = (i + 1) & mask)
+    {
+        Entry &e = entries_[slots_[i] - 1];
+        if (e.key == key)
+            return &e;
+    }
+    return nullptr;
+}
+
+void Store::insert_slot(uint32_t entry, size_t hash)
+{
+    size_t mask = slots_.size() - 1;
+    size_t i = hash & mask;
+    while (stamps_[i] == generation_)
+        i = (i + 1) & mask;
+    stamps_[i] = generation_;
+    slots_[i] = entry + 1;
+}
+
+void Store::grow()
+{
+    size_t size = slots_.empty() ? MIN_SLOTS : slots_.size() * 2;
+    slots_.assign(size, 0);
+    stamps_.assign(size, 0);
+    generation_ = 1;
+    KeyHash hash;
+    for (size_t e = 0; e < used_; ++e)
+        insert_slot((uint32_t)e, hash(entries_[e].key));
+}
+
+const uint8_t *Store::get(const Key &key, size_t &size) const
+{
+    const Value *v = nullptr;
+    if (const Entry *e = find(key, KeyHash()(key)))
+        v = &e->value;
+    else
+    {
+        auto it = base_.find(key);
+        if (it != base_.end())
+            v = &it->second;
+        else if (snapshot_)
+        {
+            uint32_t len;
+            const uint8_t *data = snapshot_->find(key, len);
+            size = len;
+            return data;
+        }
+    }
+    if (!v || v->empty())
+        return nullptr;
+    size = v->size();
+    return v->data();
+}
+
+void Store::set(const Key &key, const uint8_t *data, size_t len)
+{
+    size_t hash = KeyHash()(key);
+    if (Entry *e = find(key, hash))
+    {
+        e->value.assign(data, data + len);
+        return;
+    }
+    if (used_ == entries_.size())
+        entries_.emplace_back();
+    Entry &e = entries_[used_];
+    e.key = key;
+    e.value.assign(data, data + len);
+    if ((used_ + 1) * 2 > slots_.size())
+    {
+        ++used_;
+        grow();
+        return;
+    }
+    insert_slot((uint32_t)used_++, hash);
+}
+
+void Store::commit()
+{
+    for (size_t i = 0; i < used_; ++i)
+    {
+        Entry &e = entries_[i];
+        uint32_t len;
+        if (!e.value.empty())
+            // the entry keeps the old buffer for reuse
+            base_[e.key].swap(e.value);
+        else if (snapshot_ && snapshot_->find(e.key, len))
+            base_[e.key].clear();
+        else
+            base_.erase(e.key);
+    }
+    rollback();
+}
+
+void Store::flatten(Map &out) const
+{
+    out.clear();
+    if (snapshot_)
+        for (size_t g = 0; g < snapshot_->group_count(); ++g)
+        {
+            const snapshot::Group &group = snapshot_->group(g);
+            for (uint64_t i = group.first; i < group.first + group.count; ++i)
+            {
+                uint32_t len;
+                if (const uint8_t *v = snapshot_->value(i, len))
+                    out[make_key(group.account, group.ns, snapshot_->key(i))].assign(v, v + len);
+            }
+        }
+    for (const auto &kv : base_)
+        if (kv.second.empty())
+            out.erase(kv.first);
+        else
+            out[kv.first] = kv.second;
+}
+
+void Store::rollback()
+{
+    used_ = 0;
+    if (++generation_ == 0)
+    {
+        std::fill(stamps_.begin(), stamps_.end(), 0);
+        generation_ = 1;
+    }
+}
+
+} // namespace hookstate
@@ -0,0 +1,114 @@
+/**
+ * Transactional hook state for the host runtime.
+ *
+ * Store keeps the committed state in a hash map and the writes of the running
+ * execution in an overlay: reads look in the overlay first and fall through
+ * to the base, commit() (accept) moves the overlay into the base and
+ * rollback() drops it. The overlay is a reusable arena of entries plus an
+ * open addressing index whose slots are stamped with a generation, so
+ * rollback only bumps the generation: its cost does not depend on the size
+ * of the state or on the number of writes, and entry buffers are reused by
+ * the next execution.
+ *
+ * A snapshot::Snapshot can be attached under the base: reads fall through to
+ * it and the base only holds what changed since, with an empty value for an
+ * erased snapshot entry.
+ *
+ * Build: g++ -std=c++17 -O2 -Itools -c tools/host/hookstate.cpp tools/host/snapshot.cpp
+ */
+
+#ifndef HOST_HOOKSTATE_H
+#define HOST_HOOKSTATE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace snapshot
+{
+class Snapshot;
+}
+
+namespace hookstate
+{
+
+constexpr size_t ACCOUNT_ID_SIZE = 20;
+constexpr size_t NAMESPACE_SIZE = 32;
+constexpr size_t KEY_SIZE = 32;
+
+// hook account, namespace and key
+using Key = std::array<uint8_t, ACCOUNT_ID_SIZE + NAMESPACE_SIZE + KEY_SIZE>;
+using Value = std::vector<uint8_t>;
+
+Key make_key(const uint8_t account[ACCOUNT_ID_SIZE], const uint8_t ns[NAMESPACE_SIZE],
+             const uint8_t key[KEY_SIZE]);
+
+struct KeyHash
+{
+    size_t operator()(const Key &k) const
+    {
+        // the 32 byte key is the part that varies most, mixed with the account
+        uint64_t w[5];
+        std::memcpy(w, k.data() + ACCOUNT_ID_SIZE + NAMESPACE_SIZE, 32);
+        std::memcpy(&w[4], k.data(), 8);
+        uint64_t h = 0x9E3779B97F4A7C15ULL;
+        for (uint64_t x : w)
+            h = (h ^ x) * 0xBF58476D1CE4E5B9ULL;
+        return (size_t)(h ^ h >> 31);
+    }
+};
+
+using Map = std::unordered_map<Key, Value, KeyHash>;
+
+class Store
+{
+public:
+    // the value, or nullptr when absent or erased by the running execution
+    const uint8_t *get(const Key &key, size_t &size) const;
+    // an empty value erases
+    void set(const Key &key, const uint8_t *data, size_t len);
+
+    void commit();
+    void rollback();
+
+    // the snapshot must outlive the store, nullptr detaches it
+    void attach(const snapshot::Snapshot *snapshot) { snapshot_ = snapshot; }
+    const snapshot::Snapshot *attached() const { return snapshot_; }
+
+    // committed changes over the snapshot (all of the state without one); load
+    // state here between executions
+    Map &base() { return base_; }
+    const Map &base() const { return base_; }
+    // writes pending in the overlay
+    size_t pending() const { return used_; }
+    // the committed state, snapshot included, as one map
+    void flatten(Map &out) const;
+
+private:
+    struct Entry
+    {
+        Key key;
+        Value value; // empty: erased
+    };
+
+    Entry *find(const Key &key, size_t hash) const;
+    void insert_slot(uint32_t entry, size_t hash);
+    void grow();
+
+    Map base_;
+    const snapshot::Snapshot *snapshot_ = nullptr;
+    // overlay: entries_[0, used_) are live, the rest are kept for their buffers
+    mutable std::vector<Entry> entries_;
+    size_t used_ = 0;
+    // slot i holds entry index + 1 when stamps_[i] == generation_
+    std::vector<uint32_t> slots_;
+    std::vector<uint32_t> stamps_;
+    uint32_t generation_ = 1;
+};
+
+} // namespace hookstate
+
+#endif
@@ -0,0 +1,915 @@
+#include "hostapi.h"
+
+#include "base58.h"
+#include "error.h"
+#include "keylet.h"
+#include "sfcodes.h"
+#include "sha512.h"
+#include "xfl.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+namespace hostapi
+{
+
+using wasm::Instance;
+
+const char *exit_name(Exit exit)
+{
+    switch (exit)
+    {
+    case Exit::NONE:
+        return "none";
+    case Exit::ACCEPT:
+        return "accept";
+    case Exit::ROLLBACK:
+        return "rollback";
+    case Exit::ERROR:
+        return "error";
+    }
+    return "?";
+}
+
+void transaction_id(const uint8_t *blob, size_t len, uint8_t id[HASH_SIZE])
+{
+    static const uint8_t prefix[4] = {'T', 'X', 'N', 0};
+    sha512::Context c;
+    c.update(prefix, sizeof(prefix));
+    c.update(blob, len);
+    uint8_t digest[sha512::DIGEST_SIZE];
+    c.finish(digest);
+    std::memcpy(id, digest, HASH_SIZE);
+}
+
+void Context::set_otxn(std::vector<uint8_t> blob)
+{
+    otxn = std::move(blob);
+    otxn_valid = otxn_index.parse(otxn.data(), otxn.size());
+    transaction_id(otxn.data(), otxn.size(), otxn_id);
+}
+
+void Context::set_otxn(std::vector<uint8_t> blob, const uint8_t id[HASH_SIZE])
+{
+    otxn = std::move(blob);
+    otxn_valid = otxn_index.parse(otxn.data(), otxn.size());
+    std::memcpy(otxn_id, id, HASH_SIZE);
+}
+
+void Context::begin()
+{
+    exit = Exit::NONE;
+    exit_code = 0;
+    message.clear();
+    emitted.clear();
+    state_writes = 0;
+    state_read_bytes = 0;
+    state_written_bytes = 0;
+    for (uint32_t i = 1; i <= sto::Slots::MAX_SLOTS; ++i)
+        slots.clear(i);
+    reserved = -1;
+    nonces = 0;
+    issued_nonces.clear();
+    ledger_nonces = 0;
+    guards.clear();
+    last_guard = 0;
+}
+
+namespace
+{
+
+#define HOST(name) \
+    int64_t name([[maybe_unused]] Instance &inst, [[maybe_unused]] void *user, [[maybe_unused]] const uint64_t *arg)
+#define CTX (*static_cast<Context *>(user))
+#define U32(i) ((uint32_t)arg[i])
+#define I32(i) ((int32_t)(uint32_t)arg[i])
+#define I64(i) ((int64_t)arg[i])
+#define MEM(i) (inst.memory() + U32(i))
+// [arg[p], arg[p] + arg[l]) must be in guest memory
+#define CHECK(p, l)                      \
+    if (!inst.in_bounds(U32(p), U32(l))) \
+        return OUT_OF_BOUNDS;
+
+int64_t write_out(Instance &inst, uint32_t ptr, uint32_t len, const uint8_t *data, size_t size)
+{
+    if (!inst.in_bounds(ptr, len))
+        return OUT_OF_BOUNDS;
+    if (len < size)
+        return TOO_SMALL;
+    std::memcpy(inst.memory() + ptr, data, size);
+    inst.touch(ptr, size);
+    return (int64_t)size;
+}
+
+// values of at most 8 bytes read big endian, for the write_ptr == 0 forms
+int64_t as_int(const uint8_t *data, size_t size)
+{
+    if (size > 8)
+        return TOO_BIG;
+    uint64_t v = 0;
+    for (size_t i = 0; i < size; ++i)
+        v = v << 8 | data[i];
+    return (int64_t)v;
+}
+
+void put_be(uint8_t *p, uint64_t v, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; --i, v >>= 8)
+        p[i] = (uint8_t)v;
+}
+
+// state keys shorter than 32 bytes are left-padded with zeros
+bool pad_key(const uint8_t *key, uint32_t len, uint8_t out[HASH_SIZE])
+{
+    if (len == 0 || len > HASH_SIZE)
+        return false;
+    std::memset(out, 0, HASH_SIZE - len);
+    std::memcpy(out + HASH_SIZE - len, key, len);
+    return true;
+}
+
+int64_t halt_with(Instance &inst, Context &ctx, Exit exit, uint32_t ptr, uint32_t len, int64_t code)
+{
+    ctx.exit = exit;
+    ctx.exit_code = code;
+    if (inst.in_bounds(ptr, len))
+        ctx.message.assign((const char *)inst.memory() + ptr, len);
+    else
+        ctx.message.clear();
+    inst.halt(exit == Exit::ACCEPT ? RC_ACCEPT : RC_ROLLBACK);
+    return exit == Exit::ACCEPT ? RC_ACCEPT : RC_ROLLBACK;
+}
+
+uint32_t otxn_u32(const Context &ctx, uint32_t object, uint32_t field)
+{
+    if (!ctx.otxn_valid)
+        return 0;
+    uint32_t node = ctx.otxn_index.find(sto::Index::ROOT, object);
+    if (node == sto::Index::NOT_FOUND)
+        return 0;
+    node = ctx.otxn_index.find(node, field);
+    if (node == sto::Index::NOT_FOUND)
+        return 0;
+    return (uint32_t)as_int(ctx.otxn_index.payload(node), ctx.otxn_index.field(node).payload_size);
+}
+
+uint64_t otxn_burden_of(const Context &ctx)
+{
+    if (!ctx.otxn_valid)
+        return 1;
+    uint32_t node = ctx.otxn_index.find(sto::Index::ROOT, sfEmitDetails);
+    if (node == sto::Index::NOT_FOUND)
+        return 1;
+    node = ctx.otxn_index.find(node, sfEmitBurden);
+    if (node == sto::Index::NOT_FOUND)
+        return 1;
+    const uint8_t *p = ctx.otxn_index.payload(node);
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+        v = v << 8 | p[i];
+    return v & 0x7FFFFFFFFFFFFFFFULL;
+}
+
+void next_nonce(Context &ctx, uint8_t out[HASH_SIZE])
+{
+    uint8_t pre[HASH_SIZE + 4 + 4 + ACCOUNT_ID_SIZE];
+    std::memcpy(pre, ctx.otxn_id, HASH_SIZE);
+    put_be(pre + HASH_SIZE, ctx.ledger_seq, 4);
+    put_be(pre + HASH_SIZE + 4, ctx.nonces++, 4);
+    std::memcpy(pre + HASH_SIZE + 8, ctx.hook_account, ACCOUNT_ID_SIZE);
+    sha512::half(pre, sizeof(pre), out);
+    ctx.issued_nonces.emplace_back();
+    std::memcpy(ctx.issued_nonces.back().data(), out, HASH_SIZE);
+}
+
+// control
+
+HOST(guard)
+{
+    Context &ctx = CTX;
+    uint32_t id = U32(0), maxiter = U32(1);
+    auto &g = ctx.guards;
+    size_t i = ctx.last_guard;
+    if (i >= g.size() || g[i].first != id)
+    {
+        for (i = 0; i < g.size() && g[i].first != id; ++i)
+            ;
+        if (i == g.size())
+            g.push_back({id, 0});
+        ctx.last_guard = i;
+    }
+    if (++g[i].second > maxiter)
+    {
+        ctx.exit = Exit::ROLLBACK;
+        ctx.exit_code = GUARD_VIOLATION;
+        ctx.message = "guard violation";
+        inst.halt(RC_ROLLBACK);
+        return GUARD_VIOLATION;
+    }
+    return 1;
+}
+
+HOST(accept) { return halt_with(inst, CTX, Exit::ACCEPT, U32(0), U32(1), I64(2)); }
+HOST(rollback) { return halt_with(inst, CTX, Exit::ROLLBACK, U32(0), U32(1), I64(2)); }
+
+// hook and ledger
+
+HOST(hook_account) { return write_out(inst, U32(0), U32(1), CTX.hook_account, ACCOUNT_ID_SIZE); }
+
+HOST(hook_hash)
+{
+    if (I32(2) != -1 && I32(2) != 0)
+        return INVALID_ARGUMENT;
+    return write_out(inst, U32(0), U32(1), CTX.hook_hash, HASH_SIZE);
+}
+
+HOST(hook_pos) { return 0; }
+
+HOST(hook_param)
+{
+    Context &ctx = CTX;
+    CHECK(2, 3)
+    if (U32(3) == 0)
+        return TOO_SMALL;
+    if (U32(3) > MAX_PARAM_NAME)
+        return TOO_BIG;
+    auto it = ctx.params.find(std::vector<uint8_t>(MEM(2), MEM(2) + U32(3)));
+    if (it == ctx.params.end())
+        return DOESNT_EXIST;
+    return write_out(inst, U32(0), U32(1), it->second.data(), it->second.size());
+}
+
+HOST(ledger_seq) { return CTX.ledger_seq; }
+HOST(ledger_last_time) { return CTX.ledger_last_time; }
+HOST(ledger_last_hash) { return write_out(inst, U32(0), U32(1), CTX.ledger_last_hash, HASH_SIZE); }
+HOST(fee_base) { return CTX.fee_base; }
+
+HOST(ledger_nonce)
+{
+    Context &ctx = CTX;
+    CHECK(0, 1)
+    if (U32(1) < HASH_SIZE)
+        return TOO_SMALL;
+    if (ctx.ledger_nonces >= MAX_NONCES)
+        return TOO_MANY_NONCES;
+    uint8_t pre[HASH_SIZE + 4];
+    std::memcpy(pre, ctx.ledger_last_hash, HASH_SIZE);
+    put_be(pre + HASH_SIZE, ctx.ledger_nonces++, 4);
+    uint8_t nonce[HASH_SIZE];
+    sha512::half(pre, sizeof(pre), nonce);
+    return write_out(inst, U32(0), U32(1), nonce, HASH_SIZE);
+}
+
+// originating transaction
+
+HOST(otxn_id) { return write_out(inst, U32(0), U32(1), CTX.otxn_id, HASH_SIZE); }
+
+HOST(otxn_type)
+{
+    Context &ctx = CTX;
+    if (!ctx.otxn_valid)
+        return INVALID_TXN;
+    uint32_t node = ctx.otxn_index.find(sto::Index::ROOT, sfTransactionType);
+    if (node == sto::Index::NOT_FOUND)
+        return INVALID_TXN;
+    return as_int(ctx.otxn_index.payload(node), ctx.otxn_index.field(node).payload_size);
+}
+
+HOST(otxn_field)
+{
+    Context &ctx = CTX;
+    if (!ctx.otxn_valid)
+        return INVALID_TXN;
+    uint32_t node = ctx.otxn_index.find(sto::Index::ROOT, U32(2));
+    if (node == sto::Index::NOT_FOUND)
+        return DOESNT_EXIST;
+    const sto::Field &f = ctx.otxn_index.field(node);
+    const uint8_t *data = ctx.otxn_index.data() + (f.type() == sto::STI_ARRAY ? f.offset : f.payload_offset);
+    size_t size = f.type() == sto::STI_ARRAY ? f.size : f.payload_size;
+    if (U32(0) == 0)
+        return as_int(data, size);
+    return write_out(inst, U32(0), U32(1), data, size);
+}
+
+HOST(otxn_burden) { return (int64_t)otxn_burden_of(CTX); }
+HOST(otxn_generation) { return otxn_u32(CTX, sfEmitDetails, sfEmitGeneration); }
+
+HOST(otxn_slot)
+{
+    Context &ctx = CTX;
+    return ctx.slots.set(ctx.otxn.data(), ctx.otxn.size(), U32(0));
+}
+
+HOST(meta_slot)
+{
+    Context &ctx = CTX;
+    if (ctx.meta.empty())
+        return PREREQUISITE_NOT_MET;
+    return ctx.slots.set(ctx.meta.data(), ctx.meta.size(), U32(0));
+}
+
+// slots
+
+HOST(slot)
+{
+    Context &ctx = CTX;
+    const uint8_t *data = ctx.slots.data(U32(2));
+    if (!data)
+        return DOESNT_EXIST;
+    size_t size = (size_t)ctx.slots.size(U32(2));
+    if (U32(0) == 0)
+        return as_int(data, size);
+    return write_out(inst, U32(0), U32(1), data, size);
+}
+
+HOST(slot_set)
+{
+    Context &ctx = CTX;
+    CHECK(0, 1)
+    if (U32(1) != KEYLET_SIZE)
+        return INVALID_ARGUMENT;
+    Keylet k;
+    std::memcpy(k.data(), MEM(0), KEYLET_SIZE);
+    auto it = ctx.ledger.find(k);
+    if (it == ctx.ledger.end())
+        return DOESNT_EXIST;
+    return ctx.slots.set(it->second.data(), it->second.size(), U32(2));
+}
+
+HOST(slot_subfield) { return CTX.slots.subfield(U32(0), U32(1), U32(2)); }
+HOST(slot_subarray) { return CTX.slots.subarray(U32(0), U32(1), U32(2)); }
+HOST(slot_count) { return CTX.slots.count(U32(0)); }
+HOST(slot_size) { return CTX.slots.size(U32(0)); }
+HOST(slot_clear) { return CTX.slots.clear(U32(0)); }
+
+HOST(slot_type)
+{
+    const sto::Field *f = CTX.slots.field(U32(0));
+    if (!f)
+        return DOESNT_EXIST;
+    if (U32(1) == 0)
+        return f->code == 0 ? sto::STI_OBJECT : f->type();
+    if (U32(1) != 1)
+        return INVALID_ARGUMENT;
+    if (f->type() != sto::STI_AMOUNT)
+        return NOT_AN_AMOUNT;
+    // 1 for XRP
+    return !(CTX.slots.data(U32(0))[0] & 0x80);
+}
+
+HOST(slot_float)
+{
+    const sto::Field *f = CTX.slots.field(U32(0));
+    if (!f)
+        return DOESNT_EXIST;
+    if (f->type() != sto::STI_AMOUNT)
+        return NOT_AN_AMOUNT;
+    return xfl::amount_to_float(CTX.slots.data(U32(0)), f->payload_size);
+}
+
+// state
+
+int64_t state_read(Instance &inst, Context &ctx, uint32_t wptr, uint32_t wlen, const uint8_t account[],
+                   const uint8_t ns[], const uint8_t key[])
+{
+    size_t size;
+    const uint8_t *v = ctx.state.get(hookstate::make_key(account, ns, key), size);
+    if (!v)
+        return DOESNT_EXIST;
+    ctx.state_read_bytes += size;
+    if (wptr == 0)
+        return as_int(v, size);
+    return write_out(inst, wptr, wlen, v, size);
+}
+
+int64_t state_write(Instance &inst, Context &ctx, uint32_t rptr, uint32_t rlen, const uint8_t ns[],
+                    const uint8_t key[])
+{
+    if (!inst.in_bounds(rptr, rlen))
+        return OUT_OF_BOUNDS;
+    if (rlen > MAX_STATE_DATA)
+        return TOO_BIG;
+    ctx.state.set(hookstate::make_key(ctx.hook_account, ns, key), inst.memory() + rptr, rlen);
+    ++ctx.state_writes;
+    ctx.state_written_bytes += rlen;
+    return rlen;
+}
+
+HOST(state)
+{
+    Context &ctx = CTX;
+    CHECK(2, 3)
+    uint8_t key[HASH_SIZE];
+    if (!pad_key(MEM(2), U32(3), key))
+        return U32(3) == 0 ? TOO_SMALL : TOO_BIG;
+    return state_read(inst, ctx, U32(0), U32(1), ctx.hook_account, ctx.ns, key);
+}
+
+HOST(state_set)
+{
+    Context &ctx = CTX;
+    CHECK(2, 3)
+    uint8_t key[HASH_SIZE];
+    if (!pad_key(MEM(2), U32(3), key))
+        return U32(3) == 0 ? TOO_SMALL : TOO_BIG;
+    return state_write(inst, ctx, U32(0), U32(1), ctx.ns, key);
+}
+
+// namespace and account arguments of the foreign calls, zero length for the hook's own
+int64_t foreign_args(Instance &inst, Context &ctx, const uint64_t *arg, uint8_t key[], const uint8_t *&ns,
+                     const uint8_t *&account)
+{
+    CHECK(2, 3)
+    CHECK(4, 5)
+    CHECK(6, 7)
+    if (!pad_key(MEM(2), U32(3), key))
+        return U32(3) == 0 ? TOO_SMALL : TOO_BIG;
+    if (U32(5) != 0 && U32(5) != HASH_SIZE)
+        return INVALID_ARGUMENT;
+    if (U32(7) != 0 && U32(7) != ACCOUNT_ID_SIZE)
+        return INVALID_ARGUMENT;
+    ns = U32(5) ? MEM(4) : ctx.ns;
+    account = U32(7) ? MEM(6) : ctx.hook_account;
+    return 0;
+}
+
+HOST(state_foreign)
+{
+    Context &ctx = CTX;
+    uint8_t key[HASH_SIZE];
+    const uint8_t *ns, *account;
+    if (int64_t r = foreign_args(inst, ctx, arg, key, ns, account))
+        return r;
+    return state_read(inst, ctx, U32(0), U32(1), account, ns, key);
+}
+
+HOST(state_foreign_set)
+{
+    Context &ctx = CTX;
+    uint8_t key[HASH_SIZE];
+    const uint8_t *ns, *account;
+    if (int64_t r = foreign_args(inst, ctx, arg, key, ns, account))
+        return r;
+    // grants are not modelled: only the hook's own account is writable
+    if (std::memcmp(account, ctx.hook_account, ACCOUNT_ID_SIZE) != 0)
+        return NOT_AUTHORIZED;
+    return state_write(inst, ctx, U32(0), U32(1), ns, key);
+}
+
+// emission
+
+HOST(etxn_reserve)
+{
+    Context &ctx = CTX;
+    if (ctx.reserved >= 0)
+        return ALREADY_SET;
+    if (U32(0) < 1)
+        return TOO_SMALL;
+    if (U32(0) > MAX_EMIT)
+        return TOO_BIG;
+    ctx.reserved = U32(0);
+    return ctx.reserved;
+}
+
+HOST(etxn_burden)
+{
+    Context &ctx = CTX;
+    if (ctx.reserved < 0)
+        return PREREQUISITE_NOT_MET;
+    uint64_t burden = otxn_burden_of(ctx) * (uint64_t)ctx.reserved;
+    if (burden > 0x7FFFFFFFFFFFFFFFULL)
+        return FEE_TOO_LARGE;
+    return (int64_t)burden;
+}
+
+HOST(etxn_generation) { return otxn_u32(CTX, sfEmitDetails, sfEmitGeneration) + 1; }
+
+// base fee scaled by the burden of the emitted transaction; the ledger also adds
+// the cost of the hooks it will fire, which is not known here
+HOST(etxn_fee_base)
+{
+    Context &ctx = CTX;
+    CHECK(0, 1)
+    if (ctx.reserved < 0)
+        return PREREQUISITE_NOT_MET;
+    return ctx.fee_base * (int64_t)otxn_burden_of(ctx) * ctx.reserved;
+}
+
+HOST(etxn_nonce)
+{
+    Context &ctx = CTX;
+    CHECK(0, 1)
+    if (U32(1) < HASH_SIZE)
+        return TOO_SMALL;
+    if (ctx.nonces >= MAX_NONCES)
+        return TOO_MANY_NONCES;
+    uint8_t nonce[HASH_SIZE];
+    next_nonce(ctx, nonce);
+    return write_out(inst, U32(0), U32(1), nonce, HASH_SIZE);
+}
+
+HOST(etxn_details)
+{
+    Context &ctx = CTX;
+    CHECK(0, 1)
+    if (ctx.reserved < 0)
+        return PREREQUISITE_NOT_MET;
+    uint32_t size = ctx.has_callback ? EMIT_DETAILS_SIZE : EMIT_DETAILS_NO_CALLBACK_SIZE;
+    if (U32(1) < size)
+        return TOO_SMALL;
+    if (ctx.nonces >= MAX_NONCES)
+        return TOO_MANY_NONCES;
+
+    uint8_t out[EMIT_DETAILS_SIZE];
+    uint8_t *p = out;
+    *p++ = 0xED; // sfEmitDetails
+    *p++ = 0x20; // sfEmitGeneration
+    *p++ = 0x2E;
+    put_be(p, otxn_u32(ctx, sfEmitDetails, sfEmitGeneration) + 1, 4);
+    p += 4;
+    *p++ = 0x3D; // sfEmitBurden
+    put_be(p, otxn_burden_of(ctx) * (uint64_t)ctx.reserved, 8);
+    p += 8;
+    *p++ = 0x5B; // sfEmitParentTxnID
+    std::memcpy(p, ctx.otxn_id, HASH_SIZE);
+    p += HASH_SIZE;
+    *p++ = 0x5C; // sfEmitNonce
+    next_nonce(ctx, p);
+    p += HASH_SIZE;
+    *p++ = 0x5D; // sfEmitHookHash
+    std::memcpy(p, ctx.hook_hash, HASH_SIZE);
+    p += HASH_SIZE;
+    if (ctx.has_callback)
+    {
+        *p++ = 0x8A; // sfEmitCallback
+        *p++ = ACCOUNT_ID_SIZE;
+        std::memcpy(p, ctx.hook_account, ACCOUNT_ID_SIZE);
+        p += ACCOUNT_ID_SIZE;
+    }
+    *p++ = 0xE1;
+    return write_out(inst, U32(0), U32(1), out, (size_t)(p - out));
+}
+
+} // namespace
+
+// the ledger's checks on sfEmitDetails (xahaud, hook::emit in applyHook.cpp): the
+// generation, burden, parent transaction and hook hash must be what etxn_details
+// gives this execution and the nonce one that etxn_nonce or etxn_details issued
+// in it. sfEmitCallback is optional, a hook with a cbak may emit without one
+// (lib/macro.h ETXN_DETAILS_STRIP_CALLBACK), but when present it must name the
+// emitting hook's account.
+bool emit_details_valid(const Context &ctx, const sto::Index &tx)
+{
+    uint32_t details = tx.find(sto::Index::ROOT, sfEmitDetails);
+    if (details == sto::Index::NOT_FOUND)
+        return false;
+    auto equals = [&](uint32_t code, const uint8_t *want, size_t size) {
+        uint32_t n = tx.find(details, code);
+        return n != sto::Index::NOT_FOUND && tx.field(n).payload_size == size &&
+               std::memcmp(tx.payload(n), want, size) == 0;
+    };
+    uint8_t generation[4], burden[8];
+    put_be(generation, otxn_u32(ctx, sfEmitDetails, sfEmitGeneration) + 1, 4);
+    put_be(burden, otxn_burden_of(ctx) * (uint64_t)ctx.reserved, 8);
+    if (!equals(sfEmitGeneration, generation, sizeof(generation)) || !equals(sfEmitBurden, burden, sizeof(burden)) ||
+        !equals(sfEmitParentTxnID, ctx.otxn_id, HASH_SIZE) || !equals(sfEmitHookHash, ctx.hook_hash, HASH_SIZE))
+        return false;
+    bool issued = false;
+    for (const auto &nonce : ctx.issued_nonces)
+        issued = issued || equals(sfEmitNonce, nonce.data(), HASH_SIZE);
+    if (!issued)
+        return false;
+    return tx.find(details, sfEmitCallback) == sto::Index::NOT_FOUND ||
+           equals(sfEmitCallback, ctx.hook_account, ACCOUNT_ID_SIZE);
+}
+
+namespace
+{
+
+HOST(emit)
+{
+    Context &ctx = CTX;
+    CHECK(0, 1)
+    CHECK(2, 3)
+    if (U32(1) < HASH_SIZE)
+        return TOO_SMALL;
+    if (ctx.reserved < 0)
+        return PREREQUISITE_NOT_MET;
+    if (ctx.emitted.size() >= (size_t)ctx.reserved)
+        return TOO_MANY_EMITTED_TXN;
+    sto::Index tx;
+    if (!tx.parse(MEM(2), U32(3)) || !emit_details_valid(ctx, tx))
+        return EMISSION_FAILURE;
+    ctx.emitted.emplace_back(MEM(2), MEM(2) + U32(3));
+    uint8_t id[HASH_SIZE];
+    transaction_id(MEM(2), U32(3), id);
+    return write_out(inst, U32(0), U32(1), id, HASH_SIZE);
+}
+
+// serialized objects and utilities
+
+HOST(sto_subfield)
+{
+    CHECK(0, 1)
+    return sto::sto_subfield(MEM(0), U32(1), U32(2));
+}
+
+HOST(sto_subarray)
+{
+    CHECK(0, 1)
+    return sto::sto_subarray(MEM(0), U32(1), U32(2));
+}
+
+HOST(sto_validate)
+{
+    CHECK(0, 1)
+    if (U32(1) < 2)
+        return TOO_SMALL;
+    sto::Index index;
+    return index.parse(MEM(0), U32(1)) ? 1 : 0;
+}
+
+HOST(util_raddr)
+{
+    CHECK(0, 1)
+    CHECK(2, 3)
+    int64_t r = base58::util_raddr(MEM(0), U32(1), MEM(2), U32(3));
+    if (r > 0)
+        inst.touch(U32(0), (uint64_t)r);
+    return r;
+}
+
+HOST(util_accid)
+{
+    CHECK(0, 1)
+    CHECK(2, 3)
+    int64_t r = base58::util_accid(MEM(0), U32(1), MEM(2), U32(3));
+    if (r > 0)
+        inst.touch(U32(0), (uint64_t)r);
+    return r;
+}
+
+HOST(util_keylet)
+{
+    CHECK(0, 1)
+    int64_t r = keylet::util_keylet(MEM(0), U32(1), U32(2), inst.memory(), (uint32_t)inst.memory_size(), U32(3),
+                                    U32(4), U32(5), U32(6), U32(7), U32(8));
+    if (r > 0)
+        inst.touch(U32(0), (uint64_t)r);
+    return r;
+}
+
+HOST(util_sha512h)
+{
+    CHECK(0, 1)
+    CHECK(2, 3)
+    int64_t r = keylet::util_sha512h(MEM(0), U32(1), MEM(2), U32(3));
+    if (r > 0)
+        inst.touch(U32(0), (uint64_t)r);
+    return r;
+}
+
+// trace output, only when Context::trace is set
+
+HOST(trace)
+{
+    Context &ctx = CTX;
+    CHECK(0, 1)
+    CHECK(2, 3)
+    if (!ctx.trace)
+        return 0;
+    std::fprintf(ctx.trace, "%.*s ", (int)U32(1), (const char *)MEM(0));
+    if (U32(4))
+        for (uint32_t i = 0; i < U32(3); ++i)
+            std::fprintf(ctx.trace, "%02X", MEM(2)[i]);
+    else
+        std::fprintf(ctx.trace, "%.*s", (int)U32(3), (const char *)MEM(2));
+    std::fputc('\n', ctx.trace);
+    return 0;
+}
+
+HOST(trace_num)
+{
+    Context &ctx = CTX;
+    CHECK(0, 1)
+    if (ctx.trace)
+        std::fprintf(ctx.trace, "%.*s %" PRId64 "\n", (int)U32(1), (const char *)MEM(0), I64(2));
+    return 0;
+}
+
+HOST(trace_float)
+{
+    Context &ctx = CTX;
+    CHECK(0, 1)
+    if (!ctx.trace)
+        return 0;
+    int64_t f = I64(2);
+    if (f == 0)
+        std::fprintf(ctx.trace, "%.*s Float 0*10^(0)\n", (int)U32(1), (const char *)MEM(0));
+    else
+        std::fprintf(ctx.trace, "%.*s Float %s%" PRIu64 "*10^(%d)\n", (int)U32(1), (const char *)MEM(0),
+                     xfl::is_negative(f) ? "-" : "", xfl::mantissa_of(f), xfl::exponent_of(f));
+    return 0;
+}
+
+HOST(trace_slot)
+{
+    Context &ctx = CTX;
+    CHECK(0, 1)
+    const uint8_t *data = ctx.slots.data(U32(2));
+    if (!data)
+        return DOESNT_EXIST;
+    if (ctx.trace)
+    {
+        std::fprintf(ctx.trace, "%.*s ", (int)U32(1), (const char *)MEM(0));
+        for (int64_t i = 0, n = ctx.slots.size(U32(2)); i < n; ++i)
+            std::fprintf(ctx.trace, "%02X", data[i]);
+        std::fputc('\n', ctx.trace);
+    }
+    return 0;
+}
+
+// floats
+
+HOST(float_set) { return xfl::float_set(I32(0), I64(1)); }
+HOST(float_one) { return xfl::float_one(); }
+HOST(float_compare) { return xfl::float_compare(I64(0), I64(1), U32(2)); }
+HOST(float_sum) { return xfl::float_sum(I64(0), I64(1)); }
+HOST(float_negate) { return xfl::float_negate(I64(0)); }
+HOST(float_multiply) { return xfl::float_multiply(I64(0), I64(1)); }
+HOST(float_mulratio) { return xfl::float_mulratio(I64(0), U32(1), U32(2), U32(3)); }
+HOST(float_divide) { return xfl::float_divide(I64(0), I64(1)); }
+HOST(float_invert) { return xfl::float_invert(I64(0)); }
+HOST(float_int) { return xfl::float_int(I64(0), U32(1), U32(2)); }
+HOST(float_exponent) { return xfl::float_exponent(I64(0)); }
+HOST(float_exponent_set) { return xfl::float_exponent_set(I64(0), I32(1)); }
+HOST(float_mantissa) { return xfl::float_mantissa(I64(0)); }
+HOST(float_mantissa_set) { return xfl::float_mantissa_set(I64(0), I64(1)); }
+HOST(float_sign) { return xfl::float_sign(I64(0)); }
+HOST(float_sign_set) { return xfl::float_sign_set(I64(0), U32(1)); }
+HOST(float_log) { return xfl::float_log(I64(0)); }
+HOST(float_root) { return xfl::float_root(I64(0), U32(1)); }
+
+HOST(float_sto)
+{
+    CHECK(0, 1)
+    CHECK(2, 3)
+    CHECK(4, 5)
+    int64_t r = xfl::float_sto(MEM(0), U32(1), MEM(2), U32(3), MEM(4), U32(5), I64(6), U32(7));
+    if (r > 0)
+        inst.touch(U32(0), (uint64_t)r);
+    return r;
+}
+
+HOST(float_sto_set)
+{
+    CHECK(0, 1)
+    return xfl::float_sto_set(MEM(0), U32(1));
+}
+
+// every other import
+HOST(not_implemented)
+{
+    Context &ctx = CTX;
+    const std::string &name = inst.import_name(inst.current_import());
+    if (std::find(ctx.unimplemented.begin(), ctx.unimplemented.end(), name) == ctx.unimplemented.end())
+        ctx.unimplemented.push_back(name);
+    return NOT_IMPLEMENTED;
+}
+
+#undef HOST
+#undef CTX
+#undef U32
+#undef I32
+#undef I64
+#undef MEM
+#undef CHECK
+
+struct Entry
+{
+    const char *name;
+    wasm::HostFunc func;
+};
+
+const Entry HOST_FUNCTIONS[] = {
+    {"_g", guard},
+    {"accept", accept},
+    {"rollback", rollback},
+    {"hook_account", hook_account},
+    {"hook_hash", hook_hash},
+    {"hook_pos", hook_pos},
+    {"hook_param", hook_param},
+    {"ledger_seq", ledger_seq},
+    {"ledger_last_time", ledger_last_time},
+    {"ledger_last_hash", ledger_last_hash},
+    {"ledger_nonce", ledger_nonce},
+    {"fee_base", fee_base},
+    {"otxn_id", otxn_id},
+    {"otxn_type", otxn_type},
+    {"otxn_field", otxn_field},
+    {"otxn_burden", otxn_burden},
+    {"otxn_generation", otxn_generation},
+    {"otxn_slot", otxn_slot},
+    {"meta_slot", meta_slot},
+    {"slot", slot},
+    {"slot_set", slot_set},
+    {"slot_subfield", slot_subfield},
+    {"slot_subarray", slot_subarray},
+    {"slot_count", slot_count},
+    {"slot_size", slot_size},
+    {"slot_clear", slot_clear},
+    {"slot_type", slot_type},
+    {"slot_float", slot_float},
+    {"state", state},
+    {"state_set", state_set},
+    {"state_foreign", state_foreign},
+    {"state_foreign_set", state_foreign_set},
+    {"etxn_reserve", etxn_reserve},
+    {"etxn_burden", etxn_burden},
+    {"etxn_generation", etxn_generation},
+    {"etxn_fee_base", etxn_fee_base},
+    {"etxn_nonce", etxn_nonce},
+    {"etxn_details", etxn_details},
+    {"emit", emit},
+    {"sto_subfield", sto_subfield},
+    {"sto_subarray", sto_subarray},
+    {"sto_validate", sto_validate},
+    {"util_raddr", util_raddr},
+    {"util_accid", util_accid},
+    {"util_keylet", util_keylet},
+    {"util_sha512h", util_sha512h},
+    {"trace", trace},
+    {"trace_num", trace_num},
+    {"trace_float", trace_float},
+    {"trace_slot", trace_slot},
+    {"float_set", float_set},
+    {"float_one", float_one},
+    {"float_compare", float_compare},
+    {"float_sum", float_sum},
+    {"float_negate", float_negate},
+    {"float_multiply", float_multiply},
+    {"float_mulratio", float_mulratio},
+    {"float_divide", float_divide},
+    {"float_invert", float_invert},
+    {"float_int", float_int},
+    {"float_exponent", float_exponent},
+    {"float_exponent_set", float_exponent_set},
+    {"float_mantissa", float_mantissa},
+    {"float_mantissa_set", float_mantissa_set},
+    {"float_sign", float_sign},
+    {"float_sign_set", float_sign_set},
+    {"float_log", float_log},
+    {"float_root", float_root},
+    {"float_sto", float_sto},
+    {"float_sto_set", float_sto_set},
+};
+
+} // namespace
+
+void bind(wasm::Imports &imports, Context &ctx)
+{
+    for (const Entry &e : HOST_FUNCTIONS)
+        imports.bind("env", e.name, e.func, &ctx);
+    imports.fallback(not_implemented, &ctx);
+}
+
+Outcome run(Instance &instance, Context &ctx, bool callback, uint64_t fuel)
+{
+    instance.reset();
+    ctx.begin();
+    ctx.has_callback = instance.module().find_export("cbak").has_value();
+
+    uint64_t arg = 0;
+    wasm::Result r = instance.call(callback ? "cbak" : "hook", &arg, 1, fuel);
+
+    Outcome out{ctx.exit, ctx.exit_code, r.instructions, r.host_calls, {}};
+    if (r.status == wasm::Status::TRAP || r.status == wasm::Status::OUT_OF_FUEL)
+    {
+        out.exit = ctx.exit = Exit::ERROR;
+        out.trap = r.status == wasm::Status::TRAP ? r.trap : "out of fuel";
+    }
+    else if (ctx.exit == Exit::NONE)
+        out.code = ctx.exit_code = (int64_t)r.value;
+    return out;
+}
+
+void finish(Context &ctx, bool keep)
+{
+    if (keep)
+        ctx.state.commit();
+    else
+    {
+        ctx.state.rollback();
+        ctx.emitted.clear();
+    }
+}
+
+Outcome execute(Instance &instance, Context &ctx, bool callback, uint64_t fuel)
+{
+    Outcome out = run(instance, ctx, callback, fuel);
+    finish(ctx, ctx.exit == Exit::ACCEPT);
+    return out;
+}
+
+} // namespace hostapi
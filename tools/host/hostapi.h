@@ -0,0 +1,148 @@
+/**
+ * Host implementation of the lib/extern.h imports for wasm::Instance.
+ *
+ * A Context holds what a hook sees of the ledger (its account, the
+ * originating transaction and metadata, ledger entries for slot_set, hook
+ * parameters, hook state) and collects what one execution produces: the exit
+ * type and message, emitted transactions and state writes. bind() registers
+ * every implemented import; the others return NOT_IMPLEMENTED and are listed
+ * in Context::unimplemented. Amount, keylet, base58 and STObject calls go
+ * through the other host libraries.
+ *
+ * emit() applies the ledger's checks on sfEmitDetails: generation, burden,
+ * parent transaction and hook hash as etxn_details gives them, a nonce issued by
+ * etxn_nonce or etxn_details in this execution, and sfEmitCallback, when present,
+ * naming the hook's own account. A hook with a cbak may leave it out.
+ *
+ * execute() runs hook or cbak once and applies the ledger's all-or-nothing
+ * rule: state writes and emitted transactions are kept only on accept.
+ * run() and finish() split it for callers that run several hooks on one
+ * transaction. State
+ * writes go to the overlay of a hookstate::Store, so discarding them does not
+ * depend on the size of the state.
+ *
+ * Build: g++ -std=c++17 -O2 -Ilib -Itools -c tools/host/hostapi.cpp
+ */
+
+#ifndef HOST_HOSTAPI_H
+#define HOST_HOSTAPI_H
+
+#include "host/hookstate.h"
+#include "host/stobject.h"
+#include "wasm/interp.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hostapi
+{
+
+constexpr size_t ACCOUNT_ID_SIZE = 20;
+constexpr size_t HASH_SIZE = 32;
+constexpr size_t KEYLET_SIZE = 34;
+constexpr uint32_t MAX_STATE_DATA = 256;
+constexpr uint32_t MAX_EMIT = 255;
+constexpr uint32_t MAX_NONCES = 256;
+constexpr uint32_t MAX_PARAM_NAME = 32;
+// etxn_details output with and without sfEmitCallback, see lib/macro.h
+constexpr uint32_t EMIT_DETAILS_SIZE = 138;
+constexpr uint32_t EMIT_DETAILS_NO_CALLBACK_SIZE = 116;
+
+using Keylet = std::array<uint8_t, KEYLET_SIZE>;
+
+enum class Exit
+{
+    NONE,     // returned without accept or rollback, treated as rollback
+    ACCEPT,
+    ROLLBACK, // rollback, guard violation
+    ERROR,    // trap or out of fuel
+};
+
+const char *exit_name(Exit exit);
+
+struct Context
+{
+    // the hook
+    uint8_t hook_account[ACCOUNT_ID_SIZE] = {};
+    uint8_t ns[HASH_SIZE] = {};
+    uint8_t hook_hash[HASH_SIZE] = {};
+    std::map<std::vector<uint8_t>, std::vector<uint8_t>> params;
+    bool has_callback = false; // set by execute() when the module exports cbak
+
+    // the transaction it runs on, set_otxn() indexes it and derives its ID
+    std::vector<uint8_t> otxn;
+    std::vector<uint8_t> meta; // for cbak, empty otherwise
+    uint8_t otxn_id[HASH_SIZE] = {};
+
+    // the ledger
+    uint32_t ledger_seq = 1;
+    uint32_t ledger_last_time = 0;
+    uint8_t ledger_last_hash[HASH_SIZE] = {};
+    int64_t fee_base = 10;
+    std::map<Keylet, std::vector<uint8_t>> ledger; // serialized entries by keylet
+    hookstate::Store state;
+
+    FILE *trace = nullptr;
+
+    // the last execution
+    Exit exit = Exit::NONE;
+    int64_t exit_code = 0;
+    std::string message;
+    std::vector<std::vector<uint8_t>> emitted;
+    uint32_t state_writes = 0;
+    uint64_t state_read_bytes = 0;    // of values found by state and state_foreign
+    uint64_t state_written_bytes = 0; // passed to state_set and state_foreign_set
+    std::vector<std::string> unimplemented;
+
+    void set_otxn(std::vector<uint8_t> blob);
+    // with the ID already known, for callers running several hooks on one transaction
+    void set_otxn(std::vector<uint8_t> blob, const uint8_t id[HASH_SIZE]);
+    // clears the per-execution fields
+    void begin();
+
+    // per execution, for the host functions
+    sto::Index otxn_index;
+    bool otxn_valid = false;
+    sto::Slots slots;
+    int64_t reserved = -1;
+    uint32_t nonces = 0;
+    std::vector<std::array<uint8_t, HASH_SIZE>> issued_nonces; // by etxn_nonce and etxn_details
+    uint32_t ledger_nonces = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> guards; // guard id, hits
+    size_t last_guard = 0;
+};
+
+void bind(wasm::Imports &imports, Context &ctx);
+
+struct Outcome
+{
+    Exit exit;
+    int64_t code;
+    uint64_t instructions;
+    uint64_t host_calls;
+    std::string trap; // for Exit::ERROR
+};
+
+// resets the instance and runs hook (or cbak), leaving its effects pending
+Outcome run(wasm::Instance &instance, Context &ctx, bool callback = false, uint64_t fuel = UINT64_MAX);
+// keeps or discards the effects of the last run: a transaction that runs
+// several hooks keeps them only when every hook accepts
+void finish(Context &ctx, bool keep);
+// run() then finish() on the hook's own exit
+Outcome execute(wasm::Instance &instance, Context &ctx, bool callback = false,
+                uint64_t fuel = UINT64_MAX);
+
+// whether emit() accepts the sfEmitDetails of tx, see above
+bool emit_details_valid(const Context &ctx, const sto::Index &tx);
+
+// the hash emit() returns: SHA-512Half of "TXN\0" and the blob
+void transaction_id(const uint8_t *blob, size_t len, uint8_t id[HASH_SIZE]);
+
+} // namespace hostapi
+
+#endif
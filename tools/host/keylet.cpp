@@ -0,0 +1,510 @@
+#include "keylet.h"
+
+#include "error.h"
+#include "sha512.h"
+
+#include <cstring>
+
+namespace keylet
+{
+
+namespace
+{
+
+// ledger namespaces, the first two bytes of every preimage
+constexpr uint16_t NS_ACCOUNT = 'a';
+constexpr uint16_t NS_DIR_NODE = 'd';
+constexpr uint16_t NS_TRUST_LINE = 'r';
+constexpr uint16_t NS_OFFER = 'o';
+constexpr uint16_t NS_OWNER_DIR = 'O';
+constexpr uint16_t NS_SKIP_LIST = 's';
+constexpr uint16_t NS_ESCROW = 'u';
+constexpr uint16_t NS_AMENDMENTS = 'f';
+constexpr uint16_t NS_FEE_SETTINGS = 'e';
+constexpr uint16_t NS_TICKET = 'T';
+constexpr uint16_t NS_SIGNER_LIST = 'S';
+constexpr uint16_t NS_PAYCHAN = 'x';
+constexpr uint16_t NS_CHECK = 'C';
+constexpr uint16_t NS_DEPOSIT_PREAUTH = 'p';
+constexpr uint16_t NS_NEGATIVE_UNL = 'N';
+constexpr uint16_t NS_HOOK = 'H';
+constexpr uint16_t NS_HOOK_STATE = 'v';
+constexpr uint16_t NS_EMITTED_TXN = 'E';
+constexpr uint16_t NS_EMITTED_DIR = 'F';
+
+// namespace, account, account, state key and namespace is the longest preimage
+constexpr size_t MAX_PREIMAGE = 2 + ACCOUNT_ID_SIZE + ACCOUNT_ID_SIZE + KEY_SIZE + KEY_SIZE;
+
+// what a request hashes to: either a preimage or a key used as is
+struct Plan
+{
+    uint16_t type;
+    bool direct;
+    size_t len;
+    uint8_t data[MAX_PREIMAGE];
+
+    void start(uint16_t entry_type, uint16_t space)
+    {
+        type = entry_type;
+        direct = false;
+        len = 0;
+        data[len++] = (uint8_t)(space >> 8);
+        data[len++] = (uint8_t)space;
+    }
+
+    void add(const uint8_t *bytes, size_t n)
+    {
+        std::memcpy(data + len, bytes, n);
+        len += n;
+    }
+
+    void add32(uint32_t v)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            data[len++] = (uint8_t)(v >> shift);
+    }
+
+    void add64(uint64_t v)
+    {
+        for (int shift = 56; shift >= 0; shift -= 8)
+            data[len++] = (uint8_t)(v >> shift);
+    }
+
+    void use(uint16_t entry_type, const uint8_t key[KEY_SIZE])
+    {
+        type = entry_type;
+        direct = true;
+        len = KEY_SIZE;
+        std::memcpy(data, key, KEY_SIZE);
+    }
+};
+
+// accounts, then a sequence or an object ID given directly
+bool plan_sequenced(const Request &r, uint16_t type, uint16_t space, bool two_accounts, Plan &p)
+{
+    if (!r.account || (two_accounts && !r.account2))
+        return false;
+    if (r.key)
+    {
+        p.use(type, r.key);
+        return true;
+    }
+    p.start(type, space);
+    p.add(r.account, ACCOUNT_ID_SIZE);
+    if (two_accounts)
+        p.add(r.account2, ACCOUNT_ID_SIZE);
+    p.add32((uint32_t)r.number);
+    return true;
+}
+
+bool plan_account(const Request &r, uint16_t type, uint16_t space, Plan &p)
+{
+    if (!r.account)
+        return false;
+    p.start(type, space);
+    p.add(r.account, ACCOUNT_ID_SIZE);
+    return true;
+}
+
+bool plan(const Request &r, Plan &p)
+{
+    switch (r.type)
+    {
+    case HOOK:
+        return plan_account(r, LT_HOOK, NS_HOOK, p);
+    case ACCOUNT:
+        return plan_account(r, LT_ACCOUNT_ROOT, NS_ACCOUNT, p);
+    case OWNER_DIR:
+        return plan_account(r, LT_DIR_NODE, NS_OWNER_DIR, p);
+    case SIGNERS:
+        if (!plan_account(r, LT_SIGNER_LIST, NS_SIGNER_LIST, p))
+            return false;
+        // the default signer list ID
+        p.add32(0);
+        return true;
+    case HOOK_STATE:
+        if (!r.account || !r.key || !r.ns)
+            return false;
+        p.start(LT_HOOK_STATE, NS_HOOK_STATE);
+        p.add(r.account, ACCOUNT_ID_SIZE);
+        p.add(r.key, KEY_SIZE);
+        p.add(r.ns, KEY_SIZE);
+        return true;
+    case AMENDMENTS:
+        p.start(LT_AMENDMENTS, NS_AMENDMENTS);
+        return true;
+    case FEES:
+        p.start(LT_FEE_SETTINGS, NS_FEE_SETTINGS);
+        return true;
+    case NEGATIVE_UNL:
+        p.start(LT_NEGATIVE_UNL, NS_NEGATIVE_UNL);
+        return true;
+    case EMITTED_DIR:
+        p.start(LT_DIR_NODE, NS_EMITTED_DIR);
+        return true;
+    case SKIP:
+        p.start(LT_LEDGER_HASHES, NS_SKIP_LIST);
+        if (r.number != NO_LEDGER)
+            p.add32((uint32_t)r.number >> 16);
+        return true;
+    case CHILD:
+    case UNCHECKED:
+        if (!r.key)
+            return false;
+        p.use(r.type == CHILD ? LT_CHILD : LT_ANY, r.key);
+        return true;
+    case EMITTED:
+        if (!r.key)
+            return false;
+        p.start(LT_EMITTED_TXN, NS_EMITTED_TXN);
+        p.add(r.key, KEY_SIZE);
+        return true;
+    case LINE:
+    {
+        if (!r.account || !r.account2 || !r.key)
+            return false;
+        // the lower account ID comes first
+        bool swap = std::memcmp(r.account, r.account2, ACCOUNT_ID_SIZE) > 0;
+        p.start(LT_RIPPLE_STATE, NS_TRUST_LINE);
+        p.add(swap ? r.account2 : r.account, ACCOUNT_ID_SIZE);
+        p.add(swap ? r.account : r.account2, ACCOUNT_ID_SIZE);
+        p.add(r.key, CURRENCY_SIZE);
+        return true;
+    }
+    case DEPOSIT_PREAUTH:
+        if (!r.account || !r.account2)
+            return false;
+        p.start(LT_DEPOSIT_PREAUTH, NS_DEPOSIT_PREAUTH);
+        p.add(r.account, ACCOUNT_ID_SIZE);
+        p.add(r.account2, ACCOUNT_ID_SIZE);
+        return true;
+    case OFFER:
+        return plan_sequenced(r, LT_OFFER, NS_OFFER, false, p);
+    case CHECK:
+        return plan_sequenced(r, LT_CHECK, NS_CHECK, false, p);
+    case ESCROW:
+        return plan_sequenced(r, LT_ESCROW, NS_ESCROW, false, p);
+    case TICKET:
+        return plan_sequenced(r, LT_TICKET, NS_TICKET, false, p);
+    case PAYCHAN:
+        return plan_sequenced(r, LT_PAYCHAN, NS_PAYCHAN, true, p);
+    case QUALITY:
+        if (!r.key)
+            return false;
+        // the book directory with its last 8 bytes replaced by the quality
+        p.use(LT_DIR_NODE, r.key);
+        for (int i = 0; i < 8; ++i)
+            p.data[KEY_SIZE - 1 - i] = (uint8_t)(r.number >> (8 * i));
+        return true;
+    case PAGE:
+        if (!r.key)
+            return false;
+        if (r.number == 0)
+        {
+            p.use(LT_DIR_NODE, r.key);
+            return true;
+        }
+        p.start(LT_DIR_NODE, NS_DIR_NODE);
+        p.add(r.key, KEY_SIZE);
+        p.add64(r.number);
+        return true;
+    default:
+        return false;
+    }
+}
+
+Keylet finish(const Plan &p)
+{
+    Keylet k;
+    k.type = p.type;
+    if (p.direct)
+        std::memcpy(k.key, p.data, KEY_SIZE);
+    else
+        sha512::half(p.data, p.len, k.key);
+    return k;
+}
+
+Keylet must_build(const Request &r)
+{
+    Plan p;
+    plan(r, p);
+    return finish(p);
+}
+
+} // namespace
+
+void Keylet::serialize(uint8_t out[KEYLET_SIZE]) const
+{
+    out[0] = (uint8_t)(type >> 8);
+    out[1] = (uint8_t)type;
+    std::memcpy(out + 2, key, KEY_SIZE);
+}
+
+bool build(const Request &request, Keylet &out)
+{
+    Plan p;
+    if (!plan(request, p))
+        return false;
+    out = finish(p);
+    return true;
+}
+
+size_t batch(const Request *requests, Keylet *out, uint8_t *valid, size_t n)
+{
+    constexpr size_t CHUNK = 64;
+    Plan plans[CHUNK];
+    const uint8_t *msgs[CHUNK];
+    size_t lens[CHUNK];
+    uint8_t digests[CHUNK][sha512::HALF_SIZE];
+    size_t index[CHUNK];
+    size_t built = 0;
+    for (size_t base = 0; base < n; base += CHUNK)
+    {
+        size_t count = n - base < CHUNK ? n - base : CHUNK;
+        size_t hashed = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            Plan &p = plans[i];
+            bool ok = plan(requests[base + i], p);
+            valid[base + i] = ok;
+            built += ok;
+            if (!ok)
+            {
+                out[base + i] = Keylet{};
+                continue;
+            }
+            if (p.direct)
+            {
+                out[base + i] = finish(p);
+                continue;
+            }
+            msgs[hashed] = p.data;
+            lens[hashed] = p.len;
+            index[hashed++] = i;
+        }
+        sha512::half_batch(msgs, lens, digests, hashed);
+        for (size_t h = 0; h < hashed; ++h)
+        {
+            Keylet &k = out[base + index[h]];
+            k.type = plans[index[h]].type;
+            std::memcpy(k.key, digests[h], KEY_SIZE);
+        }
+    }
+    return built;
+}
+
+Keylet account(const uint8_t id[ACCOUNT_ID_SIZE])
+{
+    Request r{ACCOUNT};
+    r.account = id;
+    return must_build(r);
+}
+
+Keylet line(const uint8_t a[ACCOUNT_ID_SIZE], const uint8_t b[ACCOUNT_ID_SIZE], const uint8_t currency[CURRENCY_SIZE])
+{
+    Request r{LINE};
+    r.account = a;
+    r.account2 = b;
+    r.key = currency;
+    return must_build(r);
+}
+
+Keylet owner_dir(const uint8_t id[ACCOUNT_ID_SIZE])
+{
+    Request r{OWNER_DIR};
+    r.account = id;
+    return must_build(r);
+}
+
+Keylet hook(const uint8_t id[ACCOUNT_ID_SIZE])
+{
+    Request r{HOOK};
+    r.account = id;
+    return must_build(r);
+}
+
+Keylet hook_state(const uint8_t id[ACCOUNT_ID_SIZE], const uint8_t key[KEY_SIZE], const uint8_t ns[KEY_SIZE])
+{
+    Request r{HOOK_STATE};
+    r.account = id;
+    r.key = key;
+    r.ns = ns;
+    return must_build(r);
+}
+
+int64_t util_keylet(uint8_t *write, uint32_t write_len, uint32_t keylet_type, const uint8_t *memory,
+                    uint32_t memory_len, uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t e, uint32_t f)
+{
+    if (write_len < KEYLET_SIZE)
+        return TOO_SMALL;
+    if (keylet_type < HOOK || keylet_type > EMITTED)
+        return INVALID_ARGUMENT;
+
+    auto in_bounds = [&](uint32_t ptr, uint32_t len) { return (uint64_t)ptr + len <= memory_len; };
+    Request r{keylet_type};
+    switch (keylet_type)
+    {
+    // no arguments
+    case AMENDMENTS:
+    case FEES:
+    case NEGATIVE_UNL:
+    case EMITTED_DIR:
+        if (a || b || c || d || e || f)
+            return INVALID_ARGUMENT;
+        break;
+
+    // a ledger index when b is 1
+    case SKIP:
+        if (c || d || e || f || b > 1)
+            return INVALID_ARGUMENT;
+        r.number = b ? a : NO_LEDGER;
+        break;
+
+    // a 32 byte key
+    case CHILD:
+    case EMITTED:
+    case UNCHECKED:
+        if (!a || !b || c || d || e || f)
+            return INVALID_ARGUMENT;
+        if (!in_bounds(a, b))
+            return OUT_OF_BOUNDS;
+        if (b != KEY_SIZE)
+            return INVALID_ARGUMENT;
+        r.key = memory + a;
+        break;
+
+    // a 34 byte directory keylet and a 64 bit quality in c:d
+    case QUALITY:
+        if (!a || !b || e || f)
+            return INVALID_ARGUMENT;
+        if (!in_bounds(a, b))
+            return OUT_OF_BOUNDS;
+        if (b != KEYLET_SIZE || memory[a] != 0 || memory[a + 1] != LT_DIR_NODE)
+            return INVALID_ARGUMENT;
+        r.key = memory + a + 2;
+        r.number = (uint64_t)c << 32 | d;
+        break;
+
+    // a 32 byte directory root and a 64 bit page index in c:d
+    case PAGE:
+        if (!a || !b || e || f)
+            return INVALID_ARGUMENT;
+        if (!in_bounds(a, b))
+            return OUT_OF_BOUNDS;
+        if (b != KEY_SIZE)
+            return INVALID_ARGUMENT;
+        r.key = memory + a;
+        r.number = (uint64_t)c << 32 | d;
+        break;
+
+    // a 20 byte account ID
+    case HOOK:
+    case ACCOUNT:
+    case SIGNERS:
+    case OWNER_DIR:
+        if (!a || !b || c || d || e || f)
+            return INVALID_ARGUMENT;
+        if (!in_bounds(a, b))
+            return OUT_OF_BOUNDS;
+        if (b != ACCOUNT_ID_SIZE)
+            return INVALID_ARGUMENT;
+        r.account = memory + a;
+        break;
+
+    // an account ID, a 32 byte key and a 32 byte namespace
+    case HOOK_STATE:
+        if (!a || !b || !c || !d || !e || !f)
+            return INVALID_ARGUMENT;
+        if (!in_bounds(a, b) || !in_bounds(c, d) || !in_bounds(e, f))
+            return OUT_OF_BOUNDS;
+        if (b != ACCOUNT_ID_SIZE || d != KEY_SIZE || f != KEY_SIZE)
+            return INVALID_ARGUMENT;
+        r.account = memory + a;
+        r.key = memory + c;
+        r.ns = memory + e;
+        break;
+
+    // an account ID and a sequence in c, or a 32 byte object ID at c when d is 32
+    case OFFER:
+    case CHECK:
+    case ESCROW:
+    case TICKET:
+        if (!a || !b || e || f)
+            return INVALID_ARGUMENT;
+        if (!in_bounds(a, b))
+            return OUT_OF_BOUNDS;
+        if (b != ACCOUNT_ID_SIZE || (d != 0 && d != KEY_SIZE))
+            return INVALID_ARGUMENT;
+        r.account = memory + a;
+        if (d)
+        {
+            if (!in_bounds(c, KEY_SIZE))
+                return OUT_OF_BOUNDS;
+            r.key = memory + c;
+        }
+        else
+            r.number = c;
+        break;
+
+    // two account IDs
+    case DEPOSIT_PREAUTH:
+        if (!a || !b || !c || !d || e || f)
+            return INVALID_ARGUMENT;
+        if (!in_bounds(a, b) || !in_bounds(c, d))
+            return OUT_OF_BOUNDS;
+        if (b != ACCOUNT_ID_SIZE || d != ACCOUNT_ID_SIZE)
+            return INVALID_ARGUMENT;
+        r.account = memory + a;
+        r.account2 = memory + c;
+        break;
+
+    // two account IDs and a 20 byte currency
+    case LINE:
+        if (!a || !b || !c || !d || !e || !f)
+            return INVALID_ARGUMENT;
+        if (!in_bounds(a, b) || !in_bounds(c, d) || !in_bounds(e, f))
+            return OUT_OF_BOUNDS;
+        if (b != ACCOUNT_ID_SIZE || d != ACCOUNT_ID_SIZE || f != CURRENCY_SIZE)
+            return INVALID_ARGUMENT;
+        r.account = memory + a;
+        r.account2 = memory + c;
+        r.key = memory + e;
+        break;
+
+    // two account IDs and a sequence in e, or a 32 byte object ID at e when f is 32
+    case PAYCHAN:
+        if (!a || !b || !c || !d)
+            return INVALID_ARGUMENT;
+        if (!in_bounds(a, b) || !in_bounds(c, d))
+            return OUT_OF_BOUNDS;
+        if (b != ACCOUNT_ID_SIZE || d != ACCOUNT_ID_SIZE || (f != 0 && f != KEY_SIZE))
+            return INVALID_ARGUMENT;
+        r.account = memory + a;
+        r.account2 = memory + c;
+        if (f)
+        {
+            if (!in_bounds(e, KEY_SIZE))
+                return OUT_OF_BOUNDS;
+            r.key = memory + e;
+        }
+        else
+            r.number = e;
+        break;
+    }
+
+    Keylet k;
+    if (!build(r, k))
+        return NO_SUCH_KEYLET;
+    k.serialize(write);
+    return KEYLET_SIZE;
+}
+
+int64_t util_sha512h(uint8_t *write, uint32_t write_len, const uint8_t *read, uint32_t read_len)
+{
+    if (write_len < sha512::HALF_SIZE)
+        return TOO_SMALL;
+    sha512::half(read, read_len, write);
+    return sha512::HALF_SIZE;
+}
+
+} // namespace keylet
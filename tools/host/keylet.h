@@ -0,0 +1,122 @@
+/**
+ * Ledger object IDs, matching util_keylet and util_sha512h in lib/extern.h.
+ *
+ * A keylet is the 2 byte ledger entry type followed by the 32 byte object ID,
+ * the SHA-512Half of a 2 byte namespace and the keylet's arguments (a few are
+ * taken as is).
+ *
+ * batch builds many keylets and hashes their preimages in parallel lanes
+ * through sha512::half_batch.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools -c tools/host/keylet.cpp tools/host/sha512.cpp
+ */
+
+#ifndef HOST_KEYLET_H
+#define HOST_KEYLET_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace keylet
+{
+
+constexpr size_t KEYLET_SIZE = 34;
+constexpr size_t ACCOUNT_ID_SIZE = 20;
+constexpr size_t CURRENCY_SIZE = 20;
+constexpr size_t KEY_SIZE = 32;
+
+// KEYLET_* from lib/hookapi.h, which does not compile as C++
+enum Type : uint32_t
+{
+    HOOK = 1,
+    HOOK_STATE = 2,
+    ACCOUNT = 3,
+    AMENDMENTS = 4,
+    CHILD = 5,
+    SKIP = 6,
+    FEES = 7,
+    NEGATIVE_UNL = 8,
+    LINE = 9,
+    OFFER = 10,
+    QUALITY = 11,
+    EMITTED_DIR = 12,
+    TICKET = 13,
+    SIGNERS = 14,
+    CHECK = 15,
+    DEPOSIT_PREAUTH = 16,
+    UNCHECKED = 17,
+    OWNER_DIR = 18,
+    PAGE = 19,
+    ESCROW = 20,
+    PAYCHAN = 21,
+    EMITTED = 22,
+};
+
+// ledger entry types
+constexpr uint16_t LT_ANY = 0x0000;
+constexpr uint16_t LT_ACCOUNT_ROOT = 0x0061;
+constexpr uint16_t LT_DIR_NODE = 0x0064;
+constexpr uint16_t LT_RIPPLE_STATE = 0x0072;
+constexpr uint16_t LT_TICKET = 0x0054;
+constexpr uint16_t LT_SIGNER_LIST = 0x0053;
+constexpr uint16_t LT_OFFER = 0x006f;
+constexpr uint16_t LT_LEDGER_HASHES = 0x0068;
+constexpr uint16_t LT_AMENDMENTS = 0x0066;
+constexpr uint16_t LT_FEE_SETTINGS = 0x0073;
+constexpr uint16_t LT_ESCROW = 0x0075;
+constexpr uint16_t LT_PAYCHAN = 0x0078;
+constexpr uint16_t LT_CHECK = 0x0043;
+constexpr uint16_t LT_DEPOSIT_PREAUTH = 0x0070;
+constexpr uint16_t LT_NEGATIVE_UNL = 0x004e;
+constexpr uint16_t LT_HOOK = 0x0048;
+constexpr uint16_t LT_HOOK_STATE = 0x0076;
+constexpr uint16_t LT_EMITTED_TXN = 0x0045;
+constexpr uint16_t LT_CHILD = 0x1cd2;
+
+struct Keylet
+{
+    uint16_t type;
+    uint8_t key[KEY_SIZE];
+
+    // the 34 byte form util_keylet writes
+    void serialize(uint8_t out[KEYLET_SIZE]) const;
+};
+
+// SKIP number for the list of the last 256 ledgers, any other number selects
+// the long skip list holding that ledger
+constexpr uint64_t NO_LEDGER = ~0ULL;
+
+// the arguments of one keylet, unused fields are ignored
+struct Request
+{
+    uint32_t type;                     // Type
+    const uint8_t *account = nullptr;  // 20 bytes, the owner or source
+    const uint8_t *account2 = nullptr; // 20 bytes: LINE, DEPOSIT_PREAUTH, PAYCHAN
+    // 32 bytes: CHILD, EMITTED, UNCHECKED, PAGE and QUALITY (the directory),
+    // HOOK_STATE (the state key); 20 bytes: LINE (the currency); OFFER, CHECK,
+    // ESCROW, TICKET and PAYCHAN take it as the object ID instead of a sequence
+    const uint8_t *key = nullptr;
+    const uint8_t *ns = nullptr;       // 32 bytes, HOOK_STATE namespace
+    uint64_t number = 0;               // sequence, page index, quality or SKIP ledger
+};
+
+// false for unknown types or missing arguments
+bool build(const Request &request, Keylet &out);
+// valid[i] is 1 when requests[i] was built, returns the number built
+size_t batch(const Request *requests, Keylet *out, uint8_t *valid, size_t n);
+
+Keylet account(const uint8_t id[ACCOUNT_ID_SIZE]);
+Keylet line(const uint8_t a[ACCOUNT_ID_SIZE], const uint8_t b[ACCOUNT_ID_SIZE], const uint8_t currency[CURRENCY_SIZE]);
+Keylet owner_dir(const uint8_t id[ACCOUNT_ID_SIZE]);
+Keylet hook(const uint8_t id[ACCOUNT_ID_SIZE]);
+Keylet hook_state(const uint8_t id[ACCOUNT_ID_SIZE], const uint8_t key[KEY_SIZE], const uint8_t ns[KEY_SIZE]);
+
+// hook API semantics: pointer arguments are offsets into `memory`, the result is
+// written to `write`; returns 34 or an error code from lib/error.h
+int64_t util_keylet(uint8_t *write, uint32_t write_len, uint32_t keylet_type, const uint8_t *memory,
+                    uint32_t memory_len, uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t e, uint32_t f);
+int64_t util_sha512h(uint8_t *write, uint32_t write_len, const uint8_t *read, uint32_t read_len);
+
+} // namespace keylet
+
+#endif
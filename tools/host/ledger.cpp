@@ -0,0 +1,385 @@
+#include "ledger.h"
+
+#include "keylet.h"
+#include "sfcodes.h"
+#include "sha512.h"
+
+#include <cinttypes>
+#include <cstring>
+
+namespace ledger
+{
+
+namespace
+{
+
+uint64_t read_be(const uint8_t *p, size_t n)
+{
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; ++i)
+        v = v << 8 | p[i];
+    return v;
+}
+
+// a fixed size field of the root (or of `node`), nullptr when absent or of another size
+const uint8_t *field(const sto::Index &index, uint32_t code, size_t size, uint32_t node = sto::Index::ROOT)
+{
+    uint32_t n = index.find(node, code);
+    if (n == sto::Index::NOT_FOUND || index.field(n).payload_size != size)
+        return nullptr;
+    return index.payload(n);
+}
+
+uint32_t field_u32(const sto::Index &index, uint32_t code)
+{
+    const uint8_t *p = field(index, code, 4);
+    return p ? (uint32_t)read_be(p, 4) : 0;
+}
+
+// an account root as metadata shows it after the transaction
+void account_node(sto::Writer &w, const uint8_t *id, const Account &a)
+{
+    w.begin(sfModifiedNode);
+    w.uint(sfLedgerEntryType, keylet::LT_ACCOUNT_ROOT, 2);
+    w.bytes(sfLedgerIndex, keylet::account(id).key, HASH_SIZE);
+    w.begin(sfFinalFields);
+    w.uint(sfFlags, 0, 4);
+    w.uint(sfSequence, a.sequence, 4);
+    w.uint(sfOwnerCount, a.owner_count, 4);
+    if (a.minted)
+        w.uint(sfMintedNFTokens, a.minted, 4);
+    w.drops(sfBalance, (uint64_t)a.balance);
+    w.vl(sfAccount, id, ACCOUNT_ID_SIZE);
+    w.end_object();
+    w.end_object();
+}
+
+} // namespace
+
+Simulator::Simulator(const Options &options)
+    : options_(options), rng_(options.seed), seq_(options.first_ledger - 1), close_time_(options.close_time)
+{
+}
+
+Account &Simulator::account(const uint8_t id[ACCOUNT_ID_SIZE])
+{
+    AccountID key;
+    std::memcpy(key.data(), id, ACCOUNT_ID_SIZE);
+    auto it = accounts_.find(key);
+    if (it == accounts_.end())
+    {
+        it = accounts_.emplace(key, Account()).first;
+        it->second.balance = options_.initial_balance;
+    }
+    return it->second;
+}
+
+hostapi::Context *Simulator::add_hook(const uint8_t account[ACCOUNT_ID_SIZE], const std::vector<uint8_t> &wasm,
+                                      std::string &error)
+{
+    auto hook = std::make_unique<Hook>();
+    hostapi::bind(hook->imports, hook->ctx);
+    try
+    {
+        hook->module = wasm::Module::parse(wasm);
+        hook->instance = std::make_unique<wasm::Instance>(hook->module, hook->imports);
+    }
+    catch (const std::exception &e)
+    {
+        error = e.what();
+        return nullptr;
+    }
+    hostapi::Context &ctx = hook->ctx;
+    std::memcpy(ctx.hook_account, account, ACCOUNT_ID_SIZE);
+    sha512::half(wasm.data(), wasm.size(), ctx.hook_hash);
+    ctx.ledger = entries_;
+    ctx.fee_base = 10;
+    ctx.trace = options_.trace;
+    this->account(account);
+
+    AccountID key;
+    std::memcpy(key.data(), account, ACCOUNT_ID_SIZE);
+    hooks_[key] = std::move(hook);
+    return &hooks_[key]->ctx;
+}
+
+void Simulator::add_remote(const uint8_t account[ACCOUNT_ID_SIZE])
+{
+    AccountID key;
+    std::memcpy(key.data(), account, ACCOUNT_ID_SIZE);
+    remote_.insert(key);
+}
+
+void Simulator::set_entry(const hostapi::Keylet &keylet, const std::vector<uint8_t> &blob)
+{
+    entries_[keylet] = blob;
+    for (auto &h : hooks_)
+        h.second->ctx.ledger[keylet] = blob;
+}
+
+void Simulator::submit(std::vector<uint8_t> blob, uint32_t seq)
+{
+    Txn txn;
+    txn.blob = std::move(blob);
+    submitted_.emplace(seq > seq_ ? seq : seq_ + 1, std::move(txn));
+}
+
+Simulator::Hook *Simulator::hook_of(const uint8_t *account)
+{
+    if (!account)
+        return nullptr;
+    AccountID key;
+    std::memcpy(key.data(), account, ACCOUNT_ID_SIZE);
+    auto it = hooks_.find(key);
+    return it == hooks_.end() ? nullptr : it->second.get();
+}
+
+void Simulator::prepare(Hook &hook, const std::vector<uint8_t> &otxn, const uint8_t id[HASH_SIZE])
+{
+    hostapi::Context &ctx = hook.ctx;
+    ctx.set_otxn(otxn, id);
+    ctx.meta.clear();
+    ctx.ledger_seq = seq_;
+    ctx.ledger_last_time = close_time_;
+    std::memcpy(ctx.ledger_last_hash, last_hash_, HASH_SIZE);
+}
+
+void Simulator::queue_emitted(Hook &hook, uint64_t chain)
+{
+    for (std::vector<uint8_t> &blob : hook.ctx.emitted)
+    {
+        Txn txn;
+        txn.chain = chain;
+        txn.emitted = true;
+        sto::Index index;
+        if (index.parse(blob.data(), blob.size()))
+        {
+            txn.first = field_u32(index, sfFirstLedgerSequence);
+            txn.last = field_u32(index, sfLastLedgerSequence);
+        }
+        txn.blob = std::move(blob);
+        queue_.push_back(std::move(txn));
+        ++chains_[chain].pending;
+        ++stats_.emitted;
+    }
+    hook.ctx.emitted.clear();
+}
+
+void Simulator::settle(uint64_t chain)
+{
+    auto it = chains_.find(chain);
+    if (it == chains_.end())
+        return;
+    it->second.last = seq_;
+    if (--it->second.pending == 0)
+    {
+        stats_.completion.push_back(it->second.last - it->second.start + 1);
+        if (options_.completed)
+            options_.completed(chain, stats_.completion.back());
+        chains_.erase(it);
+    }
+}
+
+size_t Simulator::apply(const Txn &txn, uint32_t index)
+{
+    ++stats_.transactions;
+    sto::Index tx;
+    const uint8_t *source = nullptr, *destination = nullptr, *amount = nullptr, *fee = nullptr,
+                  *callback = nullptr;
+    uint16_t type = 0;
+    if (tx.parse(txn.blob.data(), txn.blob.size()))
+    {
+        const uint8_t *t = field(tx, sfTransactionType, 2);
+        type = t ? (uint16_t)read_be(t, 2) : 0;
+        source = field(tx, sfAccount, ACCOUNT_ID_SIZE);
+        destination = field(tx, sfDestination, ACCOUNT_ID_SIZE);
+        amount = field(tx, sfAmount, 8);
+        if (!amount)
+            amount = field(tx, sfAmount, 48);
+        fee = field(tx, sfFee, 8);
+        uint32_t details = tx.find(sto::Index::ROOT, sfEmitDetails);
+        if (details != sto::Index::NOT_FOUND)
+            callback = field(tx, sfEmitCallback, ACCOUNT_ID_SIZE, details);
+    }
+    if (!source)
+    {
+        // not a transaction the ledger would take
+        ++stats_.failed;
+        if (options_.log)
+            fprintf(options_.log, "%u #%u malformed transaction\n", seq_, index);
+        return 0;
+    }
+
+    // the hooks of both sides, stopping at the first that does not accept
+    Hook *hooks[2] = {hook_of(source), destination && std::memcmp(source, destination, ACCOUNT_ID_SIZE)
+                                           ? hook_of(destination)
+                                           : nullptr};
+    Hook *ran[2];
+    size_t ran_count = 0;
+    uint8_t id[HASH_SIZE];
+    hostapi::transaction_id(txn.blob.data(), txn.blob.size(), id);
+    bool accepted = true;
+    int64_t code = 0;
+    uint64_t instructions = 0;
+    for (Hook *h : hooks)
+    {
+        if (!h || !accepted)
+            continue;
+        prepare(*h, txn.blob, id);
+        hostapi::Outcome out = hostapi::run(*h->instance, h->ctx, false, options_.fuel);
+        ++stats_.hook_runs;
+        stats_.instructions += out.instructions;
+        instructions += out.instructions;
+        stats_.errors += out.exit == hostapi::Exit::ERROR;
+        accepted = out.exit == hostapi::Exit::ACCEPT;
+        code = accepted ? 0 : out.code;
+        ran[ran_count++] = h;
+    }
+
+    Account &from = account(source);
+    int64_t charged = fee ? (int64_t)(read_be(fee, 8) & 0x3FFFFFFFFFFFFFFFULL) : 0;
+    charged = charged < from.balance ? charged : from.balance;
+    uint8_t result = tesSUCCESS;
+    if (!accepted)
+        result = tecHOOK_REJECTED;
+    else if (txn.emitted && options_.fail_rate > 0 &&
+             std::uniform_real_distribution<double>(0, 1)(rng_) < options_.fail_rate)
+        result = tecPATH_DRY;
+    else if (type == ttPAYMENT && destination && amount && !(amount[0] & 0x80))
+    {
+        int64_t drops = (int64_t)(read_be(amount, 8) & 0x3FFFFFFFFFFFFFFFULL);
+        if (drops > from.balance - charged)
+            result = tecUNFUNDED_PAYMENT;
+        else
+        {
+            from.balance -= drops;
+            account(destination).balance += drops;
+        }
+    }
+    else if (type == ttNFTOKEN_MINT)
+    {
+        ++from.minted;
+        ++from.owner_count;
+    }
+    from.balance -= charged;
+    ++from.sequence;
+
+    for (size_t i = 0; i < ran_count; ++i)
+    {
+        hostapi::finish(ran[i]->ctx, result == tesSUCCESS);
+        queue_emitted(*ran[i], txn.chain);
+    }
+    if (result == tesSUCCESS && destination && !remote_.empty())
+    {
+        AccountID key;
+        std::memcpy(key.data(), destination, ACCOUNT_ID_SIZE);
+        if (remote_.count(key))
+            outbox_.push_back(txn.blob);
+    }
+    if (result == tecHOOK_REJECTED)
+        ++stats_.rejected;
+    else if (result != tesSUCCESS)
+        ++stats_.failed;
+
+    if (options_.log)
+        fprintf(options_.log, "%u #%u %s type %u result %u hooks %zu\n", seq_, index,
+                txn.emitted ? "emitted" : "originating", type, result, ran_count);
+
+    Applied applied{seq_, index, txn.chain, txn.emitted, type, result, &txn.blob, code, hostapi::Exit::NONE,
+                    instructions, 0};
+    Hook *cb = txn.emitted ? hook_of(callback) : nullptr;
+    if (!cb)
+    {
+        if (options_.observe)
+            options_.observe(applied);
+        return 0;
+    }
+
+    sto::Writer meta;
+    meta.uint(sfTransactionIndex, index, 4);
+    meta.begin(sfAffectedNodes);
+    account_node(meta, source, from);
+    if (result == tesSUCCESS && type == ttPAYMENT && destination && std::memcmp(source, destination, ACCOUNT_ID_SIZE))
+        account_node(meta, destination, account(destination));
+    meta.end_array();
+    meta.uint(sfTransactionResult, result, 1);
+
+    prepare(*cb, txn.blob, id);
+    cb->ctx.meta = std::move(meta.out);
+    hostapi::Outcome out = hostapi::execute(*cb->instance, cb->ctx, true, options_.fuel);
+    ++stats_.hook_runs;
+    ++stats_.callbacks;
+    stats_.instructions += out.instructions;
+    stats_.errors += out.exit == hostapi::Exit::ERROR;
+    queue_emitted(*cb, txn.chain);
+    if (options_.log)
+        fprintf(options_.log, "%u #%u cbak %s (code %" PRId64 ")\n", seq_, index, hostapi::exit_name(out.exit),
+                out.code);
+    applied.cbak = out.exit;
+    applied.cbak_instructions = out.instructions;
+    if (options_.observe)
+        options_.observe(applied);
+    return 1;
+}
+
+uint32_t Simulator::close()
+{
+    ++seq_;
+    Close rec{seq_, 0, 0, 0, 0, 0};
+
+    // emitted transactions: expired ones dropped, due ones in order up to capacity
+    std::vector<Txn> due;
+    std::deque<Txn> later;
+    for (Txn &txn : queue_)
+    {
+        if (txn.last && txn.last < seq_)
+        {
+            ++rec.expired;
+            ++stats_.expired;
+            if (options_.log)
+                fprintf(options_.log, "%u emitted transaction expired at %u\n", seq_, txn.last);
+            settle(txn.chain);
+        }
+        else if (txn.first <= seq_ && due.size() < options_.capacity)
+            due.push_back(std::move(txn));
+        else
+            later.push_back(std::move(txn));
+    }
+    queue_.swap(later);
+
+    uint32_t index = 0;
+    for (const Txn &txn : due)
+    {
+        rec.callbacks += apply(txn, index++);
+        settle(txn.chain);
+    }
+    rec.emitted = due.size();
+
+    auto end = submitted_.upper_bound(seq_);
+    for (auto it = submitted_.begin(); it != end; ++it)
+    {
+        Txn &txn = it->second;
+        txn.chain = next_chain_++;
+        chains_[txn.chain] = Chain{seq_, seq_, 1};
+        rec.callbacks += apply(txn, index++);
+        settle(txn.chain);
+        ++rec.originating;
+    }
+    submitted_.erase(submitted_.begin(), end);
+
+    rec.backlog = queue_.size();
+    if (rec.backlog > stats_.max_backlog)
+        stats_.max_backlog = rec.backlog;
+    stats_.closes.push_back(rec);
+
+    // the next ledger sees this one as the last closed
+    close_time_ += options_.close_interval;
+    uint8_t buf[HASH_SIZE + 4];
+    std::memcpy(buf, last_hash_, HASH_SIZE);
+    for (int i = 0; i < 4; ++i)
+        buf[HASH_SIZE + i] = (uint8_t)(seq_ >> (24 - 8 * i));
+    sha512::half(buf, sizeof(buf), last_hash_);
+    return seq_;
+}
+
+} // namespace ledger
@@ -0,0 +1,215 @@
+/**
+ * Discrete-event ledger simulation for chains of hooks.
+ *
+ * A Simulator holds accounts, the hooks installed on some of them (compiled
+ * modules run in wasm::Instance through hostapi) and a queue of emitted
+ * transactions. close() builds one ledger: emitted transactions that are due
+ * (FirstLedgerSequence reached) go first, up to a per-ledger capacity, then
+ * the originating transactions submitted for that ledger. Emitted transactions
+ * past their LastLedgerSequence are dropped. Each applied transaction runs the
+ * hooks of its source and destination; the effects of all of them are kept
+ * only when they all accept and the transaction succeeds. Its metadata
+ * (sfTransactionIndex, sfAffectedNodes with the account roots it changed,
+ * sfMintedNFTokens after a mint, sfTransactionResult) is synthesized and,
+ * for an emitted transaction with sfEmitCallback, passed to that hook's cbak.
+ * What the hooks emit is queued for the following ledgers.
+ *
+ * Every originating transaction starts a chain that its emitted transactions
+ * and callbacks belong to; a chain completes when nothing of it is queued, and
+ * Stats records how many ledgers that took and how large the emitted backlog
+ * grew. Options::observe and Options::completed follow single transactions
+ * and chains.
+ *
+ * The ledger model is only what the hooks observe: XRP payments move
+ * balances and fail unfunded, IOU payments and other transaction types
+ * succeed without effect, and NFTokenMint counts minted tokens per issuer.
+ * Entries for slot_set are supplied with set_entry(). Accounts whose hooks
+ * run in another simulator are registered with add_remote(), see replay.h.
+ *
+ * Build: g++ -std=c++17 -O2 -Ilib -Itools -c tools/host/ledger.cpp
+ */
+
+#ifndef HOST_LEDGER_H
+#define HOST_LEDGER_H
+
+#include "host/hostapi.h"
+#include "wasm/interp.h"
+#include "wasm/module.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ledger
+{
+
+constexpr size_t ACCOUNT_ID_SIZE = 20;
+constexpr size_t HASH_SIZE = 32;
+
+// transaction results as sfTransactionResult holds them
+constexpr uint8_t tesSUCCESS = 0;
+constexpr uint8_t tecUNFUNDED_PAYMENT = 104;
+constexpr uint8_t tecPATH_DRY = 128;
+constexpr uint8_t tecHOOK_REJECTED = 153;
+
+constexpr uint16_t ttPAYMENT = 0;
+constexpr uint16_t ttNFTOKEN_MINT = 25;
+
+using AccountID = std::array<uint8_t, ACCOUNT_ID_SIZE>;
+
+// one applied transaction, as Options::observe sees it
+struct Applied
+{
+    uint32_t seq;
+    uint32_t index;
+    uint64_t chain; // of the originating transaction
+    bool emitted;
+    uint16_t type;
+    uint8_t result;
+    const std::vector<uint8_t> *blob;
+    int64_t code;               // of the hook that did not accept, 0 when all did
+    hostapi::Exit cbak;         // of the callback, NONE when none ran
+    uint64_t instructions;      // of the hooks that ran on it
+    uint64_t cbak_instructions; // of the callback
+};
+
+struct Options
+{
+    uint32_t first_ledger = 2;
+    uint32_t close_time = 0;                // of the ledger before the first, ripple epoch
+    uint32_t close_interval = 4;            // seconds
+    size_t capacity = SIZE_MAX;             // emitted transactions applied per ledger
+    double fail_rate = 0;                   // emitted transactions failing tecPATH_DRY
+    int64_t initial_balance = 100000000000; // drops, for accounts seen first
+    uint64_t fuel = UINT64_MAX;             // instructions per hook execution
+    uint64_t seed = 1;
+    FILE *log = nullptr;                    // one line per applied transaction
+    FILE *trace = nullptr;                  // the hooks' trace calls
+    // called on the simulator's thread for every applied transaction, and
+    // with the ledgers a chain took when it completes
+    std::function<void(const Applied &)> observe;
+    std::function<void(uint64_t chain, uint32_t ledgers)> completed;
+};
+
+struct Account
+{
+    int64_t balance = 0;
+    uint32_t sequence = 1;
+    uint32_t owner_count = 0;
+    uint32_t minted = 0;
+};
+
+// one closed ledger
+struct Close
+{
+    uint32_t seq;
+    size_t originating;
+    size_t emitted;   // emitted transactions applied
+    size_t callbacks;
+    size_t expired;
+    size_t backlog;   // emitted transactions queued after the close
+};
+
+struct Stats
+{
+    uint64_t transactions = 0; // applied, originating and emitted
+    uint64_t emitted = 0;      // queued by hooks
+    uint64_t rejected = 0;     // tecHOOK_REJECTED
+    uint64_t failed = 0;       // other tec results
+    uint64_t expired = 0;
+    uint64_t hook_runs = 0;    // hook and cbak executions
+    uint64_t callbacks = 0;
+    uint64_t errors = 0;       // traps and fuel exhaustion
+    uint64_t instructions = 0;
+    size_t max_backlog = 0;
+    std::vector<uint32_t> completion; // ledgers per completed chain
+    std::vector<Close> closes;
+};
+
+class Simulator
+{
+public:
+    explicit Simulator(const Options &options);
+
+    // installs a compiled hook on an account; its Context takes parameters and
+    // initial state. nullptr with error set when the module does not load
+    hostapi::Context *add_hook(const uint8_t account[ACCOUNT_ID_SIZE], const std::vector<uint8_t> &wasm,
+                               std::string &error);
+    // a ledger entry every hook can slot_set
+    void set_entry(const hostapi::Keylet &keylet, const std::vector<uint8_t> &blob);
+    Account &account(const uint8_t id[ACCOUNT_ID_SIZE]);
+    // an account whose hook runs in another simulator: transactions to it that
+    // succeed here are collected in outbox() for that simulator to apply
+    void add_remote(const uint8_t account[ACCOUNT_ID_SIZE]);
+    std::vector<std::vector<uint8_t>> &outbox() { return outbox_; }
+
+    // an originating transaction for the ledger seq (the next one when earlier)
+    void submit(std::vector<uint8_t> blob, uint32_t seq);
+    // closes the next ledger and returns its sequence
+    uint32_t close();
+    // nothing submitted, queued or incomplete
+    bool idle() const { return submitted_.empty() && queue_.empty() && chains_.empty(); }
+
+    uint32_t ledger_seq() const { return seq_; }
+    const Stats &stats() const { return stats_; }
+
+private:
+    struct Hook
+    {
+        wasm::Module module;
+        wasm::Imports imports;
+        hostapi::Context ctx;
+        std::unique_ptr<wasm::Instance> instance;
+    };
+
+    struct Txn
+    {
+        std::vector<uint8_t> blob;
+        uint64_t chain = 0;
+        uint32_t first = 0; // FirstLedgerSequence, 0 when absent
+        uint32_t last = 0;  // LastLedgerSequence, 0 when absent
+        bool emitted = false;
+    };
+
+    struct Chain
+    {
+        uint32_t start;
+        uint32_t last;
+        size_t pending;
+    };
+
+    Hook *hook_of(const uint8_t *account);
+    void prepare(Hook &hook, const std::vector<uint8_t> &otxn, const uint8_t id[HASH_SIZE]);
+    // applies one transaction, returns the number of callbacks run
+    size_t apply(const Txn &txn, uint32_t index);
+    void queue_emitted(Hook &hook, uint64_t chain);
+    void settle(uint64_t chain);
+
+    Options options_;
+    std::mt19937_64 rng_;
+    uint32_t seq_;
+    uint32_t close_time_;
+    uint8_t last_hash_[HASH_SIZE] = {};
+    std::map<AccountID, Account> accounts_;
+    std::map<AccountID, std::unique_ptr<Hook>> hooks_;
+    std::map<hostapi::Keylet, std::vector<uint8_t>> entries_;
+    std::set<AccountID> remote_;
+    std::vector<std::vector<uint8_t>> outbox_;
+    std::multimap<uint32_t, Txn> submitted_;
+    std::deque<Txn> queue_;
+    std::map<uint64_t, Chain> chains_;
+    uint64_t next_chain_ = 0;
+    Stats stats_;
+};
+
+} // namespace ledger
+
+#endif
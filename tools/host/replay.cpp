@@ -0,0 +1,287 @@
+#include "replay.h"
+
+#include "sfcodes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace replay
+{
+
+namespace
+{
+
+// sfAccount or sfDestination of a serialized transaction, nullptr when absent
+const uint8_t *account_field(const sto::Index &tx, uint32_t code)
+{
+    uint32_t n = tx.find(sto::Index::ROOT, code);
+    if (n == sto::Index::NOT_FOUND || tx.field(n).payload_size != ledger::ACCOUNT_ID_SIZE)
+        return nullptr;
+    return tx.payload(n);
+}
+
+} // namespace
+
+Inbox::~Inbox()
+{
+    std::vector<std::vector<uint8_t>> rest;
+    drain(rest);
+}
+
+void Inbox::push(std::vector<uint8_t> blob, uint32_t from)
+{
+    Node *node = new Node{std::move(blob), from, head_.load(std::memory_order_relaxed)};
+    while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+void Inbox::drain(std::vector<std::vector<uint8_t>> &out)
+{
+    // the list is newest first
+    std::vector<Node *> nodes;
+    for (Node *n = head_.exchange(nullptr, std::memory_order_acquire); n; n = n->next)
+        nodes.push_back(n);
+    std::reverse(nodes.begin(), nodes.end());
+    std::stable_sort(nodes.begin(), nodes.end(), [](const Node *a, const Node *b) { return a->from < b->from; });
+    for (Node *n : nodes)
+    {
+        out.push_back(std::move(n->blob));
+        delete n;
+    }
+}
+
+Pool::Pool(unsigned threads)
+{
+    if (threads == 0)
+        threads = 1;
+    for (unsigned i = 0; i < threads; ++i)
+        queues_.push_back(std::make_unique<Queue>());
+    for (unsigned i = 0; i < threads; ++i)
+        workers_.emplace_back([this, i] { work(i); });
+}
+
+Pool::~Pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &t : workers_)
+        t.join();
+}
+
+void Pool::run(std::vector<std::function<void()>> &tasks)
+{
+    if (tasks.empty())
+        return;
+    {
+        // before any task is visible: workers still draining may pick them up early
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = tasks.size();
+    }
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+        Queue &q = *queues_[i % queues_.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        // popped from the back by the owner: first tasks last in
+        q.tasks.push_front(&tasks[i]);
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++round_;
+    wake_.notify_all();
+    done_.wait(lock, [this] { return pending_ == 0; });
+}
+
+std::function<void()> *Pool::next(size_t self)
+{
+    {
+        Queue &own = *queues_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            std::function<void()> *task = own.tasks.back();
+            own.tasks.pop_back();
+            return task;
+        }
+    }
+    for (size_t i = 1; i < queues_.size(); ++i)
+    {
+        Queue &victim = *queues_[(self + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            std::function<void()> *task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void Pool::work(size_t self)
+{
+    uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || round_ != seen; });
+            if (stop_)
+                return;
+            seen = round_;
+        }
+        while (std::function<void()> *task = next(self))
+        {
+            (*task)();
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0)
+                done_.notify_one();
+        }
+    }
+}
+
+Engine::Engine(const ledger::Options &options, unsigned threads)
+    : options_(options), pool_(threads), seq_(options.first_ledger - 1)
+{
+}
+
+hostapi::Context *Engine::add_hook(const uint8_t account[ledger::ACCOUNT_ID_SIZE], const std::vector<uint8_t> &wasm,
+                                   std::string &error)
+{
+    if (shard_of(account))
+    {
+        error = "account already has a hook";
+        return nullptr;
+    }
+    auto shard = std::make_unique<Shard>();
+    std::memcpy(shard->account.data(), account, ledger::ACCOUNT_ID_SIZE);
+    shard->index = (uint32_t)shards_.size();
+    ledger::Options options = options_;
+    options.seed += shards_.size();
+    shard->sim = std::make_unique<ledger::Simulator>(options);
+    hostapi::Context *ctx = shard->sim->add_hook(account, wasm, error);
+    if (!ctx)
+        return nullptr;
+    for (auto &other : shards_)
+    {
+        other->sim->add_remote(account);
+        shard->sim->add_remote(other->account.data());
+    }
+    shards_.push_back(std::move(shard));
+    return ctx;
+}
+
+void Engine::set_entry(const hostapi::Keylet &keylet, const std::vector<uint8_t> &blob)
+{
+    for (auto &shard : shards_)
+        shard->sim->set_entry(keylet, blob);
+}
+
+Shard *Engine::shard_of(const uint8_t *account)
+{
+    if (!account)
+        return nullptr;
+    for (auto &shard : shards_)
+        if (std::memcmp(shard->account.data(), account, ledger::ACCOUNT_ID_SIZE) == 0)
+            return shard.get();
+    return nullptr;
+}
+
+bool Engine::submit(std::vector<uint8_t> blob, uint32_t seq)
+{
+    sto::Index tx;
+    if (!tx.parse(blob.data(), blob.size()))
+        return false;
+    Shard *shard = shard_of(account_field(tx, sfAccount));
+    if (!shard)
+        shard = shard_of(account_field(tx, sfDestination));
+    if (!shard)
+        return false;
+    shard->sim->submit(std::move(blob), seq);
+    return true;
+}
+
+uint32_t Engine::close()
+{
+    ++seq_;
+    uint32_t seq = seq_;
+    // the slowest shards of the last ledger start first
+    std::vector<Shard *> order;
+    for (auto &shard : shards_)
+        order.push_back(shard.get());
+    std::stable_sort(order.begin(), order.end(), [](const Shard *a, const Shard *b) { return a->last > b->last; });
+
+    tasks_.clear();
+    for (Shard *shard : order)
+    {
+        tasks_.push_back([this, shard, seq] {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::vector<uint8_t>> received;
+            shard->inbox[(seq - 1) & 1].drain(received);
+            shard->received += received.size();
+            for (std::vector<uint8_t> &blob : received)
+                shard->sim->submit(std::move(blob), seq);
+            shard->sim->close();
+
+            for (std::vector<uint8_t> &blob : shard->sim->outbox())
+            {
+                sto::Index tx;
+                Shard *to = tx.parse(blob.data(), blob.size()) ? shard_of(account_field(tx, sfDestination)) : nullptr;
+                if (to)
+                    to->inbox[seq & 1].push(std::move(blob), shard->index);
+            }
+            shard->sim->outbox().clear();
+            shard->last = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            shard->busy += shard->last;
+        });
+    }
+    pool_.run(tasks_);
+    return seq;
+}
+
+bool Engine::idle() const
+{
+    for (const auto &shard : shards_)
+        if (!shard->sim->idle() || !shard->inbox[0].empty() || !shard->inbox[1].empty())
+            return false;
+    return true;
+}
+
+ledger::Stats Engine::stats() const
+{
+    ledger::Stats all;
+    for (const auto &shard : shards_)
+    {
+        const ledger::Stats &s = shard->sim->stats();
+        all.transactions += s.transactions;
+        all.emitted += s.emitted;
+        all.rejected += s.rejected;
+        all.failed += s.failed;
+        all.expired += s.expired;
+        all.hook_runs += s.hook_runs;
+        all.callbacks += s.callbacks;
+        all.errors += s.errors;
+        all.instructions += s.instructions;
+        all.completion.insert(all.completion.end(), s.completion.begin(), s.completion.end());
+        // every shard closes every ledger
+        if (all.closes.empty())
+            all.closes = s.closes;
+        else
+            for (size_t i = 0; i < s.closes.size() && i < all.closes.size(); ++i)
+            {
+                all.closes[i].originating += s.closes[i].originating;
+                all.closes[i].emitted += s.closes[i].emitted;
+                all.closes[i].callbacks += s.closes[i].callbacks;
+                all.closes[i].expired += s.closes[i].expired;
+                all.closes[i].backlog += s.closes[i].backlog;
+            }
+    }
+    for (const ledger::Close &c : all.closes)
+        all.max_backlog = std::max(all.max_backlog, c.backlog);
+    return all;
+}
+
+} // namespace replay
@@ -0,0 +1,142 @@
+/**
+ * Parallel replay of hook traffic, sharded by hook account.
+ *
+ * Hook state is per account, so an Engine gives every hook account a shard
+ * of its own: a ledger::Simulator holding that hook's instance, state store
+ * and slot table. A transaction is routed to the shard of its source when
+ * that is a hook account, otherwise to the shard of its destination. close()
+ * closes the same ledger on every shard as tasks on a work-stealing Pool and
+ * returns once all are done.
+ *
+ * A transaction that succeeds in one shard and pays another shard's hook
+ * account is pushed onto the destination's Inbox, a lock-free multi-producer
+ * queue that the destination drains before its next close; the receiving
+ * hook runs on it in the following ledger, as its own transaction. So unlike
+ * ledger::Simulator a rejection on the receiving side does not undo the
+ * sending side, and account balances are tracked per shard.
+ *
+ * Shards of one ledger run in parallel, so the speedup is bounded by the
+ * number of busy shards and by the slowest one in each ledger.
+ *
+ * Build: g++ -std=c++17 -O2 -pthread -Ilib -Itools -c tools/host/replay.cpp
+ */
+
+#ifndef HOST_REPLAY_H
+#define HOST_REPLAY_H
+
+#include "host/ledger.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace replay
+{
+
+// many producers, one consumer: push() is a CAS on the head, drain() takes the
+// whole list at once, so nodes are never popped one by one and ABA cannot occur
+class Inbox
+{
+public:
+    ~Inbox();
+    void push(std::vector<uint8_t> blob, uint32_t from);
+    // everything pushed so far, ordered by producer and then by push order, so
+    // the result does not depend on how the producers' threads interleaved
+    void drain(std::vector<std::vector<uint8_t>> &out);
+    bool empty() const { return head_.load(std::memory_order_acquire) == nullptr; }
+
+private:
+    struct Node
+    {
+        std::vector<uint8_t> blob;
+        uint32_t from;
+        Node *next;
+    };
+    std::atomic<Node *> head_{nullptr};
+};
+
+// a fixed set of workers, each with its own task queue; an idle worker takes
+// from the back of its own queue and steals from the front of the others
+class Pool
+{
+public:
+    explicit Pool(unsigned threads);
+    ~Pool();
+
+    unsigned size() const { return (unsigned)workers_.size(); }
+    // runs every task, the first ones first, and returns when all are done
+    void run(std::vector<std::function<void()>> &tasks);
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()> *> tasks;
+    };
+
+    void work(size_t self);
+    std::function<void()> *next(size_t self);
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::mutex mutex_;
+    std::condition_variable wake_, done_;
+    uint64_t round_ = 0;
+    size_t pending_ = 0;
+    bool stop_ = false;
+};
+
+struct Shard
+{
+    ledger::AccountID account;
+    uint32_t index;
+    std::unique_ptr<ledger::Simulator> sim;
+    // filled during one ledger and drained in the next, by ledger parity
+    Inbox inbox[2];
+    uint64_t received = 0; // transactions from other shards
+    double busy = 0;       // seconds spent closing ledgers
+    double last = 0;       // of them, in the last ledger
+};
+
+class Engine
+{
+public:
+    Engine(const ledger::Options &options, unsigned threads);
+
+    // a shard for the hook account, see ledger::Simulator::add_hook
+    hostapi::Context *add_hook(const uint8_t account[ledger::ACCOUNT_ID_SIZE], const std::vector<uint8_t> &wasm,
+                               std::string &error);
+    void set_entry(const hostapi::Keylet &keylet, const std::vector<uint8_t> &blob);
+    // false when neither side of the transaction has a shard
+    bool submit(std::vector<uint8_t> blob, uint32_t seq);
+
+    // closes the next ledger on every shard and returns its sequence
+    uint32_t close();
+    bool idle() const;
+
+    uint32_t ledger_seq() const { return seq_; }
+    size_t shard_count() const { return shards_.size(); }
+    const Shard &shard(size_t i) const { return *shards_[i]; }
+    // the shards' statistics combined, closes summed per ledger
+    ledger::Stats stats() const;
+
+private:
+    Shard *shard_of(const uint8_t *account);
+
+    ledger::Options options_;
+    Pool pool_;
+    uint32_t seq_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::function<void()>> tasks_;
+};
+
+} // namespace replay
+
+#endif
@@ -0,0 +1,324 @@
+#include "sha256.h"
+
+#include <cstring>
+
+#if defined(__SHA__) && defined(__SSE4_1__)
+#define SHA256_NI 1
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define SHA256_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace sha256
+{
+
+namespace
+{
+
+constexpr uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+constexpr uint32_t IV[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+inline uint32_t load_be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+inline void store_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+#if SHA256_NI
+void compress(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_loadu_si128((const __m128i *)&state[0]);
+    __m128i state1 = _mm_loadu_si128((const __m128i *)&state[4]);
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);                // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);          // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);  // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);       // CDGH
+
+    for (; blocks; --blocks, data += BLOCK_SIZE)
+    {
+        __m128i abef = state0, cdgh = state1;
+        __m128i w[4];
+        for (int i = 0; i < 16; ++i)
+        {
+            if (i < 4)
+                w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * i)), MASK);
+            else
+                w[i & 3] = _mm_sha256msg2_epu32(
+                    _mm_add_epi32(_mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]),
+                                  _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4)),
+                    w[(i + 3) & 3]);
+            __m128i msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *)&K[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+        }
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);             // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);          // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);       // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);          // ABEF
+    _mm_storeu_si128((__m128i *)&state[0], state0);
+    _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+#else
+inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+// the schedule is kept as a 16 word ring, rounds rotate the variables instead of shifting them
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, i)                                                   \
+    do                                                                                            \
+    {                                                                                             \
+        if ((i) >= 16)                                                                            \
+        {                                                                                         \
+            uint32_t w15 = w[((i) - 15) & 15], w2 = w[((i) - 2) & 15];                            \
+            w[(i) & 15] += (rotr(w15, 7) ^ rotr(w15, 18) ^ (w15 >> 3)) + w[((i) - 7) & 15] +      \
+                           (rotr(w2, 17) ^ rotr(w2, 19) ^ (w2 >> 10));                            \
+        }                                                                                         \
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + (g ^ (e & (f ^ g))) + K[i] + \
+                      w[(i) & 15];                                                                \
+        d += t1;                                                                                  \
+        h = t1 + (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) | (c & (a | b)));            \
+    } while (0)
+
+void compress(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    for (; blocks; --blocks, data += BLOCK_SIZE)
+    {
+        uint32_t w[16];
+        for (int i = 0; i < 16; ++i)
+            w[i] = load_be32(data + 4 * i);
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i += 8)
+        {
+            SHA256_ROUND(a, b, c, d, e, f, g, h, i);
+            SHA256_ROUND(h, a, b, c, d, e, f, g, i + 1);
+            SHA256_ROUND(g, h, a, b, c, d, e, f, i + 2);
+            SHA256_ROUND(f, g, h, a, b, c, d, e, i + 3);
+            SHA256_ROUND(e, f, g, h, a, b, c, d, i + 4);
+            SHA256_ROUND(d, e, f, g, h, a, b, c, i + 5);
+            SHA256_ROUND(c, d, e, f, g, h, a, b, i + 6);
+            SHA256_ROUND(b, c, d, e, f, g, h, a, i + 7);
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#undef SHA256_ROUND
+#endif
+
+#if SHA256_AVX2
+inline __m256i rotr8(__m256i x, int n)
+{
+    return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+// one block in each of eight lanes, state[j] holds word j of every lane
+void compress_x8(__m256i state[8], const uint8_t *const blocks[8])
+{
+    __m256i w[64];
+    for (int i = 0; i < 16; ++i)
+        w[i] = _mm256_setr_epi32((int)load_be32(blocks[0] + 4 * i), (int)load_be32(blocks[1] + 4 * i),
+                                 (int)load_be32(blocks[2] + 4 * i), (int)load_be32(blocks[3] + 4 * i),
+                                 (int)load_be32(blocks[4] + 4 * i), (int)load_be32(blocks[5] + 4 * i),
+                                 (int)load_be32(blocks[6] + 4 * i), (int)load_be32(blocks[7] + 4 * i));
+    for (int i = 16; i < 64; ++i)
+    {
+        __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8(w[i - 15], 7), rotr8(w[i - 15], 18)),
+                                      _mm256_srli_epi32(w[i - 15], 3));
+        __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8(w[i - 2], 17), rotr8(w[i - 2], 19)),
+                                      _mm256_srli_epi32(w[i - 2], 10));
+        w[i] = _mm256_add_epi32(_mm256_add_epi32(w[i - 16], s0), _mm256_add_epi32(w[i - 7], s1));
+    }
+    __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+    __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i)
+    {
+        __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8(e, 6), rotr8(e, 11)), rotr8(e, 25));
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, s1),
+                                      _mm256_add_epi32(ch, _mm256_add_epi32(_mm256_set1_epi32((int)K[i]), w[i])));
+        __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8(a, 2), rotr8(a, 13)), rotr8(a, 22));
+        __m256i maj = _mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_xor_si256(a, b)));
+        __m256i t2 = _mm256_add_epi32(s0, maj);
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi32(t1, t2);
+    }
+    state[0] = _mm256_add_epi32(state[0], a);
+    state[1] = _mm256_add_epi32(state[1], b);
+    state[2] = _mm256_add_epi32(state[2], c);
+    state[3] = _mm256_add_epi32(state[3], d);
+    state[4] = _mm256_add_epi32(state[4], e);
+    state[5] = _mm256_add_epi32(state[5], f);
+    state[6] = _mm256_add_epi32(state[6], g);
+    state[7] = _mm256_add_epi32(state[7], h);
+}
+
+// block `index` of the padded form of a `len` byte message
+void padded_block(const uint8_t *msg, size_t len, size_t index, uint8_t block[BLOCK_SIZE])
+{
+    size_t start = index * BLOCK_SIZE;
+    size_t take = start < len ? (len - start < BLOCK_SIZE ? len - start : BLOCK_SIZE) : 0;
+    std::memcpy(block, msg + start, take);
+    std::memset(block + take, 0, BLOCK_SIZE - take);
+    if (start <= len && len < start + BLOCK_SIZE)
+        block[len - start] = 0x80;
+    size_t blocks = (len + 8) / BLOCK_SIZE + 1;
+    if (index == blocks - 1)
+    {
+        uint64_t bits = (uint64_t)len * 8;
+        store_be32(block + 56, (uint32_t)(bits >> 32));
+        store_be32(block + 60, (uint32_t)bits);
+    }
+}
+
+void hash_x8(const uint8_t *const msgs[8], size_t len, uint8_t digests[8][DIGEST_SIZE])
+{
+    __m256i state[8];
+    for (int j = 0; j < 8; ++j)
+        state[j] = _mm256_set1_epi32((int)IV[j]);
+    alignas(32) uint8_t buffers[8][BLOCK_SIZE];
+    const uint8_t *blocks[8];
+    size_t count = (len + 8) / BLOCK_SIZE + 1;
+    for (size_t b = 0; b < count; ++b)
+    {
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            padded_block(msgs[lane], len, b, buffers[lane]);
+            blocks[lane] = buffers[lane];
+        }
+        compress_x8(state, blocks);
+    }
+    alignas(32) uint32_t words[8][8];
+    for (int j = 0; j < 8; ++j)
+        _mm256_store_si256((__m256i *)words[j], state[j]);
+    for (int lane = 0; lane < 8; ++lane)
+        for (int j = 0; j < 8; ++j)
+            store_be32(digests[lane] + 4 * j, words[j][lane]);
+}
+#endif
+
+} // namespace
+
+Context::Context()
+{
+    std::memcpy(state_, IV, sizeof(state_));
+}
+
+void Context::update(const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    size_t used = length_ % BLOCK_SIZE;
+    length_ += len;
+    if (used)
+    {
+        size_t take = BLOCK_SIZE - used < len ? BLOCK_SIZE - used : len;
+        std::memcpy(block_ + used, p, take);
+        p += take;
+        len -= take;
+        if (used + take < BLOCK_SIZE)
+            return;
+        compress(state_, block_, 1);
+    }
+    if (len >= BLOCK_SIZE)
+    {
+        compress(state_, p, len / BLOCK_SIZE);
+        p += len - len % BLOCK_SIZE;
+        len %= BLOCK_SIZE;
+    }
+    std::memcpy(block_, p, len);
+}
+
+void Context::finish(uint8_t digest[DIGEST_SIZE])
+{
+    uint64_t bits = length_ * 8;
+    size_t used = length_ % BLOCK_SIZE;
+    block_[used++] = 0x80;
+    if (used > BLOCK_SIZE - 8)
+    {
+        std::memset(block_ + used, 0, BLOCK_SIZE - used);
+        compress(state_, block_, 1);
+        used = 0;
+    }
+    std::memset(block_ + used, 0, BLOCK_SIZE - 8 - used);
+    store_be32(block_ + 56, (uint32_t)(bits >> 32));
+    store_be32(block_ + 60, (uint32_t)bits);
+    compress(state_, block_, 1);
+    for (int i = 0; i < 8; ++i)
+        store_be32(digest + 4 * i, state_[i]);
+}
+
+void hash(const void *data, size_t len, uint8_t digest[DIGEST_SIZE])
+{
+    Context ctx;
+    ctx.update(data, len);
+    ctx.finish(digest);
+}
+
+void double_hash(const void *data, size_t len, uint8_t digest[DIGEST_SIZE])
+{
+    uint8_t inner[DIGEST_SIZE];
+    hash(data, len, inner);
+    hash(inner, sizeof(inner), digest);
+}
+
+void double_hash_x8(const uint8_t *const msgs[8], size_t len, uint8_t digests[8][DIGEST_SIZE])
+{
+#if SHA256_AVX2
+    uint8_t inner[8][DIGEST_SIZE];
+    hash_x8(msgs, len, inner);
+    const uint8_t *second[8];
+    for (int lane = 0; lane < 8; ++lane)
+        second[lane] = inner[lane];
+    hash_x8(second, DIGEST_SIZE, digests);
+#else
+    for (int lane = 0; lane < 8; ++lane)
+        double_hash(msgs[lane], len, digests[lane]);
+#endif
+}
+
+const char *implementation()
+{
+#if SHA256_NI
+    return "sha-ni";
+#elif SHA256_AVX2
+    return "avx2 x8";
+#else
+    return "portable";
+#endif
+}
+
+} // namespace sha256
@@ -0,0 +1,49 @@
+/**
+ * SHA-256 for the host tools: base58 checksums and anything else hashing short
+ * messages in bulk.
+ *
+ * One compression function is picked at compile time: SHA-NI when built with
+ * -msha -msse4.1, portable C++ otherwise. hash_x8 runs eight equal length
+ * messages through an AVX2 eight lane compression when built with -mavx2 and
+ * SHA-NI is not available.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Itools -c tools/host/sha256.cpp
+ */
+
+#ifndef HOST_SHA256_H
+#define HOST_SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sha256
+{
+
+constexpr size_t DIGEST_SIZE = 32;
+constexpr size_t BLOCK_SIZE = 64;
+
+class Context
+{
+public:
+    Context();
+    void update(const void *data, size_t len);
+    void finish(uint8_t digest[DIGEST_SIZE]);
+
+private:
+    uint32_t state_[8];
+    uint8_t block_[BLOCK_SIZE];
+    uint64_t length_ = 0;
+};
+
+void hash(const void *data, size_t len, uint8_t digest[DIGEST_SIZE]);
+// SHA-256(SHA-256(data))
+void double_hash(const void *data, size_t len, uint8_t digest[DIGEST_SIZE]);
+// double_hash of eight messages of the same length, digests[i] belongs to msgs[i]
+void double_hash_x8(const uint8_t *const msgs[8], size_t len, uint8_t digests[8][DIGEST_SIZE]);
+
+// name of the compression in use, for benchmark reports
+const char *implementation();
+
+} // namespace sha256
+
+#endif
@@ -0,0 +1,285 @@
+#include "sha512.h"
+
+#include <cstring>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace sha512
+{
+
+namespace
+{
+
+constexpr uint64_t K[80] = {
+    0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc, 0x3956c25bf348b538,
+    0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, 0x12835b0145706fbe,
+    0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, 0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+    0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+    0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, 0x983e5152ee66dfab,
+    0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+    0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed,
+    0x53380d139d95b3df, 0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+    0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+    0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, 0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+    0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373,
+    0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+    0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b, 0xca273eceea26619c,
+    0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+    0x113f9804bef90dae, 0x1b710b35131c471b, 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+    0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817};
+
+constexpr uint64_t IV[8] = {0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+                            0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179};
+
+inline uint64_t load_be64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+        v = v << 8 | p[i];
+    return v;
+}
+
+inline void store_be64(uint8_t *p, uint64_t v)
+{
+    for (int i = 7; i >= 0; --i, v >>= 8)
+        p[i] = (uint8_t)v;
+}
+
+inline uint64_t rotr(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+// the schedule is kept as a 16 word ring, rounds rotate the variables instead of shifting them
+#define SHA512_ROUND(a, b, c, d, e, f, g, h, i)                                                     \
+    do                                                                                              \
+    {                                                                                               \
+        if ((i) >= 16)                                                                              \
+        {                                                                                           \
+            uint64_t w15 = w[((i) - 15) & 15], w2 = w[((i) - 2) & 15];                              \
+            w[(i) & 15] += (rotr(w15, 1) ^ rotr(w15, 8) ^ (w15 >> 7)) + w[((i) - 7) & 15] +         \
+                           (rotr(w2, 19) ^ rotr(w2, 61) ^ (w2 >> 6));                               \
+        }                                                                                           \
+        uint64_t t1 = h + (rotr(e, 14) ^ rotr(e, 18) ^ rotr(e, 41)) + (g ^ (e & (f ^ g))) + K[i] + \
+                      w[(i) & 15];                                                                  \
+        d += t1;                                                                                    \
+        h = t1 + (rotr(a, 28) ^ rotr(a, 34) ^ rotr(a, 39)) + ((a & b) | (c & (a | b)));            \
+    } while (0)
+
+void compress(uint64_t state[8], const uint8_t *data, size_t blocks)
+{
+    for (; blocks; --blocks, data += BLOCK_SIZE)
+    {
+        uint64_t w[16];
+        for (int i = 0; i < 16; ++i)
+            w[i] = load_be64(data + 8 * i);
+        uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 80; i += 8)
+        {
+            SHA512_ROUND(a, b, c, d, e, f, g, h, i);
+            SHA512_ROUND(h, a, b, c, d, e, f, g, i + 1);
+            SHA512_ROUND(g, h, a, b, c, d, e, f, i + 2);
+            SHA512_ROUND(f, g, h, a, b, c, d, e, i + 3);
+            SHA512_ROUND(e, f, g, h, a, b, c, d, i + 4);
+            SHA512_ROUND(d, e, f, g, h, a, b, c, i + 5);
+            SHA512_ROUND(c, d, e, f, g, h, a, b, i + 6);
+            SHA512_ROUND(b, c, d, e, f, g, h, a, i + 7);
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#undef SHA512_ROUND
+
+// the single padded block of a message of at most SINGLE_BLOCK_MAX bytes
+void pad_single(const uint8_t *msg, size_t len, uint8_t block[BLOCK_SIZE])
+{
+    std::memcpy(block, msg, len);
+    block[len] = 0x80;
+    std::memset(block + len + 1, 0, BLOCK_SIZE - 8 - len - 1);
+    store_be64(block + BLOCK_SIZE - 8, (uint64_t)len * 8);
+}
+
+void half_block(const uint8_t block[BLOCK_SIZE], uint8_t digest[HALF_SIZE])
+{
+    uint64_t state[8];
+    std::memcpy(state, IV, sizeof(state));
+    compress(state, block, 1);
+    for (int i = 0; i < 4; ++i)
+        store_be64(digest + 8 * i, state[i]);
+}
+
+#ifdef __AVX2__
+inline __m256i rotr4(__m256i x, int n)
+{
+    return _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - n));
+}
+
+// one padded block in each of four lanes, halves[lane] receives the first 32 bytes
+void half_x4(const uint8_t *const blocks[4], uint8_t (*halves[4])[HALF_SIZE])
+{
+    __m256i w[16];
+    for (int i = 0; i < 16; ++i)
+        w[i] = _mm256_setr_epi64x((long long)load_be64(blocks[0] + 8 * i), (long long)load_be64(blocks[1] + 8 * i),
+                                  (long long)load_be64(blocks[2] + 8 * i), (long long)load_be64(blocks[3] + 8 * i));
+    __m256i a = _mm256_set1_epi64x((long long)IV[0]), b = _mm256_set1_epi64x((long long)IV[1]);
+    __m256i c = _mm256_set1_epi64x((long long)IV[2]), d = _mm256_set1_epi64x((long long)IV[3]);
+    __m256i e = _mm256_set1_epi64x((long long)IV[4]), f = _mm256_set1_epi64x((long long)IV[5]);
+    __m256i g = _mm256_set1_epi64x((long long)IV[6]), h = _mm256_set1_epi64x((long long)IV[7]);
+    for (int i = 0; i < 80; ++i)
+    {
+        if (i >= 16)
+        {
+            __m256i w15 = w[(i - 15) & 15], w2 = w[(i - 2) & 15];
+            __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr4(w15, 1), rotr4(w15, 8)), _mm256_srli_epi64(w15, 7));
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr4(w2, 19), rotr4(w2, 61)), _mm256_srli_epi64(w2, 6));
+            w[i & 15] = _mm256_add_epi64(_mm256_add_epi64(w[i & 15], s0), _mm256_add_epi64(w[(i - 7) & 15], s1));
+        }
+        __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr4(e, 14), rotr4(e, 18)), rotr4(e, 41));
+        __m256i ch = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+        __m256i t1 = _mm256_add_epi64(_mm256_add_epi64(h, s1),
+                                      _mm256_add_epi64(ch, _mm256_add_epi64(_mm256_set1_epi64x((long long)K[i]), w[i & 15])));
+        __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr4(a, 28), rotr4(a, 34)), rotr4(a, 39));
+        __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi64(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi64(t1, _mm256_add_epi64(s0, maj));
+    }
+    // only the first four state words make up the half digest
+    alignas(32) uint64_t words[4][4];
+    _mm256_store_si256((__m256i *)words[0], _mm256_add_epi64(a, _mm256_set1_epi64x((long long)IV[0])));
+    _mm256_store_si256((__m256i *)words[1], _mm256_add_epi64(b, _mm256_set1_epi64x((long long)IV[1])));
+    _mm256_store_si256((__m256i *)words[2], _mm256_add_epi64(c, _mm256_set1_epi64x((long long)IV[2])));
+    _mm256_store_si256((__m256i *)words[3], _mm256_add_epi64(d, _mm256_set1_epi64x((long long)IV[3])));
+    for (int lane = 0; lane < 4; ++lane)
+        for (int j = 0; j < 4; ++j)
+            store_be64(*halves[lane] + 8 * j, words[j][lane]);
+}
+#endif
+
+
+} // namespace
+
+Context::Context()
+{
+    std::memcpy(state_, IV, sizeof(state_));
+}
+
+void Context::update(const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    size_t used = length_ % BLOCK_SIZE;
+    length_ += len;
+    if (used)
+    {
+        size_t take = BLOCK_SIZE - used < len ? BLOCK_SIZE - used : len;
+        std::memcpy(block_ + used, p, take);
+        p += take;
+        len -= take;
+        if (used + take < BLOCK_SIZE)
+            return;
+        compress(state_, block_, 1);
+    }
+    if (len >= BLOCK_SIZE)
+    {
+        compress(state_, p, len / BLOCK_SIZE);
+        p += len - len % BLOCK_SIZE;
+        len %= BLOCK_SIZE;
+    }
+    std::memcpy(block_, p, len);
+}
+
+void Context::finish(uint8_t digest[DIGEST_SIZE])
+{
+    // the length field is 128 bits, messages here never need the upper half
+    uint64_t bits = length_ * 8;
+    size_t used = length_ % BLOCK_SIZE;
+    block_[used++] = 0x80;
+    if (used > BLOCK_SIZE - 16)
+    {
+        std::memset(block_ + used, 0, BLOCK_SIZE - used);
+        compress(state_, block_, 1);
+        used = 0;
+    }
+    std::memset(block_ + used, 0, BLOCK_SIZE - 8 - used);
+    store_be64(block_ + BLOCK_SIZE - 8, bits);
+    compress(state_, block_, 1);
+    for (int i = 0; i < 8; ++i)
+        store_be64(digest + 8 * i, state_[i]);
+}
+
+void hash(const void *data, size_t len, uint8_t digest[DIGEST_SIZE])
+{
+    Context ctx;
+    ctx.update(data, len);
+    ctx.finish(digest);
+}
+
+void half(const void *data, size_t len, uint8_t digest[HALF_SIZE])
+{
+    if (len <= SINGLE_BLOCK_MAX)
+    {
+        uint8_t block[BLOCK_SIZE];
+        pad_single((const uint8_t *)data, len, block);
+        half_block(block, digest);
+        return;
+    }
+    uint8_t full[DIGEST_SIZE];
+    hash(data, len, full);
+    std::memcpy(digest, full, HALF_SIZE);
+}
+
+void half_batch(const uint8_t *const *msgs, const size_t *lens, uint8_t (*digests)[HALF_SIZE], size_t n)
+{
+#ifdef __AVX2__
+    // single block messages are gathered into groups of four lanes
+    uint8_t blocks[4][BLOCK_SIZE];
+    const uint8_t *lanes[4];
+    uint8_t (*outs[4])[HALF_SIZE];
+    int filled = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (lens[i] > SINGLE_BLOCK_MAX)
+        {
+            half(msgs[i], lens[i], digests[i]);
+            continue;
+        }
+        pad_single(msgs[i], lens[i], blocks[filled]);
+        lanes[filled] = blocks[filled];
+        outs[filled] = &digests[i];
+        if (++filled == 4)
+        {
+            half_x4(lanes, outs);
+            filled = 0;
+        }
+    }
+    for (int lane = 0; lane < filled; ++lane)
+        half_block(blocks[lane], *outs[lane]);
+#else
+    for (size_t i = 0; i < n; ++i)
+        half(msgs[i], lens[i], digests[i]);
+#endif
+}
+
+const char *implementation()
+{
+#ifdef __AVX2__
+    return "avx2 x4";
+#else
+    return "portable";
+#endif
+}
+
+} // namespace sha512
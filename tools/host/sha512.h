@@ -0,0 +1,50 @@
+/**
+ * SHA-512 and SHA-512Half (the first 32 bytes, util_sha512h and every ledger
+ * object ID) for the host tools.
+ *
+ * half_batch hashes messages that fit a single block (at most 111 bytes, which
+ * covers every keylet preimage) four at a time in AVX2 lanes when built with
+ * -mavx2; longer messages and builds without AVX2 use the scalar compression.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Itools -c tools/host/sha512.cpp
+ */
+
+#ifndef HOST_SHA512_H
+#define HOST_SHA512_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sha512
+{
+
+constexpr size_t DIGEST_SIZE = 64;
+constexpr size_t HALF_SIZE = 32;
+constexpr size_t BLOCK_SIZE = 128;
+// longest message that pads into one block
+constexpr size_t SINGLE_BLOCK_MAX = BLOCK_SIZE - 17;
+
+class Context
+{
+public:
+    Context();
+    void update(const void *data, size_t len);
+    void finish(uint8_t digest[DIGEST_SIZE]);
+
+private:
+    uint64_t state_[8];
+    uint8_t block_[BLOCK_SIZE];
+    uint64_t length_ = 0;
+};
+
+void hash(const void *data, size_t len, uint8_t digest[DIGEST_SIZE]);
+void half(const void *data, size_t len, uint8_t digest[HALF_SIZE]);
+// digests[i] = half(msgs[i], lens[i])
+void half_batch(const uint8_t *const *msgs, const size_t *lens, uint8_t (*digests)[HALF_SIZE], size_t n);
+
+// name of the batch kernel in use, for benchmark reports
+const char *implementation();
+
+} // namespace sha512
+
+#endif
@@ -0,0 +1,220 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace snapshot
+{
+
+using hookstate::ACCOUNT_ID_SIZE;
+using hookstate::KEY_SIZE;
+using hookstate::NAMESPACE_SIZE;
+
+namespace
+{
+
+uint64_t align8(uint64_t v) { return (v + 7) & ~7ULL; }
+
+// group order: account, then namespace
+int compare_group(const uint8_t *account, const uint8_t *ns, const Group &g)
+{
+    int c = std::memcmp(account, g.account, ACCOUNT_ID_SIZE);
+    return c ? c : std::memcmp(ns, g.ns, NAMESPACE_SIZE);
+}
+
+} // namespace
+
+Snapshot::~Snapshot() { close(); }
+
+void Snapshot::close()
+{
+    if (map_)
+        munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+    header_ = nullptr;
+    groups_ = nullptr;
+    keys_ = nullptr;
+    refs_ = nullptr;
+    heap_ = nullptr;
+}
+
+bool Snapshot::open(const std::string &path, std::string &error)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header))
+    {
+        ::close(fd);
+        error = path + ": not a snapshot";
+        return false;
+    }
+    map_size_ = (size_t)st.st_size;
+    map_ = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map_ == MAP_FAILED)
+    {
+        map_ = nullptr;
+        error = "cannot map " + path;
+        return false;
+    }
+
+    const uint8_t *base = (const uint8_t *)map_;
+    const Header *h = (const Header *)base;
+    uint64_t n = h->entry_count;
+    uint64_t groups_end = sizeof(Header) + (uint64_t)h->group_count * sizeof(Group);
+    bool ok = std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0 && h->version == VERSION &&
+              n <= map_size_ / KEY_SIZE && h->keys_offset >= groups_end && h->keys_offset % 8 == 0 &&
+              h->refs_offset >= h->keys_offset + n * KEY_SIZE && h->refs_offset % 8 == 0 &&
+              h->heap_offset >= h->refs_offset + n * sizeof(Ref) && h->heap_offset <= map_size_ &&
+              h->heap_size <= map_size_ - h->heap_offset;
+    if (ok)
+    {
+        groups_ = (const Group *)(base + sizeof(Header));
+        uint64_t next = 0;
+        for (uint32_t g = 0; ok && g < h->group_count; ++g)
+        {
+            // contiguous, in order and sorted by account and namespace
+            ok = groups_[g].first == next && groups_[g].count <= n - next &&
+                 (g == 0 || compare_group(groups_[g].account, groups_[g].ns, groups_[g - 1]) > 0);
+            next += groups_[g].count;
+        }
+        ok = ok && next == n;
+    }
+    if (!ok)
+    {
+        close();
+        error = path + ": malformed snapshot";
+        return false;
+    }
+    header_ = h;
+    keys_ = base + h->keys_offset;
+    refs_ = (const Ref *)(base + h->refs_offset);
+    heap_ = base + h->heap_offset;
+    return true;
+}
+
+const uint8_t *Snapshot::value(size_t entry, uint32_t &size) const
+{
+    const Ref &r = refs_[entry];
+    if (r.offset > header_->heap_size || r.size > header_->heap_size - r.offset)
+        return nullptr;
+    size = r.size;
+    return heap_ + r.offset;
+}
+
+const uint8_t *Snapshot::find(const uint8_t account[ACCOUNT_ID_SIZE], const uint8_t ns[NAMESPACE_SIZE],
+                              const uint8_t key[KEY_SIZE], uint32_t &size) const
+{
+    if (!header_)
+        return nullptr;
+    const Group *g = std::lower_bound(groups_, groups_ + header_->group_count, 0,
+                                      [&](const Group &x, int) { return compare_group(account, ns, x) > 0; });
+    if (g == groups_ + header_->group_count || compare_group(account, ns, *g) != 0)
+        return nullptr;
+    uint64_t lo = g->first, hi = g->first + g->count;
+    while (lo < hi)
+    {
+        uint64_t mid = lo + (hi - lo) / 2;
+        int c = std::memcmp(keys_ + mid * KEY_SIZE, key, KEY_SIZE);
+        if (c == 0)
+            return value(mid, size);
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return nullptr;
+}
+
+const uint8_t *Snapshot::find(const hookstate::Key &key, uint32_t &size) const
+{
+    const uint8_t *k = key.data();
+    return find(k, k + ACCOUNT_ID_SIZE, k + ACCOUNT_ID_SIZE + NAMESPACE_SIZE, size);
+}
+
+bool write(const std::string &path, const hookstate::Map &state, std::string &error)
+{
+    // Key orders by account, namespace, then key: exactly the file order
+    std::vector<const hookstate::Map::value_type *> entries;
+    entries.reserve(state.size());
+    for (const auto &kv : state)
+        if (!kv.second.empty())
+            entries.push_back(&kv);
+    std::sort(entries.begin(), entries.end(), [](auto a, auto b) { return a->first < b->first; });
+
+    std::vector<Group> groups;
+    uint64_t heap_size = 0;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const uint8_t *k = entries[i]->first.data();
+        if (groups.empty() || compare_group(k, k + ACCOUNT_ID_SIZE, groups.back()) != 0)
+        {
+            Group g{};
+            std::memcpy(g.account, k, ACCOUNT_ID_SIZE);
+            std::memcpy(g.ns, k + ACCOUNT_ID_SIZE, NAMESPACE_SIZE);
+            g.first = i;
+            groups.push_back(g);
+        }
+        ++groups.back().count;
+        heap_size += entries[i]->second.size();
+    }
+
+    Header h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.group_count = (uint32_t)groups.size();
+    h.entry_count = entries.size();
+    h.keys_offset = align8(sizeof(Header) + groups.size() * sizeof(Group));
+    h.refs_offset = align8(h.keys_offset + entries.size() * KEY_SIZE);
+    h.heap_offset = align8(h.refs_offset + entries.size() * sizeof(Ref));
+    h.heap_size = heap_size;
+
+    std::vector<uint8_t> out(h.heap_offset + heap_size);
+    std::memcpy(out.data(), &h, sizeof(h));
+    std::memcpy(out.data() + sizeof(Header), groups.data(), groups.size() * sizeof(Group));
+    uint64_t at = 0;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const hookstate::Value &v = entries[i]->second;
+        std::memcpy(out.data() + h.keys_offset + i * KEY_SIZE,
+                    entries[i]->first.data() + ACCOUNT_ID_SIZE + NAMESPACE_SIZE, KEY_SIZE);
+        Ref r{at, (uint32_t)v.size(), 0};
+        std::memcpy(out.data() + h.refs_offset + i * sizeof(Ref), &r, sizeof(r));
+        std::memcpy(out.data() + h.heap_offset + at, v.data(), v.size());
+        at += v.size();
+    }
+
+    // written next to the target and renamed, so an open snapshot is never truncated
+    std::string tmp = path + ".tmp";
+    FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f)
+    {
+        error = "cannot write " + tmp;
+        return false;
+    }
+    bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmp.c_str());
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+} // namespace snapshot
@@ -0,0 +1,103 @@
+/**
+ * On-disk hook state snapshots, opened with mmap.
+ *
+ * A snapshot holds the state of any number of (account, namespace) groups.
+ * The file is a header, the group table sorted by account and namespace, the
+ * 32 byte keys of every group sorted within the group, one value reference
+ * per key and the value heap. All integers are little endian and every
+ * section is 8 byte aligned, so open() only maps the file and checks the
+ * header and group table; lookups binary search the mapped keys and bounds
+ * check the reference they find. A Snapshot can sit under a hookstate::Store,
+ * whose overlay and base then hold the changes.
+ *
+ * POSIX only (mmap).
+ *
+ * Build: g++ -std=c++17 -O2 -Itools -c tools/host/snapshot.cpp
+ */
+
+#ifndef HOST_SNAPSHOT_H
+#define HOST_SNAPSHOT_H
+
+#include "host/hookstate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace snapshot
+{
+
+constexpr char MAGIC[8] = {'H', 'K', 'S', 'T', 'A', 'T', 'E', 0};
+constexpr uint32_t VERSION = 1;
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t group_count;
+    uint64_t entry_count;
+    uint64_t keys_offset;
+    uint64_t refs_offset;
+    uint64_t heap_offset;
+    uint64_t heap_size;
+};
+
+struct Group
+{
+    uint8_t account[hookstate::ACCOUNT_ID_SIZE];
+    uint8_t ns[hookstate::NAMESPACE_SIZE];
+    uint32_t reserved;
+    uint64_t first; // index of the group's first key
+    uint64_t count;
+};
+
+struct Ref
+{
+    uint64_t offset; // into the heap
+    uint32_t size;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 56 && sizeof(Group) == 72 && sizeof(Ref) == 16, "snapshot layout");
+
+class Snapshot
+{
+public:
+    Snapshot() = default;
+    ~Snapshot();
+    Snapshot(const Snapshot &) = delete;
+    Snapshot &operator=(const Snapshot &) = delete;
+
+    // false with a message when the file cannot be mapped or is malformed
+    bool open(const std::string &path, std::string &error);
+    void close();
+
+    // the value of a key, nullptr when absent
+    const uint8_t *find(const uint8_t account[hookstate::ACCOUNT_ID_SIZE],
+                        const uint8_t ns[hookstate::NAMESPACE_SIZE], const uint8_t key[hookstate::KEY_SIZE],
+                        uint32_t &size) const;
+    const uint8_t *find(const hookstate::Key &key, uint32_t &size) const;
+
+    size_t group_count() const { return header_ ? header_->group_count : 0; }
+    size_t entry_count() const { return header_ ? header_->entry_count : 0; }
+    const Group &group(size_t i) const { return groups_[i]; }
+    const uint8_t *key(size_t entry) const { return keys_ + entry * hookstate::KEY_SIZE; }
+    // nullptr when the reference points outside the heap
+    const uint8_t *value(size_t entry, uint32_t &size) const;
+
+private:
+    void *map_ = nullptr;
+    size_t map_size_ = 0;
+    const Header *header_ = nullptr;
+    const Group *groups_ = nullptr;
+    const uint8_t *keys_ = nullptr;
+    const Ref *refs_ = nullptr;
+    const uint8_t *heap_ = nullptr;
+};
+
+// writes the entries of a state map (erased, empty values are skipped)
+bool write(const std::string &path, const hookstate::Map &state, std::string &error);
+
+} // namespace snapshot
+
+#endif
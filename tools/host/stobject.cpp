@@ -0,0 +1,598 @@
+#include "stobject.h"
+
+#include "error.h"
+
+#include <cstring>
+
+namespace sto
+{
+
+namespace
+{
+
+// sto_subarray gives up after this many entries, as the hook API does
+constexpr uint32_t MAX_ITERATIONS = 1024;
+
+inline int64_t pack(uint32_t offset, uint32_t length)
+{
+    return (static_cast<int64_t>(offset) << 32) + length;
+}
+
+// the field header at p: returns its length and sets the code, or -1
+inline int parse_header(const uint8_t *p, const uint8_t *end, uint32_t &code)
+{
+    if (p >= end)
+        return -1;
+    uint32_t type = p[0] >> 4;
+    uint32_t field = p[0] & 0x0F;
+    int n = 1;
+    if (type == 0)
+    {
+        if (p + n >= end)
+            return -1;
+        type = p[n++];
+        if (type < 16)
+            return -1;
+    }
+    if (field == 0)
+    {
+        if (p + n >= end)
+            return -1;
+        field = p[n++];
+        if (field < 16)
+            return -1;
+    }
+    code = (type << 16) + field;
+    return n;
+}
+
+// a VL length prefix at p: returns its length and sets the value, or -1
+inline int parse_vl(const uint8_t *p, const uint8_t *end, uint32_t &length)
+{
+    if (p >= end)
+        return -1;
+    uint32_t b1 = p[0];
+    if (b1 <= 192)
+    {
+        length = b1;
+        return 1;
+    }
+    if (b1 <= 240)
+    {
+        if (end - p < 2)
+            return -1;
+        length = 193 + (b1 - 193) * 256 + p[1];
+        return 2;
+    }
+    if (b1 <= 254)
+    {
+        if (end - p < 3)
+            return -1;
+        length = 12481 + (b1 - 241) * 65536 + p[1] * 256 + p[2];
+        return 3;
+    }
+    return -1;
+}
+
+inline uint32_t hash(uint32_t code, uint32_t bits)
+{
+    return (code * 0x9E3779B1U) >> (32 - bits);
+}
+
+inline bool is_object(const Field &f)
+{
+    return f.code == 0 || f.type() == STI_OBJECT;
+}
+
+// payload of a field that is not an object or array, starting at p: sets the
+// length prefix size and payload size, returns false when malformed
+bool leaf_length(uint32_t type, const uint8_t *p, const uint8_t *end, uint32_t &prefix, uint32_t &size)
+{
+    prefix = 0;
+    switch (type)
+    {
+    case STI_UINT8:
+        size = 1;
+        break;
+    case STI_UINT16:
+        size = 2;
+        break;
+    case STI_UINT32:
+        size = 4;
+        break;
+    case STI_UINT64:
+        size = 8;
+        break;
+    case STI_UINT96:
+        size = 12;
+        break;
+    case STI_UINT128:
+        size = 16;
+        break;
+    case STI_UINT160:
+    case STI_CURRENCY:
+        size = 20;
+        break;
+    case STI_UINT192:
+        size = 24;
+        break;
+    case STI_UINT256:
+        size = 32;
+        break;
+    case STI_UINT384:
+        size = 48;
+        break;
+    case STI_UINT512:
+        size = 64;
+        break;
+    case STI_AMOUNT:
+        if (p >= end)
+            return false;
+        size = (p[0] & 0x80) ? 48 : 8;
+        break;
+    case STI_ISSUE:
+    {
+        if (end - p < 20)
+            return false;
+        size = 20;
+        for (int i = 0; i < 20; ++i)
+            if (p[i])
+            {
+                size = 40;
+                break;
+            }
+        break;
+    }
+    case STI_VL:
+    case STI_ACCOUNT:
+    case STI_VECTOR256:
+    {
+        int n = parse_vl(p, end, size);
+        if (n < 0)
+            return false;
+        prefix = n;
+        break;
+    }
+    case STI_PATHSET:
+    {
+        // steps of a flag byte and 20 bytes per flag, 0xFF between paths, 0x00 at the end
+        const uint8_t *q = p;
+        for (;;)
+        {
+            if (q >= end)
+                return false;
+            uint8_t flags = *q++;
+            if (flags == 0x00)
+                break;
+            if (flags == 0xFF)
+                continue;
+            q += 20 * (((flags & 0x01) != 0) + ((flags & 0x10) != 0) + ((flags & 0x20) != 0));
+        }
+        size = static_cast<uint32_t>(q - p);
+        break;
+    }
+    default:
+        return false;
+    }
+    return static_cast<size_t>(end - p) >= prefix + static_cast<size_t>(size);
+}
+
+} // namespace
+
+int64_t field_length(const uint8_t *p, const uint8_t *end, uint32_t &code, uint32_t &payload_start,
+                     uint32_t &payload_size, int depth)
+{
+    if (depth > MAX_DEPTH)
+        return -1;
+    int header = parse_header(p, end, code);
+    if (header < 0)
+        return -1;
+    uint32_t type = code >> 16;
+    const uint8_t *q = p + header;
+
+    if (type == STI_OBJECT || type == STI_ARRAY)
+    {
+        if (code == OBJECT_END || code == ARRAY_END)
+            return -1;
+        uint32_t marker = type == STI_OBJECT ? OBJECT_END : ARRAY_END;
+        for (;;)
+        {
+            uint32_t child, start, size;
+            if (q < end && *q == (type == STI_OBJECT ? 0xE1 : 0xF1))
+                break;
+            int64_t n = field_length(q, end, child, start, size, depth + 1);
+            if (n < 0 || child == marker)
+                return -1;
+            q += n;
+        }
+        payload_start = header;
+        payload_size = static_cast<uint32_t>(q - p) - header;
+        return q + 1 - p;
+    }
+
+    uint32_t prefix, size;
+    if (!leaf_length(type, q, end, prefix, size))
+        return -1;
+    payload_start = header + prefix;
+    payload_size = size;
+    return header + prefix + size;
+}
+
+int64_t sto_subfield(const uint8_t *read, uint32_t read_len, uint32_t field_id)
+{
+    const uint8_t *p = read;
+    const uint8_t *end = read + read_len;
+    for (uint32_t i = 0; i < MAX_ITERATIONS && p < end; ++i)
+    {
+        uint32_t code, start, size;
+        int64_t n = field_length(p, end, code, start, size);
+        if (n < 0)
+            return PARSE_ERROR;
+        if (code == field_id)
+        {
+            // arrays are returned whole, everything else as its payload
+            if ((code >> 16) == STI_ARRAY)
+                return pack(static_cast<uint32_t>(p - read), static_cast<uint32_t>(n));
+            return pack(static_cast<uint32_t>(p - read) + start, size);
+        }
+        p += n;
+    }
+    return DOESNT_EXIST;
+}
+
+int64_t sto_subarray(const uint8_t *read, uint32_t read_len, uint32_t index)
+{
+    if (read_len < 2)
+        return TOO_SMALL;
+    const uint8_t *p = read;
+    const uint8_t *end = read + read_len;
+    // an array as sto_subfield returns it: skip its header and end marker
+    if ((*p & 0xF0) == 0xF0)
+    {
+        ++p;
+        --end;
+    }
+    for (uint32_t i = 0; i < MAX_ITERATIONS && p < end; ++i)
+    {
+        uint32_t code, start, size;
+        int64_t n = field_length(p, end, code, start, size);
+        if (n < 0)
+            return PARSE_ERROR;
+        if (i == index)
+            return pack(static_cast<uint32_t>(p - read), static_cast<uint32_t>(n));
+        p += n;
+    }
+    return DOESNT_EXIST;
+}
+
+bool Index::parse(const uint8_t *data, size_t len)
+{
+    data_ = data;
+    len_ = len;
+    nodes_.clear();
+    table_.clear();
+    if (len > UINT32_MAX)
+        return false;
+    if (levels_.size() < MAX_DEPTH + 1)
+        levels_.resize(MAX_DEPTH + 1);
+
+    nodes_.push_back(Field{});
+    uint32_t first, count;
+    if (scan(0, static_cast<uint32_t>(len), 0, 0, first, count) < 0)
+    {
+        nodes_.clear();
+        return false;
+    }
+    Field &root = nodes_[ROOT];
+    root.size = root.payload_size = static_cast<uint32_t>(len);
+    root.first_child = first;
+    root.child_count = count;
+    build_table(root);
+    return true;
+}
+
+// scans the children of a container from pos: up to end for the root (depth 0),
+// up to and including the end marker otherwise; returns the position after it
+int64_t Index::scan(uint32_t pos, uint32_t end, uint8_t marker, int depth, uint32_t &first, uint32_t &count)
+{
+    if (depth > MAX_DEPTH)
+        return -1;
+    // containers at one depth never overlap, so each depth has one scratch vector
+    std::vector<Field> &level = levels_[depth];
+    level.clear();
+    const uint8_t *limit = data_ + end;
+
+    for (;;)
+    {
+        if (pos >= end)
+        {
+            if (depth > 0)
+                return -1;
+            break;
+        }
+        if (depth > 0 && data_[pos] == marker)
+        {
+            ++pos;
+            break;
+        }
+        Field f{};
+        f.offset = pos;
+        int header = parse_header(data_ + pos, limit, f.code);
+        if (header < 0 || f.code == OBJECT_END || f.code == ARRAY_END)
+            return -1;
+        uint32_t type = f.type();
+        pos += header;
+
+        if (type == STI_OBJECT || type == STI_ARRAY)
+        {
+            uint32_t child_first, child_count;
+            int64_t next = scan(pos, end, type == STI_OBJECT ? 0xE1 : 0xF1, depth + 1, child_first, child_count);
+            if (next < 0)
+                return -1;
+            f.payload_offset = pos;
+            f.payload_size = static_cast<uint32_t>(next) - 1 - pos;
+            f.first_child = child_first;
+            f.child_count = child_count;
+            if (type == STI_OBJECT)
+                build_table(f);
+            pos = static_cast<uint32_t>(next);
+        }
+        else
+        {
+            uint32_t prefix, size;
+            if (!leaf_length(type, data_ + pos, limit, prefix, size))
+                return -1;
+            f.payload_offset = pos + prefix;
+            f.payload_size = size;
+            pos += prefix + size;
+        }
+        f.size = pos - f.offset;
+        level.push_back(f);
+    }
+
+    first = static_cast<uint32_t>(nodes_.size());
+    count = static_cast<uint32_t>(level.size());
+    nodes_.insert(nodes_.end(), level.begin(), level.end());
+    return pos;
+}
+
+// open addressing from field code to child, sized to stay at most half full;
+// probing keeps insertion order, so a duplicated field finds its first copy
+void Index::build_table(Field &f)
+{
+    uint32_t bits = 2;
+    while ((1U << bits) < 2 * f.child_count)
+        ++bits;
+    f.table = static_cast<uint32_t>(table_.size());
+    f.table_bits = bits;
+    table_.resize(table_.size() + (1U << bits), 0);
+    uint32_t *slots = table_.data() + f.table;
+    uint32_t mask = (1U << bits) - 1;
+    for (uint32_t i = 0; i < f.child_count; ++i)
+    {
+        uint32_t node = f.first_child + i;
+        uint32_t h = hash(nodes_[node].code, bits);
+        while (slots[h])
+            h = (h + 1) & mask;
+        slots[h] = node + 1;
+    }
+}
+
+uint32_t Index::find(uint32_t node, uint32_t code) const
+{
+    const Field &f = nodes_[node];
+    if (!is_object(f))
+        return NOT_FOUND;
+    const uint32_t *slots = table_.data() + f.table;
+    uint32_t mask = (1U << f.table_bits) - 1;
+    for (uint32_t h = hash(code, f.table_bits); slots[h]; h = (h + 1) & mask)
+        if (nodes_[slots[h] - 1].code == code)
+            return slots[h] - 1;
+    return NOT_FOUND;
+}
+
+uint32_t Index::at(uint32_t node, uint32_t index) const
+{
+    const Field &f = nodes_[node];
+    if (index >= f.child_count)
+        return NOT_FOUND;
+    return f.first_child + index;
+}
+
+int64_t Index::subfield(uint32_t node, uint32_t field_id) const
+{
+    const Field &f = nodes_[node];
+    if (!is_object(f))
+        return NOT_AN_OBJECT;
+    uint32_t child = find(node, field_id);
+    if (child == NOT_FOUND)
+        return DOESNT_EXIST;
+    const Field &c = nodes_[child];
+    if (c.type() == STI_ARRAY)
+        return pack(c.offset - f.payload_offset, c.size);
+    return pack(c.payload_offset - f.payload_offset, c.payload_size);
+}
+
+int64_t Index::subarray(uint32_t node, uint32_t index) const
+{
+    const Field &f = nodes_[node];
+    if (f.code == 0 || f.type() != STI_ARRAY)
+        return NOT_AN_ARRAY;
+    if (index >= MAX_ITERATIONS)
+        return DOESNT_EXIST;
+    uint32_t child = at(node, index);
+    if (child == NOT_FOUND)
+        return DOESNT_EXIST;
+    // relative to the array header, as sto_subfield returns arrays
+    const Field &c = nodes_[child];
+    return pack(c.offset - f.offset, c.size);
+}
+
+int64_t Slots::place(uint32_t new_slot, const std::shared_ptr<Index> &index, uint32_t node)
+{
+    if (new_slot > MAX_SLOTS)
+        return INVALID_ARGUMENT;
+    if (new_slot == 0)
+    {
+        for (uint32_t i = 1; i <= MAX_SLOTS; ++i)
+            if (!slots_[i].index)
+            {
+                new_slot = i;
+                break;
+            }
+        if (new_slot == 0)
+            return NO_FREE_SLOTS;
+    }
+    slots_[new_slot].index = index;
+    slots_[new_slot].node = node;
+    return new_slot;
+}
+
+int64_t Slots::set(const uint8_t *data, size_t len, uint32_t new_slot)
+{
+    if (new_slot > MAX_SLOTS)
+        return INVALID_ARGUMENT;
+    auto index = std::make_shared<Index>();
+    if (!index->parse(data, len))
+        return PARSE_ERROR;
+    return place(new_slot, index, Index::ROOT);
+}
+
+int64_t Slots::subfield(uint32_t parent_slot, uint32_t field_id, uint32_t new_slot)
+{
+    if (parent_slot > MAX_SLOTS || !slots_[parent_slot].index)
+        return DOESNT_EXIST;
+    if (new_slot > MAX_SLOTS)
+        return INVALID_ARGUMENT;
+    const Slot &parent = slots_[parent_slot];
+    if (!is_object(parent.index->field(parent.node)))
+        return NOT_AN_OBJECT;
+    uint32_t node = parent.index->find(parent.node, field_id);
+    if (node == Index::NOT_FOUND)
+        return DOESNT_EXIST;
+    // copied first, place may overwrite the parent
+    std::shared_ptr<Index> index = parent.index;
+    return place(new_slot, index, node);
+}
+
+int64_t Slots::subarray(uint32_t parent_slot, uint32_t index, uint32_t new_slot)
+{
+    if (parent_slot > MAX_SLOTS || !slots_[parent_slot].index)
+        return DOESNT_EXIST;
+    if (new_slot > MAX_SLOTS)
+        return INVALID_ARGUMENT;
+    const Slot &parent = slots_[parent_slot];
+    if (parent.index->field(parent.node).type() != STI_ARRAY)
+        return NOT_AN_ARRAY;
+    uint32_t node = parent.index->at(parent.node, index);
+    if (node == Index::NOT_FOUND)
+        return DOESNT_EXIST;
+    std::shared_ptr<Index> shared = parent.index;
+    return place(new_slot, shared, node);
+}
+
+int64_t Slots::count(uint32_t slot) const
+{
+    if (slot > MAX_SLOTS || !slots_[slot].index)
+        return DOESNT_EXIST;
+    const Field &f = slots_[slot].index->field(slots_[slot].node);
+    if (f.type() != STI_ARRAY)
+        return NOT_AN_ARRAY;
+    return f.child_count;
+}
+
+int64_t Slots::size(uint32_t slot) const
+{
+    if (slot > MAX_SLOTS || !slots_[slot].index)
+        return DOESNT_EXIST;
+    const Field &f = slots_[slot].index->field(slots_[slot].node);
+    return f.type() == STI_ARRAY ? f.size : f.payload_size;
+}
+
+int64_t Slots::clear(uint32_t slot)
+{
+    if (slot > MAX_SLOTS || !slots_[slot].index)
+        return DOESNT_EXIST;
+    slots_[slot].index.reset();
+    slots_[slot].node = 0;
+    return 1;
+}
+
+const uint8_t *Slots::data(uint32_t slot) const
+{
+    if (slot > MAX_SLOTS || !slots_[slot].index)
+        return nullptr;
+    const Index &index = *slots_[slot].index;
+    const Field &f = index.field(slots_[slot].node);
+    return index.data() + (f.type() == STI_ARRAY ? f.offset : f.payload_offset);
+}
+
+const Field *Slots::field(uint32_t slot) const
+{
+    if (slot > MAX_SLOTS || !slots_[slot].index)
+        return nullptr;
+    return &slots_[slot].index->field(slots_[slot].node);
+}
+
+void Writer::header(uint32_t code)
+{
+    uint32_t type = code >> 16, field = code & 0xFFFF;
+    if (type < 16 && field < 16)
+        out.push_back((uint8_t)(type << 4 | field));
+    else if (type < 16)
+    {
+        out.push_back((uint8_t)(type << 4));
+        out.push_back((uint8_t)field);
+    }
+    else if (field < 16)
+    {
+        out.push_back((uint8_t)field);
+        out.push_back((uint8_t)type);
+    }
+    else
+    {
+        out.push_back(0);
+        out.push_back((uint8_t)type);
+        out.push_back((uint8_t)field);
+    }
+}
+
+void Writer::uint(uint32_t code, uint64_t value, int bytes)
+{
+    header(code);
+    for (int i = bytes - 1; i >= 0; --i)
+        out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+void Writer::bytes(uint32_t code, const uint8_t *p, size_t n)
+{
+    header(code);
+    out.insert(out.end(), p, p + n);
+}
+
+void Writer::vl(uint32_t code, const uint8_t *p, size_t n)
+{
+    header(code);
+    if (n <= 192)
+        out.push_back((uint8_t)n);
+    else
+    {
+        n -= 193;
+        out.push_back((uint8_t)(193 + (n >> 8)));
+        out.push_back((uint8_t)n);
+        n += 193;
+    }
+    out.insert(out.end(), p, p + n);
+}
+
+void Writer::iou(uint32_t code, uint64_t mantissa, int exponent, const char *currency, const uint8_t *issuer)
+{
+    uint64_t v = 0xC000000000000000ULL | (uint64_t)(exponent + 97) << 54 | mantissa;
+    uint(code, v, 8);
+    uint8_t c[20] = {0};
+    std::memcpy(c + 12, currency, 3);
+    out.insert(out.end(), c, c + 20);
+    out.insert(out.end(), issuer, issuer + 20);
+}
+
+} // namespace sto
@@ -0,0 +1,169 @@
+/**
+ * Zero-copy STObject parsing, matching sto_subfield, sto_subarray, slot_subfield
+ * and slot_subarray in lib/extern.h.
+ *
+ * sto_subfield/sto_subarray scan the buffer on every call, as the hook API
+ * does. Index scans a serialized object once and keeps one Field per field
+ * in an arena: the children of each object or array are contiguous, so array
+ * elements are found by position, and every object has a small open addressing
+ * table from field code to child. Later lookups are O(1) and point into the
+ * original buffer, which must outlive the index. parse() reuses the arena, so
+ * a long-lived Index stops allocating once it has seen the largest object.
+ *
+ * Slots emulates the hook slot table on top of indexes, and Writer serializes
+ * objects for tools that build transactions and metadata.
+ *
+ * Build: g++ -std=c++17 -O2 -Ilib -Itools -c tools/host/stobject.cpp
+ */
+
+#ifndef HOST_STOBJECT_H
+#define HOST_STOBJECT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sto
+{
+
+// serialized type codes, the upper 16 bits of a field code
+constexpr uint32_t STI_UINT16 = 1;
+constexpr uint32_t STI_UINT32 = 2;
+constexpr uint32_t STI_UINT64 = 3;
+constexpr uint32_t STI_UINT128 = 4;
+constexpr uint32_t STI_UINT256 = 5;
+constexpr uint32_t STI_AMOUNT = 6;
+constexpr uint32_t STI_VL = 7;
+constexpr uint32_t STI_ACCOUNT = 8;
+constexpr uint32_t STI_OBJECT = 14;
+constexpr uint32_t STI_ARRAY = 15;
+constexpr uint32_t STI_UINT8 = 16;
+constexpr uint32_t STI_UINT160 = 17;
+constexpr uint32_t STI_PATHSET = 18;
+constexpr uint32_t STI_VECTOR256 = 19;
+constexpr uint32_t STI_UINT96 = 20;
+constexpr uint32_t STI_UINT192 = 21;
+constexpr uint32_t STI_UINT384 = 22;
+constexpr uint32_t STI_UINT512 = 23;
+constexpr uint32_t STI_ISSUE = 24;
+constexpr uint32_t STI_CURRENCY = 26;
+
+constexpr uint32_t OBJECT_END = (STI_OBJECT << 16) + 1;
+constexpr uint32_t ARRAY_END = (STI_ARRAY << 16) + 1;
+// nesting deeper than this is rejected
+constexpr int MAX_DEPTH = 16;
+
+struct Field
+{
+    uint32_t code;           // (type << 16) + field, 0 for the root
+    uint32_t offset;         // of the field header in the buffer
+    uint32_t size;           // header, length prefix, payload and end marker
+    uint32_t payload_offset; // the value: after any length prefix, before any end marker
+    uint32_t payload_size;
+    uint32_t first_child;    // objects and arrays: children are nodes first_child..+child_count
+    uint32_t child_count;
+    uint32_t table;          // objects and the root: lookup table slice, 1 << table_bits entries
+    uint32_t table_bits;
+
+    uint32_t type() const { return code >> 16; }
+};
+
+// the size of the field at p and its payload position relative to p, or -1
+int64_t field_length(const uint8_t *p, const uint8_t *end, uint32_t &code, uint32_t &payload_start,
+                     uint32_t &payload_size, int depth = 0);
+
+// hook API semantics on a buffer: (offset << 32) + length or an error code from lib/error.h
+int64_t sto_subfield(const uint8_t *read, uint32_t read_len, uint32_t field_id);
+int64_t sto_subarray(const uint8_t *read, uint32_t read_len, uint32_t index);
+
+class Index
+{
+public:
+    static constexpr uint32_t ROOT = 0;
+    static constexpr uint32_t NOT_FOUND = ~0U;
+
+    // indexes the fields of an object serialized without a header (a transaction,
+    // ledger entry or metadata blob); false when it is malformed
+    bool parse(const uint8_t *data, size_t len);
+
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return len_; }
+    size_t node_count() const { return nodes_.size(); }
+    const Field &field(uint32_t node) const { return nodes_[node]; }
+    const uint8_t *payload(uint32_t node) const { return data_ + nodes_[node].payload_offset; }
+
+    // child of an object (or the root) by field code, NOT_FOUND when absent
+    uint32_t find(uint32_t node, uint32_t code) const;
+    // element of an array, NOT_FOUND past the end
+    uint32_t at(uint32_t node, uint32_t index) const;
+
+    // sto_subfield on an object's payload (NOT_AN_OBJECT otherwise), and sto_subarray
+    // on an array as sto_subfield returns it, header included (NOT_AN_ARRAY otherwise);
+    // offsets are relative to those buffers
+    int64_t subfield(uint32_t node, uint32_t field_id) const;
+    int64_t subarray(uint32_t node, uint32_t index) const;
+
+private:
+    int64_t scan(uint32_t pos, uint32_t end, uint8_t marker, int depth, uint32_t &first, uint32_t &count);
+    void build_table(Field &f);
+
+    const uint8_t *data_ = nullptr;
+    size_t len_ = 0;
+    std::vector<Field> nodes_;
+    std::vector<uint32_t> table_;
+    // per depth scratch for the children of the containers being scanned
+    std::vector<std::vector<Field>> levels_;
+};
+
+// the hook slot table: slot numbers 1..255, each a node of a shared Index
+class Slots
+{
+public:
+    static constexpr uint32_t MAX_SLOTS = 255;
+
+    // slot_set on an object the caller has already serialized, the buffer is not copied
+    int64_t set(const uint8_t *data, size_t len, uint32_t new_slot = 0);
+    int64_t subfield(uint32_t parent_slot, uint32_t field_id, uint32_t new_slot = 0);
+    int64_t subarray(uint32_t parent_slot, uint32_t index, uint32_t new_slot = 0);
+    int64_t count(uint32_t slot) const;
+    int64_t size(uint32_t slot) const;
+    int64_t clear(uint32_t slot);
+
+    // the slot's value: payload of a field, the whole array for arrays, the buffer for roots
+    const uint8_t *data(uint32_t slot) const;
+    const Field *field(uint32_t slot) const;
+
+private:
+    struct Slot
+    {
+        std::shared_ptr<Index> index;
+        uint32_t node = 0;
+    };
+
+    int64_t place(uint32_t new_slot, const std::shared_ptr<Index> &index, uint32_t node);
+
+    Slot slots_[MAX_SLOTS + 1];
+};
+
+// a minimal serializer, fields must be written in canonical order
+class Writer
+{
+public:
+    std::vector<uint8_t> out;
+
+    void header(uint32_t code);
+    void uint(uint32_t code, uint64_t value, int bytes);
+    void bytes(uint32_t code, const uint8_t *p, size_t n);
+    void vl(uint32_t code, const uint8_t *p, size_t n);
+    void drops(uint32_t code, uint64_t value) { uint(code, 0x4000000000000000ULL | value, 8); }
+    // an IOU amount: 48 bytes, the value bits are not interpreted here
+    void iou(uint32_t code, uint64_t mantissa, int exponent, const char *currency, const uint8_t *issuer);
+    void begin(uint32_t code) { header(code); }
+    void end_object() { out.push_back(0xE1); }
+    void end_array() { out.push_back(0xF1); }
+};
+
+} // namespace sto
+
+#endif
@@ -0,0 +1,904 @@
+#include "txjson.h"
+
+#include "host/base58.h"
+#include "host/sha512.h"
+#include "host/stobject.h"
+#include "host/util.h"
+#include "sfcodes.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace txjson
+{
+
+namespace
+{
+
+constexpr int MAX_DEPTH = 64;
+
+struct Name
+{
+    const char *name;
+    int code;
+};
+
+const Name FIELDS[] = {
+    {"Account", sfAccount}, {"AccountHash", sfAccountHash}, {"AccountTxnID", sfAccountTxnID},
+    {"AffectedNodes", sfAffectedNodes}, {"Amendment", sfAmendment}, {"Amendments", sfAmendments},
+    {"Amount", sfAmount}, {"Authorize", sfAuthorize}, {"Balance", sfBalance}, {"BaseFee", sfBaseFee},
+    {"BondAmount", sfBondAmount}, {"BookDirectory", sfBookDirectory}, {"BookNode", sfBookNode},
+    {"BurnedNFTokens", sfBurnedNFTokens}, {"CancelAfter", sfCancelAfter}, {"Channel", sfChannel},
+    {"CheckID", sfCheckID}, {"ClearFlag", sfClearFlag}, {"CloseResolution", sfCloseResolution},
+    {"CloseTime", sfCloseTime}, {"Condition", sfCondition}, {"ConsensusHash", sfConsensusHash},
+    {"Cookie", sfCookie}, {"CreateCode", sfCreateCode}, {"CreatedNode", sfCreatedNode},
+    {"DeletedNode", sfDeletedNode}, {"DeliverMin", sfDeliverMin}, {"DeliveredAmount", sfDeliveredAmount},
+    {"Destination", sfDestination}, {"DestinationNode", sfDestinationNode}, {"DestinationTag", sfDestinationTag},
+    {"Digest", sfDigest}, {"DisabledValidator", sfDisabledValidator}, {"DisabledValidators", sfDisabledValidators},
+    {"Domain", sfDomain}, {"EmailHash", sfEmailHash}, {"EmitBurden", sfEmitBurden},
+    {"EmitCallback", sfEmitCallback}, {"EmitDetails", sfEmitDetails}, {"EmitGeneration", sfEmitGeneration},
+    {"EmitHookHash", sfEmitHookHash}, {"EmitNonce", sfEmitNonce}, {"EmitParentTxnID", sfEmitParentTxnID},
+    {"EmittedTxn", sfEmittedTxn}, {"ExchangeRate", sfExchangeRate}, {"Expiration", sfExpiration},
+    {"ExpireCode", sfExpireCode}, {"Fee", sfFee}, {"FinalFields", sfFinalFields}, {"FinishAfter", sfFinishAfter},
+    {"FirstLedgerSequence", sfFirstLedgerSequence}, {"Flags", sfFlags}, {"Fulfillment", sfFulfillment},
+    {"FundCode", sfFundCode}, {"Hashes", sfHashes}, {"HighLimit", sfHighLimit}, {"HighNode", sfHighNode},
+    {"HighQualityIn", sfHighQualityIn}, {"HighQualityOut", sfHighQualityOut}, {"Hook", sfHook},
+    {"HookAccount", sfHookAccount}, {"HookApiVersion", sfHookApiVersion}, {"HookCallbackFee", sfHookCallbackFee},
+    {"HookDefinition", sfHookDefinition}, {"HookEmitCount", sfHookEmitCount}, {"HookExecution", sfHookExecution},
+    {"HookExecutionIndex", sfHookExecutionIndex}, {"HookExecutions", sfHookExecutions}, {"HookGrant", sfHookGrant},
+    {"HookGrants", sfHookGrants}, {"HookHash", sfHookHash}, {"HookInstructionCount", sfHookInstructionCount},
+    {"HookNamespace", sfHookNamespace}, {"HookNamespaces", sfHookNamespaces}, {"HookOn", sfHookOn},
+    {"HookParameter", sfHookParameter}, {"HookParameterName", sfHookParameterName},
+    {"HookParameterValue", sfHookParameterValue}, {"HookParameters", sfHookParameters},
+    {"HookResult", sfHookResult}, {"HookReturnCode", sfHookReturnCode}, {"HookReturnString", sfHookReturnString},
+    {"HookSetTxnID", sfHookSetTxnID}, {"HookStateChangeCount", sfHookStateChangeCount},
+    {"HookStateCount", sfHookStateCount}, {"HookStateData", sfHookStateData}, {"HookStateKey", sfHookStateKey},
+    {"Hooks", sfHooks}, {"IndexNext", sfIndexNext}, {"IndexPrevious", sfIndexPrevious}, {"Indexes", sfIndexes},
+    {"InvoiceID", sfInvoiceID}, {"Issuer", sfIssuer}, {"LastLedgerSequence", sfLastLedgerSequence},
+    {"LedgerEntryType", sfLedgerEntryType}, {"LedgerHash", sfLedgerHash}, {"LedgerIndex", sfLedgerIndex},
+    {"LedgerSequence", sfLedgerSequence}, {"LimitAmount", sfLimitAmount}, {"LoadFee", sfLoadFee},
+    {"LowLimit", sfLowLimit}, {"LowNode", sfLowNode}, {"LowQualityIn", sfLowQualityIn},
+    {"LowQualityOut", sfLowQualityOut}, {"Majorities", sfMajorities}, {"Majority", sfMajority},
+    {"MasterSignature", sfMasterSignature}, {"Memo", sfMemo}, {"MemoData", sfMemoData},
+    {"MemoFormat", sfMemoFormat}, {"MemoType", sfMemoType}, {"Memos", sfMemos}, {"MessageKey", sfMessageKey},
+    {"Method", sfMethod}, {"MinimumOffer", sfMinimumOffer}, {"MintedNFTokens", sfMintedNFTokens},
+    {"ModifiedNode", sfModifiedNode}, {"NFToken", sfNFToken}, {"NFTokenBrokerFee", sfNFTokenBrokerFee},
+    {"NFTokenBuyOffer", sfNFTokenBuyOffer}, {"NFTokenID", sfNFTokenID}, {"NFTokenMinter", sfNFTokenMinter},
+    {"NFTokenOfferNode", sfNFTokenOfferNode}, {"NFTokenOffers", sfNFTokenOffers},
+    {"NFTokenSellOffer", sfNFTokenSellOffer}, {"NFTokenTaxon", sfNFTokenTaxon}, {"NFTokens", sfNFTokens},
+    {"Necessary", sfNecessary}, {"NewFields", sfNewFields}, {"NextPageMin", sfNextPageMin},
+    {"Nickname", sfNickname}, {"OfferSequence", sfOfferSequence}, {"OperationLimit", sfOperationLimit},
+    {"Owner", sfOwner}, {"OwnerCount", sfOwnerCount}, {"OwnerNode", sfOwnerNode},
+    {"ParentCloseTime", sfParentCloseTime}, {"ParentHash", sfParentHash}, {"Paths", sfPaths},
+    {"PreviousFields", sfPreviousFields}, {"PreviousPageMin", sfPreviousPageMin},
+    {"PreviousTxnID", sfPreviousTxnID}, {"PreviousTxnLgrSeq", sfPreviousTxnLgrSeq}, {"PublicKey", sfPublicKey},
+    {"QualityIn", sfQualityIn}, {"QualityOut", sfQualityOut}, {"ReferenceCount", sfReferenceCount},
+    {"ReferenceFeeUnits", sfReferenceFeeUnits}, {"RegularKey", sfRegularKey}, {"RemoveCode", sfRemoveCode},
+    {"ReserveBase", sfReserveBase}, {"ReserveIncrement", sfReserveIncrement}, {"RippleEscrow", sfRippleEscrow},
+    {"RootIndex", sfRootIndex}, {"SendMax", sfSendMax}, {"Sequence", sfSequence},
+    {"ServerVersion", sfServerVersion}, {"SetFlag", sfSetFlag}, {"SettleDelay", sfSettleDelay},
+    {"Signature", sfSignature}, {"Signer", sfSigner}, {"SignerEntries", sfSignerEntries},
+    {"SignerEntry", sfSignerEntry}, {"SignerListID", sfSignerListID}, {"SignerQuorum", sfSignerQuorum},
+    {"SignerWeight", sfSignerWeight}, {"Signers", sfSigners}, {"SigningPubKey", sfSigningPubKey},
+    {"SigningTime", sfSigningTime}, {"SourceTag", sfSourceTag}, {"StampEscrow", sfStampEscrow},
+    {"Sufficient", sfSufficient}, {"TakerGets", sfTakerGets}, {"TakerGetsCurrency", sfTakerGetsCurrency},
+    {"TakerGetsIssuer", sfTakerGetsIssuer}, {"TakerPays", sfTakerPays}, {"TakerPaysCurrency", sfTakerPaysCurrency},
+    {"TakerPaysIssuer", sfTakerPaysIssuer}, {"Template", sfTemplate}, {"TemplateEntry", sfTemplateEntry},
+    {"TickSize", sfTickSize}, {"TicketCount", sfTicketCount}, {"TicketSequence", sfTicketSequence},
+    {"TransactionHash", sfTransactionHash}, {"TransactionIndex", sfTransactionIndex},
+    {"TransactionMetaData", sfTransactionMetaData}, {"TransactionResult", sfTransactionResult},
+    {"TransactionType", sfTransactionType}, {"TransferFee", sfTransferFee}, {"TransferRate", sfTransferRate},
+    {"TxnSignature", sfTxnSignature}, {"UNLModifyDisabling", sfUNLModifyDisabling},
+    {"UNLModifyValidator", sfUNLModifyValidator}, {"URI", sfURI}, {"Unauthorize", sfUnauthorize},
+    {"ValidatedHash", sfValidatedHash}, {"ValidatorToDisable", sfValidatorToDisable},
+    {"ValidatorToReEnable", sfValidatorToReEnable}, {"Version", sfVersion}, {"WalletLocator", sfWalletLocator},
+    {"WalletSize", sfWalletSize},
+};
+
+const Name TRANSACTION_TYPES[] = {
+    {"Payment", 0}, {"EscrowCreate", 1}, {"EscrowFinish", 2}, {"AccountSet", 3}, {"EscrowCancel", 4},
+    {"SetRegularKey", 5}, {"OfferCreate", 7}, {"OfferCancel", 8}, {"TicketCreate", 10}, {"SignerListSet", 12},
+    {"PaymentChannelCreate", 13}, {"PaymentChannelFund", 14}, {"PaymentChannelClaim", 15}, {"CheckCreate", 16},
+    {"CheckCash", 17}, {"CheckCancel", 18}, {"DepositPreauth", 19}, {"TrustSet", 20}, {"AccountDelete", 21},
+    {"SetHook", 22}, {"NFTokenMint", 25}, {"NFTokenBurn", 26}, {"NFTokenCreateOffer", 27},
+    {"NFTokenCancelOffer", 28}, {"NFTokenAcceptOffer", 29}, {"Invoke", 99}, {"EnableAmendment", 100},
+    {"SetFee", 101}, {"UNLModify", 102},
+};
+
+const Name RESULTS[] = {
+    {"tesSUCCESS", 0}, {"tecCLAIM", 100}, {"tecPATH_PARTIAL", 101}, {"tecUNFUNDED_ADD", 102},
+    {"tecUNFUNDED_OFFER", 103}, {"tecUNFUNDED_PAYMENT", 104}, {"tecFAILED_PROCESSING", 105},
+    {"tecDIR_FULL", 121}, {"tecINSUF_RESERVE_LINE", 122}, {"tecINSUF_RESERVE_OFFER", 123}, {"tecNO_DST", 124},
+    {"tecNO_DST_INSUF_XRP", 125}, {"tecNO_LINE_INSUF_RESERVE", 126}, {"tecNO_LINE_REDUNDANT", 127},
+    {"tecPATH_DRY", 128}, {"tecUNFUNDED", 129}, {"tecNO_ALTERNATIVE_KEY", 130}, {"tecNO_REGULAR_KEY", 131},
+    {"tecOWNERS", 132}, {"tecNO_ISSUER", 133}, {"tecNO_AUTH", 134}, {"tecNO_LINE", 135}, {"tecINSUFF_FEE", 136},
+    {"tecFROZEN", 137}, {"tecNO_TARGET", 138}, {"tecNO_PERMISSION", 139}, {"tecNO_ENTRY", 140},
+    {"tecINSUFFICIENT_RESERVE", 141}, {"tecNEED_MASTER_KEY", 142}, {"tecDST_TAG_NEEDED", 143},
+    {"tecINTERNAL", 144}, {"tecOVERSIZE", 145}, {"tecCRYPTOCONDITION_ERROR", 146}, {"tecINVARIANT_FAILED", 147},
+    {"tecEXPIRED", 148}, {"tecDUPLICATE", 149}, {"tecKILLED", 150}, {"tecHAS_OBLIGATIONS", 151},
+    {"tecTOO_SOON", 152}, {"tecHOOK_REJECTED", 153},
+};
+
+template <size_t N>
+int lookup(const Name (&table)[N], const std::string &name)
+{
+    for (const Name &n : table)
+        if (name == n.name)
+            return n.code;
+    return -1;
+}
+
+int field_code(const std::string &name)
+{
+    static const std::unordered_map<std::string, int> codes = [] {
+        std::unordered_map<std::string, int> m;
+        for (const Name &n : FIELDS)
+            m[n.name] = n.code;
+        return m;
+    }();
+    auto it = codes.find(name);
+    return it == codes.end() ? -1 : it->second;
+}
+
+// decimal digits only, at most max
+bool to_uint(const std::string &text, uint64_t max, uint64_t &out)
+{
+    if (text.empty() || text.size() > 20)
+        return false;
+    out = 0;
+    for (char c : text)
+    {
+        if (c < '0' || c > '9' || out > (max - (uint64_t)(c - '0')) / 10)
+            return false;
+        out = out * 10 + (uint64_t)(c - '0');
+    }
+    return true;
+}
+
+// a number, or a string of digits as ledger_index sometimes is
+bool number(const Value *v, uint64_t max, uint64_t &out)
+{
+    return v && (v->kind == Value::NUMBER || v->kind == Value::STRING) && to_uint(v->text, max, out);
+}
+
+class Parser
+{
+public:
+    Parser(const char *p, size_t n) : start_(p), p_(p), end_(p + n) {}
+
+    bool parse(std::vector<Value> &out, std::string &error)
+    {
+        for (skip(); p_ < end_; skip())
+        {
+            out.emplace_back();
+            if (!value(out.back(), 0))
+            {
+                error = error_ + " at byte " + std::to_string(p_ - start_);
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    void skip()
+    {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r'))
+            ++p_;
+    }
+
+    bool fail(const char *what)
+    {
+        error_ = what;
+        return false;
+    }
+
+    bool literal(const char *word)
+    {
+        size_t n = std::strlen(word);
+        if ((size_t)(end_ - p_) < n || std::memcmp(p_, word, n) != 0)
+            return fail("bad literal");
+        p_ += n;
+        return true;
+    }
+
+    bool value(Value &v, int depth)
+    {
+        if (depth > MAX_DEPTH)
+            return fail("nesting too deep");
+        skip();
+        if (p_ == end_)
+            return fail("unexpected end");
+        char c = *p_;
+        if (c == '{')
+            return object(v, depth);
+        if (c == '[')
+            return array(v, depth);
+        if (c == '"')
+        {
+            v.kind = Value::STRING;
+            return string(v.text);
+        }
+        if (c == 't' || c == 'f')
+        {
+            v.kind = Value::BOOL;
+            v.text = c == 't' ? "true" : "false";
+            return literal(v.text.c_str());
+        }
+        if (c == 'n')
+        {
+            v.kind = Value::NUL;
+            return literal("null");
+        }
+        const char *start = p_;
+        while (p_ < end_ && (std::strchr("+-.eE", *p_) || (*p_ >= '0' && *p_ <= '9')))
+            ++p_;
+        if (p_ == start)
+            return fail("unexpected character");
+        v.kind = Value::NUMBER;
+        v.text.assign(start, p_);
+        return true;
+    }
+
+    bool object(Value &v, int depth)
+    {
+        v.kind = Value::OBJECT;
+        ++p_;
+        skip();
+        if (p_ < end_ && *p_ == '}')
+        {
+            ++p_;
+            return true;
+        }
+        for (;;)
+        {
+            skip();
+            v.members.emplace_back();
+            if (p_ == end_ || *p_ != '"' || !string(v.members.back().first))
+                return fail("expected a member name");
+            skip();
+            if (p_ == end_ || *p_++ != ':')
+                return fail("expected ':'");
+            if (!value(v.members.back().second, depth + 1))
+                return false;
+            skip();
+            if (p_ < end_ && *p_ == ',')
+                ++p_;
+            else if (p_ < end_ && *p_ == '}')
+            {
+                ++p_;
+                return true;
+            }
+            else
+                return fail("expected ',' or '}'");
+        }
+    }
+
+    bool array(Value &v, int depth)
+    {
+        v.kind = Value::ARRAY;
+        ++p_;
+        skip();
+        if (p_ < end_ && *p_ == ']')
+        {
+            ++p_;
+            return true;
+        }
+        for (;;)
+        {
+            v.items.emplace_back();
+            if (!value(v.items.back(), depth + 1))
+                return false;
+            skip();
+            if (p_ < end_ && *p_ == ',')
+                ++p_;
+            else if (p_ < end_ && *p_ == ']')
+            {
+                ++p_;
+                return true;
+            }
+            else
+                return fail("expected ',' or ']'");
+        }
+    }
+
+    bool hex4(uint32_t &out)
+    {
+        if (end_ - p_ < 4)
+            return fail("bad \\u escape");
+        out = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            int d = util::hex_digit(*p_++);
+            if (d < 0)
+                return fail("bad \\u escape");
+            out = out << 4 | (uint32_t)d;
+        }
+        return true;
+    }
+
+    bool string(std::string &out)
+    {
+        ++p_;
+        out.clear();
+        while (p_ < end_ && *p_ != '"')
+        {
+            char c = *p_++;
+            if (c != '\\')
+            {
+                out.push_back(c);
+                continue;
+            }
+            if (p_ == end_)
+                break;
+            c = *p_++;
+            switch (c)
+            {
+            case 'b':
+                out.push_back('\b');
+                break;
+            case 'f':
+                out.push_back('\f');
+                break;
+            case 'n':
+                out.push_back('\n');
+                break;
+            case 'r':
+                out.push_back('\r');
+                break;
+            case 't':
+                out.push_back('\t');
+                break;
+            case 'u':
+            {
+                uint32_t cp, low;
+                if (!hex4(cp))
+                    return false;
+                if (cp >= 0xD800 && cp < 0xDC00)
+                {
+                    if (end_ - p_ < 2 || p_[0] != '\\' || p_[1] != 'u')
+                        return fail("unpaired surrogate");
+                    p_ += 2;
+                    if (!hex4(low) || low < 0xDC00 || low >= 0xE000)
+                        return fail("unpaired surrogate");
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                // UTF-8
+                if (cp < 0x80)
+                    out.push_back((char)cp);
+                else if (cp < 0x800)
+                {
+                    out.push_back((char)(0xC0 | cp >> 6));
+                    out.push_back((char)(0x80 | (cp & 0x3F)));
+                }
+                else if (cp < 0x10000)
+                {
+                    out.push_back((char)(0xE0 | cp >> 12));
+                    out.push_back((char)(0x80 | (cp >> 6 & 0x3F)));
+                    out.push_back((char)(0x80 | (cp & 0x3F)));
+                }
+                else
+                {
+                    out.push_back((char)(0xF0 | cp >> 18));
+                    out.push_back((char)(0x80 | (cp >> 12 & 0x3F)));
+                    out.push_back((char)(0x80 | (cp >> 6 & 0x3F)));
+                    out.push_back((char)(0x80 | (cp & 0x3F)));
+                }
+                break;
+            }
+            default: // \" \\ \/
+                out.push_back(c);
+                break;
+            }
+        }
+        if (p_ == end_)
+            return fail("unterminated string");
+        ++p_;
+        return true;
+    }
+
+    const char *start_;
+    const char *p_;
+    const char *end_;
+    std::string error_;
+};
+
+// a 3 letter code or 40 hex digits; XRP only where allowed (paths)
+bool currency(const std::string &text, bool allow_xrp, uint8_t out[20])
+{
+    std::memset(out, 0, 20);
+    if (text.size() == 3)
+    {
+        if (text == "XRP")
+            return allow_xrp;
+        std::memcpy(out + 12, text.data(), 3);
+        return true;
+    }
+    std::vector<uint8_t> bin;
+    if (!util::from_hex(text, bin) || bin.size() != 20)
+        return false;
+    std::memcpy(out, bin.data(), 20);
+    return true;
+}
+
+// an IOU value to mantissa and exponent, truncated to 16 significant digits
+bool decimal(const std::string &text, bool &negative, uint64_t &mantissa, int &exponent)
+{
+    size_t i = 0, n = text.size();
+    negative = i < n && text[i] == '-';
+    if (i < n && (text[i] == '-' || text[i] == '+'))
+        ++i;
+    mantissa = 0;
+    exponent = 0;
+    bool digits = false, point = false;
+    for (; i < n; ++i)
+    {
+        char c = text[i];
+        if (c == '.' && !point)
+            point = true;
+        else if (c >= '0' && c <= '9')
+        {
+            digits = true;
+            if (mantissa < 100000000000000000ULL)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(c - '0');
+                exponent -= point;
+            }
+            else
+                exponent += !point;
+        }
+        else
+            break;
+    }
+    if (!digits)
+        return false;
+    if (i < n && (text[i] == 'e' || text[i] == 'E'))
+    {
+        ++i;
+        bool minus = i < n && text[i] == '-';
+        if (i < n && (text[i] == '-' || text[i] == '+'))
+            ++i;
+        uint64_t e;
+        if (!to_uint(text.substr(i), 1000, e))
+            return false;
+        exponent += minus ? -(int)e : (int)e;
+        i = n;
+    }
+    if (i != n)
+        return false;
+    if (mantissa == 0)
+        return true;
+    while (mantissa < 1000000000000000ULL)
+    {
+        mantissa *= 10;
+        --exponent;
+    }
+    while (mantissa >= 10000000000000000ULL)
+    {
+        mantissa /= 10;
+        ++exponent;
+    }
+    if (exponent > 80)
+        return false;
+    if (exponent < -96)
+        mantissa = 0;
+    return true;
+}
+
+bool amount(sto::Writer &w, uint32_t code, const Value &v, std::string &error)
+{
+    if (v.kind == Value::STRING || v.kind == Value::NUMBER)
+    {
+        bool negative = !v.text.empty() && v.text[0] == '-';
+        uint64_t drops;
+        if (!to_uint(v.text.substr(negative), 100000000000000000ULL, drops))
+        {
+            error = "bad XRP amount " + v.text;
+            return false;
+        }
+        w.uint(code, negative ? drops : 0x4000000000000000ULL | drops, 8);
+        return true;
+    }
+    const Value *value = v.get("value"), *cur = v.get("currency"), *issuer = v.get("issuer");
+    bool negative;
+    uint64_t mantissa;
+    int exponent;
+    uint8_t c[20], account[20];
+    if (v.kind != Value::OBJECT || !value || !cur || !issuer || cur->kind != Value::STRING ||
+        issuer->kind != Value::STRING || !decimal(value->text, negative, mantissa, exponent) ||
+        !currency(cur->text, false, c) || !base58::decode_account(issuer->text.data(), issuer->text.size(), account))
+    {
+        error = "bad issued amount";
+        return false;
+    }
+    uint64_t bits = 0x8000000000000000ULL;
+    if (mantissa)
+        bits = (negative ? 0x8000000000000000ULL : 0xC000000000000000ULL) | (uint64_t)(exponent + 97) << 54 | mantissa;
+    w.uint(code, bits, 8);
+    w.out.insert(w.out.end(), c, c + 20);
+    w.out.insert(w.out.end(), account, account + 20);
+    return true;
+}
+
+// steps are type bits and their fields, 0xFF between paths and 0x00 at the end
+bool pathset(sto::Writer &w, uint32_t code, const Value &v, std::string &error)
+{
+    error = "bad Paths";
+    if (v.kind != Value::ARRAY)
+        return false;
+    w.header(code);
+    for (size_t p = 0; p < v.items.size(); ++p)
+    {
+        const Value &path = v.items[p];
+        if (path.kind != Value::ARRAY)
+            return false;
+        if (p)
+            w.out.push_back(0xFF);
+        for (const Value &step : path.items)
+        {
+            const Value *account = step.get("account"), *cur = step.get("currency"), *issuer = step.get("issuer");
+            uint8_t type = (account ? 0x01 : 0) | (cur ? 0x10 : 0) | (issuer ? 0x20 : 0);
+            uint8_t bin[3][20];
+            if (step.kind != Value::OBJECT || !type ||
+                (account && (account->kind != Value::STRING ||
+                             !base58::decode_account(account->text.data(), account->text.size(), bin[0]))) ||
+                (cur && (cur->kind != Value::STRING || !currency(cur->text, true, bin[1]))) ||
+                (issuer && (issuer->kind != Value::STRING ||
+                            !base58::decode_account(issuer->text.data(), issuer->text.size(), bin[2]))))
+                return false;
+            w.out.push_back(type);
+            for (int i = 0; i < 3; ++i)
+                if (type & (i == 0 ? 0x01 : i == 1 ? 0x10 : 0x20))
+                    w.out.insert(w.out.end(), bin[i], bin[i] + 20);
+        }
+    }
+    w.out.push_back(0x00);
+    return true;
+}
+
+bool object(sto::Writer &w, const Value &v, std::string &error, int depth);
+
+bool field(sto::Writer &w, uint32_t code, const std::string &name, const Value &v, std::string &error, int depth)
+{
+    uint32_t type = code >> 16;
+    uint64_t n;
+    std::vector<uint8_t> bin;
+    switch (type)
+    {
+    case sto::STI_UINT8:
+    case sto::STI_UINT16:
+    case sto::STI_UINT32:
+    {
+        int bytes = type == sto::STI_UINT8 ? 1 : type == sto::STI_UINT16 ? 2 : 4;
+        int named = v.kind != Value::STRING                ? -1
+                    : code == (uint32_t)sfTransactionType   ? transaction_type(v.text)
+                    : code == (uint32_t)sfTransactionResult ? result_code(v.text)
+                                                            : -1;
+        if (named >= 0)
+            n = (uint64_t)named;
+        else if (!number(&v, (1ULL << (8 * bytes)) - 1, n))
+            break;
+        w.uint(code, n, bytes);
+        return true;
+    }
+    case sto::STI_UINT64:
+        if (v.kind != Value::STRING || v.text.empty() || v.text.size() > 16 ||
+            !util::from_hex(std::string(v.text.size() % 2, '0') + v.text, bin))
+            break;
+        n = 0;
+        for (uint8_t b : bin)
+            n = n << 8 | b;
+        w.uint(code, n, 8);
+        return true;
+    case sto::STI_UINT128:
+    case sto::STI_UINT160:
+    case sto::STI_UINT256:
+    {
+        size_t size = type == sto::STI_UINT128 ? 16 : type == sto::STI_UINT160 ? 20 : 32;
+        if (v.kind != Value::STRING || !util::from_hex(v.text, bin) || bin.size() != size)
+            break;
+        w.bytes(code, bin.data(), size);
+        return true;
+    }
+    case sto::STI_AMOUNT:
+        return amount(w, code, v, error);
+    case sto::STI_VL:
+        if (v.kind != Value::STRING || !util::from_hex(v.text, bin))
+            break;
+        w.vl(code, bin.data(), bin.size());
+        return true;
+    case sto::STI_ACCOUNT:
+    {
+        uint8_t id[20];
+        if (v.kind != Value::STRING || !base58::decode_account(v.text.data(), v.text.size(), id))
+            break;
+        w.vl(code, id, sizeof(id));
+        return true;
+    }
+    case sto::STI_OBJECT:
+        if (v.kind != Value::OBJECT)
+            break;
+        w.begin(code);
+        if (!object(w, v, error, depth + 1))
+            return false;
+        w.end_object();
+        return true;
+    case sto::STI_ARRAY:
+        if (v.kind != Value::ARRAY)
+            break;
+        w.begin(code);
+        // every element is {"InnerObjectName": {...}}
+        for (const Value &e : v.items)
+        {
+            int inner = e.kind == Value::OBJECT && e.members.size() == 1 ? field_code(e.members[0].first) : -1;
+            if (inner < 0 || (uint32_t)inner >> 16 != sto::STI_OBJECT ||
+                !field(w, (uint32_t)inner, e.members[0].first, e.members[0].second, error, depth + 1))
+            {
+                if (error.empty())
+                    error = "bad element of " + name;
+                return false;
+            }
+        }
+        w.end_array();
+        return true;
+    case sto::STI_PATHSET:
+        return pathset(w, code, v, error);
+    case sto::STI_VECTOR256:
+    {
+        if (v.kind != Value::ARRAY)
+            break;
+        std::vector<uint8_t> all, one;
+        for (const Value &h : v.items)
+        {
+            if (h.kind != Value::STRING || !util::from_hex(h.text, one) || one.size() != 32)
+            {
+                error = "bad value for " + name;
+                return false;
+            }
+            all.insert(all.end(), one.begin(), one.end());
+        }
+        w.vl(code, all.data(), all.size());
+        return true;
+    }
+    default:
+        error = "unsupported field " + name;
+        return false;
+    }
+    error = "bad value for " + name;
+    return false;
+}
+
+// the fields of an object in canonical order, without its header or end marker
+bool object(sto::Writer &w, const Value &v, std::string &error, int depth)
+{
+    if (depth > MAX_DEPTH)
+    {
+        error = "nesting too deep";
+        return false;
+    }
+    struct Item
+    {
+        uint32_t code;
+        const std::string *name;
+        const Value *value;
+    };
+    std::vector<Item> items;
+    bool amount = v.get("Amount") != nullptr;
+    for (const auto &m : v.members)
+    {
+        const std::string &name = m.first;
+        // the APIs add lowercase keys, and DeliverMax replaces Amount in API v2
+        if (name.empty() || (name[0] >= 'a' && name[0] <= 'z') || (name == "DeliverMax" && amount))
+            continue;
+        int code = name == "DeliverMax" ? (int)sfAmount : field_code(name);
+        if (code < 0)
+        {
+            error = "unknown field " + name;
+            return false;
+        }
+        items.push_back({(uint32_t)code, &name, &m.second});
+    }
+    std::sort(items.begin(), items.end(), [](const Item &a, const Item &b) { return a.code < b.code; });
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        if (i && items[i].code == items[i - 1].code)
+        {
+            error = "duplicate field " + *items[i].name;
+            return false;
+        }
+        if (!field(w, items[i].code, *items[i].name, *items[i].value, error, depth))
+            return false;
+    }
+    return true;
+}
+
+struct Scope
+{
+    uint32_t ledger_seq = 0;
+    uint32_t close_time = 0;
+};
+
+void enter(const Value &v, Scope &s)
+{
+    uint64_t n;
+    if (number(v.get("ledger_index"), UINT32_MAX, n))
+        s.ledger_seq = (uint32_t)n;
+    if (number(v.get("close_time"), UINT32_MAX, n) || number(v.get("date"), UINT32_MAX, n))
+        s.close_time = (uint32_t)n;
+}
+
+bool metadata(const Value *meta, Transaction &t, std::string &error)
+{
+    if (!meta || meta->kind == Value::NUL)
+        return true;
+    if (meta->kind == Value::OBJECT)
+    {
+        const Value *result = meta->get("TransactionResult");
+        uint64_t index;
+        if (result)
+        {
+            int code = result->kind == Value::STRING ? result_code(result->text) : -1;
+            if (code < 0)
+            {
+                error = "unknown result " + result->text;
+                return false;
+            }
+            t.result = (uint8_t)code;
+        }
+        if (number(meta->get("TransactionIndex"), UINT32_MAX, index))
+            t.index = (uint32_t)index;
+        return true;
+    }
+    std::vector<uint8_t> bin;
+    sto::Index m;
+    if (meta->kind != Value::STRING || !util::from_hex(meta->text, bin) || !m.parse(bin.data(), bin.size()))
+    {
+        error = "malformed metadata";
+        return false;
+    }
+    uint32_t r = m.find(sto::Index::ROOT, sfTransactionResult), i = m.find(sto::Index::ROOT, sfTransactionIndex);
+    if (r != sto::Index::NOT_FOUND && m.field(r).payload_size == 1)
+        t.result = m.payload(r)[0];
+    if (i != sto::Index::NOT_FOUND && m.field(i).payload_size == 4)
+    {
+        const uint8_t *p = m.payload(i);
+        t.index = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+    }
+    return true;
+}
+
+// checks the blob against a transaction hash, when one is given
+bool verify(const Transaction &t, const Value *hash, std::string &error)
+{
+    std::vector<uint8_t> expected;
+    if (!hash || hash->kind != Value::STRING || !util::from_hex(hash->text, expected) ||
+        expected.size() != sha512::HALF_SIZE)
+        return true;
+    static const uint8_t prefix[4] = {'T', 'X', 'N', 0};
+    sha512::Context ctx;
+    uint8_t digest[sha512::DIGEST_SIZE];
+    ctx.update(prefix, sizeof(prefix));
+    ctx.update(t.blob.data(), t.blob.size());
+    ctx.finish(digest);
+    if (std::memcmp(digest, expected.data(), sha512::HALF_SIZE) != 0)
+    {
+        error = "serialization does not match hash " + hash->text;
+        return false;
+    }
+    return true;
+}
+
+bool visit(const Value &v, Scope scope, std::vector<Transaction> &out, std::string &error, int depth)
+{
+    if (depth > MAX_DEPTH)
+        return true;
+    if (v.kind == Value::ARRAY)
+    {
+        for (const Value &item : v.items)
+            if (!visit(item, scope, out, error, depth + 1))
+                return false;
+        return true;
+    }
+    if (v.kind != Value::OBJECT)
+        return true;
+    enter(v, scope);
+
+    const Value *blob = v.get("tx_blob"), *tx = v.get("tx_json");
+    if (!tx)
+        tx = v.get("tx");
+    if (tx && tx->kind != Value::OBJECT)
+        tx = nullptr;
+    if (v.get("TransactionType"))
+        tx = &v;
+    else if (tx)
+        enter(*tx, scope);
+    else if (!blob || blob->kind != Value::STRING)
+    {
+        for (const auto &m : v.members)
+            if (!visit(m.second, scope, out, error, depth + 1))
+                return false;
+        return true;
+    }
+
+    Transaction t;
+    t.ledger_seq = scope.ledger_seq;
+    t.close_time = scope.close_time;
+    const Value *meta = v.get("meta"), *hash = v.get("hash");
+    if (!meta)
+        meta = v.get("metaData");
+    if (tx && tx != &v)
+    {
+        if (!meta)
+            meta = tx->get("meta") ? tx->get("meta") : tx->get("metaData");
+        if (!hash)
+            hash = tx->get("hash");
+    }
+    sto::Index parsed;
+    if (tx)
+    {
+        sto::Writer w;
+        if (!object(w, *tx, error, 0))
+            return false;
+        t.blob = std::move(w.out);
+    }
+    else if (!util::from_hex(blob->text, t.blob) || !parsed.parse(t.blob.data(), t.blob.size()))
+    {
+        error = "malformed tx_blob";
+        return false;
+    }
+    if (tx ? tx->get("EmitDetails") != nullptr : parsed.find(sto::Index::ROOT, sfEmitDetails) != sto::Index::NOT_FOUND)
+        t.flags |= corpus::EMITTED;
+    if (!metadata(meta, t, error) || !verify(t, hash, error))
+        return false;
+    out.push_back(std::move(t));
+    return true;
+}
+
+} // namespace
+
+const Value *Value::get(const char *name) const
+{
+    for (const auto &m : members)
+        if (m.first == name)
+            return &m.second;
+    return nullptr;
+}
+
+bool parse(const char *text, size_t len, std::vector<Value> &out, std::string &error)
+{
+    return Parser(text, len).parse(out, error);
+}
+
+bool serialize(const Value &tx, std::vector<uint8_t> &out, std::string &error)
+{
+    if (tx.kind != Value::OBJECT)
+    {
+        error = "not an object";
+        return false;
+    }
+    sto::Writer w;
+    if (!object(w, tx, error, 0))
+        return false;
+    out = std::move(w.out);
+    return true;
+}
+
+bool extract(const Value &doc, std::vector<Transaction> &out, std::string &error)
+{
+    return visit(doc, Scope(), out, error, 0);
+}
+
+int transaction_type(const std::string &name) { return lookup(TRANSACTION_TYPES, name); }
+
+int result_code(const std::string &name) { return lookup(RESULTS, name); }
+
+const char *result_name(int code)
+{
+    for (const Name &n : RESULTS)
+        if (n.code == code)
+            return n.name;
+    return nullptr;
+}
+
+} // namespace txjson
@@ -0,0 +1,87 @@
+/**
+ * XRPL JSON transactions to their binary serialization, for building corpora
+ * from recorded traffic.
+ *
+ * parse() reads a JSON document, or several written one after another (JSON
+ * lines). serialize() writes a transaction object in canonical field order:
+ * every field of lib/sfcodes.h is known by name, amounts are XRP drop strings
+ * or {currency, issuer, value} objects, UInt64 fields and blobs are hex,
+ * accounts are r-addresses, TransactionType and TransactionResult are names.
+ * Lowercase keys the APIs add (hash, meta, ledger_index, date ...) are
+ * skipped and DeliverMax stands in for a missing Amount.
+ *
+ * extract() finds the transactions in the shapes the XRPL APIs return them:
+ * objects with TransactionType (tx, ledger with expanded transactions), with
+ * tx or tx_json (account_tx, API v1 and v2) and with tx_blob (binary
+ * responses). Metadata next to them, as an object or hex, gives the expected
+ * result and transaction index; ledger_index and close_time or date come from
+ * the closest enclosing object that has them. When a hash is given the
+ * serialization is checked against it.
+ *
+ * Build: g++ -std=c++17 -O2 -Ilib -Itools -c tools/host/txjson.cpp tools/host/stobject.cpp tools/host/base58.cpp
+ *        tools/host/sha256.cpp tools/host/sha512.cpp
+ */
+
+#ifndef HOST_TXJSON_H
+#define HOST_TXJSON_H
+
+#include "host/corpus.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace txjson
+{
+
+struct Value
+{
+    enum Kind
+    {
+        NUL,
+        BOOL,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    Kind kind = NUL;
+    // strings unescaped, numbers and booleans as written
+    std::string text;
+    std::vector<Value> items;
+    std::vector<std::pair<std::string, Value>> members;
+
+    // member of an object, nullptr when absent
+    const Value *get(const char *name) const;
+};
+
+// appends every top-level value, false with a message at the first syntax error
+bool parse(const char *text, size_t len, std::vector<Value> &out, std::string &error);
+
+bool serialize(const Value &tx, std::vector<uint8_t> &out, std::string &error);
+
+struct Transaction
+{
+    std::vector<uint8_t> blob;
+    uint32_t ledger_seq = 0;
+    uint32_t close_time = 0;
+    uint32_t index = corpus::INDEX_UNKNOWN;
+    uint8_t result = corpus::RESULT_UNKNOWN;
+    uint8_t flags = 0;
+};
+
+// appends the transactions found in a document, in document order
+bool extract(const Value &doc, std::vector<Transaction> &out, std::string &error);
+
+// codes by name, -1 when unknown
+int transaction_type(const std::string &name);
+int result_code(const std::string &name);
+// the name of a result code, nullptr when unknown
+const char *result_name(int code);
+
+} // namespace txjson
+
+#endif
@@ -0,0 +1,83 @@
+#include "util.h"
+
+#include <fstream>
+#include <iterator>
+
+namespace util
+{
+
+bool read_file(const std::string &path, std::vector<uint8_t> &out)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+bool from_hex(const char *text, size_t len, std::vector<uint8_t> &out)
+{
+    out.clear();
+    if (len % 2)
+        return false;
+    out.reserve(len / 2);
+    for (size_t i = 0; i < len; i += 2)
+    {
+        int h = hex_digit(text[i]), l = hex_digit(text[i + 1]);
+        if (h < 0 || l < 0)
+            return false;
+        out.push_back((uint8_t)(h << 4 | l));
+    }
+    return true;
+}
+
+bool from_hex(const std::string &text, std::vector<uint8_t> &out)
+{
+    return from_hex(text.data(), text.size(), out);
+}
+
+std::string to_hex(const uint8_t *p, size_t n)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    std::string out;
+    out.reserve(2 * n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        out.push_back(digits[p[i] >> 4]);
+        out.push_back(digits[p[i] & 15]);
+    }
+    return out;
+}
+
+bool split(const std::string &arg, std::string &name, std::string &value)
+{
+    size_t eq = arg.find('=');
+    if (eq == std::string::npos || eq == 0 || eq + 1 == arg.size())
+        return false;
+    name = arg.substr(0, eq);
+    value = arg.substr(eq + 1);
+    return true;
+}
+
+bool selected(const std::string &name, const std::vector<std::string> &filters)
+{
+    if (filters.empty())
+        return true;
+    for (const std::string &f : filters)
+        if (name.compare(0, f.size(), f) == 0)
+            return true;
+    return false;
+}
+
+} // namespace util
@@ -0,0 +1,48 @@
+/**
+ * Small helpers shared by the tools: whole-file reads, hex in both directions,
+ * NAME=VALUE option splitting, name prefix filters and wall-clock timing.
+ *
+ * Build: g++ -std=c++17 -O2 -Itools -c tools/host/util.cpp
+ */
+
+#ifndef HOST_UTIL_H
+#define HOST_UTIL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace util
+{
+
+// the whole file, false when it cannot be opened
+bool read_file(const std::string &path, std::vector<uint8_t> &out);
+
+// 0-15, or -1 when c is not a hex digit
+int hex_digit(char c);
+// an even number of hex digits, either case; false (and out undefined) otherwise
+bool from_hex(const char *text, size_t len, std::vector<uint8_t> &out);
+bool from_hex(const std::string &text, std::vector<uint8_t> &out);
+// upper case
+std::string to_hex(const uint8_t *p, size_t n);
+
+// NAME=VALUE split at the first =, false when either side is empty
+bool split(const std::string &arg, std::string &name, std::string &value);
+
+// true when name starts with one of the filters, or there are none
+bool selected(const std::string &name, const std::vector<std::string> &filters);
+
+// wall-clock seconds f() takes
+template <class F>
+double seconds(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace util
+
+#endif
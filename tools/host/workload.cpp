@@ -0,0 +1,72 @@
+#include "workload.h"
+
+#include "host/util.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace workload
+{
+
+bool read(std::istream &in, const std::string &name, std::vector<Item> &items, std::string &error)
+{
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number)
+    {
+        std::istringstream fields(line);
+        std::string ledger, blob, extra;
+        if (!(fields >> ledger) || ledger[0] == '#')
+            continue;
+        char *end;
+        unsigned long offset = strtoul(ledger.c_str(), &end, 10);
+        Item item{(uint32_t)offset, {}};
+        if (*end || !(fields >> blob) || (fields >> extra) || !util::from_hex(blob, item.blob) || item.blob.empty())
+        {
+            error = name + ":" + std::to_string(number) + ": malformed workload line";
+            return false;
+        }
+        items.push_back(std::move(item));
+    }
+    return true;
+}
+
+void read(const corpus::Corpus &c, std::vector<Item> &items)
+{
+    bool started = false;
+    uint32_t base = 0;
+    for (corpus::Record r : c)
+    {
+        if (!started)
+            base = r.ledger_seq;
+        started = true;
+        uint32_t offset = r.ledger_seq - std::min(base, r.ledger_seq);
+        if (!r.emitted())
+            items.push_back(Item{offset, std::vector<uint8_t>(r.blob, r.blob + r.size)});
+    }
+}
+
+bool load(const std::string &path, std::vector<Item> &items, std::string &error)
+{
+    if (path.empty() || path == "-")
+        return read(std::cin, "<stdin>", items, error);
+    if (corpus::is_corpus(path))
+    {
+        corpus::Corpus c;
+        if (!c.open(path, error))
+            return false;
+        read(c, items);
+        return true;
+    }
+    std::ifstream in(path);
+    if (!in)
+    {
+        error = "cannot read " + path;
+        return false;
+    }
+    return read(in, path, items, error);
+}
+
+} // namespace workload
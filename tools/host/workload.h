@@ -0,0 +1,42 @@
+/**
+ * Workloads for the tools that drive hooks through ledgers (ledger_sim,
+ * hook_replay, state_footprint).
+ *
+ * A workload is either text, one LEDGER HEX line per transaction (the ledger
+ * as an offset from the first one, the serialized transaction in hex, blank
+ * lines and lines starting with # skipped), or a tools/host/corpus file, whose
+ * ledgers are taken relative to the first record's and whose emitted records
+ * are skipped since the hooks emit them again.
+ *
+ * Build: g++ -std=c++17 -O2 -Itools -c tools/host/workload.cpp
+ */
+
+#ifndef HOST_WORKLOAD_H
+#define HOST_WORKLOAD_H
+
+#include "host/corpus.h"
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace workload
+{
+
+struct Item
+{
+    uint32_t offset; // ledgers after the first
+    std::vector<uint8_t> blob;
+};
+
+// the lines of a text workload, false at the first malformed one, error naming it as name:line
+bool read(std::istream &in, const std::string &name, std::vector<Item> &items, std::string &error);
+// the originating transactions of a corpus
+void read(const corpus::Corpus &c, std::vector<Item> &items);
+// a corpus or text file, standard input when path is empty or "-"
+bool load(const std::string &path, std::vector<Item> &items, std::string &error);
+
+} // namespace workload
+
+#endif
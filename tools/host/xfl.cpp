@@ -0,0 +1,867 @@
+#include "xfl.h"
+
+#include "error.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace xfl
+{
+
+namespace
+{
+
+constexpr uint64_t POW10[20] = {1ULL,
+                                10ULL,
+                                100ULL,
+                                1000ULL,
+                                10000ULL,
+                                100000ULL,
+                                1000000ULL,
+                                10000000ULL,
+                                100000000ULL,
+                                1000000000ULL,
+                                10000000000ULL,
+                                100000000000ULL,
+                                1000000000000ULL,
+                                10000000000000ULL,
+                                100000000000000ULL,
+                                1000000000000000ULL,
+                                10000000000000000ULL,
+                                100000000000000000ULL,
+                                1000000000000000000ULL,
+                                10000000000000000000ULL};
+
+// rippled's IOUAmount: signed mantissa, zero is (0, -100)
+struct Iou
+{
+    int64_t mantissa = 0;
+    int32_t exponent = -100;
+    bool overflow = false;
+
+    Iou() = default;
+    Iou(int64_t m, int32_t e) : mantissa(m), exponent(e) { normalize(); }
+
+    bool zero() const { return mantissa == 0; }
+
+    void normalize()
+    {
+        if (mantissa == 0)
+        {
+            *this = Iou();
+            return;
+        }
+        bool negative = mantissa < 0;
+        if (negative)
+            mantissa = -mantissa;
+        while ((uint64_t)mantissa < MIN_MANTISSA && exponent > MIN_EXPONENT)
+        {
+            mantissa *= 10;
+            --exponent;
+        }
+        while ((uint64_t)mantissa > MAX_MANTISSA)
+        {
+            if (exponent >= MAX_EXPONENT)
+            {
+                overflow = true;
+                return;
+            }
+            mantissa /= 10;
+            ++exponent;
+        }
+        if (exponent < MIN_EXPONENT || (uint64_t)mantissa < MIN_MANTISSA)
+        {
+            *this = Iou();
+            return;
+        }
+        if (exponent > MAX_EXPONENT)
+        {
+            overflow = true;
+            return;
+        }
+        if (negative)
+            mantissa = -mantissa;
+    }
+
+    Iou &operator+=(const Iou &other)
+    {
+        if (other.zero())
+            return *this;
+        if (zero())
+            return *this = other;
+        int64_t m = other.mantissa;
+        int32_t e = other.exponent;
+        // past 19 digits the shifted side is 0, exactly as the loop would leave it
+        if (e - exponent > 19)
+        {
+            mantissa = 0;
+            exponent = e;
+        }
+        if (exponent - e > 19)
+        {
+            m = 0;
+            e = exponent;
+        }
+        while (exponent < e)
+        {
+            mantissa /= 10;
+            ++exponent;
+        }
+        while (e < exponent)
+        {
+            m /= 10;
+            ++e;
+        }
+        mantissa += m;
+        if (mantissa >= -10 && mantissa <= 10)
+        {
+            *this = Iou();
+            return *this;
+        }
+        normalize();
+        return *this;
+    }
+};
+
+// IOUAmount::operator<
+bool iou_less(const Iou &a, const Iou &b)
+{
+    bool lneg = a.mantissa < 0;
+    bool rneg = b.mantissa < 0;
+    if (lneg != rneg)
+        return lneg;
+    if (a.zero())
+        return b.mantissa > 0;
+    if (b.zero())
+        return false;
+    if (a.exponent > b.exponent)
+        return lneg;
+    if (a.exponent < b.exponent)
+        return !lneg;
+    return a.mantissa < b.mantissa;
+}
+
+Iou to_iou(int64_t f)
+{
+    int64_t m = (int64_t)mantissa_of(f);
+    return Iou(is_negative(f) ? -m : m, exponent_of(f));
+}
+
+int64_t from_iou(const Iou &amt)
+{
+    if (amt.overflow)
+        return OVERFLOW;
+    if (amt.zero())
+        return 0;
+    bool negative = amt.mantissa < 0;
+    return make_float((uint64_t)(negative ? -amt.mantissa : amt.mantissa), amt.exponent, negative);
+}
+
+int log10_floor(unsigned __int128 v)
+{
+    int i = 0;
+    unsigned __int128 p = 10;
+    while (i < 38 && p <= v)
+    {
+        p *= 10;
+        ++i;
+    }
+    return i;
+}
+
+int log10_ceil(unsigned __int128 v)
+{
+    int i = 0;
+    unsigned __int128 p = 1;
+    while (i < 38 && p < v)
+    {
+        p *= 10;
+        ++i;
+    }
+    return i;
+}
+
+unsigned __int128 pow10_128(int n)
+{
+    unsigned __int128 p = 1;
+    while (n-- > 0)
+        p *= 10;
+    return p;
+}
+
+// rippled's mulRatio(IOUAmount, num, den, roundUp)
+Iou mul_ratio(const Iou &amt, uint32_t num, uint32_t den, bool round_up)
+{
+    static const int fl64 = log10_floor((unsigned __int128)INT64_MAX);
+    bool negative = amt.mantissa < 0;
+    unsigned __int128 den128 = den;
+    unsigned __int128 mul = (unsigned __int128)(uint64_t)(negative ? -amt.mantissa : amt.mantissa) * num;
+    unsigned __int128 low = mul / den128;
+    unsigned __int128 rem = mul - low * den128;
+    int exponent = amt.exponent;
+    if (rem)
+    {
+        int room = fl64 - log10_ceil(low);
+        if (room > 0)
+        {
+            exponent -= room;
+            low *= pow10_128(room);
+            rem *= pow10_128(room);
+        }
+        unsigned __int128 add = rem / den128;
+        low += add;
+        rem -= add * den128;
+    }
+    bool has_rem = rem != 0;
+    int shrink = log10_ceil(low) - fl64;
+    if (shrink > 0)
+    {
+        unsigned __int128 saved = low;
+        exponent += shrink;
+        low /= pow10_128(shrink);
+        if (!has_rem)
+            has_rem = saved - low * pow10_128(shrink) != 0;
+    }
+    int64_t mantissa = (int64_t)low;
+    if (negative)
+        mantissa = -mantissa;
+    Iou result(mantissa, exponent);
+    if (result.overflow || !has_rem)
+        return result;
+    if (round_up && !negative)
+    {
+        if (result.zero())
+            return Iou((int64_t)MIN_MANTISSA, MIN_EXPONENT);
+        return Iou(result.mantissa + 1, result.exponent);
+    }
+    if (!round_up && negative)
+    {
+        if (result.zero())
+            return Iou(-(int64_t)MIN_MANTISSA, MIN_EXPONENT);
+        return Iou(result.mantissa - 1, result.exponent);
+    }
+    return result;
+}
+
+int64_t double_to_xfl(double x)
+{
+    if (x == 0)
+        return 0;
+    bool negative = x < 0;
+    double value = negative ? -x : x;
+    int32_t exponent = (int32_t)log10(value);
+    value *= pow(10, -exponent + 15);
+    int64_t mantissa = (int64_t)value;
+    if ((uint64_t)mantissa < MIN_MANTISSA)
+    {
+        if ((uint64_t)mantissa == MIN_MANTISSA - 1)
+            mantissa += 1;
+        else
+        {
+            mantissa *= 10;
+            --exponent;
+        }
+    }
+    if ((uint64_t)mantissa > MAX_MANTISSA)
+    {
+        if ((uint64_t)mantissa == MAX_MANTISSA + 1)
+            mantissa -= 1;
+        else
+        {
+            mantissa /= 10;
+            ++exponent;
+        }
+    }
+    return make_float((uint64_t)mantissa, exponent - 15, negative);
+}
+
+#define RETURN_IF_INVALID_FLOAT(f) \
+    if (!is_valid(f))              \
+        return INVALID_FLOAT;
+
+} // namespace
+
+bool is_valid(int64_t f)
+{
+    if (f < 0)
+        return false;
+    if (f == 0)
+        return true;
+    uint64_t m = mantissa_of(f);
+    int32_t e = exponent_of(f);
+    return m >= MIN_MANTISSA && m <= MAX_MANTISSA && e >= MIN_EXPONENT && e <= MAX_EXPONENT;
+}
+
+int64_t make_float(uint64_t mantissa, int32_t exponent, bool negative)
+{
+    if (mantissa == 0)
+        return 0;
+    if (mantissa > MAX_MANTISSA)
+        return MANTISSA_OVERSIZED;
+    if (mantissa < MIN_MANTISSA)
+        return MANTISSA_UNDERSIZED;
+    if (exponent > MAX_EXPONENT)
+        return EXPONENT_OVERSIZED;
+    if (exponent < MIN_EXPONENT)
+        return EXPONENT_UNDERSIZED;
+    uint64_t out = negative ? 0 : 1ULL << 62;
+    out |= (uint64_t)(exponent + 97) << 54;
+    out |= mantissa;
+    return (int64_t)out;
+}
+
+int64_t normalize(int64_t mantissa, int32_t exponent, bool negative)
+{
+    if (mantissa == 0)
+        return 0;
+    if (mantissa == INT64_MIN)
+        ++mantissa;
+    if (mantissa < 0)
+    {
+        mantissa = -mantissa;
+        negative = true;
+    }
+    while ((uint64_t)mantissa > MAX_MANTISSA)
+    {
+        mantissa /= 10;
+        ++exponent;
+    }
+    while ((uint64_t)mantissa < MIN_MANTISSA)
+    {
+        mantissa *= 10;
+        --exponent;
+    }
+    if (exponent < MIN_EXPONENT)
+        return 0;
+    if (exponent > MAX_EXPONENT)
+        return OVERFLOW;
+    return make_float((uint64_t)mantissa, exponent, negative);
+}
+
+int64_t float_set(int32_t exponent, int64_t mantissa)
+{
+    return normalize(mantissa, exponent);
+}
+
+int64_t float_one()
+{
+    return ONE;
+}
+
+int64_t float_compare(int64_t float1, int64_t float2, uint32_t mode)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    RETURN_IF_INVALID_FLOAT(float2);
+    bool equal = mode & COMPARE_EQUAL;
+    bool less = mode & COMPARE_LESS;
+    bool greater = mode & COMPARE_GREATER;
+    if ((equal && less && greater) || mode == 0)
+        return INVALID_ARGUMENT;
+    Iou a = to_iou(float1);
+    Iou b = to_iou(float2);
+    bool lt = iou_less(a, b);
+    bool eq = a.mantissa == b.mantissa && a.exponent == b.exponent;
+    bool gt = !lt && !eq;
+    if (less && greater && !eq)
+        return 1;
+    if (equal && eq)
+        return 1;
+    if (greater && gt)
+        return 1;
+    if (less && lt)
+        return 1;
+    return 0;
+}
+
+int64_t float_sum(int64_t float1, int64_t float2)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    RETURN_IF_INVALID_FLOAT(float2);
+    if (float1 == 0)
+        return float2;
+    if (float2 == 0)
+        return float1;
+    Iou a = to_iou(float1);
+    a += to_iou(float2);
+    return from_iou(a);
+}
+
+int64_t float_negate(int64_t float1)
+{
+    if (float1 == 0)
+        return 0;
+    RETURN_IF_INVALID_FLOAT(float1);
+    return (int64_t)((uint64_t)float1 ^ (1ULL << 62));
+}
+
+int64_t float_multiply(int64_t float1, int64_t float2)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    RETURN_IF_INVALID_FLOAT(float2);
+    if (float1 == 0 || float2 == 0)
+        return 0;
+    unsigned __int128 product = (unsigned __int128)mantissa_of(float1) * mantissa_of(float2);
+    uint64_t mantissa = (uint64_t)(product / POW10[15]);
+    int32_t exponent = exponent_of(float1) + exponent_of(float2) + 15;
+    bool negative = is_negative(float1) != is_negative(float2);
+    return normalize((int64_t)mantissa, exponent, negative);
+}
+
+int64_t float_mulratio(int64_t float1, uint32_t round_up, uint32_t numerator, uint32_t denominator)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    if (float1 == 0)
+        return 0;
+    if (denominator == 0)
+        return DIVISION_BY_ZERO;
+    Iou out = mul_ratio(Iou((int64_t)mantissa_of(float1), exponent_of(float1)), numerator, denominator, round_up != 0);
+    if (out.overflow)
+        return OVERFLOW;
+    int64_t mantissa = out.mantissa < 0 ? -out.mantissa : out.mantissa;
+    return make_float((uint64_t)mantissa, out.exponent, is_negative(float1));
+}
+
+int64_t float_divide(int64_t float1, int64_t float2)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    RETURN_IF_INVALID_FLOAT(float2);
+    if (float2 == 0)
+        return DIVISION_BY_ZERO;
+    if (float1 == 0)
+        return 0;
+    if (float2 == ONE)
+        return float1;
+
+    uint64_t man1 = mantissa_of(float1);
+    int32_t exp1 = exponent_of(float1);
+    uint64_t man2 = mantissa_of(float2);
+    int32_t exp2 = exponent_of(float2);
+    bool negative = is_negative(float1) != is_negative(float2);
+
+    // long division one decimal digit at a time
+    while (man2 > man1)
+    {
+        man2 /= 10;
+        ++exp2;
+    }
+    if (man2 == 0)
+        return DIVISION_BY_ZERO;
+    while (man2 < man1)
+    {
+        if (man2 * 10 > man1)
+            break;
+        man2 *= 10;
+        --exp2;
+    }
+    uint64_t man3 = 0;
+    int32_t exp3 = exp1 - exp2;
+    while (man2 > 0)
+    {
+        uint64_t digit = 0;
+        for (; man1 >= man2; man1 -= man2, ++digit)
+            ;
+        man3 = man3 * 10 + digit;
+        man2 /= 10;
+        if (man2 == 0)
+            break;
+        --exp3;
+    }
+    return normalize((int64_t)man3, exp3, negative);
+}
+
+int64_t float_invert(int64_t float1)
+{
+    if (float1 == 0)
+        return DIVISION_BY_ZERO;
+    if (float1 == ONE)
+        return ONE;
+    return float_divide(ONE, float1);
+}
+
+int64_t float_int(int64_t float1, uint32_t decimal_places, uint32_t absolute)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    if (float1 == 0)
+        return 0;
+    uint64_t mantissa = mantissa_of(float1);
+    int32_t exponent = exponent_of(float1);
+    if (decimal_places > 15)
+        return INVALID_ARGUMENT;
+    if (is_negative(float1) && !absolute)
+        return CANT_RETURN_NEGATIVE;
+    int32_t shift = -(exponent + (int32_t)decimal_places);
+    if (shift > 15)
+        return 0;
+    if (shift < 0)
+        return TOO_BIG;
+    return (int64_t)(mantissa / POW10[shift]);
+}
+
+int64_t float_exponent(int64_t float1)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    if (float1 == 0)
+        return 0;
+    return exponent_of(float1);
+}
+
+int64_t float_exponent_set(int64_t float1, int32_t exponent)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    if (float1 == 0)
+        return 0;
+    return make_float(mantissa_of(float1), exponent, is_negative(float1));
+}
+
+int64_t float_mantissa(int64_t float1)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    if (float1 == 0)
+        return 0;
+    return (int64_t)mantissa_of(float1);
+}
+
+int64_t float_mantissa_set(int64_t float1, int64_t mantissa)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    if (mantissa == 0)
+        return 0;
+    return make_float((uint64_t)mantissa, exponent_of(float1), is_negative(float1));
+}
+
+int64_t float_sign(int64_t float1)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    if (float1 == 0)
+        return 0;
+    return is_negative(float1);
+}
+
+int64_t float_sign_set(int64_t float1, uint32_t negative)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    if (float1 == 0)
+        return 0;
+    return make_float(mantissa_of(float1), exponent_of(float1), negative != 0);
+}
+
+int64_t float_log(int64_t float1)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    if (float1 == 0)
+        return INVALID_ARGUMENT;
+    if (is_negative(float1))
+        return COMPLEX_NOT_SUPPORTED;
+    double result = log10((double)mantissa_of(float1));
+    result += exponent_of(float1);
+    return double_to_xfl(result);
+}
+
+int64_t float_root(int64_t float1, uint32_t n)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    if (float1 == 0)
+        return 0;
+    if (n < 2)
+        return INVALID_ARGUMENT;
+    if (is_negative(float1))
+        return COMPLEX_NOT_SUPPORTED;
+    double input = (double)mantissa_of(float1) * pow(10, exponent_of(float1));
+    return double_to_xfl(pow(input, 1.0 / n));
+}
+
+int64_t float_sto(uint8_t *write, uint32_t write_len, const uint8_t *currency, uint32_t currency_len,
+                  const uint8_t *issuer, uint32_t issuer_len, int64_t float1, uint32_t field_code)
+{
+    RETURN_IF_INVALID_FLOAT(float1);
+    uint16_t field = field_code & 0xFFFFU;
+    uint16_t type = field_code >> 16U;
+    bool is_xrp = field_code == 0;
+    bool is_short = field_code == STO_SHORT;
+
+    uint32_t needed = 8;
+    if (!is_xrp && !is_short)
+        needed += 40 + (field < 16 && type < 16 ? 1 : field >= 16 && type >= 16 ? 3 : 2);
+    if (issuer_len != 20 && issuer_len != 0)
+        return INVALID_ARGUMENT;
+    if (currency_len != 0 && currency_len != 3 && currency_len != 20)
+        return INVALID_ARGUMENT;
+    if (!is_xrp && !is_short && (currency_len == 0 || issuer_len == 0))
+        return INVALID_ARGUMENT;
+    if (needed > write_len)
+        return TOO_SMALL;
+
+    uint8_t *upto = write;
+    if (!is_xrp && !is_short)
+    {
+        if (field < 16 && type < 16)
+            *upto++ = (uint8_t)((type << 4U) + field);
+        else if (field >= 16 && type < 16)
+        {
+            *upto++ = (uint8_t)(type << 4U);
+            *upto++ = (uint8_t)field;
+        }
+        else if (field < 16 && type >= 16)
+        {
+            *upto++ = (uint8_t)(field << 4U);
+            *upto++ = (uint8_t)type;
+        }
+        else
+        {
+            *upto++ = 0;
+            *upto++ = (uint8_t)type;
+            *upto++ = (uint8_t)field;
+        }
+    }
+
+    uint64_t mantissa = mantissa_of(float1);
+    int32_t exponent = exponent_of(float1);
+    bool negative = is_negative(float1);
+    if (is_xrp)
+    {
+        // drops are XRP * 1e6
+        uint64_t drops = 0;
+        if (float1 != 0)
+        {
+            int32_t shift = -(exponent + 6);
+            if (shift > 15)
+                drops = 0;
+            else if (shift >= 0)
+                drops = mantissa / POW10[shift];
+            else if (shift >= -2)
+                drops = mantissa * POW10[-shift];
+            else
+                return OVERFLOW;
+        }
+        uint64_t out = (negative && drops ? 0 : 1ULL << 62) | drops;
+        for (int i = 0; i < 8; ++i)
+            *upto++ = (uint8_t)(out >> (56 - 8 * i));
+    }
+    else if (float1 == 0)
+    {
+        *upto++ = 0x80;
+        for (int i = 1; i < 8; ++i)
+            *upto++ = 0;
+    }
+    else
+    {
+        uint64_t out = (1ULL << 63) | (negative ? 0 : 1ULL << 62) | (uint64_t)(exponent + 97) << 54 | mantissa;
+        for (int i = 0; i < 8; ++i)
+            *upto++ = (uint8_t)(out >> (56 - 8 * i));
+    }
+
+    if (!is_xrp && !is_short)
+    {
+        if (currency_len == 3)
+        {
+            memset(upto, 0, 20);
+            memcpy(upto + 12, currency, 3);
+        }
+        else
+            memcpy(upto, currency, 20);
+        upto += 20;
+        memcpy(upto, issuer, 20);
+        upto += 20;
+    }
+    return upto - write;
+}
+
+int64_t amount_to_float(const uint8_t *amount, uint32_t len)
+{
+    if (len < 8)
+        return NOT_AN_AMOUNT;
+    uint64_t raw = 0;
+    for (int i = 0; i < 8; ++i)
+        raw = raw << 8 | amount[i];
+    bool is_xrp = (raw >> 63) == 0;
+    bool negative = ((raw >> 62) & 1) == 0;
+    uint64_t mantissa;
+    int32_t exponent;
+    if (is_xrp)
+    {
+        mantissa = raw & ((1ULL << 62) - 1);
+        exponent = -6;
+    }
+    else
+    {
+        mantissa = raw & ((1ULL << 54) - 1);
+        exponent = (int32_t)((raw >> 54) & 0xFF) - 97;
+    }
+    if (mantissa == 0)
+        return 0;
+    return normalize((int64_t)mantissa, exponent, negative);
+}
+
+int64_t float_sto_set(const uint8_t *read, uint32_t read_len)
+{
+    if (read_len < 8)
+        return NOT_AN_OBJECT;
+    if (read_len > 8 && read_len != 48)
+    {
+        // strip the field header
+        uint8_t hi = read[0] >> 4U;
+        uint8_t lo = read[0] & 0xFU;
+        uint32_t header = hi == 0 && lo == 0 ? 3 : hi == 0 || lo == 0 ? 2 : 1;
+        if (read_len < header + 8)
+            return NOT_AN_OBJECT;
+        read += header;
+        read_len -= header;
+    }
+    return amount_to_float(read, read_len);
+}
+
+// ---- batches
+
+namespace
+{
+
+#ifdef __AVX2__
+inline __m256i load4(const int64_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+inline void store4(int64_t *p, __m256i v) { _mm256_storeu_si256((__m256i *)p, v); }
+
+// all-ones lanes for valid XFLs (zero included)
+inline __m256i valid4(__m256i x)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i m = _mm256_and_si256(x, _mm256_set1_epi64x((1LL << 54) - 1));
+    __m256i e = _mm256_and_si256(_mm256_srli_epi64(x, 54), _mm256_set1_epi64x(0xFF));
+    __m256i ok = _mm256_cmpgt_epi64(x, zero);
+    ok = _mm256_andnot_si256(_mm256_cmpgt_epi64(_mm256_set1_epi64x((int64_t)MIN_MANTISSA), m), ok);
+    ok = _mm256_andnot_si256(_mm256_cmpgt_epi64(m, _mm256_set1_epi64x((int64_t)MAX_MANTISSA)), ok);
+    ok = _mm256_andnot_si256(_mm256_cmpgt_epi64(_mm256_set1_epi64x(MIN_EXPONENT + 97), e), ok);
+    ok = _mm256_andnot_si256(_mm256_cmpgt_epi64(e, _mm256_set1_epi64x(MAX_EXPONENT + 97)), ok);
+    return _mm256_or_si256(ok, _mm256_cmpeq_epi64(x, zero));
+}
+
+// order preserving key: negatives reversed below zero, positives as is
+inline __m256i key4(__m256i x)
+{
+    const __m256i sign = _mm256_set1_epi64x(1LL << 62);
+    __m256i positive = _mm256_cmpeq_epi64(_mm256_and_si256(x, sign), sign);
+    __m256i reversed = _mm256_sub_epi64(_mm256_set1_epi64x((1LL << 62) - 1), x);
+    return _mm256_blendv_epi8(reversed, x, positive);
+}
+#endif
+
+} // namespace
+
+void batch_valid(const int64_t *a, int64_t *out, size_t n)
+{
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256i one = _mm256_set1_epi64x(1);
+    for (; i + 4 <= n; i += 4)
+        store4(out + i, _mm256_and_si256(valid4(load4(a + i)), one));
+#endif
+    for (; i < n; ++i)
+        out[i] = is_valid(a[i]);
+}
+
+void batch_compare(const int64_t *a, const int64_t *b, uint32_t mode, int64_t *out, size_t n)
+{
+    size_t i = 0;
+    bool bad_mode = mode == 0 || (mode & 7) == 7;
+#ifdef __AVX2__
+    if (!bad_mode)
+    {
+        const __m256i eq_on = _mm256_set1_epi64x(mode & COMPARE_EQUAL ? -1 : 0);
+        const __m256i lt_on = _mm256_set1_epi64x(mode & COMPARE_LESS ? -1 : 0);
+        const __m256i gt_on = _mm256_set1_epi64x(mode & COMPARE_GREATER ? -1 : 0);
+        const __m256i one = _mm256_set1_epi64x(1);
+        const __m256i invalid = _mm256_set1_epi64x(INVALID_FLOAT);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256i x = load4(a + i);
+            __m256i y = load4(b + i);
+            __m256i kx = key4(x), ky = key4(y);
+            __m256i hit = _mm256_and_si256(eq_on, _mm256_cmpeq_epi64(kx, ky));
+            hit = _mm256_or_si256(hit, _mm256_and_si256(lt_on, _mm256_cmpgt_epi64(ky, kx)));
+            hit = _mm256_or_si256(hit, _mm256_and_si256(gt_on, _mm256_cmpgt_epi64(kx, ky)));
+            __m256i valid = _mm256_and_si256(valid4(x), valid4(y));
+            store4(out + i, _mm256_blendv_epi8(invalid, _mm256_and_si256(hit, one), valid));
+        }
+    }
+#endif
+    for (; i < n; ++i)
+        out[i] = float_compare(a[i], b[i], mode);
+}
+
+void batch_negate(const int64_t *a, int64_t *out, size_t n)
+{
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256i sign = _mm256_set1_epi64x(1LL << 62);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i invalid = _mm256_set1_epi64x(INVALID_FLOAT);
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i x = load4(a + i);
+        __m256i flipped = _mm256_andnot_si256(_mm256_cmpeq_epi64(x, zero), _mm256_xor_si256(x, sign));
+        store4(out + i, _mm256_blendv_epi8(invalid, flipped, valid4(x)));
+    }
+#endif
+    for (; i < n; ++i)
+        out[i] = float_negate(a[i]);
+}
+
+void batch_sign(const int64_t *a, int64_t *out, size_t n)
+{
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256i sign = _mm256_set1_epi64x(1LL << 62);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i invalid = _mm256_set1_epi64x(INVALID_FLOAT);
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i x = load4(a + i);
+        __m256i negative = _mm256_and_si256(_mm256_cmpeq_epi64(_mm256_and_si256(x, sign), zero),
+                                            _mm256_xor_si256(_mm256_cmpeq_epi64(x, zero), _mm256_set1_epi64x(-1)));
+        store4(out + i, _mm256_blendv_epi8(invalid, _mm256_and_si256(negative, one), valid4(x)));
+    }
+#endif
+    for (; i < n; ++i)
+        out[i] = float_sign(a[i]);
+}
+
+void batch_mantissa(const int64_t *a, int64_t *out, size_t n)
+{
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256i mask = _mm256_set1_epi64x((1LL << 54) - 1);
+    const __m256i invalid = _mm256_set1_epi64x(INVALID_FLOAT);
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i x = load4(a + i);
+        store4(out + i, _mm256_blendv_epi8(invalid, _mm256_and_si256(x, mask), valid4(x)));
+    }
+#endif
+    for (; i < n; ++i)
+        out[i] = float_mantissa(a[i]);
+}
+
+void batch_exponent(const int64_t *a, int64_t *out, size_t n)
+{
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i invalid = _mm256_set1_epi64x(INVALID_FLOAT);
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i x = load4(a + i);
+        __m256i e = _mm256_sub_epi64(_mm256_and_si256(_mm256_srli_epi64(x, 54), _mm256_set1_epi64x(0xFF)),
+                                     _mm256_set1_epi64x(97));
+        e = _mm256_andnot_si256(_mm256_cmpeq_epi64(x, zero), e);
+        store4(out + i, _mm256_blendv_epi8(invalid, e, valid4(x)));
+    }
+#endif
+    for (; i < n; ++i)
+        out[i] = float_exponent(a[i]);
+}
+
+} // namespace xfl
@@ -0,0 +1,91 @@
+/**
+ * Native XFL floating point, bit-exact with the float_* hook API in lib/extern.h.
+ *
+ * XFL layout (int64): bit 63 is always 0, bit 62 is set for positive numbers,
+ * bits 54-61 hold exponent + 97 and bits 0-53 the mantissa, normalized to
+ * [1e15, 1e16). Zero is 0. Errors are the negative codes from lib/error.h.
+ *
+ * Normalization and rounding follow rippled's hook implementation built on
+ * IOUAmount: truncation towards zero, underflow to zero, OVERFLOW above 1e96.
+ * Functions that read or write guest memory take plain buffers instead.
+ *
+ * The batch_* functions give, for arrays, results identical to the scalar
+ * calls. They cover only what runs four lanes at a time with AVX2 when built
+ * with -mavx2: validation, negate, compare and field extraction. Sums, products
+ * and quotients normalize in data dependent loops and have no batch form.
+ *
+ * Build: g++ -std=c++17 -O2 -mavx2 -Ilib -Itools -c tools/host/xfl.cpp
+ */
+
+#ifndef HOST_XFL_H
+#define HOST_XFL_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace xfl
+{
+
+constexpr uint64_t MIN_MANTISSA = 1000000000000000ULL;
+constexpr uint64_t MAX_MANTISSA = 9999999999999999ULL;
+constexpr int32_t MIN_EXPONENT = -96;
+constexpr int32_t MAX_EXPONENT = 80;
+constexpr int64_t ONE = 6089866696204910592LL;
+
+constexpr uint32_t COMPARE_EQUAL = 1;
+constexpr uint32_t COMPARE_LESS = 2;
+constexpr uint32_t COMPARE_GREATER = 4;
+
+// field code for float_sto writing only the 8 byte amount
+constexpr uint32_t STO_SHORT = 0xFFFFFFFFU;
+
+inline uint64_t mantissa_of(int64_t f) { return (uint64_t)f & ((1ULL << 54) - 1); }
+inline int32_t exponent_of(int64_t f) { return (int32_t)(((uint64_t)f >> 54) & 0xFF) - 97; }
+inline bool is_negative(int64_t f) { return ((f >> 62) & 1) == 0; }
+bool is_valid(int64_t f);
+
+// builds an XFL from a normalized mantissa, range errors are reported per field
+int64_t make_float(uint64_t mantissa, int32_t exponent, bool negative);
+// normalizes any mantissa/exponent pair: truncates, underflows to 0, OVERFLOW above range
+int64_t normalize(int64_t mantissa, int32_t exponent, bool negative = false);
+
+int64_t float_set(int32_t exponent, int64_t mantissa);
+int64_t float_one();
+int64_t float_compare(int64_t float1, int64_t float2, uint32_t mode);
+int64_t float_sum(int64_t float1, int64_t float2);
+int64_t float_negate(int64_t float1);
+int64_t float_multiply(int64_t float1, int64_t float2);
+int64_t float_mulratio(int64_t float1, uint32_t round_up, uint32_t numerator, uint32_t denominator);
+int64_t float_divide(int64_t float1, int64_t float2);
+int64_t float_invert(int64_t float1);
+int64_t float_int(int64_t float1, uint32_t decimal_places, uint32_t absolute);
+int64_t float_exponent(int64_t float1);
+int64_t float_exponent_set(int64_t float1, int32_t exponent);
+int64_t float_mantissa(int64_t float1);
+int64_t float_mantissa_set(int64_t float1, int64_t mantissa);
+int64_t float_sign(int64_t float1);
+int64_t float_sign_set(int64_t float1, uint32_t negative);
+int64_t float_log(int64_t float1);
+int64_t float_root(int64_t float1, uint32_t n);
+
+// serializes float1 as an STAmount: field_code 0 writes XRP drops (the float being
+// in XRP), STO_SHORT only the 8 amount bytes, anything else a field header, the
+// amount and the 20 byte currency (3 byte ISO codes are expanded) and issuer
+int64_t float_sto(uint8_t *write, uint32_t write_len, const uint8_t *currency, uint32_t currency_len,
+                  const uint8_t *issuer, uint32_t issuer_len, int64_t float1, uint32_t field_code);
+// parses an STAmount with or without field header, XRP drops come back in XRP
+int64_t float_sto_set(const uint8_t *read, uint32_t read_len);
+// slot_float on a serialized amount (no field header)
+int64_t amount_to_float(const uint8_t *amount, uint32_t len);
+
+// element-wise: out[i] = f(a[i], b[i]), batch_valid gives 1 or 0 as is_valid
+void batch_valid(const int64_t *a, int64_t *out, size_t n);
+void batch_compare(const int64_t *a, const int64_t *b, uint32_t mode, int64_t *out, size_t n);
+void batch_negate(const int64_t *a, int64_t *out, size_t n);
+void batch_sign(const int64_t *a, int64_t *out, size_t n);
+void batch_mantissa(const int64_t *a, int64_t *out, size_t n);
+void batch_exponent(const int64_t *a, int64_t *out, size_t n);
+
+} // namespace xfl
+
+#endif
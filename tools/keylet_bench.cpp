@@ -0,0 +1,232 @@
+/**
+ * keylet_bench - cross-checks and times the keylet engine in tools/host/keylet
+ *
+ * Checks every keylet type against fixed vectors (the account root, fee,
+ * amendment, negative UNL and skip list IDs are the ones on mainnet), through
+ * both build() and util_keylet on a guest memory image, then builds N random
+ * trust line and mixed keylets one by one and in batches, verifies they agree
+ * and prints keylets per second.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/keylet_bench.cpp tools/host/keylet.cpp tools/host/sha512.cpp tools/host/util.cpp -o build/keylet_bench
+ * Usage: keylet_bench [-n COUNT] [-s SEED]
+ *
+ * Exit status is 0 when every check passes, 1 otherwise.
+ */
+
+#include "host/keylet.h"
+#include "host/sha512.h"
+#include "host/util.h"
+
+#include "error.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace keylet;
+
+namespace
+{
+
+// guest memory image: arguments at fixed offsets, as a hook would pass them
+constexpr uint32_t AT_GENESIS = 16;
+constexpr uint32_t AT_ACCOUNT2 = 48;
+constexpr uint32_t AT_KEY = 80;
+constexpr uint32_t AT_NS = 112;
+constexpr uint32_t AT_USD = 144;
+constexpr uint32_t MEMORY_SIZE = 256;
+
+struct Vector
+{
+    const char *name;
+    uint32_t type;
+    uint32_t args[6]; // util_keylet a..f
+    const char *expected;
+};
+
+const Vector VECTORS[] = {
+    {"account", ACCOUNT, {AT_GENESIS, 20}, "00612B6AC232AA4C4BE41BF49D2459FA4A0347E1B543A4C92FCEE0821C0201E2E9A8"},
+    {"fees", FEES, {}, "00734BC50C9B0D8515D3EAAE1E74B29A95804346C491EE1A95BF25E4AAB854A6A651"},
+    {"amendments", AMENDMENTS, {}, "00667DB0788C020F02780A673DC74757F23823FA3014C1866E72CC4CD8B226CD6EF4"},
+    {"negative unl", NEGATIVE_UNL, {}, "004E2E8A59AA9D3B5B186B0B9E0F62E6C02587CA74A4D778938E957B6357D364B244"},
+    {"skip", SKIP, {}, "0068B4979A36CDC7F3D3D5C31A4EAE2AC7D7209DDA877588B9AFC66799692AB0D66B"},
+    {"skip 70000", SKIP, {70000, 1}, "006880FF75BFB4F671EBB41858C316EAF264462435E67D571AEC8C4E26FEB053C13B"},
+    {"owner dir", OWNER_DIR, {AT_GENESIS, 20}, "0064D8120FC732737A2CF2E9968FDF3797A43B457F2A81AA06D2653171A1EA635204"},
+    {"hook", HOOK, {AT_GENESIS, 20}, "0048469372BEE8814EC52CA2AECB5374AB57A47B53627E3C0E2ACBE3FDC78DBFEC7B"},
+    {"signers", SIGNERS, {AT_GENESIS, 20}, "0053778365D5180F5DF3016817D1F318527AD7410D83F8636CF48C43E8AF72AB49BF"},
+    {"hook state", HOOK_STATE, {AT_GENESIS, 20, AT_KEY, 32, AT_NS, 32},
+     "00762CBA38867EE48B2F14FCF15EE861D32D5BFEC3E7B90C4E291C784C2E5F1FB89B"},
+    {"line", LINE, {AT_GENESIS, 20, AT_ACCOUNT2, 20, AT_USD, 20},
+     "0072338A948FB93230F9D062D9F4112D00828A671D71BB441E233513E57DF9F18461"},
+    {"line swapped", LINE, {AT_ACCOUNT2, 20, AT_GENESIS, 20, AT_USD, 20},
+     "0072338A948FB93230F9D062D9F4112D00828A671D71BB441E233513E57DF9F18461"},
+    {"offer", OFFER, {AT_GENESIS, 20, 5}, "006FBF656DABDD84E6128A45039F8D557C9477D4DA31F5B00868F2191F0A11FE3798"},
+    {"check", CHECK, {AT_GENESIS, 20, 5}, "00437F640CCE9CBA5B9DEF70D455B9BFFB1C9D500A5409B7AA84275C542AC0C35AE5"},
+    {"escrow", ESCROW, {AT_GENESIS, 20, 5}, "00757AD77DAEB1695C9E01674B8ECCA38F7961ABC7E8B728926B44A9B5F7630842AD"},
+    {"ticket", TICKET, {AT_GENESIS, 20, 5}, "0054EE418FDC986F49CF6486E88AC61F4ED64607F134F03B7A525828213AAC066AE2"},
+    {"check by id", CHECK, {AT_GENESIS, 20, AT_KEY, 32},
+     "0043202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"},
+    {"paychan", PAYCHAN, {AT_GENESIS, 20, AT_ACCOUNT2, 20, 7},
+     "0078CCA10410D190789B66BC65A66306BF94414A92C24721072017F245E376F8CE26"},
+    {"deposit preauth", DEPOSIT_PREAUTH, {AT_GENESIS, 20, AT_ACCOUNT2, 20},
+     "00709DF8A391B5A476905BF5F80952BD30178B7B3783A6A25CA9FE5E636CB90761E9"},
+    {"emitted", EMITTED, {AT_KEY, 32}, "00454F2AF564466E8F07D5379EFDA2C19B0CEE1A0E7BD8C2B76FB4C15E7EB2F949F8"},
+    {"emitted dir", EMITTED_DIR, {}, "0064B4DE823055D00BC12CD78FE1AAF74EE6062195B2629F49A25915A39C64BE1900"},
+    {"child", CHILD, {AT_KEY, 32}, "1CD2202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"},
+    {"unchecked", UNCHECKED, {AT_KEY, 32}, "0000202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"},
+    {"page 0", PAGE, {AT_KEY, 32}, "0064202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"},
+    {"page 3", PAGE, {AT_KEY, 32, 0, 3}, "0064F720B60DA1DE29EF39787D2565DE2B4D5D7B413FECECD8D2424CD04987398F02"},
+};
+
+struct ErrorCase
+{
+    const char *name;
+    uint32_t write_len;
+    uint32_t type;
+    uint32_t args[6];
+    int64_t expected;
+};
+
+const ErrorCase ERRORS[] = {
+    {"short output", 33, ACCOUNT, {AT_GENESIS, 20}, TOO_SMALL},
+    {"unknown type", 34, 23, {}, INVALID_ARGUMENT},
+    {"short account", 34, ACCOUNT, {AT_GENESIS, 19}, INVALID_ARGUMENT},
+    {"stray argument", 34, FEES, {1}, INVALID_ARGUMENT},
+    {"out of bounds", 34, ACCOUNT, {MEMORY_SIZE - 10, 20}, OUT_OF_BOUNDS},
+    {"quality of non-dir", 34, QUALITY, {AT_KEY - 2, 34, 0, 1}, INVALID_ARGUMENT},
+};
+
+void report(const char *name, size_t n, double secs)
+{
+    std::printf("%-24s %10.2f M/s %10.1f ns\n", name, n / secs / 1e6, secs * 1e9 / n);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t n = 1000000;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "-n") && i + 1 < argc)
+            n = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-s") && i + 1 < argc)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [-n COUNT] [-s SEED]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    uint8_t memory[MEMORY_SIZE] = {0};
+    const uint8_t genesis[20] = {0xB5, 0xF7, 0x62, 0x79, 0x8A, 0x53, 0xD5, 0x43, 0xA0, 0x14,
+                                 0xCA, 0xF8, 0xB2, 0x97, 0xCF, 0xF8, 0xF2, 0xF9, 0x37, 0xE8};
+    std::memcpy(memory + AT_GENESIS, genesis, 20);
+    for (int i = 0; i < 20; ++i)
+        memory[AT_ACCOUNT2 + i] = (uint8_t)(1 + i);
+    for (int i = 0; i < 32; ++i)
+    {
+        memory[AT_KEY + i] = (uint8_t)(0x20 + i);
+        memory[AT_NS + i] = (uint8_t)(0xA0 + i);
+    }
+    std::memcpy(memory + AT_USD + 12, "USD", 3);
+
+    int failures = 0;
+    for (const Vector &v : VECTORS)
+    {
+        uint8_t out[KEYLET_SIZE];
+        const uint32_t *a = v.args;
+        int64_t rc = util_keylet(out, sizeof(out), v.type, memory, MEMORY_SIZE, a[0], a[1], a[2], a[3], a[4], a[5]);
+        if (rc != (int64_t)KEYLET_SIZE || util::to_hex(out, KEYLET_SIZE) != v.expected)
+        {
+            std::printf("%s: got %lld %s, expected %s\n", v.name, (long long)rc,
+                        rc > 0 ? util::to_hex(out, 34).c_str() : "", v.expected);
+            ++failures;
+        }
+    }
+    for (const ErrorCase &c : ERRORS)
+    {
+        uint8_t out[KEYLET_SIZE];
+        const uint32_t *a = c.args;
+        int64_t rc = util_keylet(out, c.write_len, c.type, memory, MEMORY_SIZE, a[0], a[1], a[2], a[3], a[4], a[5]);
+        if (rc != c.expected)
+        {
+            std::printf("%s: got %lld, expected %lld\n", c.name, (long long)rc, (long long)c.expected);
+            ++failures;
+        }
+    }
+    if (util::to_hex(account(genesis).key, KEY_SIZE) != std::string(VECTORS[0].expected + 4))
+    {
+        std::printf("account() disagrees with util_keylet\n");
+        ++failures;
+    }
+
+    // random trust lines, and a mix of every hashed type sharing the same arguments
+    std::mt19937_64 rng(seed);
+    std::vector<uint8_t> args(n * 3 * KEY_SIZE);
+    for (auto &b : args)
+        b = (uint8_t)rng();
+    std::vector<Request> lines(n), mixed(n);
+    const uint32_t hashed[] = {HOOK, HOOK_STATE, ACCOUNT, LINE, OFFER, SIGNERS, CHECK, DEPOSIT_PREAUTH,
+                               OWNER_DIR, ESCROW, PAYCHAN, EMITTED, TICKET, PAGE};
+    for (size_t i = 0; i < n; ++i)
+    {
+        const uint8_t *base = &args[i * 3 * KEY_SIZE];
+        Request &l = lines[i];
+        l.type = LINE;
+        l.account = base;
+        l.account2 = base + KEY_SIZE;
+        l.key = base + 2 * KEY_SIZE;
+        Request &m = mixed[i];
+        m.type = hashed[rng() % (sizeof(hashed) / sizeof(hashed[0]))];
+        m.account = base;
+        m.account2 = base + KEY_SIZE;
+        m.key = m.type == LINE || m.type == HOOK_STATE || m.type == EMITTED || m.type == PAGE ? base + 2 * KEY_SIZE
+                                                                                             : nullptr;
+        m.ns = base + KEY_SIZE;
+        m.number = 1 + rng() % 1000;
+    }
+
+    std::vector<Keylet> scalar(n), batched(n), mixed_scalar(n), mixed_batched(n);
+    std::vector<uint8_t> valid(n);
+    std::printf("sha512: %s, %zu keylets\n", sha512::implementation(), n);
+    report("line", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+                   scalar[i] = line(lines[i].account, lines[i].account2, lines[i].key);
+           }));
+    size_t built_lines = 0;
+    report("batch line", n, util::seconds([&] { built_lines = batch(lines.data(), batched.data(), valid.data(), n); }));
+    size_t built_scalar = 0;
+    report("build mixed", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+                   built_scalar += build(mixed[i], mixed_scalar[i]);
+           }));
+    size_t built_mixed = 0;
+    report("batch mixed", n,
+           util::seconds([&] { built_mixed = batch(mixed.data(), mixed_batched.data(), valid.data(), n); }));
+    uint8_t digest[32];
+    report("util_sha512h 64 bytes", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+                   util_sha512h(digest, sizeof(digest), &args[i * 3 * KEY_SIZE], 64);
+           }));
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        mismatches += scalar[i].type != batched[i].type || std::memcmp(scalar[i].key, batched[i].key, KEY_SIZE);
+        mismatches += mixed_scalar[i].type != mixed_batched[i].type ||
+                      std::memcmp(mixed_scalar[i].key, mixed_batched[i].key, KEY_SIZE);
+    }
+    if (mismatches || built_lines != n || built_scalar != n || built_mixed != n)
+    {
+        std::printf("FAILED: %zu batch/scalar mismatches, built %zu %zu %zu of %zu\n", mismatches, built_lines,
+                    built_scalar, built_mixed, n);
+        ++failures;
+    }
+    return failures ? 1 : 0;
+}
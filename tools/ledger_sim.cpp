@@ -0,0 +1,232 @@
+/**
+ * ledger_sim - closes ledgers over a workload of transactions for installed hooks
+ *
+ * Installs compiled hooks on accounts, submits the originating transactions
+ * of a workload to the ledgers they name and closes ledgers through
+ * tools/host/ledger until every chain of emitted transactions and callbacks
+ * has completed (or -l ledgers have closed). Prints per-ledger counts with -v
+ * and one line per transaction with --log, then the totals, the emitted
+ * backlog and ledgers-to-completion percentiles.
+ *
+ * A workload line is: LEDGER HEX, the ledger as an offset from the first one
+ * and the serialized transaction in hex. Blank lines and lines starting with #
+ * are skipped. A WORKLOAD that is a tools/host/corpus file is read in place
+ * instead, its ledgers taken relative to the first record's; emitted records
+ * are skipped since the hooks emit them again. --param and --state apply to
+ * the hook given last.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/ledger_sim.cpp tools/host/ledger.cpp
+ *        tools/wasm/module.cpp tools/wasm/instr.cpp tools/wasm/interp.cpp tools/host/hostapi.cpp
+ *        tools/host/hookstate.cpp tools/host/snapshot.cpp tools/host/stobject.cpp tools/host/xfl.cpp
+ *        tools/host/base58.cpp tools/host/sha256.cpp tools/host/keylet.cpp tools/host/sha512.cpp
+ *        tools/host/corpus.cpp tools/host/util.cpp tools/host/workload.cpp -o build/ledger_sim
+ * Usage: ledger_sim --hook RADDR=FILE [--param NAME=HEX]... [--state SNAPSHOT] [--hook ...]...
+ *                   [--entry KEYLET=HEX]... [-l LEDGERS] [--capacity N] [--fail RATE] [--time T]
+ *                   [--fuel N] [-s SEED] [-v] [--log] [--trace] [WORKLOAD]
+ *
+ * Exit status is 0 when every chain completed, 1 otherwise, 2 on usage or load errors.
+ */
+
+#include "host/base58.h"
+#include "host/ledger.h"
+#include "host/snapshot.h"
+#include "host/util.h"
+#include "host/workload.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+void usage()
+{
+    fprintf(stderr, "usage: ledger_sim --hook RADDR=FILE [--param NAME=HEX]... [--state SNAPSHOT] [--hook ...]...\n"
+                    "                  [--entry KEYLET=HEX]... [-l LEDGERS] [--capacity N] [--fail RATE] [--time T]\n"
+                    "                  [--fuel N] [-s SEED] [-v] [--log] [--trace] [WORKLOAD]\n");
+}
+
+uint32_t percentile(const std::vector<uint32_t> &sorted, double p)
+{
+    return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ledger::Options options;
+    uint32_t max_ledgers = 10000;
+    bool verbose = false, log = false, trace = false;
+    std::string workload_path;
+    // --hook and the options that follow it, applied once the simulator exists
+    struct HookArgs
+    {
+        std::string account, path, state;
+        std::vector<std::string> params;
+    };
+    std::vector<HookArgs> hooks;
+    std::vector<std::string> entries;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--hook" && i + 1 < argc)
+        {
+            HookArgs h;
+            if (!util::split(argv[++i], h.account, h.path))
+            {
+                usage();
+                return 2;
+            }
+            hooks.push_back(h);
+        }
+        else if ((arg == "--param" || arg == "--state") && i + 1 < argc && !hooks.empty())
+        {
+            if (arg == "--param")
+                hooks.back().params.push_back(argv[++i]);
+            else
+                hooks.back().state = argv[++i];
+        }
+        else if (arg == "--entry" && i + 1 < argc)
+            entries.push_back(argv[++i]);
+        else if (arg == "-l" && i + 1 < argc)
+            max_ledgers = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "--capacity" && i + 1 < argc)
+            options.capacity = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "--fail" && i + 1 < argc)
+            options.fail_rate = strtod(argv[++i], nullptr);
+        else if (arg == "--time" && i + 1 < argc)
+            options.close_time = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "--fuel" && i + 1 < argc)
+            options.fuel = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "-s" && i + 1 < argc)
+            options.seed = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "-v")
+            verbose = true;
+        else if (arg == "--log")
+            log = true;
+        else if (arg == "--trace")
+            trace = true;
+        else if (!arg.empty() && (arg[0] != '-' || arg == "-") && workload_path.empty())
+            workload_path = arg;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (hooks.empty())
+    {
+        usage();
+        return 2;
+    }
+    options.log = log ? stdout : nullptr;
+    options.trace = trace ? stdout : nullptr;
+
+    ledger::Simulator sim(options);
+    std::vector<std::unique_ptr<snapshot::Snapshot>> snapshots;
+    for (const HookArgs &h : hooks)
+    {
+        uint8_t account[ledger::ACCOUNT_ID_SIZE];
+        std::vector<uint8_t> bin;
+        std::string error;
+        if (!base58::decode_account(h.account.data(), h.account.size(), account))
+        {
+            fprintf(stderr, "ledger_sim: bad account %s\n", h.account.c_str());
+            return 2;
+        }
+        if (!util::read_file(h.path, bin))
+        {
+            fprintf(stderr, "ledger_sim: cannot read %s\n", h.path.c_str());
+            return 2;
+        }
+        hostapi::Context *ctx = sim.add_hook(account, bin, error);
+        if (!ctx)
+        {
+            fprintf(stderr, "ledger_sim: %s: %s\n", h.path.c_str(), error.c_str());
+            return 2;
+        }
+        for (const std::string &p : h.params)
+        {
+            std::string name, value;
+            std::vector<uint8_t> bin_value;
+            if (!util::split(p, name, value) || !util::from_hex(value, bin_value))
+            {
+                fprintf(stderr, "ledger_sim: bad parameter %s, expected NAME=HEX\n", p.c_str());
+                return 2;
+            }
+            ctx->params[std::vector<uint8_t>(name.begin(), name.end())] = bin_value;
+        }
+        if (!h.state.empty())
+        {
+            snapshots.push_back(std::make_unique<snapshot::Snapshot>());
+            if (!snapshots.back()->open(h.state, error))
+            {
+                fprintf(stderr, "ledger_sim: %s\n", error.c_str());
+                return 2;
+            }
+            ctx->state.attach(snapshots.back().get());
+        }
+    }
+    for (const std::string &e : entries)
+    {
+        std::string key, value;
+        std::vector<uint8_t> key_bin, blob;
+        if (!util::split(e, key, value) || !util::from_hex(key, key_bin) || key_bin.size() != hostapi::KEYLET_SIZE ||
+            !util::from_hex(value, blob))
+        {
+            fprintf(stderr, "ledger_sim: bad entry %s, expected KEYLET=HEX\n", e.c_str());
+            return 2;
+        }
+        hostapi::Keylet keylet;
+        std::copy(key_bin.begin(), key_bin.end(), keylet.begin());
+        sim.set_entry(keylet, blob);
+    }
+
+    uint32_t first = options.first_ledger;
+    std::vector<workload::Item> items;
+    std::string error;
+    if (!workload::load(workload_path, items, error))
+    {
+        fprintf(stderr, "ledger_sim: %s\n", error.c_str());
+        return 2;
+    }
+    for (workload::Item &item : items)
+        sim.submit(std::move(item.blob), first + item.offset);
+
+    if (verbose)
+        printf("%-10s %8s %8s %8s %8s %8s\n", "ledger", "orig", "emitted", "cbak", "expired", "backlog");
+    uint32_t closed = 0;
+    double t = util::seconds([&] {
+        for (; closed < max_ledgers && !sim.idle(); ++closed)
+        {
+            sim.close();
+            const ledger::Close &c = sim.stats().closes.back();
+            if (verbose)
+                printf("%-10u %8zu %8zu %8zu %8zu %8zu\n", c.seq, c.originating, c.emitted, c.callbacks, c.expired,
+                       c.backlog);
+        }
+    });
+
+    const ledger::Stats &s = sim.stats();
+    std::vector<uint32_t> completion = s.completion;
+    std::sort(completion.begin(), completion.end());
+    printf("ledgers       %u in %.3f s\n", closed, t);
+    printf("transactions  %" PRIu64 " applied, %" PRIu64 " emitted, %" PRIu64 " rejected, %" PRIu64
+           " failed, %" PRIu64 " expired\n",
+           s.transactions, s.emitted, s.rejected, s.failed, s.expired);
+    printf("hooks         %" PRIu64 " runs, %" PRIu64 " callbacks, %" PRIu64 " errors, %" PRIu64 " instructions\n",
+           s.hook_runs, s.callbacks, s.errors, s.instructions);
+    printf("backlog       max %zu\n", s.max_backlog);
+    printf("completion    %zu chains, ledgers p50 %u p90 %u p99 %u max %u\n", completion.size(),
+           percentile(completion, 0.5), percentile(completion, 0.9), percentile(completion, 0.99),
+           completion.empty() ? 0 : completion.back());
+    if (!sim.idle())
+        printf("incomplete after %u ledgers\n", closed);
+    return sim.idle() ? 0 : 1;
+}
@@ -0,0 +1,620 @@
+/**
+ * loan_market - a market of loan agents against loan.c, through the ledger simulation
+ *
+ * Installs the loan hook (DIR/loan.wasm) on a tools/host/ledger Simulator and
+ * lets AGENTS accounts, each with trustlines to the five IOU issuers, trade on
+ * it for LEDGERS ledgers, then drains the market. Every ledger:
+ *
+ *   makers    about MAKES new offers (Poisson), borrower or lender at random,
+ *             loan and collateral in one of the first CURRENCIES currencies,
+ *             10 to 1000 units against half as much again, PERIOD days
+ *   takers    take each waiting offer with probability TAKE
+ *   makers    cancel an offer still waiting PATIENCE ledgers after it was made
+ *   repayers  repay a running loan at a random ledger before it ends, except
+ *   defaulters  a share DEFAULT of the borrowers, whose lenders close the loan
+ *             once its period is over
+ *   owed      accounts with an outbox record ask for it with probability RESEND,
+ *             and the operator flushes a page every FLUSH ledgers
+ *
+ * A ledger closes every INTERVAL seconds. --fail makes that share of emitted
+ * payments fail tecPATH_DRY so the outbox fills through cbak.
+ *
+ * loan.c keeps a counter of its entries (key ending 7) that make and the
+ * cbak of a first failure to an account increment (by the outbox entries it
+ * creates: record, queue entry and meta), and cancel, repay, close, resend and
+ * flush decrement; new offers are rejected once it is above MAX_STATES (1000).
+ * After every close the hook state is read back: offers waiting and running,
+ * outbox records and entries, the counter and its drift (the counter less
+ * offers and outbox entries). The report has a row every EVERY ledgers,
+ * the ledgers the drift changed in with what was applied there, the
+ * occupancy peaks and the ledgers spent at the ceiling, time-to-take per
+ * currency, rejections by action and exit code, and the instructions per
+ * action (accepted and rejected), per callback and per run on the hook's own
+ * emitted payments.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/loan_market.cpp tools/host/actions.cpp
+ *        tools/host/ledger.cpp tools/wasm/module.cpp tools/wasm/instr.cpp tools/wasm/interp.cpp
+ *        tools/host/hostapi.cpp tools/host/hookstate.cpp tools/host/snapshot.cpp tools/host/stobject.cpp
+ *        tools/host/xfl.cpp tools/host/base58.cpp tools/host/sha256.cpp tools/host/keylet.cpp
+ *        tools/host/sha512.cpp tools/host/util.cpp -o build/loan_market
+ * Usage: loan_market [-d DIR] [-a AGENTS] [-m MAKES] [-t TAKE] [--default RATE] [--patience PATIENCE]
+ *                    [--period MIN,MAX] [--currencies N] [--resend P] [--flush FLUSH] [--fail RATE]
+ *                    [-i INTERVAL] [-l LEDGERS] [--drain LEDGERS] [-e EVERY] [-s SEED]
+ *
+ * Exit status is 0 when the market drained with the counter matching the
+ * entries, 1 when it drifted or did not drain, 2 on usage or load errors.
+ */
+
+#include "host/actions.h"
+#include "host/keylet.h"
+#include "host/ledger.h"
+#include "host/stobject.h"
+#include "host/util.h"
+#include "sfcodes.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using hookstate::NAMESPACE_SIZE;
+
+namespace
+{
+
+using namespace actions;
+
+// loan.c
+constexpr uint64_t MAX_STATES = 1000;
+constexpr size_t LOAN_SIZE = 85;
+constexpr uint8_t COUNTER_KEY_END = 7;
+constexpr uint64_t MIN_FEE = 10 * XRP;
+constexpr uint32_t INTEREST = 5000;
+constexpr int64_t TOO_BIG = -3;
+
+constexpr uint8_t WAITING = 1;
+constexpr uint8_t RUNNING = 2;
+constexpr uint8_t BORROWER = 1;
+
+// offsets into an offer
+constexpr size_t LOAN_STATE = 0;
+constexpr size_t ROLE = 1;
+constexpr size_t LOAN_CURRENCY = 3;
+constexpr size_t COLLATERAL_CURRENCY = 4;
+constexpr size_t LOAN_AMOUNT = 13;
+constexpr size_t COLLATERAL_AMOUNT = 21;
+constexpr size_t TIMESTAMP_END = 37;
+constexpr size_t MAKER = 45;
+constexpr size_t TAKER = 65;
+
+constexpr int CURRENCIES = 6;
+const char *const CURRENCY_NAMES[CURRENCIES] = {"XRP", "GBP", "EUR", "USD", "CHF", "CNH"};
+const char *const ISSUERS[CURRENCIES] = {"",
+                                         "rMZC8eoTsdr8f5yyBG47pwtpWdebT7BLeY",
+                                         "r43MzJE8EPcb2hLJjh1aGR2pFwjc6T9czo",
+                                         "rajuXb5NwEyRZSKUzNLaevMwo8hmzVQQNS",
+                                         "rDsb8uKJ4k4kygjPud2pYA9qApdCvkRVa2",
+                                         "rHxAKPGPwqtgewEfcevVTUT6MghRGWwGFb"};
+const char *const OPERATOR = "rfohbAu5HbCT2PMnu1Nu3fNmTK9ZodBoSW";
+
+// the memo actions, then what runs without one
+enum Kind
+{
+    MAKE = 1,
+    CANCEL,
+    TAKE,
+    REPAY,
+    CLOSE,
+    RESEND,
+    FLUSH,
+    CBAK,
+    CBAK_FAILED,
+    OUTGOING, // the hook on its own emitted payments
+    KINDS
+};
+const char *const KIND_NAMES[KINDS] = {"",       "make",  "cancel", "take",        "repay",   "close",
+                                       "resend", "flush", "cbak",   "cbak failed", "outgoing"};
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: loan_market [-d DIR] [-a AGENTS] [-m MAKES] [-t TAKE] [--default RATE] [--patience PATIENCE]\n"
+            "                   [--period MIN,MAX] [--currencies N] [--resend P] [--flush FLUSH] [--fail RATE]\n"
+            "                   [-i INTERVAL] [-l LEDGERS] [--drain LEDGERS] [-e EVERY] [-s SEED]\n");
+}
+
+// "MIN,MAX", false unless 1 <= MIN <= MAX <= 9999
+bool range(const std::string &arg, uint32_t &lo, uint32_t &hi)
+{
+    char *end;
+    lo = (uint32_t)strtoul(arg.c_str(), &end, 10);
+    if (*end != ',')
+        return false;
+    hi = (uint32_t)strtoul(end + 1, &end, 10);
+    return !*end && lo >= 1 && lo <= hi && hi <= 9999;
+}
+
+uint64_t read_be(const uint8_t *p, int n)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < n; ++i)
+        v = v << 8 | p[i];
+    return v;
+}
+
+uint64_t percentile(const std::vector<uint64_t> &sorted, double p)
+{
+    return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+const uint8_t *field(const std::vector<uint8_t> &blob, uint32_t code, size_t size)
+{
+    sto::Index index;
+    if (!index.parse(blob.data(), blob.size()))
+        return nullptr;
+    uint32_t n = index.find(sto::Index::ROOT, code);
+    if (n == sto::Index::NOT_FOUND || index.field(n).payload_size != size)
+        return nullptr;
+    return index.payload(n);
+}
+
+Amount amount(int currency, uint64_t value, const AccountID issuers[CURRENCIES])
+{
+    if (currency == 0)
+        return drops(value);
+    return Amount{value, CURRENCY_NAMES[currency], issuers[currency]};
+}
+
+// what one scan of the hook state found
+struct Occupancy
+{
+    uint64_t waiting = 0;
+    uint64_t running = 0;
+    uint64_t records = 0; // outbox records, one per owed account
+    uint64_t outbox = 0;  // outbox entries: records, queue entries and meta
+    uint64_t entries = 0; // all of them
+    uint64_t counter = 0;
+    int64_t drift() const { return (int64_t)counter - (int64_t)(waiting + running + outbox); }
+};
+
+// an offer as the agents remember it
+struct Offer
+{
+    uint32_t made;
+    uint32_t patience; // the ledger its maker cancels in
+    uint32_t taken = 0;
+    uint32_t repay = 0; // the ledger the borrower repays in, 0 for a default
+};
+
+struct Counts
+{
+    uint64_t sent = 0;
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+};
+
+// the rows between two printed ones
+struct Row
+{
+    uint64_t accepted[KINDS] = {};
+    uint64_t rejected = 0;
+    uint64_t ceiling = 0; // makes rejected over MAX_STATES
+    uint64_t failed = 0;  // emitted payments
+};
+
+struct Drift
+{
+    uint32_t seq;
+    int64_t before;
+    int64_t after;
+    Row applied;
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string dir = "build/release";
+    uint32_t agents = 100, patience = 48, period_lo = 1, period_hi = 7, flush = 0, ledgers = 500, drain = 2000;
+    uint32_t every = 25;
+    int currencies = CURRENCIES;
+    double makes = 5, take = 0.05, default_rate = 0.1, resend = 0.2;
+    ledger::Options options;
+    options.close_interval = 3600;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-d" && i + 1 < argc)
+            dir = argv[++i];
+        else if (arg == "-a" && i + 1 < argc)
+            agents = std::max(2UL, strtoul(argv[++i], nullptr, 0));
+        else if (arg == "-m" && i + 1 < argc)
+            makes = strtod(argv[++i], nullptr);
+        else if (arg == "-t" && i + 1 < argc)
+            take = strtod(argv[++i], nullptr);
+        else if (arg == "--default" && i + 1 < argc)
+            default_rate = strtod(argv[++i], nullptr);
+        else if (arg == "--patience" && i + 1 < argc)
+            patience = std::max(1UL, strtoul(argv[++i], nullptr, 0));
+        else if (arg == "--period" && i + 1 < argc)
+        {
+            if (!range(argv[++i], period_lo, period_hi))
+            {
+                usage();
+                return 2;
+            }
+        }
+        else if (arg == "--currencies" && i + 1 < argc)
+            currencies = std::min(CURRENCIES, std::max(1, atoi(argv[++i])));
+        else if (arg == "--resend" && i + 1 < argc)
+            resend = strtod(argv[++i], nullptr);
+        else if (arg == "--flush" && i + 1 < argc)
+            flush = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "--fail" && i + 1 < argc)
+            options.fail_rate = strtod(argv[++i], nullptr);
+        else if (arg == "-i" && i + 1 < argc)
+            options.close_interval = std::max(1UL, strtoul(argv[++i], nullptr, 0));
+        else if (arg == "-l" && i + 1 < argc)
+            ledgers = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "--drain" && i + 1 < argc)
+            drain = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "-e" && i + 1 < argc)
+            every = std::max(1UL, strtoul(argv[++i], nullptr, 0));
+        else if (arg == "-s" && i + 1 < argc)
+            options.seed = strtoull(argv[++i], nullptr, 0);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (makes < 0 || take < 0 || take > 1 || default_rate < 0 || default_rate > 1 || resend < 0 || resend > 1)
+    {
+        usage();
+        return 2;
+    }
+
+    std::string path = dir + "/loan.wasm";
+    std::vector<uint8_t> wasm;
+    if (!util::read_file(path, wasm))
+    {
+        fprintf(stderr, "loan_market: cannot read %s\n", path.c_str());
+        return 2;
+    }
+
+    // what the observer learns
+    std::map<std::pair<AccountID, uint32_t>, Kind> pending; // by account and sequence
+    Counts counts[KINDS];
+    std::map<std::pair<int, int64_t>, uint64_t> rejections; // by action and exit code
+    std::vector<uint64_t> accepted_cost[KINDS], rejected_cost[KINDS];
+    Row row, ledger_row;
+    uint64_t failed = 0;
+
+    options.close_time = OPEN_TIME;
+    options.observe = [&](const ledger::Applied &a) {
+        if (a.emitted)
+        {
+            if (a.result != ledger::tesSUCCESS)
+            {
+                ++failed;
+                ++row.failed;
+                ++ledger_row.failed;
+            }
+            accepted_cost[OUTGOING].push_back(a.instructions);
+            if (a.cbak == hostapi::Exit::NONE)
+                return;
+            Kind k = a.result == ledger::tesSUCCESS ? CBAK : CBAK_FAILED;
+            ++counts[k].sent;
+            ++(a.cbak == hostapi::Exit::ACCEPT ? counts[k].accepted : counts[k].rejected);
+            (a.cbak == hostapi::Exit::ACCEPT ? accepted_cost[k] : rejected_cost[k]).push_back(a.cbak_instructions);
+            return;
+        }
+        const uint8_t *from = field(*a.blob, sfAccount, ACCOUNT_ID_SIZE);
+        const uint8_t *seq = field(*a.blob, sfSequence, 4);
+        if (!from || !seq)
+            return;
+        AccountID id;
+        std::memcpy(id.data(), from, ACCOUNT_ID_SIZE);
+        auto it = pending.find({id, (uint32_t)read_be(seq, 4)});
+        if (it == pending.end())
+            return;
+        Kind k = it->second;
+        pending.erase(it);
+        if (a.result == ledger::tesSUCCESS)
+        {
+            ++counts[k].accepted;
+            ++row.accepted[k];
+            ++ledger_row.accepted[k];
+            accepted_cost[k].push_back(a.instructions);
+            return;
+        }
+        ++counts[k].rejected;
+        ++row.rejected;
+        ++ledger_row.rejected;
+        ++rejections[{k, a.code}];
+        rejected_cost[k].push_back(a.instructions);
+        if (k == MAKE && a.code == TOO_BIG)
+        {
+            ++row.ceiling;
+            ++ledger_row.ceiling;
+        }
+    };
+
+    ledger::Simulator sim(options);
+    const AccountID hook_id = account(0);
+    std::string error;
+    hostapi::Context *ctx = sim.add_hook(hook_id.data(), wasm, error);
+    if (!ctx)
+    {
+        fprintf(stderr, "loan_market: %s: %s\n", path.c_str(), error.c_str());
+        return 2;
+    }
+
+    // agents with trustlines to every issuer, well above what they offer
+    AccountID issuers[CURRENCIES] = {};
+    for (int c = 1; c < CURRENCIES; ++c)
+        issuers[c] = named(ISSUERS[c]);
+    const AccountID operator_id = named(OPERATOR);
+    std::vector<AccountID> ids;
+    std::map<AccountID, uint32_t> sequences;
+    for (uint32_t n = 0; n < agents; ++n)
+    {
+        AccountID id = account(1000 + n);
+        ids.push_back(id);
+        sequences[id] = 1;
+        for (int c = 1; c < CURRENCIES; ++c)
+        {
+            uint8_t code[keylet::CURRENCY_SIZE] = {0};
+            std::memcpy(code + 12, CURRENCY_NAMES[c], 3);
+            sto::Writer line;
+            line.uint(sfLedgerEntryType, keylet::LT_RIPPLE_STATE, 2);
+            line.uint(sfFlags, 0, 4);
+            line.iou(sfLowLimit, 1000000000000000ULL, 0, CURRENCY_NAMES[c], issuers[c].data());
+            line.iou(sfHighLimit, 1000000000000000ULL, 0, CURRENCY_NAMES[c], id.data());
+            hostapi::Keylet k;
+            keylet::line(issuers[c].data(), id.data(), code).serialize(k.data());
+            sim.set_entry(k, line.out);
+        }
+    }
+    sequences[operator_id] = 1;
+
+    auto send = [&](const AccountID &from, const Amount &amt, const std::string &memo, Kind k, uint32_t seq) {
+        uint32_t &sequence = sequences[from];
+        pending[{from, sequence}] = k;
+        ++counts[k].sent;
+        sim.submit(payment(from, hook_id, amt, 0, sequence++, memo), seq);
+    };
+    // the ledger_last_time the hook sees while ledger seq is built
+    auto last_time = [&](uint32_t seq) {
+        return (uint64_t)options.close_time + (uint64_t)(seq - options.first_ledger) * options.close_interval;
+    };
+
+    std::mt19937_64 rng(options.seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::poisson_distribution<uint32_t> arrivals(makes);
+    std::uniform_int_distribution<uint32_t> pick(0, agents - 1), units(10, 1000), period(period_lo, period_hi);
+    std::uniform_int_distribution<int> currency(0, currencies - 1), role(1, 2);
+
+    std::map<LoanID, Offer> offers;
+    std::map<int, std::vector<uint64_t>> time_to_take; // ledgers, by loan currency
+    std::map<int, uint64_t> made_in;                    // offers by loan currency
+    std::vector<Drift> drifts;
+    Occupancy peak, last;
+    uint64_t peak_total = 0, ceiling_ledgers = 0, defaults = 0;
+    int64_t max_drift = 0;
+    uint32_t first = options.first_ledger, stop = first + ledgers, end = stop + drain, seq = first;
+    bool drained = false;
+
+    printf("%-8s %6s %6s %6s %6s %6s %6s %8s %8s %8s %8s %8s %8s %6s\n", "ledger", "made", "taken", "repaid", "closed",
+           "cancel", "resent", "rejected", "ceiling", "waiting", "running", "outbox", "counter", "drift");
+    for (; seq < end; ++seq)
+    {
+        // the hook state after the last close
+        hookstate::Map state;
+        ctx->state.flatten(state);
+        Occupancy now;
+        std::vector<std::pair<LoanID, const uint8_t *>> live;
+        std::vector<AccountID> owed;
+        for (const auto &kv : state)
+        {
+            const uint8_t *key = kv.first.data() + ACCOUNT_ID_SIZE + NAMESPACE_SIZE;
+            const hookstate::Value &v = kv.second;
+            ++now.entries;
+            if (std::memcmp(key + 28, "OBX", 3) == 0)
+                ++now.outbox;
+            if (std::memcmp(key + 28, "OBXR", 4) == 0)
+            {
+                ++now.records;
+                AccountID id;
+                std::memcpy(id.data(), key, ACCOUNT_ID_SIZE);
+                owed.push_back(id);
+                continue;
+            }
+            if (std::memcmp(key + 28, "OBX", 3) == 0)
+                continue;
+            if (key[31] == COUNTER_KEY_END && v.size() == 8 &&
+                std::all_of(key, key + 31, [](uint8_t b) { return b == 0; }))
+            {
+                now.counter = read_be(v.data(), 8);
+                continue;
+            }
+            if (v.size() != LOAN_SIZE)
+                continue;
+            now.waiting += v[LOAN_STATE] == WAITING;
+            now.running += v[LOAN_STATE] == RUNNING;
+            LoanID id;
+            std::memcpy(id.data(), key, id.size());
+            live.push_back({id, v.data()});
+        }
+        std::sort(live.begin(), live.end());
+        std::sort(owed.begin(), owed.end());
+
+        if (seq > first && now.drift() != last.drift())
+            drifts.push_back(Drift{seq - 1, last.drift(), now.drift(), ledger_row});
+        max_drift = std::max(max_drift, std::abs(now.drift()));
+        peak.waiting = std::max(peak.waiting, now.waiting);
+        peak.running = std::max(peak.running, now.running);
+        peak.records = std::max(peak.records, now.records);
+        peak.counter = std::max(peak.counter, now.counter);
+        peak_total = std::max(peak_total, now.entries);
+        ceiling_ledgers += now.counter > MAX_STATES;
+        if (seq > first && ((seq - first) % every == 0))
+        {
+            printf("%-8u %6" PRIu64 " %6" PRIu64 " %6" PRIu64 " %6" PRIu64 " %6" PRIu64 " %6" PRIu64 " %8" PRIu64
+                   " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %6" PRId64 "\n",
+                   seq - 1, row.accepted[MAKE], row.accepted[TAKE], row.accepted[REPAY], row.accepted[CLOSE],
+                   row.accepted[CANCEL], row.accepted[RESEND] + row.accepted[FLUSH], row.rejected, row.ceiling,
+                   now.waiting, now.running, now.records, now.counter, now.drift());
+            row = Row();
+        }
+        last = now;
+        ledger_row = Row();
+
+        bool open = now.waiting || now.running || now.records || !pending.empty();
+        if (seq >= stop && !open && sim.idle())
+        {
+            drained = true;
+            break;
+        }
+
+        // offers gone from the state were cancelled, repaid or closed
+        for (auto it = offers.begin(); it != offers.end();)
+        {
+            std::pair<LoanID, const uint8_t *> probe{it->first, nullptr};
+            auto found = std::lower_bound(live.begin(), live.end(), probe);
+            if (found == live.end() || found->first != it->first)
+                it = offers.erase(it);
+            else
+                ++it;
+        }
+        uint64_t time = last_time(seq);
+        for (const auto &l : live)
+        {
+            const uint8_t *v = l.second;
+            AccountID maker, taker;
+            std::memcpy(maker.data(), v + MAKER, ACCOUNT_ID_SIZE);
+            std::memcpy(taker.data(), v + TAKER, ACCOUNT_ID_SIZE);
+            bool borrower = v[ROLE] == BORROWER;
+            int loan_currency = v[LOAN_CURRENCY], collateral_currency = v[COLLATERAL_CURRENCY];
+            uint64_t loan_amount = read_be(v + LOAN_AMOUNT, 8), collateral_amount = read_be(v + COLLATERAL_AMOUNT, 8);
+            auto it = offers.find(l.first);
+            if (it == offers.end())
+            {
+                it = offers.insert({l.first, Offer{seq - 1, seq - 1 + patience}}).first;
+                ++made_in[loan_currency];
+            }
+            Offer &o = it->second;
+            if (v[LOAN_STATE] == WAITING)
+            {
+                if (seq >= o.patience)
+                    send(maker, drops(XRP), loan_action(CANCEL, l.first), CANCEL, seq);
+                else if (uniform(rng) < take)
+                {
+                    const AccountID *by = &ids[pick(rng)];
+                    if (*by == maker)
+                        by = &ids[(by - ids.data() + 1) % ids.size()];
+                    send(*by,
+                         borrower ? amount(loan_currency, loan_amount, issuers)
+                                  : amount(collateral_currency, collateral_amount, issuers),
+                         loan_action(TAKE, l.first), TAKE, seq);
+                }
+                continue;
+            }
+            if (v[LOAN_STATE] != RUNNING)
+                continue;
+            uint64_t ends = read_be(v + TIMESTAMP_END, 8);
+            if (!o.taken)
+            {
+                o.taken = seq - 1;
+                time_to_take[loan_currency].push_back(o.taken - o.made);
+                // the last ledger that still sees the loan running
+                uint32_t due = seq;
+                while (last_time(due + 1) < ends)
+                    ++due;
+                if (uniform(rng) < default_rate)
+                    ++defaults;
+                else
+                    o.repay = std::uniform_int_distribution<uint32_t>(seq, std::max(seq, due))(rng);
+            }
+            const AccountID &lender = borrower ? taker : maker;
+            const AccountID &debtor = borrower ? maker : taker;
+            if (o.repay && seq >= o.repay)
+                send(debtor, amount(loan_currency, loan_amount, issuers), loan_action(REPAY, l.first), REPAY, seq);
+            else if (!o.repay && time >= ends)
+                send(lender, drops(XRP), loan_action(CLOSE, l.first), CLOSE, seq);
+        }
+
+        for (const AccountID &id : owed)
+            if (sequences.count(id) && id != operator_id && uniform(rng) < resend)
+                send(id, drops(XRP), loan_outbox_action(RESEND), RESEND, seq);
+        if (flush && !owed.empty() && (seq - first) % flush == 0)
+            send(operator_id, drops(XRP), loan_outbox_action(FLUSH), FLUSH, seq);
+
+        for (uint32_t n = seq < stop ? arrivals(rng) : 0; n > 0; --n)
+        {
+            const AccountID &maker = ids[pick(rng)];
+            int r = role(rng), lc = currency(rng), cc = currency(rng);
+            uint64_t la = units(rng) * XRP, ca = la * 3 / 2, sent = r == BORROWER ? ca : la;
+            send(maker, amount(r == BORROWER ? cc : lc, sent + std::max(sent / 1000, MIN_FEE), issuers),
+                 loan_offer(r, lc, la, cc, ca, INTEREST, period(rng)), MAKE, seq);
+        }
+        sim.close();
+    }
+
+    printf("\nagents        %u, %.2f offers per ledger for %u ledgers of %u s, %s after %u more\n", agents, makes,
+           ledgers, options.close_interval, drained ? "drained" : "not drained", seq - stop);
+    printf("occupancy     peak %" PRIu64 " waiting, %" PRIu64 " running, %" PRIu64 " outbox records, %" PRIu64
+           " state entries\n",
+           peak.waiting, peak.running, peak.records, peak_total);
+    auto at_ceiling = rejections.find({MAKE, TOO_BIG});
+    printf("ceiling       counter peak %" PRIu64 " of %" PRIu64 ", %" PRIu64 " ledgers above it, %" PRIu64
+           " offers rejected there\n",
+           peak.counter, MAX_STATES, ceiling_ledgers, at_ceiling == rejections.end() ? 0 : at_ceiling->second);
+    printf("drift         counter less offers and outbox entries: %" PRId64 " at the end, %" PRId64
+           " at most, changed in %zu ledgers\n",
+           last.drift(), max_drift, drifts.size());
+    for (size_t i = 0; i < drifts.size() && i < 10; ++i)
+    {
+        const Drift &d = drifts[i];
+        printf("  ledger %-8u %+" PRId64 " to %" PRId64 " after", d.seq, d.after - d.before, d.after);
+        for (int k = MAKE; k < CBAK; ++k)
+            if (d.applied.accepted[k])
+                printf(" %s %" PRIu64, KIND_NAMES[k], d.applied.accepted[k]);
+        printf(" (%" PRIu64 " emitted failed)\n", d.applied.failed);
+    }
+    printf("loans         %" PRIu64 " defaulted, %" PRIu64 " emitted payments failed\n", defaults, failed);
+    printf("time to take  ledgers by loan currency\n");
+    for (auto &kv : time_to_take)
+    {
+        std::sort(kv.second.begin(), kv.second.end());
+        printf("  %-4s %6zu of %6" PRIu64 " taken  p50 %4" PRIu64 " p90 %4" PRIu64 " max %4" PRIu64 "\n",
+               CURRENCY_NAMES[kv.first], kv.second.size(), made_in[kv.first], percentile(kv.second, 0.5),
+               percentile(kv.second, 0.9), kv.second.back());
+    }
+    printf("rejections    by action and exit code\n");
+    for (const auto &kv : rejections)
+        printf("  %-12s %-8" PRId64 " %" PRIu64 "\n", KIND_NAMES[kv.first.first], kv.first.second, kv.second);
+    printf("\n%-12s %8s %8s %8s %10s %10s %10s %10s %10s\n", "instructions", "sent", "accepted", "rejected", "p50",
+           "p90", "p99", "max", "rejected50");
+    for (int k = MAKE; k < KINDS; ++k)
+    {
+        std::vector<uint64_t> &ok = accepted_cost[k], &no = rejected_cost[k];
+        if (ok.empty() && no.empty())
+            continue;
+        std::sort(ok.begin(), ok.end());
+        std::sort(no.begin(), no.end());
+        uint64_t sent = k == OUTGOING ? ok.size() : counts[k].sent;
+        printf("%-12s %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+               " %10" PRIu64 "\n",
+               KIND_NAMES[k], sent, k == OUTGOING ? sent : counts[k].accepted, counts[k].rejected,
+               percentile(ok, 0.5), percentile(ok, 0.9), percentile(ok, 0.99), ok.empty() ? 0 : ok.back(),
+               percentile(no, 0.5));
+    }
+    return drained && last.drift() == 0 ? 0 : 1;
+}
@@ -0,0 +1,392 @@
+/**
+ * sale_rush - drop-opening load on a launchpad or ticket hook, through the ledger simulation
+ *
+ * Installs one sale hook (launchpad_*.c or ticket_*.c, read from
+ * DIR/<hook>.wasm) on a tools/host/ledger Simulator, sets the sale up in the
+ * first ledger and opens it OPEN ledgers later to BUYERS buyers. Each buyer
+ * arrives once within WINDOW ledgers of the opening, drawn from a curve:
+ *
+ *   burst  all in the opening ledger
+ *   flat   evenly over the window
+ *   ramp   more and more towards the end of the window
+ *   decay  most at the opening, fewer after
+ *
+ * and pays the price of one category, drawn with the weights of --mix (one
+ * per category, even by default). A rejected buy is sent again in the next
+ * ledger up to RETRIES times; a buyer whose NFT offer failed asks for it again
+ * (tag 3). --fail makes that share of emitted transactions fail tecPATH_DRY,
+ * --capacity bounds the emitted transactions applied per ledger.
+ *
+ * Each buy emits an offer, and a mint of the next NFT whose cbak stores its
+ * id: a buy that arrives before that callback is rejected. The report has one
+ * row per ledger with activity (buyers arriving, buys sent, accepted and
+ * rejected, offers delivered, emitted transactions failed, callbacks and the
+ * emitted backlog after the close), then the rejections by hook exit code,
+ * the callback lag (ledgers from a buy until its chain of emitted
+ * transactions and callbacks completed) and the time to sell out.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/sale_rush.cpp tools/host/actions.cpp
+ *        tools/host/ledger.cpp tools/wasm/module.cpp tools/wasm/instr.cpp tools/wasm/interp.cpp
+ *        tools/host/hostapi.cpp tools/host/hookstate.cpp tools/host/snapshot.cpp tools/host/stobject.cpp
+ *        tools/host/xfl.cpp tools/host/base58.cpp tools/host/sha256.cpp tools/host/keylet.cpp
+ *        tools/host/sha512.cpp tools/host/util.cpp -o build/sale_rush
+ * Usage: sale_rush [-d DIR] [-b BUYERS] [--curve burst|flat|ramp|decay] [-w WINDOW] [--open OPEN]
+ *                  [--mix W,W...] [--retries RETRIES] [--fail RATE] [--capacity N] [-l LEDGERS] [-s SEED] HOOK
+ *
+ * Exit status is 0 when the run settled, 1 when it was still busy after
+ * LEDGERS ledgers, 2 on usage or load errors.
+ */
+
+#include "host/actions.h"
+#include "host/ledger.h"
+#include "host/util.h"
+#include "sfcodes.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using namespace actions;
+
+// the destination tags of the sale hooks
+constexpr uint32_t SETUP = 1;
+constexpr uint32_t BUY = 2;
+constexpr uint32_t RETRY = 3;
+
+constexpr uint16_t ttNFTOKEN_CREATE_OFFER = 27;
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: sale_rush [-d DIR] [-b BUYERS] [--curve burst|flat|ramp|decay] [-w WINDOW] [--open OPEN]\n"
+            "                 [--mix W,W...] [--retries RETRIES] [--fail RATE] [--capacity N] [-l LEDGERS] [-s SEED]"
+            " HOOK\n");
+}
+
+// "a,b,c" as numbers, false when one does not parse
+bool split(const std::string &list, std::vector<double> &out)
+{
+    std::istringstream in(list);
+    std::string item;
+    out.clear();
+    while (std::getline(in, item, ','))
+    {
+        char *end;
+        double v = strtod(item.c_str(), &end);
+        if (item.empty() || *end || v < 0)
+            return false;
+        out.push_back(v);
+    }
+    return !out.empty();
+}
+
+uint32_t percentile(const std::vector<uint32_t> &sorted, double p)
+{
+    return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+// the ledger, from 0, a buyer arrives in
+uint32_t arrival(const std::string &curve, uint32_t window, std::mt19937_64 &rng)
+{
+    double u = std::uniform_real_distribution<double>(0, 1)(rng);
+    double at = 0;
+    if (curve == "flat")
+        at = u;
+    else if (curve == "ramp")
+        at = std::sqrt(u);
+    else if (curve == "decay")
+        at = 1 - std::sqrt(1 - u);
+    return std::min(window - 1, (uint32_t)(at * window));
+}
+
+const uint8_t *field(const std::vector<uint8_t> &blob, uint32_t code, size_t size)
+{
+    sto::Index index;
+    if (!index.parse(blob.data(), blob.size()))
+        return nullptr;
+    uint32_t n = index.find(sto::Index::ROOT, code);
+    if (n == sto::Index::NOT_FOUND || index.field(n).payload_size != size)
+        return nullptr;
+    return index.payload(n);
+}
+
+struct Buyer
+{
+    AccountID id;
+    uint32_t arrives;
+    size_t category;
+    uint32_t sequence = 1;
+    int attempts = 0;
+    bool bought = false;
+};
+
+// one ledger's row
+struct Row
+{
+    uint32_t arrived = 0;
+    uint32_t sent = 0;
+    uint32_t accepted = 0;
+    uint32_t rejected = 0;
+    uint32_t delivered = 0; // offers
+    uint32_t failed = 0;    // emitted transactions
+    uint32_t retries = 0;   // offers asked for again and accepted
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string dir = "build/release", curve = "flat", name;
+    uint32_t buyers = 2000, window = 10, open = 2, max_ledgers = 1000;
+    int retries = 3;
+    std::vector<double> mix;
+    ledger::Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-d" && i + 1 < argc)
+            dir = argv[++i];
+        else if (arg == "-b" && i + 1 < argc)
+            buyers = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "--curve" && i + 1 < argc)
+            curve = argv[++i];
+        else if (arg == "-w" && i + 1 < argc)
+            window = std::max(1UL, strtoul(argv[++i], nullptr, 0));
+        else if (arg == "--open" && i + 1 < argc)
+            open = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "--mix" && i + 1 < argc)
+        {
+            if (!split(argv[++i], mix))
+            {
+                usage();
+                return 2;
+            }
+        }
+        else if (arg == "--retries" && i + 1 < argc)
+            retries = std::max(0, atoi(argv[++i]));
+        else if (arg == "--fail" && i + 1 < argc)
+            options.fail_rate = strtod(argv[++i], nullptr);
+        else if (arg == "--capacity" && i + 1 < argc)
+            options.capacity = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "-l" && i + 1 < argc)
+            max_ledgers = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "-s" && i + 1 < argc)
+            options.seed = strtoull(argv[++i], nullptr, 0);
+        else if (!arg.empty() && arg[0] != '-' && name.empty())
+            name = arg;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    const Hook *hook = nullptr;
+    for (const Hook &h : hooks())
+        if (name == h.name && (h.family & SALE))
+            hook = &h;
+    if (!hook || (curve != "burst" && curve != "flat" && curve != "ramp" && curve != "decay"))
+    {
+        usage();
+        return 2;
+    }
+    if (mix.empty())
+        mix.assign(hook->prices.size(), 1);
+    if (mix.size() != hook->prices.size())
+    {
+        fprintf(stderr, "sale_rush: %s has %zu categories\n", hook->name, hook->prices.size());
+        return 2;
+    }
+
+    std::string path = dir + "/" + hook->name + ".wasm";
+    std::vector<uint8_t> wasm;
+    if (!util::read_file(path, wasm))
+    {
+        fprintf(stderr, "sale_rush: cannot read %s\n", path.c_str());
+        return 2;
+    }
+
+    // what the observer learns, by ledger and by chain
+    std::map<uint32_t, Row> rows;
+    std::map<AccountID, size_t> by_account;
+    std::vector<Buyer> agents;
+    std::multimap<uint32_t, size_t> retry_at;   // buys sent again
+    std::multimap<uint32_t, size_t> reoffer_at; // offers asked for again
+    std::set<uint64_t> buys;                    // chains of accepted buys
+    std::map<int64_t, uint64_t> rejections;     // by exit code
+    std::vector<uint32_t> lag;
+    std::vector<uint32_t> sold(hook->prices.size(), 0), last_sale(hook->prices.size(), 0);
+    uint32_t last_buy = 0, gave_up = 0;
+    uint64_t rejected_since = 0; // the last accepted buy
+
+    options.close_time = OPEN_TIME;
+    options.observe = [&](const ledger::Applied &a) {
+        Row &row = rows[a.seq];
+        if (a.emitted)
+        {
+            if (a.result != ledger::tesSUCCESS)
+                ++row.failed;
+            if (a.type != ttNFTOKEN_CREATE_OFFER)
+                return;
+            const uint8_t *to = field(*a.blob, sfDestination, ACCOUNT_ID_SIZE);
+            AccountID id{};
+            if (to)
+                std::memcpy(id.data(), to, ACCOUNT_ID_SIZE);
+            auto it = by_account.find(id);
+            if (a.result == ledger::tesSUCCESS)
+                ++row.delivered;
+            else if (it != by_account.end())
+                reoffer_at.insert({a.seq + 1, it->second});
+            return;
+        }
+        const uint8_t *from = field(*a.blob, sfAccount, ACCOUNT_ID_SIZE);
+        const uint8_t *tag = field(*a.blob, sfDestinationTag, 4);
+        AccountID id{};
+        if (from)
+            std::memcpy(id.data(), from, ACCOUNT_ID_SIZE);
+        auto it = by_account.find(id);
+        uint32_t t = tag ? (uint32_t)tag[0] << 24 | (uint32_t)tag[1] << 16 | (uint32_t)tag[2] << 8 | tag[3] : 0;
+        if (it == by_account.end() || (t != BUY && t != RETRY))
+            return;
+        Buyer &b = agents[it->second];
+        bool ok = a.result == ledger::tesSUCCESS;
+        if (t == RETRY)
+        {
+            row.retries += ok;
+            return;
+        }
+        if (ok)
+        {
+            ++row.accepted;
+            b.bought = true;
+            buys.insert(a.chain);
+            ++sold[b.category];
+            last_sale[b.category] = a.seq;
+            last_buy = a.seq;
+            rejected_since = 0;
+            return;
+        }
+        ++row.rejected;
+        ++rejections[a.code];
+        ++rejected_since;
+        if (b.attempts <= retries)
+            retry_at.insert({a.seq + 1, it->second});
+        else
+            ++gave_up;
+    };
+    options.completed = [&](uint64_t chain, uint32_t ledgers) {
+        if (buys.erase(chain))
+            lag.push_back(ledgers);
+    };
+
+    ledger::Simulator sim(options);
+    const AccountID hook_id = account(0);
+    std::string error;
+    if (!sim.add_hook(hook_id.data(), wasm, error))
+    {
+        fprintf(stderr, "sale_rush: %s: %s\n", path.c_str(), error.c_str());
+        return 2;
+    }
+
+    std::mt19937_64 rng(options.seed);
+    std::discrete_distribution<size_t> categories(mix.begin(), mix.end());
+    uint32_t first = options.first_ledger, opening = first + open;
+    for (uint32_t i = 0; i < buyers; ++i)
+    {
+        Buyer b;
+        b.id = account(1000 + i);
+        b.arrives = opening + arrival(curve, window, rng);
+        b.category = categories(rng);
+        by_account[b.id] = agents.size();
+        agents.push_back(b);
+        ++rows[b.arrives].arrived;
+    }
+    uint32_t operator_sequence = 1;
+    sim.submit(payment(account(4), hook_id, drops(XRP), SETUP, operator_sequence++, ""), first);
+
+    auto buy = [&](size_t n, uint32_t seq) {
+        Buyer &b = agents[n];
+        ++b.attempts;
+        ++rows[seq].sent;
+        sim.submit(payment(b.id, hook_id, drops(hook->prices[b.category]), BUY, b.sequence++, ""), seq);
+    };
+    std::multimap<uint32_t, size_t> arrivals;
+    for (size_t n = 0; n < agents.size(); ++n)
+        arrivals.insert({agents[n].arrives, n});
+
+    uint32_t closed = 0;
+    for (; closed < max_ledgers; ++closed)
+    {
+        uint32_t seq = sim.ledger_seq() + 1;
+        auto range = arrivals.equal_range(seq);
+        for (auto it = range.first; it != range.second; ++it)
+            buy(it->second, seq);
+        range = retry_at.equal_range(seq);
+        for (auto it = range.first; it != range.second; ++it)
+            buy(it->second, seq);
+        range = reoffer_at.equal_range(seq);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            Buyer &b = agents[it->second];
+            sim.submit(payment(b.id, hook_id, drops(XRP), RETRY, b.sequence++, ""), seq);
+        }
+        bool more = arrivals.upper_bound(seq) != arrivals.end() || retry_at.upper_bound(seq) != retry_at.end() ||
+                    reoffer_at.upper_bound(seq) != reoffer_at.end();
+        if (sim.idle() && !more)
+            break;
+        sim.close();
+    }
+
+    printf("%-8s %8s %8s %8s %8s %9s %8s %8s %8s %8s\n", "ledger", "arrived", "sent", "accepted", "rejected",
+           "delivered", "reoffers", "failed", "cbak", "backlog");
+    uint64_t accepted = 0, rejected = 0, delivered = 0, failed = 0, reoffers = 0;
+    for (const ledger::Close &c : sim.stats().closes)
+    {
+        const Row &r = rows[c.seq];
+        accepted += r.accepted;
+        rejected += r.rejected;
+        delivered += r.delivered;
+        failed += r.failed;
+        reoffers += r.retries;
+        if (!r.arrived && !r.sent && !c.emitted && !c.callbacks && !c.backlog)
+            continue;
+        printf("%-8u %8u %8u %8u %8u %9u %8u %8u %8zu %8zu\n", c.seq, r.arrived, r.sent, r.accepted, r.rejected,
+               r.delivered, r.retries, r.failed, c.callbacks, c.backlog);
+    }
+
+    const ledger::Stats &s = sim.stats();
+    std::sort(lag.begin(), lag.end());
+    printf("\nbuyers        %u over %u ledgers (%s) from ledger %u, %" PRIu64 " bought, %u gave up\n", buyers, window,
+           curve.c_str(), opening, accepted, gave_up);
+    printf("buys          %" PRIu64 " accepted, %" PRIu64 " rejected\n", accepted, rejected);
+    for (const auto &kv : rejections)
+        printf("  code %-8" PRId64 " %" PRIu64 "\n", kv.first, kv.second);
+    printf("emitted       %" PRIu64 " queued, %" PRIu64 " offers delivered, %" PRIu64 " failed, %" PRIu64
+           " offers asked for again, %" PRIu64 " expired, max backlog %zu\n",
+           s.emitted, delivered, failed, reoffers, s.expired, s.max_backlog);
+    printf("callback lag  ledgers p50 %u p90 %u p99 %u max %u over %zu buys\n", percentile(lag, 0.5),
+           percentile(lag, 0.9), percentile(lag, 0.99), lag.empty() ? 0 : lag.back(), lag.size());
+    for (size_t c = 0; c < sold.size(); ++c)
+        printf("category %zu    %u sold at %" PRIu64 " drops, last in ledger %u\n", c, sold[c], hook->prices[c],
+               last_sale[c]);
+    // demand left over once sales stopped
+    if (last_buy && rejected_since)
+        printf("sold out      %u ledgers after opening, %" PRIu64 " buys rejected after the last sale\n",
+               last_buy - opening + 1, rejected_since);
+    else
+        printf("sold out      not within the run\n");
+    bool settled = closed < max_ledgers;
+    if (!settled)
+        printf("still busy after %u ledgers\n", closed);
+    return settled ? 0 : 1;
+}
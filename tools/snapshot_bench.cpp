@@ -0,0 +1,192 @@
+/**
+ * snapshot_bench - cross-checks and times hook state snapshots (tools/host/snapshot)
+ *
+ * Generates COUNT state entries shaped like the loan and launchpad hooks'
+ * (85 byte loan records, 42 byte buyer records, 32 byte NFT IDs), writes a
+ * snapshot and checks every entry reads back through a hookstate::Store
+ * with the snapshot attached, then that overlay writes and erasures flatten
+ * to the expected state. Times writing, opening and reading the snapshot
+ * against rebuilding the same state in memory.
+ *
+ * Build: g++ -std=c++17 -O2 -Itools tools/snapshot_bench.cpp tools/host/snapshot.cpp tools/host/hookstate.cpp tools/host/util.cpp -o build/snapshot_bench
+ * Usage: snapshot_bench [-n COUNT] [-s SEED] [-o FILE]
+ *
+ * Exit status is 0 when every check passes, 1 otherwise.
+ */
+
+#include "host/hookstate.h"
+#include "host/snapshot.h"
+#include "host/util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace hookstate;
+
+namespace
+{
+
+void report(const char *name, size_t n, double secs)
+{
+    std::printf("%-28s %10.3f ms %12.1f ns/entry\n", name, secs * 1e3, secs * 1e9 / n);
+}
+
+struct Shape
+{
+    uint8_t account_seed;
+    uint8_t ns_tag;
+    size_t value_size;
+};
+
+// loan records, launchpad buyers and NFT IDs
+const Shape SHAPES[] = {{1, 0x00, 85}, {2, 0x00, 42}, {2, 0x01, 32}};
+
+Map generate(size_t n, uint64_t seed, std::vector<Key> &keys)
+{
+    std::mt19937_64 rng(seed);
+    Map state;
+    state.reserve(n);
+    keys.clear();
+    for (size_t i = 0; i < n; ++i)
+    {
+        const Shape &s = SHAPES[i % 3];
+        uint8_t account[ACCOUNT_ID_SIZE], ns[NAMESPACE_SIZE] = {0}, key[KEY_SIZE] = {0};
+        std::memset(account, s.account_seed, sizeof(account));
+        ns[NAMESPACE_SIZE - 1] = s.ns_tag;
+        // counters for loans, account IDs (random) for buyers and NFTs
+        if (s.value_size == 85)
+            for (int b = 0; b < 8; ++b)
+                key[KEY_SIZE - 1 - b] = (uint8_t)(i >> (8 * b));
+        else
+            for (size_t b = KEY_SIZE - ACCOUNT_ID_SIZE; b < KEY_SIZE; ++b)
+                key[b] = (uint8_t)rng();
+        Value v(s.value_size);
+        for (uint8_t &b : v)
+            b = (uint8_t)rng();
+        Key k = make_key(account, ns, key);
+        keys.push_back(k);
+        state[k] = v;
+    }
+    return state;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t n = 1000000;
+    uint64_t seed = 1;
+    std::string path = "/tmp/snapshot_bench." + std::to_string(getpid());
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "-n") && i + 1 < argc)
+            n = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-s") && i + 1 < argc)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-o") && i + 1 < argc)
+            path = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "usage: %s [-n COUNT] [-s SEED] [-o FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Key> keys;
+    Map state;
+    double t_build = util::seconds([&] { state = generate(n, seed, keys); });
+    n = state.size();
+
+    std::string error;
+    bool written = false;
+    double t_write = util::seconds([&] { written = snapshot::write(path, state, error); });
+    if (!written)
+    {
+        std::fprintf(stderr, "snapshot_bench: %s\n", error.c_str());
+        return 1;
+    }
+
+    snapshot::Snapshot snap;
+    bool opened = false;
+    double t_open = util::seconds([&] { opened = snap.open(path, error); });
+    if (!opened)
+    {
+        std::fprintf(stderr, "snapshot_bench: %s\n", error.c_str());
+        return 1;
+    }
+
+    // every entry through a store over the snapshot
+    int failures = 0;
+    Store store;
+    store.attach(&snap);
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(seed));
+    size_t found = 0;
+    double t_read = util::seconds([&] {
+        for (size_t i : order)
+        {
+            size_t size;
+            found += store.get(keys[i], size) != nullptr;
+        }
+    });
+    for (const Key &k : keys)
+    {
+        size_t size;
+        const uint8_t *v = store.get(k, size);
+        const Value &expected = state.at(k);
+        if (!v || size != expected.size() || std::memcmp(v, expected.data(), size) != 0)
+            ++failures;
+    }
+
+    // changes over the snapshot: rewrite, erase, add, one rolled back
+    Map expected = state;
+    std::mt19937_64 rng(seed + 1);
+    for (size_t i = 0; i < 1000 && !keys.empty(); ++i)
+    {
+        const Key &k = keys[rng() % keys.size()];
+        uint8_t v[3] = {(uint8_t)i, 1, 2};
+        bool erase = rng() & 1;
+        store.set(k, v, erase ? 0 : sizeof(v));
+        if (rng() % 4 == 0)
+            store.rollback();
+        else
+        {
+            store.commit();
+            if (erase)
+                expected.erase(k);
+            else
+                expected[k].assign(v, v + sizeof(v));
+        }
+    }
+    Map flat;
+    store.flatten(flat);
+    if (flat != expected)
+        ++failures;
+
+    Map rebuilt;
+    double t_rebuild = util::seconds([&] { rebuilt = state; });
+
+    struct stat st;
+    std::printf("%zu entries in %zu groups, %.1f MB\n", n, snap.group_count(),
+                stat(path.c_str(), &st) == 0 ? st.st_size / 1e6 : 0.0);
+    report("generate", n, t_build);
+    report("write snapshot", n, t_write);
+    report("open snapshot", n, t_open);
+    report("read all, random order", n, t_read);
+    report("rebuild map from memory", n, t_rebuild);
+    std::printf("cross-check: %s\n", failures ? "FAIL" : "ok");
+
+    snap.close();
+    std::remove(path.c_str());
+    return failures || found != n ? 1 : 0;
+}
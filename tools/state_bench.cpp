@@ -0,0 +1,212 @@
+/**
+ * state_bench - cross-checks and times the hook state overlay in tools/host/hookstate
+ *
+ * Runs random executions (reads, writes and erasures, then accept or
+ * rollback) against a hookstate::Store and against a plain map that is copied
+ * before each execution and restored on rollback, checking every read and the
+ * final state agree. Then loads COUNT entries (loan sized records) and times
+ * executions of a few writes ending in rollback or accept both ways.
+ *
+ * Build: g++ -std=c++17 -O2 -Itools tools/state_bench.cpp tools/host/hookstate.cpp tools/host/snapshot.cpp tools/host/util.cpp -o build/state_bench
+ * Usage: state_bench [-n COUNT] [-w WRITES] [-s SEED]
+ *
+ * Exit status is 0 when every check passes, 1 otherwise.
+ */
+
+#include "host/hookstate.h"
+#include "host/util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace hookstate;
+
+namespace
+{
+
+const uint8_t ACCOUNT[ACCOUNT_ID_SIZE] = {0xB5, 0xF7, 0x62, 0x79, 0x8A, 0x53, 0xD5, 0x43, 0xA0, 0x14,
+                                          0xCA, 0xF8, 0xB2, 0x97, 0xCF, 0xF8, 0xF2, 0xF9, 0x37, 0xE8};
+const uint8_t NS[NAMESPACE_SIZE] = {0};
+
+// keys as the hooks build them: a small counter, left-padded
+Key counter_key(uint64_t i)
+{
+    uint8_t k[KEY_SIZE] = {0};
+    for (int b = 0; b < 8; ++b)
+        k[KEY_SIZE - 1 - b] = (uint8_t)(i >> (8 * b));
+    return make_key(ACCOUNT, NS, k);
+}
+
+Value random_value(std::mt19937_64 &rng)
+{
+    // loan records and per-buyer records
+    Value v(rng() & 1 ? 85 : 42);
+    for (uint8_t &b : v)
+        b = (uint8_t)rng();
+    return v;
+}
+
+void report(const char *name, size_t n, double secs)
+{
+    std::printf("%-28s %12.0f /s %12.2f us\n", name, n / secs, secs * 1e6 / n);
+}
+
+// random executions against both implementations, returns the number of mismatches
+int cross_check(uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    Store store;
+    Map plain;
+    int failures = 0;
+    const uint64_t keys = 512;
+    for (int exec = 0; exec < 20000; ++exec)
+    {
+        Map saved = plain;
+        int ops = 1 + (int)(rng() % 12);
+        for (int op = 0; op < ops; ++op)
+        {
+            Key k = counter_key(rng() % keys);
+            switch (rng() % 4)
+            {
+            case 0:
+            {
+                store.set(k, nullptr, 0);
+                plain.erase(k);
+                break;
+            }
+            case 1:
+            case 2:
+            {
+                Value v = random_value(rng);
+                store.set(k, v.data(), v.size());
+                plain[k] = v;
+                break;
+            }
+            default:
+            {
+                size_t size;
+                const uint8_t *a = store.get(k, size);
+                auto it = plain.find(k);
+                if ((a == nullptr) != (it == plain.end()) || (a && Value(a, a + size) != it->second))
+                    ++failures;
+            }
+            }
+        }
+        if (store.pending() > (size_t)ops)
+            ++failures;
+        if (rng() % 3 == 0)
+        {
+            store.rollback();
+            plain.swap(saved);
+        }
+        else
+            store.commit();
+    }
+    if (store.base() != plain)
+        ++failures;
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t n = 1000000, writes = 4;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "-n") && i + 1 < argc)
+            n = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-w") && i + 1 < argc)
+            writes = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-s") && i + 1 < argc)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [-n COUNT] [-w WRITES] [-s SEED]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int failures = cross_check(seed);
+    std::printf("cross-check: %s\n", failures ? "FAIL" : "ok");
+
+    std::mt19937_64 rng(seed);
+    Store store;
+    store.base().reserve(n);
+    for (size_t i = 0; i < n; ++i)
+        store.base()[counter_key(i)] = random_value(rng);
+    Map plain = store.base();
+
+    std::vector<Key> keys(4096);
+    std::vector<Value> values(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        keys[i] = counter_key(rng() % (n + n / 8 + 1));
+        values[i] = random_value(rng);
+    }
+    std::printf("%zu entries, %zu writes per execution\n", n, writes);
+
+    // snapshot copies are slow at this size: fewer executions
+    size_t copies = n >= 100000 ? 10 : 1000;
+    size_t runs = 1000000, at = 0;
+    double t = util::seconds([&] {
+        for (size_t r = 0; r < copies; ++r)
+        {
+            Map saved = plain;
+            for (size_t w = 0; w < writes; ++w, at = (at + 1) % keys.size())
+                plain[keys[at]] = values[at];
+            plain.swap(saved);
+        }
+    });
+    report("snapshot copy, rollback", copies, t);
+
+    t = util::seconds([&] {
+        for (size_t r = 0; r < runs; ++r)
+        {
+            for (size_t w = 0; w < writes; ++w, at = (at + 1) % keys.size())
+                store.set(keys[at], values[at].data(), values[at].size());
+            store.rollback();
+        }
+    });
+    report("overlay, rollback", runs, t);
+
+    t = util::seconds([&] {
+        for (size_t r = 0; r < runs; ++r)
+        {
+            for (size_t w = 0; w < writes; ++w, at = (at + 1) % keys.size())
+                store.set(keys[at], values[at].data(), values[at].size());
+            store.commit();
+        }
+    });
+    report("overlay, accept", runs, t);
+
+    size_t found = 0;
+    t = util::seconds([&] {
+        for (size_t r = 0; r < runs; ++r, at = (at + 1) % keys.size())
+        {
+            size_t size;
+            found += store.get(keys[at], size) != nullptr;
+        }
+    });
+    report("read through empty overlay", runs, t);
+
+    for (size_t w = 0; w < writes; ++w)
+        store.set(keys[w], values[w].data(), values[w].size());
+    t = util::seconds([&] {
+        for (size_t r = 0; r < runs; ++r, at = (at + 1) % keys.size())
+        {
+            size_t size;
+            found += store.get(keys[at], size) != nullptr;
+        }
+    });
+    report("read with pending writes", runs, t);
+    store.rollback();
+    if (found == 0)
+        ++failures;
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,459 @@
+/**
+ * state_footprint - hook state entries, bytes and owner reserve by key class, over time
+ *
+ * Every state entry a hook keeps holds owner reserve. This classifies each key
+ * by the patterns of the hooks in src/ready:
+ *
+ *   counter  zero but the last byte, 7, 8 or 9 (loan counters and fees,
+ *            sale refunds, paid and index records, lottery counters), and
+ *            the lib/opstats.h counters record (OPSC)
+ *   outbox   lib/outbox.h records, queue entries and meta (OBX + tag)
+ *   account  an account ID in the first 20 bytes, zero after (buyers,
+ *            lottery and doubler players)
+ *   index    at most two non-zero bytes (NFT ids per category, lottery numbers)
+ *   nonce    anything else: ids built from times, sequences or nonces (loans)
+ *
+ * and reports, at each point, the live entries, bytes and reserve per hook
+ * account, and at the end per class: live entries and reserve, the peak, how
+ * many were created and deleted between the points, and the oldest entries
+ * never deleted. A class whose entries were created but never deleted is
+ * flagged: nothing in the window gave its reserve back.
+ *
+ * snapshot takes the points from state snapshots (tools/host/snapshot) given
+ * in time order. run drives a workload through tools/host/ledger as ledger_sim
+ * does, the hooks run in the embedded interpreter, and takes a point every
+ * EVERY ledgers and after the last. The reserve is DROPS per entry (0.2 XRP
+ * by default).
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/state_footprint.cpp tools/host/ledger.cpp
+ *        tools/wasm/module.cpp tools/wasm/instr.cpp tools/wasm/interp.cpp tools/host/hostapi.cpp
+ *        tools/host/hookstate.cpp tools/host/snapshot.cpp tools/host/stobject.cpp tools/host/xfl.cpp
+ *        tools/host/base58.cpp tools/host/sha256.cpp tools/host/keylet.cpp tools/host/sha512.cpp
+ *        tools/host/corpus.cpp tools/host/util.cpp tools/host/workload.cpp -o build/state_footprint
+ * Usage: state_footprint snapshot [-r DROPS] [-k N] SNAPSHOT...
+ *        state_footprint run --hook RADDR=FILE [--param NAME=HEX]... [--state SNAPSHOT] [--hook ...]...
+ *                            [-e EVERY] [-l LEDGERS] [--capacity N] [--fail RATE] [--time T] [-s SEED]
+ *                            [-r DROPS] [-k N] [WORKLOAD]
+ *
+ * Exit status is 0 on success, 1 when a class only grew or a run did not
+ * complete, 2 on usage or load errors.
+ */
+
+#include "host/base58.h"
+#include "host/ledger.h"
+#include "host/snapshot.h"
+#include "host/util.h"
+#include "host/workload.h"
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using hookstate::ACCOUNT_ID_SIZE;
+using hookstate::KEY_SIZE;
+using hookstate::NAMESPACE_SIZE;
+
+namespace
+{
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: state_footprint snapshot [-r DROPS] [-k N] SNAPSHOT...\n"
+            "       state_footprint run --hook RADDR=FILE [--param NAME=HEX]... [--state SNAPSHOT] [--hook ...]...\n"
+            "                           [-e EVERY] [-l LEDGERS] [--capacity N] [--fail RATE] [--time T] [-s SEED]\n"
+            "                           [-r DROPS] [-k N] [WORKLOAD]\n");
+}
+
+std::string raddr(const uint8_t *account)
+{
+    char text[base58::RADDR_MAX];
+    size_t n = base58::encode_account(account, text);
+    return std::string(text, n);
+}
+
+enum Class
+{
+    COUNTER,
+    OUTBOX,
+    ACCOUNT,
+    INDEX,
+    NONCE,
+    CLASSES
+};
+
+const char *const CLASS_NAMES[CLASSES] = {"counter", "outbox", "account", "index", "nonce"};
+
+Class classify(const uint8_t key[KEY_SIZE])
+{
+    size_t nonzero = 0, account = 0, tail = 0;
+    for (size_t i = 0; i < KEY_SIZE; ++i)
+        if (key[i])
+        {
+            ++nonzero;
+            (i < ACCOUNT_ID_SIZE ? account : tail)++;
+        }
+    if (nonzero == 1 && key[KEY_SIZE - 1] >= 7 && key[KEY_SIZE - 1] <= 9)
+        return COUNTER;
+    if (nonzero == 4 && key[28] == 'O' && key[29] == 'P' && key[30] == 'S' && key[31] == 'C')
+        return COUNTER;
+    if (key[28] == 'O' && key[29] == 'B' && key[30] == 'X')
+        return OUTBOX;
+    if (nonzero <= 2)
+        return INDEX;
+    // loan ids leave the bytes after their time and sequence zero, account IDs
+    // fill all 20
+    if (tail == 0 && account > 12)
+        return ACCOUNT;
+    return NONCE;
+}
+
+struct Usage
+{
+    uint64_t entries = 0;
+    uint64_t bytes = 0;
+};
+
+// one class of one hook account over all points
+struct Totals
+{
+    Usage live;
+    uint64_t peak = 0;
+    uint64_t created = 0; // after the first point
+    uint64_t deleted = 0;
+};
+
+struct Life
+{
+    size_t since; // the point it appeared at
+    size_t size;
+};
+
+class Tracker
+{
+public:
+    Tracker(uint64_t reserve, size_t oldest) : reserve_(reserve), oldest_(oldest) {}
+
+    // one point in time: the whole state of every hook account observed
+    void observe(const std::string &label, const hookstate::Map &state)
+    {
+        std::map<hookstate::Key, Life> next;
+        std::map<std::string, std::array<Usage, CLASSES>> usage;
+        for (const auto &kv : state)
+        {
+            const hookstate::Key &k = kv.first;
+            if (kv.second.empty())
+                continue;
+            std::string account = raddr(k.data());
+            Class c = classify(k.data() + ACCOUNT_ID_SIZE + NAMESPACE_SIZE);
+            Usage &u = usage[account][c];
+            ++u.entries;
+            u.bytes += kv.second.size();
+            auto was = lives_.find(k);
+            if (was == lives_.end() && points_ > 0)
+                ++totals_[account][c].created;
+            next[k] = Life{was == lives_.end() ? points_ : was->second.since, kv.second.size()};
+        }
+        for (const auto &kv : lives_)
+            if (!next.count(kv.first))
+                ++totals_[raddr(kv.first.data())][classify(kv.first.data() + ACCOUNT_ID_SIZE + NAMESPACE_SIZE)]
+                      .deleted;
+        lives_.swap(next);
+
+        // accounts that emptied still get a row
+        for (const auto &kv : totals_)
+            usage[kv.first];
+        if (points_ == 0)
+        {
+            printf("%-12s %-35s %8s %10s %12s", "point", "account", "entries", "bytes", "reserve_xrp");
+            for (const char *name : CLASS_NAMES)
+                printf(" %8s", name);
+            printf("\n");
+        }
+        for (auto &kv : usage)
+        {
+            Usage all;
+            std::string counts;
+            for (int c = 0; c < CLASSES; ++c)
+            {
+                Totals &t = totals_[kv.first][c];
+                t.live = kv.second[c];
+                t.peak = std::max(t.peak, t.live.entries);
+                all.entries += t.live.entries;
+                all.bytes += t.live.bytes;
+                char count[24];
+                snprintf(count, sizeof(count), " %8" PRIu64, t.live.entries);
+                counts += count;
+            }
+            printf("%-12s %-35s %8" PRIu64 " %10" PRIu64 " %12.6f%s\n", label.c_str(), kv.first.c_str(),
+                   all.entries, all.bytes, (double)(all.entries * reserve_) / 1e6, counts.c_str());
+        }
+        labels_.push_back(label);
+        ++points_;
+    }
+
+    // the end of the window; returns the number of classes that only grew
+    size_t report() const
+    {
+        size_t grew = 0;
+        for (const auto &kv : totals_)
+        {
+            printf("\n%s after %zu points\n", kv.first.c_str(), points_);
+            printf("  %-8s %8s %10s %12s %8s %8s %8s\n", "class", "live", "bytes", "reserve_xrp", "peak", "created",
+                   "deleted");
+            for (int c = 0; c < CLASSES; ++c)
+            {
+                const Totals &t = kv.second[c];
+                if (!t.peak && !t.created && !t.deleted)
+                    continue;
+                bool only_grew = t.created > 0 && t.deleted == 0;
+                grew += only_grew;
+                printf("  %-8s %8" PRIu64 " %10" PRIu64 " %12.6f %8" PRIu64 " %8" PRIu64 " %8" PRIu64 "%s\n",
+                       CLASS_NAMES[c], t.live.entries, t.live.bytes, (double)(t.live.entries * reserve_) / 1e6, t.peak,
+                       t.created, t.deleted, only_grew ? "  never deleted" : "");
+            }
+            // the oldest live entries: what has held reserve longest
+            std::vector<std::pair<size_t, const hookstate::Key *>> held;
+            for (const auto &life : lives_)
+                if (raddr(life.first.data()) == kv.first)
+                    held.push_back({life.second.since, &life.first});
+            std::stable_sort(held.begin(), held.end(),
+                             [](const auto &a, const auto &b) { return a.first < b.first; });
+            for (size_t i = 0; i < held.size() && i < oldest_; ++i)
+            {
+                const uint8_t *key = held[i].second->data() + ACCOUNT_ID_SIZE + NAMESPACE_SIZE;
+                printf("  oldest %-8s %s since %s, %zu bytes\n", CLASS_NAMES[classify(key)],
+                       util::to_hex(key, KEY_SIZE).c_str(), labels_[held[i].first].c_str(),
+                       lives_.at(*held[i].second).size);
+            }
+        }
+        return grew;
+    }
+
+private:
+    uint64_t reserve_;
+    size_t oldest_;
+    size_t points_ = 0;
+    std::vector<std::string> labels_;
+    std::map<hookstate::Key, Life> lives_;
+    std::map<std::string, std::array<Totals, CLASSES>> totals_;
+};
+
+bool common_option(int argc, char **argv, int &i, uint64_t &reserve, size_t &oldest)
+{
+    std::string arg = argv[i];
+    if (arg == "-r" && i + 1 < argc)
+        reserve = strtoull(argv[++i], nullptr, 0);
+    else if (arg == "-k" && i + 1 < argc)
+        oldest = strtoull(argv[++i], nullptr, 0);
+    else
+        return false;
+    return true;
+}
+
+int snapshots(int argc, char **argv)
+{
+    uint64_t reserve = 200000;
+    size_t oldest = 5;
+    std::vector<std::string> paths;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (common_option(argc, argv, i, reserve, oldest))
+            continue;
+        std::string arg = argv[i];
+        if (arg.empty() || arg[0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        paths.push_back(arg);
+    }
+    if (paths.empty())
+    {
+        usage();
+        return 2;
+    }
+
+    Tracker tracker(reserve, oldest);
+    for (const std::string &path : paths)
+    {
+        snapshot::Snapshot snap;
+        std::string error;
+        if (!snap.open(path, error))
+        {
+            fprintf(stderr, "state_footprint: %s\n", error.c_str());
+            return 2;
+        }
+        hookstate::Store store;
+        store.attach(&snap);
+        hookstate::Map state;
+        store.flatten(state);
+        tracker.observe(path.substr(path.find_last_of('/') + 1), state);
+    }
+    return tracker.report() ? 1 : 0;
+}
+
+int run(int argc, char **argv)
+{
+    ledger::Options options;
+    uint32_t max_ledgers = 10000, every = 10;
+    uint64_t reserve = 200000;
+    size_t oldest = 5;
+    std::string workload_path;
+    struct HookArgs
+    {
+        std::string account, path, state;
+        std::vector<std::string> params;
+    };
+    std::vector<HookArgs> hooks;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (common_option(argc, argv, i, reserve, oldest))
+            continue;
+        std::string arg = argv[i];
+        if (arg == "--hook" && i + 1 < argc)
+        {
+            HookArgs h;
+            if (!util::split(argv[++i], h.account, h.path))
+            {
+                usage();
+                return 2;
+            }
+            hooks.push_back(h);
+        }
+        else if ((arg == "--param" || arg == "--state") && i + 1 < argc && !hooks.empty())
+        {
+            if (arg == "--param")
+                hooks.back().params.push_back(argv[++i]);
+            else
+                hooks.back().state = argv[++i];
+        }
+        else if (arg == "-e" && i + 1 < argc)
+            every = std::max(1UL, strtoul(argv[++i], nullptr, 0));
+        else if (arg == "-l" && i + 1 < argc)
+            max_ledgers = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "--capacity" && i + 1 < argc)
+            options.capacity = strtoull(argv[++i], nullptr, 0);
+        else if (arg == "--fail" && i + 1 < argc)
+            options.fail_rate = strtod(argv[++i], nullptr);
+        else if (arg == "--time" && i + 1 < argc)
+            options.close_time = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (arg == "-s" && i + 1 < argc)
+            options.seed = strtoull(argv[++i], nullptr, 0);
+        else if (!arg.empty() && (arg[0] != '-' || arg == "-") && workload_path.empty())
+            workload_path = arg;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (hooks.empty())
+    {
+        usage();
+        return 2;
+    }
+
+    ledger::Simulator sim(options);
+    std::vector<std::unique_ptr<snapshot::Snapshot>> snapshots;
+    std::vector<hostapi::Context *> contexts;
+    for (const HookArgs &h : hooks)
+    {
+        uint8_t account[ledger::ACCOUNT_ID_SIZE];
+        std::vector<uint8_t> bin;
+        std::string error;
+        if (!base58::decode_account(h.account.data(), h.account.size(), account))
+        {
+            fprintf(stderr, "state_footprint: bad account %s\n", h.account.c_str());
+            return 2;
+        }
+        if (!util::read_file(h.path, bin))
+        {
+            fprintf(stderr, "state_footprint: cannot read %s\n", h.path.c_str());
+            return 2;
+        }
+        hostapi::Context *ctx = sim.add_hook(account, bin, error);
+        if (!ctx)
+        {
+            fprintf(stderr, "state_footprint: %s: %s\n", h.path.c_str(), error.c_str());
+            return 2;
+        }
+        for (const std::string &p : h.params)
+        {
+            std::string name, value;
+            std::vector<uint8_t> bin_value;
+            if (!util::split(p, name, value) || !util::from_hex(value, bin_value))
+            {
+                fprintf(stderr, "state_footprint: bad parameter %s, expected NAME=HEX\n", p.c_str());
+                return 2;
+            }
+            ctx->params[std::vector<uint8_t>(name.begin(), name.end())] = bin_value;
+        }
+        if (!h.state.empty())
+        {
+            snapshots.push_back(std::make_unique<snapshot::Snapshot>());
+            if (!snapshots.back()->open(h.state, error))
+            {
+                fprintf(stderr, "state_footprint: %s\n", error.c_str());
+                return 2;
+            }
+            ctx->state.attach(snapshots.back().get());
+        }
+        contexts.push_back(ctx);
+    }
+
+    uint32_t first = options.first_ledger;
+    std::vector<workload::Item> items;
+    std::string error;
+    if (!workload::load(workload_path, items, error))
+    {
+        fprintf(stderr, "state_footprint: %s\n", error.c_str());
+        return 2;
+    }
+    for (workload::Item &item : items)
+        sim.submit(std::move(item.blob), first + item.offset);
+
+    Tracker tracker(reserve, oldest);
+    auto observe = [&]() {
+        hookstate::Map all, one;
+        for (hostapi::Context *ctx : contexts)
+        {
+            ctx->state.flatten(one);
+            all.insert(one.begin(), one.end());
+        }
+        tracker.observe("ledger " + std::to_string(sim.ledger_seq()), all);
+    };
+    observe();
+    uint32_t closed = 0;
+    while (closed < max_ledgers && !sim.idle())
+    {
+        sim.close();
+        if (++closed % every == 0 || sim.idle())
+            observe();
+    }
+    if (closed % every != 0 && !sim.idle())
+        observe();
+    size_t grew = tracker.report();
+    if (!sim.idle())
+        printf("incomplete after %u ledgers\n", closed);
+    return grew || !sim.idle() ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "snapshot")
+        return snapshots(argc, argv);
+    if (command == "run")
+        return run(argc, argv);
+    usage();
+    return 2;
+}
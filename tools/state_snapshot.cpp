@@ -0,0 +1,229 @@
+/**
+ * state_snapshot - builds and dumps hook state snapshots (tools/host/snapshot)
+ *
+ * import reads state lines and writes a snapshot; with -b the lines are
+ * applied as changes on top of an existing snapshot through a copy-on-write
+ * hookstate::Store, and a value of - erases the key. export prints a snapshot
+ * in the same line format, info prints its groups.
+ *
+ * A state line is: ACCOUNT NAMESPACE KEY VALUE, the account as an r-address
+ * or 40 hex digits, the namespace as 64 hex digits, the key as up to 64 hex
+ * digits (left-padded as state_set does) and the value in hex. Blank lines
+ * and lines starting with # are skipped.
+ *
+ * Build: g++ -std=c++17 -O2 -Ilib -Itools tools/state_snapshot.cpp tools/host/snapshot.cpp
+ *        tools/host/hookstate.cpp tools/host/base58.cpp tools/host/sha256.cpp
+ *        tools/host/util.cpp -o build/state_snapshot
+ * Usage: state_snapshot import [-b BASE] -o OUT [FILE]...
+ *        state_snapshot export SNAPSHOT
+ *        state_snapshot info SNAPSHOT
+ *
+ * Exit status is 0 on success, 1 on malformed input, 2 on usage or I/O errors.
+ */
+
+#include "host/base58.h"
+#include "host/hookstate.h"
+#include "host/snapshot.h"
+#include "host/util.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using hookstate::ACCOUNT_ID_SIZE;
+using hookstate::KEY_SIZE;
+using hookstate::NAMESPACE_SIZE;
+
+namespace
+{
+
+void usage()
+{
+    fprintf(stderr, "usage: state_snapshot import [-b BASE] -o OUT [FILE]...\n"
+                    "       state_snapshot export SNAPSHOT\n"
+                    "       state_snapshot info SNAPSHOT\n");
+}
+
+void print_hex(FILE *f, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+        fprintf(f, "%02X", data[i]);
+}
+
+bool parse_account(const std::string &text, uint8_t out[ACCOUNT_ID_SIZE])
+{
+    std::vector<uint8_t> bin;
+    if (text.size() == 2 * ACCOUNT_ID_SIZE && util::from_hex(text, bin))
+    {
+        std::memcpy(out, bin.data(), ACCOUNT_ID_SIZE);
+        return true;
+    }
+    return base58::decode_account(text.data(), text.size(), out);
+}
+
+// applies the state lines of one stream, false at the first malformed line
+bool apply(std::istream &in, const std::string &name, hookstate::Store &store)
+{
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number)
+    {
+        std::istringstream fields(line);
+        std::string account, ns, key, value, extra;
+        if (!(fields >> account) || account[0] == '#')
+            continue;
+        uint8_t acc[ACCOUNT_ID_SIZE], k[KEY_SIZE] = {0};
+        std::vector<uint8_t> ns_bin, key_bin, value_bin;
+        bool ok = (fields >> ns >> key >> value) && !(fields >> extra) && parse_account(account, acc) &&
+                  util::from_hex(ns, ns_bin) && ns_bin.size() == NAMESPACE_SIZE && util::from_hex(key, key_bin) &&
+                  !key_bin.empty() && key_bin.size() <= KEY_SIZE &&
+                  (value == "-" || (util::from_hex(value, value_bin) && !value_bin.empty()));
+        if (!ok)
+        {
+            fprintf(stderr, "%s:%zu: malformed state line\n", name.c_str(), number);
+            return false;
+        }
+        std::memcpy(k + KEY_SIZE - key_bin.size(), key_bin.data(), key_bin.size());
+        store.set(hookstate::make_key(acc, ns_bin.data(), k), value_bin.data(), value_bin.size());
+    }
+    store.commit();
+    return true;
+}
+
+int import(int argc, char **argv)
+{
+    std::string base_path, out_path;
+    std::vector<std::string> inputs;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-b" && i + 1 < argc)
+            base_path = argv[++i];
+        else if (arg == "-o" && i + 1 < argc)
+            out_path = argv[++i];
+        else if (!arg.empty() && (arg[0] != '-' || arg == "-"))
+            inputs.push_back(arg);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (out_path.empty())
+    {
+        usage();
+        return 2;
+    }
+
+    std::string error;
+    snapshot::Snapshot base;
+    hookstate::Store store;
+    if (!base_path.empty())
+    {
+        if (!base.open(base_path, error))
+        {
+            fprintf(stderr, "state_snapshot: %s\n", error.c_str());
+            return 2;
+        }
+        store.attach(&base);
+    }
+    if (inputs.empty())
+        inputs.push_back("-");
+    for (const std::string &path : inputs)
+    {
+        if (path == "-")
+        {
+            if (!apply(std::cin, "<stdin>", store))
+                return 1;
+            continue;
+        }
+        std::ifstream in(path);
+        if (!in)
+        {
+            fprintf(stderr, "state_snapshot: cannot read %s\n", path.c_str());
+            return 2;
+        }
+        if (!apply(in, path, store))
+            return 1;
+    }
+
+    hookstate::Map state;
+    store.flatten(state);
+    if (!snapshot::write(out_path, state, error))
+    {
+        fprintf(stderr, "state_snapshot: %s\n", error.c_str());
+        return 2;
+    }
+    printf("%zu entries\n", state.size());
+    return 0;
+}
+
+int dump(const std::string &path, bool entries)
+{
+    snapshot::Snapshot snap;
+    std::string error;
+    if (!snap.open(path, error))
+    {
+        fprintf(stderr, "state_snapshot: %s\n", error.c_str());
+        return 2;
+    }
+    int status = 0;
+    for (size_t g = 0; g < snap.group_count(); ++g)
+    {
+        const snapshot::Group &group = snap.group(g);
+        char raddr[base58::RADDR_MAX + 1];
+        raddr[base58::encode_account(group.account, raddr)] = 0;
+        if (!entries)
+        {
+            uint64_t bytes = 0;
+            for (uint64_t i = group.first; i < group.first + group.count; ++i)
+            {
+                uint32_t size = 0;
+                snap.value(i, size);
+                bytes += size;
+            }
+            printf("%s ", raddr);
+            print_hex(stdout, group.ns, NAMESPACE_SIZE);
+            printf(" %" PRIu64 " entries, %" PRIu64 " value bytes\n", group.count, bytes);
+            continue;
+        }
+        for (uint64_t i = group.first; i < group.first + group.count; ++i)
+        {
+            uint32_t size;
+            const uint8_t *v = snap.value(i, size);
+            if (!v)
+            {
+                fprintf(stderr, "state_snapshot: entry %" PRIu64 " points outside the heap\n", i);
+                status = 1;
+                continue;
+            }
+            printf("%s ", raddr);
+            print_hex(stdout, group.ns, NAMESPACE_SIZE);
+            putchar(' ');
+            print_hex(stdout, snap.key(i), KEY_SIZE);
+            putchar(' ');
+            print_hex(stdout, v, size);
+            putchar('\n');
+        }
+    }
+    if (!entries)
+        printf("%zu groups, %zu entries\n", snap.group_count(), snap.entry_count());
+    return status;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "import")
+        return import(argc, argv);
+    if ((command == "export" || command == "info") && argc == 3)
+        return dump(argv[2], command == "export");
+    usage();
+    return 2;
+}
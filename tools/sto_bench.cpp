@@ -0,0 +1,491 @@
+/**
+ * sto_bench - cross-checks and times the STObject index in tools/host/stobject
+ *
+ * Serializes a Payment with memos, its metadata (an account root and a trust
+ * line modified, an IOU delivered amount) and the metadata of an NFTokenMint
+ * that creates an NFToken page, in the shapes mainnet produces. Every field
+ * of every object and every array element is looked up through the index and
+ * through the linear sto_subfield/sto_subarray and the results must agree;
+ * the slot table is checked against the hook error codes. Then the memo and
+ * affected node walks hooks do are timed N times both ways.
+ *
+ * Build: g++ -std=c++17 -O2 -Ilib -Itools tools/sto_bench.cpp tools/host/stobject.cpp tools/host/util.cpp -o build/sto_bench
+ * Usage: sto_bench [-n COUNT] [-s SEED]
+ *
+ * Exit status is 0 when every check passes, 1 otherwise.
+ */
+
+#include "host/stobject.h"
+#include "host/util.h"
+
+#include "error.h"
+#include "sfcodes.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace sto;
+
+namespace
+{
+
+struct Blobs
+{
+    std::vector<uint8_t> payment, payment_meta, mint_meta;
+};
+
+Blobs make_blobs(std::mt19937_64 &rng)
+{
+    auto fill = [&](uint8_t *p, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            p[i] = (uint8_t)rng();
+    };
+    uint8_t alice[20], bob[20], gateway[20], hash[32], hash2[32], index[32], key[33], sig[71];
+    fill(alice, 20), fill(bob, 20), fill(gateway, 20), fill(hash, 32), fill(hash2, 32), fill(index, 32);
+    fill(key, 33), fill(sig, 71);
+
+    Blobs b;
+    {
+        Writer w;
+        w.uint(sfTransactionType, 0, 2);
+        w.uint(sfFlags, 0x80000000, 4);
+        w.uint(sfSequence, 4711, 4);
+        w.uint(sfLastLedgerSequence, 81234567, 4);
+        w.drops(sfAmount, 25000000);
+        w.drops(sfFee, 12);
+        w.vl(sfSigningPubKey, key, 33);
+        w.vl(sfTxnSignature, sig, 71);
+        w.vl(sfAccount, alice, 20);
+        w.vl(sfDestination, bob, 20);
+        w.begin(sfMemos);
+        const char *memos[][2] = {{"loan/request", "{\"principal\":25000000,\"term\":30}"},
+                                  {"loan/collateral", "rHb9CJAWyB4rj91VRWn96DkukG4bwdtyTh"},
+                                  {"client", "hooks-toolkit 1.4"}};
+        for (auto &m : memos)
+        {
+            w.begin(sfMemo);
+            w.vl(sfMemoType, (const uint8_t *)m[0], std::strlen(m[0]));
+            w.vl(sfMemoData, (const uint8_t *)m[1], std::strlen(m[1]));
+            w.vl(sfMemoFormat, (const uint8_t *)"application/json", 16);
+            w.end_object();
+        }
+        w.end_array();
+        b.payment = w.out;
+    }
+    {
+        Writer w;
+        w.uint(sfTransactionIndex, 17, 4);
+        w.iou(sfDeliveredAmount, 2500000000000000ULL, -14, "USD", gateway);
+        w.begin(sfAffectedNodes);
+        for (int i = 0; i < 2; ++i)
+        {
+            w.begin(sfModifiedNode);
+            w.uint(sfLedgerEntryType, 0x61, 2);
+            w.bytes(sfPreviousTxnID, hash, 32);
+            w.bytes(sfLedgerIndex, index, 32);
+            w.uint(sfPreviousTxnLgrSeq, 81234500 + i, 4);
+            w.begin(sfFinalFields);
+            w.uint(sfFlags, 0, 4);
+            w.uint(sfSequence, 4712 - i, 4);
+            w.uint(sfOwnerCount, 3 + i, 4);
+            w.drops(sfBalance, 1000000000ULL - 25000012 * (1 - i));
+            w.vl(sfAccount, i ? bob : alice, 20);
+            w.end_object();
+            w.begin(sfPreviousFields);
+            w.drops(sfBalance, 1000000000ULL - i * 25000000);
+            w.end_object();
+            w.end_object();
+        }
+        w.begin(sfModifiedNode);
+        w.uint(sfLedgerEntryType, 0x72, 2);
+        w.bytes(sfPreviousTxnID, hash2, 32);
+        w.bytes(sfLedgerIndex, hash, 32);
+        w.begin(sfFinalFields);
+        w.uint(sfFlags, 0x00020000, 4);
+        w.iou(sfBalance, 7500000000000000ULL, -14, "USD", gateway);
+        w.iou(sfLowLimit, 0, -100, "USD", bob);
+        w.iou(sfHighLimit, 1000000000000000ULL, -12, "USD", gateway);
+        w.end_object();
+        w.begin(sfPreviousFields);
+        w.iou(sfBalance, 5000000000000000ULL, -14, "USD", gateway);
+        w.end_object();
+        w.end_object();
+        w.end_array();
+        w.uint(sfTransactionResult, 0, 1);
+        b.payment_meta = w.out;
+    }
+    {
+        Writer w;
+        w.uint(sfTransactionIndex, 4, 4);
+        w.begin(sfAffectedNodes);
+        w.begin(sfModifiedNode);
+        w.uint(sfLedgerEntryType, 0x61, 2);
+        w.bytes(sfPreviousTxnID, hash2, 32);
+        w.bytes(sfLedgerIndex, index, 32);
+        w.begin(sfFinalFields);
+        w.uint(sfFlags, 0, 4);
+        w.uint(sfSequence, 88, 4);
+        w.uint(sfOwnerCount, 9, 4);
+        w.uint(sfMintedNFTokens, 31, 4);
+        w.drops(sfBalance, 99999988);
+        w.vl(sfAccount, alice, 20);
+        w.end_object();
+        w.begin(sfPreviousFields);
+        w.uint(sfOwnerCount, 8, 4);
+        w.uint(sfMintedNFTokens, 30, 4);
+        w.drops(sfBalance, 100000000);
+        w.end_object();
+        w.end_object();
+        w.begin(sfCreatedNode);
+        w.uint(sfLedgerEntryType, 0x50, 2);
+        w.bytes(sfLedgerIndex, hash, 32);
+        w.begin(sfNewFields);
+        w.bytes(sfPreviousPageMin, hash2, 32);
+        w.begin(sfNFTokens);
+        for (int i = 0; i < 32; ++i)
+        {
+            uint8_t id[32], uri[64];
+            fill(id, 32);
+            int n = std::snprintf((char *)uri, sizeof(uri), "ipfs://bafybeigdyrzt5sfp7udm7hu76uh7y26nf3efuylqabf3oc/%d",
+                                  i);
+            w.begin(sfNFToken);
+            w.bytes(sfNFTokenID, id, 32);
+            w.vl(sfURI, uri, n);
+            w.end_object();
+        }
+        w.end_array();
+        w.end_object();
+        w.end_object();
+        w.end_array();
+        w.uint(sfTransactionResult, 0, 1);
+        b.mint_meta = w.out;
+    }
+    return b;
+}
+
+// every object field and array element of the index against the linear scan
+int cross_check(const char *name, const Index &index)
+{
+    int failures = 0;
+    for (uint32_t node = 0; node < index.node_count(); ++node)
+    {
+        const Field &f = index.field(node);
+        if (f.code == 0 || f.type() == STI_OBJECT)
+        {
+            const uint8_t *payload = index.payload(node);
+            for (uint32_t i = 0; i < f.child_count; ++i)
+            {
+                uint32_t code = index.field(f.first_child + i).code;
+                int64_t got = index.subfield(node, code), want = sto_subfield(payload, f.payload_size, code);
+                if (got != want)
+                {
+                    std::printf("%s: node %u field %08x: index %llx, sto_subfield %llx\n", name, node, code,
+                                (long long)got, (long long)want);
+                    ++failures;
+                }
+            }
+            int64_t missing = index.subfield(node, sfNextPageMin);
+            if (missing != DOESNT_EXIST || sto_subfield(payload, f.payload_size, sfNextPageMin) != DOESNT_EXIST)
+            {
+                std::printf("%s: node %u: missing field found\n", name, node);
+                ++failures;
+            }
+        }
+        else if (f.type() == STI_ARRAY)
+        {
+            const uint8_t *array = index.data() + f.offset;
+            for (uint32_t i = 0; i <= f.child_count; ++i)
+            {
+                int64_t got = index.subarray(node, i), want = sto_subarray(array, f.size, i);
+                if (got != want)
+                {
+                    std::printf("%s: node %u element %u: index %llx, sto_subarray %llx\n", name, node, i,
+                                (long long)got, (long long)want);
+                    ++failures;
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+int check_slots(const Blobs &b)
+{
+    struct Case
+    {
+        const char *name;
+        int64_t got, expected;
+    };
+    Slots slots;
+    int64_t meta = slots.set(b.mint_meta.data(), b.mint_meta.size());
+    int64_t nodes = slots.subfield(meta, sfAffectedNodes);
+    int64_t created = slots.subarray(nodes, 1);
+    int64_t fields = slots.subfield(created, sfNewFields);
+    int64_t tokens = slots.subfield(fields, sfNFTokens);
+    int64_t last = slots.subarray(tokens, 31, 200);
+    int64_t uri = slots.subfield(last, sfURI);
+    const Field *u = slots.field(uri);
+    const Case cases[] = {
+        {"slot_set", meta, 1},
+        {"slot_subfield", nodes, 2},
+        {"slot_count", slots.count(nodes), 2},
+        {"slot_count tokens", slots.count(tokens), 32},
+        {"slot_subarray into slot", last, 200},
+        {"slot_size uri", slots.size(uri), u ? u->payload_size : -1},
+        {"uri text", u ? std::memcmp(slots.data(uri), "ipfs://", 7) : -1, 0},
+        {"slot_subarray on object", slots.subarray(meta, 0), NOT_AN_ARRAY},
+        {"slot_subfield on array", slots.subfield(nodes, sfLedgerIndex), NOT_AN_OBJECT},
+        {"slot_count on object", slots.count(meta), NOT_AN_ARRAY},
+        {"missing field", slots.subfield(meta, sfDeliveredAmount), DOESNT_EXIST},
+        {"past the end", slots.subarray(tokens, 32), DOESNT_EXIST},
+        {"empty parent", slots.subfield(100, sfAffectedNodes), DOESNT_EXIST},
+        {"bad new slot", slots.subfield(meta, sfAffectedNodes, 256), INVALID_ARGUMENT},
+        {"slot_clear", slots.clear(meta), 1},
+        {"cleared slot", slots.size(meta), DOESNT_EXIST},
+        {"children survive clear", slots.count(tokens), 32},
+        {"bad blob", slots.set(b.payment.data(), b.payment.size() - 3), PARSE_ERROR},
+    };
+    int failures = 0;
+    for (const Case &c : cases)
+        if (c.got != c.expected)
+        {
+            std::printf("%s: got %lld, expected %lld\n", c.name, (long long)c.got, (long long)c.expected);
+            ++failures;
+        }
+    int64_t rc = 0;
+    for (int i = 0; i < 300 && rc >= 0; ++i)
+        rc = slots.subarray(tokens, i % 32);
+    if (rc != NO_FREE_SLOTS)
+    {
+        std::printf("full slot table: got %lld, expected %d\n", (long long)rc, NO_FREE_SLOTS);
+        ++failures;
+    }
+    return failures;
+}
+
+inline uint32_t offset_of(int64_t r)
+{
+    return (uint32_t)(r >> 32);
+}
+
+inline uint32_t length_of(int64_t r)
+{
+    return (uint32_t)r;
+}
+
+// the memo walk of loan.c: every memo's type and data
+uint64_t memos_linear(const std::vector<uint8_t> &tx)
+{
+    uint64_t sum = 0;
+    int64_t memos = sto_subfield(tx.data(), tx.size(), sfMemos);
+    if (memos < 0)
+        return 0;
+    const uint8_t *array = tx.data() + offset_of(memos);
+    for (uint32_t i = 0;; ++i)
+    {
+        int64_t memo = sto_subarray(array, length_of(memos), i);
+        if (memo < 0)
+            break;
+        // the element is the sfMemo field, its payload holds the memo fields
+        int64_t inner = sto_subfield(array + offset_of(memo), length_of(memo), sfMemo);
+        const uint8_t *fields = array + offset_of(memo) + offset_of(inner);
+        sum += sto_subfield(fields, length_of(inner), sfMemoType);
+        sum += sto_subfield(fields, length_of(inner), sfMemoData);
+    }
+    return sum;
+}
+
+uint64_t memos_indexed(const Index &index)
+{
+    uint64_t sum = 0;
+    uint32_t memos = index.find(Index::ROOT, sfMemos);
+    if (memos == Index::NOT_FOUND)
+        return 0;
+    for (uint32_t i = 0, memo; (memo = index.at(memos, i)) != Index::NOT_FOUND; ++i)
+    {
+        sum += index.subfield(memo, sfMemoType);
+        sum += index.subfield(memo, sfMemoData);
+    }
+    return sum;
+}
+
+// the affected node walk of the sale callbacks: each node's type, final or new
+// fields and their balance or token list
+uint64_t nodes_linear(const std::vector<uint8_t> &meta)
+{
+    uint64_t sum = 0;
+    int64_t nodes = sto_subfield(meta.data(), meta.size(), sfAffectedNodes);
+    if (nodes < 0)
+        return 0;
+    const uint8_t *array = meta.data() + offset_of(nodes);
+    for (uint32_t i = 0;; ++i)
+    {
+        int64_t node = sto_subarray(array, length_of(nodes), i);
+        if (node < 0)
+            break;
+        const uint8_t *p = array + offset_of(node);
+        uint32_t code, start, size;
+        field_length(p, p + length_of(node), code, start, size);
+        const uint8_t *fields = p + start;
+        sum += sto_subfield(fields, size, sfLedgerEntryType);
+        int64_t inner = sto_subfield(fields, size, code == sfCreatedNode ? sfNewFields : sfFinalFields);
+        if (inner < 0)
+            continue;
+        const uint8_t *q = fields + offset_of(inner);
+        sum += sto_subfield(q, length_of(inner), sfBalance);
+        int64_t tokens = sto_subfield(q, length_of(inner), sfNFTokens);
+        if (tokens >= 0)
+            sum += sto_subarray(q + offset_of(tokens), length_of(tokens), 31);
+    }
+    return sum;
+}
+
+uint64_t nodes_indexed(const Index &index)
+{
+    uint64_t sum = 0;
+    uint32_t nodes = index.find(Index::ROOT, sfAffectedNodes);
+    if (nodes == Index::NOT_FOUND)
+        return 0;
+    for (uint32_t i = 0, node; (node = index.at(nodes, i)) != Index::NOT_FOUND; ++i)
+    {
+        sum += index.subfield(node, sfLedgerEntryType);
+        uint32_t code = index.field(node).code;
+        uint32_t inner = index.find(node, code == sfCreatedNode ? sfNewFields : sfFinalFields);
+        if (inner == Index::NOT_FOUND)
+            continue;
+        sum += index.subfield(inner, sfBalance);
+        uint32_t tokens = index.find(inner, sfNFTokens);
+        if (tokens != Index::NOT_FOUND)
+            sum += index.subarray(tokens, 31);
+    }
+    return sum;
+}
+
+void report(const char *name, size_t n, double secs)
+{
+    std::printf("%-28s %10.2f M/s %10.1f ns\n", name, n / secs / 1e6, secs * 1e9 / n);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t n = 1000000;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "-n") && i + 1 < argc)
+            n = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-s") && i + 1 < argc)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [-n COUNT] [-s SEED]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::mt19937_64 rng(seed);
+    Blobs b = make_blobs(rng);
+    int failures = 0;
+
+    Index payment, payment_meta, mint_meta;
+    const struct
+    {
+        const char *name;
+        const std::vector<uint8_t> &blob;
+        Index &index;
+    } blobs[] = {{"payment", b.payment, payment},
+                 {"payment meta", b.payment_meta, payment_meta},
+                 {"nftoken mint meta", b.mint_meta, mint_meta}};
+    for (auto &x : blobs)
+    {
+        if (!x.index.parse(x.blob.data(), x.blob.size()))
+        {
+            std::printf("%s: parse failed\n", x.name);
+            ++failures;
+            continue;
+        }
+        std::printf("%-18s %5zu bytes %4zu fields\n", x.name, x.blob.size(), x.index.node_count() - 1);
+        failures += cross_check(x.name, x.index);
+        for (size_t cut = 1; cut < x.blob.size(); cut += 7)
+        {
+            Index broken;
+            uint32_t code, start, size;
+            size_t whole = 0;
+            while (whole < cut)
+            {
+                int64_t len = field_length(x.blob.data() + whole, x.blob.data() + cut, code, start, size);
+                if (len < 0)
+                    break;
+                whole += len;
+            }
+            if (broken.parse(x.blob.data(), cut) != (whole == cut))
+            {
+                std::printf("%s: truncated to %zu bytes, parse disagrees with field_length\n", x.name, cut);
+                ++failures;
+                break;
+            }
+        }
+    }
+    failures += check_slots(b);
+    if (memos_linear(b.payment) != memos_indexed(payment) || nodes_linear(b.payment_meta) != nodes_indexed(payment_meta) ||
+        nodes_linear(b.mint_meta) != nodes_indexed(mint_meta))
+    {
+        std::printf("linear and indexed walks disagree\n");
+        ++failures;
+    }
+
+    uint64_t sink = 0;
+    Index scratch;
+    report("memos linear", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+                   sink += memos_linear(b.payment);
+           }));
+    report("memos parse + indexed", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+               {
+                   scratch.parse(b.payment.data(), b.payment.size());
+                   sink += memos_indexed(scratch);
+               }
+           }));
+    report("memos indexed", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+                   sink += memos_indexed(payment);
+           }));
+    report("payment meta linear", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+                   sink += nodes_linear(b.payment_meta);
+           }));
+    report("payment meta parse + indexed", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+               {
+                   scratch.parse(b.payment_meta.data(), b.payment_meta.size());
+                   sink += nodes_indexed(scratch);
+               }
+           }));
+    report("payment meta indexed", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+                   sink += nodes_indexed(payment_meta);
+           }));
+    report("mint meta linear", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+                   sink += nodes_linear(b.mint_meta);
+           }));
+    report("mint meta parse + indexed", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+               {
+                   scratch.parse(b.mint_meta.data(), b.mint_meta.size());
+                   sink += nodes_indexed(scratch);
+               }
+           }));
+    report("mint meta indexed", n, util::seconds([&] {
+               for (size_t i = 0; i < n; ++i)
+                   sink += nodes_indexed(mint_meta);
+           }));
+    std::printf("checksum %016llx\n", (unsigned long long)sink);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,341 @@
+/**
+ * tx_corpus - builds, inspects and times binary transaction corpora (tools/host/corpus)
+ *
+ * convert reads XRPL JSON (tx, ledger and account_tx responses, or files of
+ * their transactions, one document or JSON lines; see tools/host/txjson) and
+ * writes a corpus sorted by ledger and transaction index. A transaction seen
+ * twice in the same ledger position, as when two hook accounts' histories
+ * overlap, is kept once. info prints the record count, ledger range, expected
+ * results and whether every record is readable. dump prints the originating
+ * transactions as workload lines for ledger_sim and hook_replay (which also
+ * read corpora directly), -e includes the emitted ones. bench times reading
+ * the corpus against decoding the same transactions from hex workload text.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/tx_corpus.cpp tools/host/corpus.cpp
+ *        tools/host/txjson.cpp tools/host/stobject.cpp tools/host/base58.cpp tools/host/sha256.cpp
+ *        tools/host/sha512.cpp tools/host/util.cpp -o build/tx_corpus
+ * Usage: tx_corpus convert -o OUT [FILE]...
+ *        tx_corpus info CORPUS
+ *        tx_corpus dump [-e] CORPUS
+ *        tx_corpus bench [-n ROUNDS] CORPUS
+ *
+ * Exit status is 0 on success, 1 on malformed input, 2 on usage or I/O errors.
+ */
+
+#include "host/corpus.h"
+#include "host/stobject.h"
+#include "host/txjson.h"
+#include "host/util.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+void usage()
+{
+    fprintf(stderr, "usage: tx_corpus convert -o OUT [FILE]...\n"
+                    "       tx_corpus info CORPUS\n"
+                    "       tx_corpus dump [-e] CORPUS\n"
+                    "       tx_corpus bench [-n ROUNDS] CORPUS\n");
+}
+
+void append_hex(std::string &out, const uint8_t *p, size_t n)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < n; ++i)
+    {
+        out.push_back(digits[p[i] >> 4]);
+        out.push_back(digits[p[i] & 15]);
+    }
+}
+
+bool open(const std::string &path, corpus::Corpus &c)
+{
+    std::string error;
+    if (!c.open(path, error))
+    {
+        fprintf(stderr, "tx_corpus: %s\n", error.c_str());
+        return false;
+    }
+    return true;
+}
+
+int convert(int argc, char **argv)
+{
+    std::string out_path;
+    std::vector<std::string> inputs;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            out_path = argv[++i];
+        else if (!arg.empty() && (arg[0] != '-' || arg == "-"))
+            inputs.push_back(arg);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (out_path.empty())
+    {
+        usage();
+        return 2;
+    }
+    if (inputs.empty())
+        inputs.push_back("-");
+
+    std::vector<txjson::Transaction> txs;
+    for (const std::string &path : inputs)
+    {
+        std::string text;
+        if (path == "-")
+            text.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+        else
+        {
+            std::ifstream in(path, std::ios::binary);
+            if (!in)
+            {
+                fprintf(stderr, "tx_corpus: cannot read %s\n", path.c_str());
+                return 2;
+            }
+            text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        std::vector<txjson::Value> docs;
+        std::string error;
+        bool ok = txjson::parse(text.data(), text.size(), docs, error);
+        for (size_t i = 0; ok && i < docs.size(); ++i)
+            ok = txjson::extract(docs[i], txs, error);
+        if (!ok)
+        {
+            fprintf(stderr, "%s: %s\n", path == "-" ? "<stdin>" : path.c_str(), error.c_str());
+            return 1;
+        }
+    }
+
+    // account_tx returns newest first; an unknown index sorts last in its ledger
+    std::stable_sort(txs.begin(), txs.end(), [](const txjson::Transaction &a, const txjson::Transaction &b) {
+        return a.ledger_seq != b.ledger_seq ? a.ledger_seq < b.ledger_seq : a.index < b.index;
+    });
+    corpus::Writer writer;
+    std::string error;
+    if (!writer.open(out_path, error))
+    {
+        fprintf(stderr, "tx_corpus: %s\n", error.c_str());
+        return 2;
+    }
+    size_t duplicates = 0;
+    for (size_t i = 0; i < txs.size(); ++i)
+    {
+        const txjson::Transaction &t = txs[i];
+        if (i && t.index != corpus::INDEX_UNKNOWN && t.ledger_seq == txs[i - 1].ledger_seq &&
+            t.index == txs[i - 1].index && t.blob == txs[i - 1].blob)
+        {
+            ++duplicates;
+            continue;
+        }
+        corpus::Record r{t.blob.data(), (uint32_t)t.blob.size(), t.ledger_seq, t.close_time, t.index, t.result,
+                         t.flags};
+        if (!writer.add(r))
+        {
+            fprintf(stderr, "tx_corpus: cannot write %s\n", out_path.c_str());
+            return 2;
+        }
+    }
+    if (!writer.finish(error))
+    {
+        fprintf(stderr, "tx_corpus: %s\n", error.c_str());
+        return 2;
+    }
+    printf("%" PRIu64 " records, %zu duplicates dropped\n", writer.record_count(), duplicates);
+    return 0;
+}
+
+int info(const std::string &path)
+{
+    corpus::Corpus c;
+    if (!open(path, c))
+        return 2;
+    uint64_t n = 0, emitted = 0, bytes = 0, unordered = 0;
+    uint32_t first = 0, last = 0, first_time = 0, last_time = 0, prev_seq = 0, prev_index = 0;
+    std::map<int, uint64_t> results;
+    for (corpus::Record r : c)
+    {
+        if (n == 0)
+        {
+            first = r.ledger_seq;
+            first_time = r.close_time;
+        }
+        else if (r.ledger_seq < prev_seq || (r.ledger_seq == prev_seq && r.index < prev_index))
+            ++unordered;
+        first = std::min(first, r.ledger_seq);
+        last = std::max(last, r.ledger_seq);
+        first_time = std::min(first_time, r.close_time);
+        last_time = std::max(last_time, r.close_time);
+        prev_seq = r.ledger_seq;
+        prev_index = r.index;
+        emitted += r.emitted();
+        bytes += r.size;
+        ++results[r.result];
+        ++n;
+    }
+    printf("records       %" PRIu64 ", %" PRIu64 " emitted, %" PRIu64 " transaction bytes, %" PRIu64 " file bytes\n",
+           n, emitted, bytes, sizeof(corpus::Header) + c.data_size());
+    printf("ledgers       %u..%u, close time %u..%u%s\n", first, last, first_time, last_time,
+           unordered ? ", not in ledger order" : "");
+    for (const auto &kv : results)
+    {
+        const char *name = kv.first == corpus::RESULT_UNKNOWN ? "unknown" : txjson::result_name(kv.first);
+        if (name)
+            printf("result        %-24s %" PRIu64 "\n", name, kv.second);
+        else
+            printf("result        %-24d %" PRIu64 "\n", kv.first, kv.second);
+    }
+    std::string error;
+    if (!c.check(error))
+    {
+        fprintf(stderr, "tx_corpus: %s: %s\n", path.c_str(), error.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+int dump(const std::string &path, bool emitted)
+{
+    corpus::Corpus c;
+    if (!open(path, c))
+        return 2;
+    bool started = false;
+    uint32_t first = 0;
+    std::string line;
+    for (corpus::Record r : c)
+    {
+        if (!started)
+            first = r.ledger_seq;
+        started = true;
+        if (r.emitted() && !emitted)
+            continue;
+        line = std::to_string(r.ledger_seq - std::min(first, r.ledger_seq)) + ' ';
+        append_hex(line, r.blob, r.size);
+        line.push_back('\n');
+        fwrite(line.data(), 1, line.size(), stdout);
+    }
+    return 0;
+}
+
+int bench(int argc, char **argv)
+{
+    int rounds = 5;
+    std::string path;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc)
+            rounds = std::max(1, atoi(argv[++i]));
+        else if (!arg.empty() && arg[0] != '-' && path.empty())
+            path = arg;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    corpus::Corpus c;
+    if (path.empty())
+    {
+        usage();
+        return 2;
+    }
+    if (!open(path, c))
+        return 2;
+
+    // the same transactions as workload text, decoded the way ledger_sim reads it
+    std::string text;
+    uint64_t records = 0, bytes = 0;
+    for (corpus::Record r : c)
+    {
+        text += std::to_string(r.ledger_seq) + ' ';
+        append_hex(text, r.blob, r.size);
+        text.push_back('\n');
+        ++records;
+        bytes += r.size;
+    }
+    if (!records)
+    {
+        fprintf(stderr, "tx_corpus: %s is empty\n", path.c_str());
+        return 1;
+    }
+
+    uint64_t sink = 0;
+    sto::Index index;
+    auto report = [&](const char *name, double t) {
+        printf("%-18s %9.3f ms %12.0f records/s %9.1f MB/s\n", name, t * 1e3 / rounds, records * rounds / t,
+               bytes * rounds / t / 1e6);
+    };
+    report("corpus iterate", util::seconds([&] {
+               for (int i = 0; i < rounds; ++i)
+                   for (corpus::Record r : c)
+                       sink += r.size + r.blob[r.size - 1];
+           }));
+    report("corpus + index", util::seconds([&] {
+               for (int i = 0; i < rounds; ++i)
+                   for (corpus::Record r : c)
+                       sink += index.parse(r.blob, r.size) ? index.node_count() : 0;
+           }));
+    report("hex decode", util::seconds([&] {
+               std::vector<uint8_t> blob;
+               for (int i = 0; i < rounds; ++i)
+                   for (size_t at = 0; at < text.size();)
+                   {
+                       size_t space = text.find(' ', at), nl = text.find('\n', space);
+                       sink += strtoul(text.c_str() + at, nullptr, 10);
+                       if (util::from_hex(text.data() + space + 1, nl - space - 1, blob))
+                           sink += blob.size() + blob.back();
+                       at = nl + 1;
+                   }
+           }));
+    report("hex + index", util::seconds([&] {
+               std::vector<uint8_t> blob;
+               for (int i = 0; i < rounds; ++i)
+                   for (size_t at = 0; at < text.size();)
+                   {
+                       size_t space = text.find(' ', at), nl = text.find('\n', space);
+                       if (util::from_hex(text.data() + space + 1, nl - space - 1, blob) &&
+                           index.parse(blob.data(), blob.size()))
+                           sink += index.node_count();
+                       at = nl + 1;
+                   }
+           }));
+    printf("%" PRIu64 " records, %" PRIu64 " bytes, %d rounds (checksum %" PRIu64 ")\n", records, bytes, rounds,
+           sink);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "convert")
+        return convert(argc, argv);
+    if (command == "info" && argc == 3)
+        return info(argv[2]);
+    if (command == "dump" && argc == 3)
+        return dump(argv[2], false);
+    if (command == "dump" && argc == 4 && std::string(argv[2]) == "-e")
+        return dump(argv[3], true);
+    if (command == "bench")
+        return bench(argc, argv);
+    usage();
+    return 2;
+}
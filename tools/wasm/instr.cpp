@@ -0,0 +1,192 @@
+#include "instr.h"
+
+#include <cstdio>
+
+namespace wasm
+{
+
+namespace
+{
+
+const char *const basic_names[0xD3] = {
+    // 0x00
+    "unreachable", "nop", "block", "loop", "if", "else", nullptr, nullptr,
+    nullptr, nullptr, nullptr, "end", "br", "br_if", "br_table", "return",
+    // 0x10
+    "call", "call_indirect", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+    nullptr, nullptr, "drop", "select", "select", nullptr, nullptr, nullptr,
+    // 0x20
+    "local.get", "local.set", "local.tee", "global.get", "global.set", "table.get", "table.set", nullptr,
+    "i32.load", "i64.load", "f32.load", "f64.load", "i32.load8_s", "i32.load8_u", "i32.load16_s", "i32.load16_u",
+    // 0x30
+    "i64.load8_s", "i64.load8_u", "i64.load16_s", "i64.load16_u", "i64.load32_s", "i64.load32_u", "i32.store", "i64.store",
+    "f32.store", "f64.store", "i32.store8", "i32.store16", "i64.store8", "i64.store16", "i64.store32", "memory.size",
+    // 0x40
+    "memory.grow", "i32.const", "i64.const", "f32.const", "f64.const", "i32.eqz", "i32.eq", "i32.ne",
+    "i32.lt_s", "i32.lt_u", "i32.gt_s", "i32.gt_u", "i32.le_s", "i32.le_u", "i32.ge_s", "i32.ge_u",
+    // 0x50
+    "i64.eqz", "i64.eq", "i64.ne", "i64.lt_s", "i64.lt_u", "i64.gt_s", "i64.gt_u", "i64.le_s",
+    "i64.le_u", "i64.ge_s", "i64.ge_u", "f32.eq", "f32.ne", "f32.lt", "f32.gt", "f32.le",
+    // 0x60
+    "f32.ge", "f64.eq", "f64.ne", "f64.lt", "f64.gt", "f64.le", "f64.ge", "i32.clz",
+    "i32.ctz", "i32.popcnt", "i32.add", "i32.sub", "i32.mul", "i32.div_s", "i32.div_u", "i32.rem_s",
+    // 0x70
+    "i32.rem_u", "i32.and", "i32.or", "i32.xor", "i32.shl", "i32.shr_s", "i32.shr_u", "i32.rotl",
+    "i32.rotr", "i64.clz", "i64.ctz", "i64.popcnt", "i64.add", "i64.sub", "i64.mul", "i64.div_s",
+    // 0x80
+    "i64.div_u", "i64.rem_s", "i64.rem_u", "i64.and", "i64.or", "i64.xor", "i64.shl", "i64.shr_s",
+    "i64.shr_u", "i64.rotl", "i64.rotr", "f32.abs", "f32.neg", "f32.ceil", "f32.floor", "f32.trunc",
+    // 0x90
+    "f32.nearest", "f32.sqrt", "f32.add", "f32.sub", "f32.mul", "f32.div", "f32.min", "f32.max",
+    "f32.copysign", "f64.abs", "f64.neg", "f64.ceil", "f64.floor", "f64.trunc", "f64.nearest", "f64.sqrt",
+    // 0xA0
+    "f64.add", "f64.sub", "f64.mul", "f64.div", "f64.min", "f64.max", "f64.copysign", "i32.wrap_i64",
+    "i32.trunc_f32_s", "i32.trunc_f32_u", "i32.trunc_f64_s", "i32.trunc_f64_u", "i64.extend_i32_s", "i64.extend_i32_u", "i64.trunc_f32_s", "i64.trunc_f32_u",
+    // 0xB0
+    "i64.trunc_f64_s", "i64.trunc_f64_u", "f32.convert_i32_s", "f32.convert_i32_u", "f32.convert_i64_s", "f32.convert_i64_u", "f32.demote_f64", "f64.convert_i32_s",
+    "f64.convert_i32_u", "f64.convert_i64_s", "f64.convert_i64_u", "f64.promote_f32", "i32.reinterpret_f32", "i64.reinterpret_f64", "f32.reinterpret_i32", "f64.reinterpret_i64",
+    // 0xC0
+    "i32.extend8_s", "i32.extend16_s", "i64.extend8_s", "i64.extend16_s", "i64.extend32_s", nullptr, nullptr, nullptr,
+    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+    // 0xD0
+    "ref.null", "ref.is_null", "ref.func"};
+
+const char *const prefixed_names[18] = {
+    "i32.trunc_sat_f32_s", "i32.trunc_sat_f32_u", "i32.trunc_sat_f64_s", "i32.trunc_sat_f64_u",
+    "i64.trunc_sat_f32_s", "i64.trunc_sat_f32_u", "i64.trunc_sat_f64_s", "i64.trunc_sat_f64_u",
+    "memory.init", "data.drop", "memory.copy", "memory.fill",
+    "table.init", "elem.drop", "table.copy", "table.grow", "table.size", "table.fill"};
+
+} // namespace
+
+Instr InstrReader::next()
+{
+    Instr in;
+    in.offset = r_.pos;
+    uint8_t b = r_.u8();
+    in.op = b;
+    in.imm_offset = r_.pos;
+    if (b == OP_PREFIX)
+    {
+        uint32_t sub = r_.u32();
+        if (sub >= 18)
+            throw ParseError("unsupported 0xFC opcode " + std::to_string(sub), in.offset);
+        in.op = (uint16_t)(0xFC00 | sub);
+        in.imm_offset = r_.pos;
+        switch (sub)
+        {
+        case 8: // memory.init data mem
+            in.imm = r_.u32();
+            r_.u8();
+            break;
+        case 9:  // data.drop
+        case 13: // elem.drop
+        case 15: // table.grow
+        case 16: // table.size
+        case 17: // table.fill
+            in.imm = r_.u32();
+            break;
+        case 10: // memory.copy dst src
+            in.imm2 = r_.u8();
+            in.imm = r_.u8();
+            break;
+        case 11: // memory.fill
+            r_.u8();
+            break;
+        case 12: // table.init elem table
+        case 14: // table.copy dst src
+            in.imm = r_.u32();
+            in.imm2 = r_.u32();
+            break;
+        }
+        in.length = r_.pos - in.offset;
+        return in;
+    }
+    if (b >= sizeof(basic_names) / sizeof(basic_names[0]) || basic_names[b] == nullptr)
+    {
+        char hex[8];
+        snprintf(hex, sizeof(hex), "0x%02X", b);
+        throw ParseError(std::string("unsupported opcode ") + hex, in.offset);
+    }
+    switch (b)
+    {
+    case OP_BLOCK:
+    case OP_LOOP:
+    case OP_IF:
+        in.imm = r_.s64();
+        break;
+    case OP_BR:
+    case OP_BR_IF:
+    case OP_CALL:
+    case OP_LOCAL_GET:
+    case OP_LOCAL_SET:
+    case OP_LOCAL_TEE:
+    case OP_GLOBAL_GET:
+    case OP_GLOBAL_SET:
+    case 0x25: // table.get
+    case 0x26: // table.set
+    case OP_REF_FUNC:
+        in.imm = r_.u32();
+        break;
+    case OP_BR_TABLE:
+        for (uint32_t n = r_.u32() + 1; n > 0; --n)
+            in.targets.push_back(r_.u32());
+        break;
+    case OP_CALL_INDIRECT:
+        in.imm = r_.u32();
+        in.imm2 = r_.u32();
+        break;
+    case OP_SELECT_T:
+        for (uint32_t n = r_.u32(); n > 0; --n)
+            r_.u8();
+        break;
+    case OP_MEMORY_SIZE:
+    case OP_MEMORY_GROW:
+    case OP_REF_NULL:
+        in.imm = r_.u8();
+        break;
+    case OP_I32_CONST:
+        in.imm = r_.s32();
+        break;
+    case OP_I64_CONST:
+        in.imm = r_.s64();
+        break;
+    case OP_F32_CONST:
+        in.imm = r_.fixed32();
+        break;
+    case OP_F64_CONST:
+        in.imm = (int64_t)r_.fixed64();
+        break;
+    default:
+        if (in.is_load() || in.is_store())
+        {
+            in.imm2 = r_.u32();
+            in.imm = r_.u32();
+        }
+        break;
+    }
+    in.length = r_.pos - in.offset;
+    return in;
+}
+
+std::vector<Instr> decode(const std::vector<uint8_t> &body)
+{
+    std::vector<Instr> out;
+    InstrReader r(body);
+    while (!r.done())
+        out.push_back(r.next());
+    return out;
+}
+
+std::string opcode_name(uint16_t op)
+{
+    if ((op & 0xFF00) == 0xFC00 && (op & 0xFF) < 18)
+        return prefixed_names[op & 0xFF];
+    if (op < sizeof(basic_names) / sizeof(basic_names[0]) && basic_names[op])
+        return basic_names[op];
+    char hex[16];
+    snprintf(hex, sizeof(hex), "op 0x%X", op);
+    return hex;
+}
+
+} // namespace wasm
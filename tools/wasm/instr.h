@@ -0,0 +1,98 @@
+/**
+ * Instruction decoding for function bodies.
+ *
+ * InstrReader walks an expression one instruction at a time and exposes the
+ * decoded immediates; the byte range of every instruction is kept so tools can
+ * copy the body and only re-encode what they change.
+ */
+
+#ifndef WASM_INSTR_H
+#define WASM_INSTR_H
+
+#include "module.h"
+
+namespace wasm
+{
+
+// opcodes the tools look at by name, prefixed ones are 0xFC00 | sub-opcode
+enum Opcode : uint16_t
+{
+    OP_UNREACHABLE = 0x00,
+    OP_NOP = 0x01,
+    OP_BLOCK = 0x02,
+    OP_LOOP = 0x03,
+    OP_IF = 0x04,
+    OP_ELSE = 0x05,
+    OP_END = 0x0B,
+    OP_BR = 0x0C,
+    OP_BR_IF = 0x0D,
+    OP_BR_TABLE = 0x0E,
+    OP_RETURN = 0x0F,
+    OP_CALL = 0x10,
+    OP_CALL_INDIRECT = 0x11,
+    OP_DROP = 0x1A,
+    OP_SELECT = 0x1B,
+    OP_SELECT_T = 0x1C,
+    OP_LOCAL_GET = 0x20,
+    OP_LOCAL_SET = 0x21,
+    OP_LOCAL_TEE = 0x22,
+    OP_GLOBAL_GET = 0x23,
+    OP_GLOBAL_SET = 0x24,
+    OP_I32_CONST = 0x41,
+    OP_I64_CONST = 0x42,
+    OP_F32_CONST = 0x43,
+    OP_F64_CONST = 0x44,
+    OP_MEMORY_SIZE = 0x3F,
+    OP_MEMORY_GROW = 0x40,
+    OP_REF_NULL = 0xD0,
+    OP_REF_IS_NULL = 0xD1,
+    OP_REF_FUNC = 0xD2,
+    OP_PREFIX = 0xFC,
+    OP_MEMORY_INIT = 0xFC08,
+    OP_DATA_DROP = 0xFC09,
+    OP_MEMORY_COPY = 0xFC0A,
+    OP_MEMORY_FILL = 0xFC0B,
+};
+
+// block types: BLOCK_EMPTY, a value type, or a type index (>= 0)
+constexpr int64_t BLOCK_EMPTY = -64;
+
+struct Instr
+{
+    uint16_t op = 0;
+    size_t offset = 0; // within the body
+    size_t length = 0;
+    // call / call_indirect type / local / global / br depth / ref.func / data index,
+    // the i32/i64 constant, the block type, or the memarg offset
+    int64_t imm = 0;
+    uint32_t imm2 = 0;              // call_indirect table, memarg alignment, memory.copy dst
+    std::vector<uint32_t> targets; // br_table, default last
+    size_t imm_offset = 0;         // of the first immediate within the body
+
+    bool is_load() const { return op >= 0x28 && op <= 0x35; }
+    bool is_store() const { return op >= 0x36 && op <= 0x3E; }
+    bool is_block_start() const { return op == OP_BLOCK || op == OP_LOOP || op == OP_IF; }
+};
+
+class InstrReader
+{
+public:
+    InstrReader(const std::vector<uint8_t> &body) : r_(body.data(), body.size()) {}
+
+    bool done() const { return r_.eof(); }
+    // decodes the next instruction, throws ParseError on unknown opcodes
+    Instr next();
+
+private:
+    Reader r_;
+};
+
+// decodes a whole body
+std::vector<Instr> decode(const std::vector<uint8_t> &body);
+
+// mnemonic for reports, "op 0x.." for opcodes without one
+std::string opcode_name(uint16_t op);
+
+} // namespace wasm
+
+#endif
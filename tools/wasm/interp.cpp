@@ -0,0 +1,1616 @@
+#include "interp.h"
+
+#include "instr.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__GNUC__) && !defined(WASM_NO_THREADING)
+#define WASM_THREADED 1
+#else
+#define WASM_THREADED 0
+#endif
+
+namespace wasm
+{
+
+namespace
+{
+
+// the compiled instruction set: WASM operators with decoded immediates, plus
+// metering, branches with resolved stack adjustment and a few fused pairs
+#define WASM_OPS(X)                                                                                                    \
+    X(CHARGE)                                                                                                          \
+    X(UNREACHABLE)                                                                                                     \
+    X(JUMP)                                                                                                            \
+    X(BR)                                                                                                              \
+    X(BR_IF)                                                                                                           \
+    X(BR_IF_NOMOVE)                                                                                                    \
+    X(BR_UNLESS)                                                                                                       \
+    X(BR_TABLE)                                                                                                        \
+    X(RETURN)                                                                                                          \
+    X(CALL)                                                                                                            \
+    X(CALL_HOST)                                                                                                       \
+    X(CALL_INDIRECT)                                                                                                   \
+    X(DROP)                                                                                                            \
+    X(SELECT)                                                                                                          \
+    X(LOCAL_GET)                                                                                                       \
+    X(LOCAL_GET2)                                                                                                      \
+    X(LOCAL_SET)                                                                                                       \
+    X(LOCAL_TEE)                                                                                                       \
+    X(GLOBAL_GET)                                                                                                      \
+    X(GLOBAL_SET)                                                                                                      \
+    X(I32_LOAD)                                                                                                        \
+    X(I32_LOAD_LOCAL)                                                                                                  \
+    X(I64_LOAD)                                                                                                        \
+    X(I32_LOAD8_S)                                                                                                     \
+    X(I32_LOAD8_U)                                                                                                     \
+    X(I32_LOAD16_S)                                                                                                    \
+    X(I32_LOAD16_U)                                                                                                    \
+    X(I64_LOAD8_S)                                                                                                     \
+    X(I64_LOAD8_U)                                                                                                     \
+    X(I64_LOAD16_S)                                                                                                    \
+    X(I64_LOAD16_U)                                                                                                    \
+    X(I64_LOAD32_S)                                                                                                    \
+    X(I64_LOAD32_U)                                                                                                    \
+    X(I32_STORE)                                                                                                       \
+    X(I64_STORE)                                                                                                       \
+    X(I32_STORE8)                                                                                                      \
+    X(I32_STORE16)                                                                                                     \
+    X(I64_STORE8)                                                                                                      \
+    X(I64_STORE16)                                                                                                     \
+    X(I64_STORE32)                                                                                                     \
+    X(MEMORY_SIZE)                                                                                                     \
+    X(MEMORY_GROW)                                                                                                     \
+    X(MEMORY_INIT)                                                                                                     \
+    X(DATA_DROP)                                                                                                       \
+    X(MEMORY_COPY)                                                                                                     \
+    X(MEMORY_FILL)                                                                                                     \
+    X(CONST)                                                                                                           \
+    X(I32_ADDI)                                                                                                        \
+    X(I64_ADDI)                                                                                                        \
+    X(I32_EQZ)                                                                                                         \
+    X(I32_EQ)                                                                                                          \
+    X(I32_NE)                                                                                                          \
+    X(I32_LT_S)                                                                                                        \
+    X(I32_LT_U)                                                                                                        \
+    X(I32_GT_S)                                                                                                        \
+    X(I32_GT_U)                                                                                                        \
+    X(I32_LE_S)                                                                                                        \
+    X(I32_LE_U)                                                                                                        \
+    X(I32_GE_S)                                                                                                        \
+    X(I32_GE_U)                                                                                                        \
+    X(I64_EQZ)                                                                                                         \
+    X(I64_EQ)                                                                                                          \
+    X(I64_NE)                                                                                                          \
+    X(I64_LT_S)                                                                                                        \
+    X(I64_LT_U)                                                                                                        \
+    X(I64_GT_S)                                                                                                        \
+    X(I64_GT_U)                                                                                                        \
+    X(I64_LE_S)                                                                                                        \
+    X(I64_LE_U)                                                                                                        \
+    X(I64_GE_S)                                                                                                        \
+    X(I64_GE_U)                                                                                                        \
+    X(I32_CLZ)                                                                                                         \
+    X(I32_CTZ)                                                                                                         \
+    X(I32_POPCNT)                                                                                                      \
+    X(I32_ADD)                                                                                                         \
+    X(I32_SUB)                                                                                                         \
+    X(I32_MUL)                                                                                                         \
+    X(I32_DIV_S)                                                                                                       \
+    X(I32_DIV_U)                                                                                                       \
+    X(I32_REM_S)                                                                                                       \
+    X(I32_REM_U)                                                                                                       \
+    X(I32_AND)                                                                                                         \
+    X(I32_OR)                                                                                                          \
+    X(I32_XOR)                                                                                                         \
+    X(I32_SHL)                                                                                                         \
+    X(I32_SHR_S)                                                                                                       \
+    X(I32_SHR_U)                                                                                                       \
+    X(I32_ROTL)                                                                                                        \
+    X(I32_ROTR)                                                                                                        \
+    X(I64_CLZ)                                                                                                         \
+    X(I64_CTZ)                                                                                                         \
+    X(I64_POPCNT)                                                                                                      \
+    X(I64_ADD)                                                                                                         \
+    X(I64_SUB)                                                                                                         \
+    X(I64_MUL)                                                                                                         \
+    X(I64_DIV_S)                                                                                                       \
+    X(I64_DIV_U)                                                                                                       \
+    X(I64_REM_S)                                                                                                       \
+    X(I64_REM_U)                                                                                                       \
+    X(I64_AND)                                                                                                         \
+    X(I64_OR)                                                                                                          \
+    X(I64_XOR)                                                                                                         \
+    X(I64_SHL)                                                                                                         \
+    X(I64_SHR_S)                                                                                                       \
+    X(I64_SHR_U)                                                                                                       \
+    X(I64_ROTL)                                                                                                        \
+    X(I64_ROTR)                                                                                                        \
+    X(I32_WRAP_I64)                                                                                                    \
+    X(I64_EXTEND_I32_S)                                                                                                \
+    X(I64_EXTEND_I32_U)                                                                                                \
+    X(I32_EXTEND8_S)                                                                                                   \
+    X(I32_EXTEND16_S)                                                                                                  \
+    X(I64_EXTEND8_S)                                                                                                   \
+    X(I64_EXTEND16_S)                                                                                                  \
+    X(I64_EXTEND32_S)
+
+enum Op : uint32_t
+{
+#define WASM_ENUM(name) I_##name,
+    WASM_OPS(WASM_ENUM)
+#undef WASM_ENUM
+};
+
+// dirty page tracking granularity for reset()
+constexpr uint32_t DIRTY_SHIFT = 12;
+
+constexpr int64_t NO_FUNC = -1;
+
+// value stack effect of the plain WASM operators the compiler maps one to one
+struct Simple
+{
+    uint16_t wasm;
+    Op op;
+    uint8_t pops;
+    uint8_t pushes;
+};
+
+const Simple SIMPLE[] = {
+    {0x45, I_I32_EQZ, 1, 1},     {0x46, I_I32_EQ, 2, 1},      {0x47, I_I32_NE, 2, 1},
+    {0x48, I_I32_LT_S, 2, 1},    {0x49, I_I32_LT_U, 2, 1},    {0x4A, I_I32_GT_S, 2, 1},
+    {0x4B, I_I32_GT_U, 2, 1},    {0x4C, I_I32_LE_S, 2, 1},    {0x4D, I_I32_LE_U, 2, 1},
+    {0x4E, I_I32_GE_S, 2, 1},    {0x4F, I_I32_GE_U, 2, 1},    {0x50, I_I64_EQZ, 1, 1},
+    {0x51, I_I64_EQ, 2, 1},      {0x52, I_I64_NE, 2, 1},      {0x53, I_I64_LT_S, 2, 1},
+    {0x54, I_I64_LT_U, 2, 1},    {0x55, I_I64_GT_S, 2, 1},    {0x56, I_I64_GT_U, 2, 1},
+    {0x57, I_I64_LE_S, 2, 1},    {0x58, I_I64_LE_U, 2, 1},    {0x59, I_I64_GE_S, 2, 1},
+    {0x5A, I_I64_GE_U, 2, 1},    {0x67, I_I32_CLZ, 1, 1},     {0x68, I_I32_CTZ, 1, 1},
+    {0x69, I_I32_POPCNT, 1, 1},  {0x6A, I_I32_ADD, 2, 1},     {0x6B, I_I32_SUB, 2, 1},
+    {0x6C, I_I32_MUL, 2, 1},     {0x6D, I_I32_DIV_S, 2, 1},   {0x6E, I_I32_DIV_U, 2, 1},
+    {0x6F, I_I32_REM_S, 2, 1},   {0x70, I_I32_REM_U, 2, 1},   {0x71, I_I32_AND, 2, 1},
+    {0x72, I_I32_OR, 2, 1},      {0x73, I_I32_XOR, 2, 1},     {0x74, I_I32_SHL, 2, 1},
+    {0x75, I_I32_SHR_S, 2, 1},   {0x76, I_I32_SHR_U, 2, 1},   {0x77, I_I32_ROTL, 2, 1},
+    {0x78, I_I32_ROTR, 2, 1},    {0x79, I_I64_CLZ, 1, 1},     {0x7A, I_I64_CTZ, 1, 1},
+    {0x7B, I_I64_POPCNT, 1, 1},  {0x7C, I_I64_ADD, 2, 1},     {0x7D, I_I64_SUB, 2, 1},
+    {0x7E, I_I64_MUL, 2, 1},     {0x7F, I_I64_DIV_S, 2, 1},   {0x80, I_I64_DIV_U, 2, 1},
+    {0x81, I_I64_REM_S, 2, 1},   {0x82, I_I64_REM_U, 2, 1},   {0x83, I_I64_AND, 2, 1},
+    {0x84, I_I64_OR, 2, 1},      {0x85, I_I64_XOR, 2, 1},     {0x86, I_I64_SHL, 2, 1},
+    {0x87, I_I64_SHR_S, 2, 1},   {0x88, I_I64_SHR_U, 2, 1},   {0x89, I_I64_ROTL, 2, 1},
+    {0x8A, I_I64_ROTR, 2, 1},    {0xA7, I_I32_WRAP_I64, 1, 1}, {0xAC, I_I64_EXTEND_I32_S, 1, 1},
+    {0xAD, I_I64_EXTEND_I32_U, 1, 1}, {0xC0, I_I32_EXTEND8_S, 1, 1}, {0xC1, I_I32_EXTEND16_S, 1, 1},
+    {0xC2, I_I64_EXTEND8_S, 1, 1}, {0xC3, I_I64_EXTEND16_S, 1, 1}, {0xC4, I_I64_EXTEND32_S, 1, 1},
+    {0x28, I_I32_LOAD, 1, 1},    {0x29, I_I64_LOAD, 1, 1},    {0x2C, I_I32_LOAD8_S, 1, 1},
+    {0x2D, I_I32_LOAD8_U, 1, 1}, {0x2E, I_I32_LOAD16_S, 1, 1}, {0x2F, I_I32_LOAD16_U, 1, 1},
+    {0x30, I_I64_LOAD8_S, 1, 1}, {0x31, I_I64_LOAD8_U, 1, 1}, {0x32, I_I64_LOAD16_S, 1, 1},
+    {0x33, I_I64_LOAD16_U, 1, 1}, {0x34, I_I64_LOAD32_S, 1, 1}, {0x35, I_I64_LOAD32_U, 1, 1},
+    {0x36, I_I32_STORE, 2, 0},   {0x37, I_I64_STORE, 2, 0},   {0x3A, I_I32_STORE8, 2, 0},
+    {0x3B, I_I32_STORE16, 2, 0}, {0x3C, I_I64_STORE8, 2, 0},  {0x3D, I_I64_STORE16, 2, 0},
+    {0x3E, I_I64_STORE32, 2, 0},
+};
+
+// WASM opcode -> index in SIMPLE + 1, 0 for operators handled separately
+struct SimpleTable
+{
+    uint8_t index[256] = {};
+    SimpleTable()
+    {
+        for (size_t i = 0; i < sizeof(SIMPLE) / sizeof(SIMPLE[0]); ++i)
+            index[SIMPLE[i].wasm] = (uint8_t)(i + 1);
+    }
+};
+
+const SimpleTable simple_table;
+
+bool same_type(const FuncType &a, const FuncType &b)
+{
+    return a.params == b.params && a.results == b.results;
+}
+
+} // namespace
+
+struct Instance::Insn
+{
+    const void *label; // handler, with threaded dispatch
+    uint32_t op;
+    uint32_t a;
+    uint64_t b;
+};
+
+struct Instance::Function
+{
+    std::vector<Insn> code;
+    // per instruction: metered instructions of its run that come after it,
+    // uncharged when a trap stops the run there
+    std::vector<uint32_t> rest;
+    uint32_t params = 0;
+    uint32_t locals = 0; // params included
+    uint32_t results = 0;
+    uint32_t max_height = 0; // locals and operand stack
+};
+
+struct Instance::Frame
+{
+    const Insn *pc;
+    uint64_t *fp;
+    const Function *fn;
+};
+
+void Imports::bind(const std::string &module, const std::string &name, HostFunc func, void *user)
+{
+    for (HostBinding &b : bindings_)
+        if (b.module == module && b.name == name)
+        {
+            b.func = func;
+            b.user = user;
+            return;
+        }
+    bindings_.push_back({module, name, func, user});
+}
+
+void Imports::fallback(HostFunc func, void *user)
+{
+    fallback_.func = func;
+    fallback_.user = user;
+}
+
+const HostBinding *Imports::find(const std::string &module, const std::string &name) const
+{
+    for (const HostBinding &b : bindings_)
+        if (b.module == module && b.name == name)
+            return &b;
+    return nullptr;
+}
+
+// translates one function body into the compiled stream
+class Instance::Compiler
+{
+public:
+    Compiler(const Instance &inst, const wasm::Function &src, uint32_t func_index, Function &out)
+        : inst_(inst), m_(inst.module_), src_(src), out_(out)
+    {
+        const FuncType &t = m_.func_type(func_index);
+        out.params = (uint32_t)t.params.size();
+        out.results = (uint32_t)t.results.size();
+        uint64_t locals = out.params;
+        for (auto &run : src.locals)
+        {
+            check_type(run.second, 0);
+            locals += run.first;
+        }
+        for (uint8_t p : t.params)
+            check_type(p, 0);
+        if (locals > STACK_SLOTS)
+            throw ParseError("too many locals", src.offset);
+        out.locals = (uint32_t)locals;
+        height_ = out.locals;
+        out.max_height = height_;
+    }
+
+    void compile()
+    {
+        Ctrl fn;
+        fn.kind = K_FUNC;
+        fn.height = height_;
+        fn.results = out_.results;
+        ctrl_.push_back(fn);
+
+        InstrReader r(src_.body);
+        while (!r.done())
+        {
+            Instr in = r.next();
+            at_ = in.offset;
+            if (ctrl_.empty())
+                fail("code after the final end");
+            step(in);
+        }
+        if (!ctrl_.empty())
+            fail("missing end");
+        close_run();
+    }
+
+private:
+    enum Kind : uint8_t
+    {
+        K_BLOCK,
+        K_LOOP,
+        K_IF,
+        K_ELSE,
+        K_FUNC,
+    };
+
+    struct Ctrl
+    {
+        Kind kind = K_BLOCK;
+        uint32_t height = 0; // below the block's params
+        uint32_t params = 0;
+        uint32_t results = 0;
+        uint32_t start = 0;      // loops: branch target
+        uint32_t if_branch = 0;  // ifs: the BR_UNLESS to patch
+        bool live = true;        // entered reachably
+        bool then_live = false;  // ifs: the then branch fell through to else
+        std::vector<uint32_t> fixups; // branches to the end
+    };
+
+    [[noreturn]] void fail(const std::string &what) const { throw ParseError(what, src_.offset + at_); }
+
+    void check_type(uint8_t t, size_t) const
+    {
+        if (t != VT_I32 && t != VT_I64)
+            fail("unsupported value type (hooks are integer only)");
+    }
+
+    void block_type(int64_t bt, uint32_t &params, uint32_t &results) const
+    {
+        params = results = 0;
+        if (bt == BLOCK_EMPTY)
+            return;
+        if (bt < 0)
+        {
+            check_type((uint8_t)(bt & 0x7F), 0);
+            results = 1;
+            return;
+        }
+        if ((uint64_t)bt >= m_.types.size())
+            fail("bad block type");
+        const FuncType &t = m_.types[bt];
+        params = (uint32_t)t.params.size();
+        results = (uint32_t)t.results.size();
+    }
+
+    void pop(uint32_t n)
+    {
+        if (height_ < ctrl_.back().height + n || height_ < out_.locals + n)
+            fail("value stack underflow");
+        height_ -= n;
+    }
+
+    void push(uint32_t n)
+    {
+        height_ += n;
+        if (height_ > out_.max_height)
+            out_.max_height = height_;
+        if (out_.max_height > STACK_SLOTS)
+            fail("value stack too deep");
+    }
+
+    // counts one executed instruction in the current run, opening a run if needed
+    void count()
+    {
+        if (new_run_)
+        {
+            close_run();
+            run_start_ = (uint32_t)out_.code.size();
+            out_.code.push_back({nullptr, I_CHARGE, 0, 0});
+            out_.rest.push_back(0);
+            run_count_ = 0;
+            new_run_ = false;
+        }
+        ++run_count_;
+    }
+
+    // the CHARGE of a run gets its length, and every instruction of the run the
+    // number counted after it
+    void close_run()
+    {
+        if (run_start_ == NONE)
+            return;
+        out_.code[run_start_].a = run_count_;
+        for (size_t i = run_start_ + 1; i < out_.code.size(); ++i)
+            out_.rest[i] = run_count_ - out_.rest[i];
+        run_start_ = NONE;
+    }
+
+    Insn &emit(Op op, uint32_t a = 0, uint64_t b = 0)
+    {
+        out_.code.push_back({nullptr, op, a, b});
+        out_.rest.push_back(run_count_);
+        return out_.code.back();
+    }
+
+    // the previous instruction, when it belongs to the current run and can be fused
+    Insn *previous(Op op)
+    {
+        if (run_start_ == NONE || out_.code.size() <= run_start_ + 1 || new_run_)
+            return nullptr;
+        Insn &p = out_.code.back();
+        return p.op == op ? &p : nullptr;
+    }
+
+    // the run ends after the current instruction
+    void end_run() { new_run_ = true; }
+
+    void dead()
+    {
+        live_ = false;
+        end_run();
+    }
+
+    // branch to the label `depth` levels up, `kind` one of BR, BR_IF, JUMP-as-br
+    void branch(uint32_t depth, bool conditional)
+    {
+        if (depth >= ctrl_.size())
+            fail("branch depth out of range");
+        Ctrl &target = ctrl_[ctrl_.size() - 1 - depth];
+        uint32_t arity = target.kind == K_LOOP ? target.params : target.results;
+        if (height_ < target.height + arity)
+            fail("value stack underflow at branch");
+        bool move = height_ != target.height + arity;
+        Op op = conditional ? (move ? I_BR_IF : I_BR_IF_NOMOVE) : (move ? I_BR : I_JUMP);
+        uint32_t at = (uint32_t)out_.code.size();
+        // a BR_IF_NOMOVE right after i32.eqz becomes a BR_UNLESS
+        if (op == I_BR_IF_NOMOVE)
+            if (Insn *p = previous(I_I32_EQZ))
+            {
+                p->op = I_BR_UNLESS;
+                at = (uint32_t)(out_.code.size() - 1);
+                out_.rest.back() = run_count_;
+                link_branch(target, at);
+                return;
+            }
+        emit(op, 0, (uint64_t)target.height << 32 | arity);
+        link_branch(target, at);
+    }
+
+    void link_branch(Ctrl &target, uint32_t at)
+    {
+        if (target.kind == K_LOOP)
+            out_.code[at].a = (uint32_t)(target.start - at);
+        else
+            target.fixups.push_back(at);
+    }
+
+    void patch(const std::vector<uint32_t> &fixups, uint32_t dest)
+    {
+        for (uint32_t at : fixups)
+            out_.code[at].a = dest - at;
+    }
+
+    void step(const Instr &in)
+    {
+        uint16_t op = in.op;
+        if (!live_)
+        {
+            // unreachable code: only the block structure matters
+            switch (op)
+            {
+            case OP_BLOCK:
+            case OP_LOOP:
+            case OP_IF:
+            {
+                Ctrl c;
+                c.kind = op == OP_LOOP ? K_LOOP : op == OP_IF ? K_IF : K_BLOCK;
+                c.live = false;
+                c.height = height_;
+                ctrl_.push_back(c);
+                return;
+            }
+            case OP_ELSE:
+            case OP_END:
+                break;
+            default:
+                return;
+            }
+        }
+
+        switch (op)
+        {
+        case OP_UNREACHABLE:
+            count();
+            emit(I_UNREACHABLE);
+            dead();
+            return;
+        case OP_NOP:
+            count();
+            return;
+        case OP_BLOCK:
+        case OP_LOOP:
+        case OP_IF:
+        {
+            Ctrl c;
+            c.kind = op == OP_LOOP ? K_LOOP : op == OP_IF ? K_IF : K_BLOCK;
+            block_type(in.imm, c.params, c.results);
+            count();
+            if (op == OP_IF)
+                pop(1);
+            if (height_ < ctrl_.back().height + c.params)
+                fail("value stack underflow at block");
+            c.height = height_ - c.params;
+            if (op == OP_LOOP)
+            {
+                end_run();
+                c.start = (uint32_t)out_.code.size();
+            }
+            else if (op == OP_IF)
+            {
+                c.if_branch = (uint32_t)out_.code.size();
+                emit(I_BR_UNLESS);
+                end_run();
+            }
+            ctrl_.push_back(c);
+            return;
+        }
+        case OP_ELSE:
+        {
+            Ctrl &c = ctrl_.back();
+            if (c.kind != K_IF)
+                fail("else without if");
+            if (live_)
+            {
+                count();
+                if (height_ != c.height + c.results)
+                    fail("stack height mismatch at else");
+                c.fixups.push_back((uint32_t)out_.code.size());
+                emit(I_JUMP);
+            }
+            c.then_live = live_;
+            c.kind = K_ELSE;
+            live_ = c.live;
+            height_ = c.height + c.params;
+            end_run();
+            if (c.live)
+                out_.code[c.if_branch].a = (uint32_t)(out_.code.size() - c.if_branch);
+            return;
+        }
+        case OP_END:
+        {
+            Ctrl c = std::move(ctrl_.back());
+            if (live_)
+            {
+                count();
+                if (height_ != c.height + c.results)
+                    fail("stack height mismatch at end");
+            }
+            ctrl_.pop_back();
+            uint32_t dest = (uint32_t)out_.code.size();
+            if (c.kind == K_FUNC)
+            {
+                patch(c.fixups, dest);
+                emit(I_RETURN);
+                return;
+            }
+            patch(c.fixups, dest);
+            if (c.kind == K_IF && c.live)
+            {
+                if (c.params != c.results)
+                    fail("if without else must not change the stack");
+                out_.code[c.if_branch].a = dest - c.if_branch;
+            }
+            live_ = c.live;
+            height_ = c.height + c.results;
+            if (c.kind != K_LOOP)
+                end_run();
+            return;
+        }
+        case OP_BR:
+            count();
+            branch((uint32_t)in.imm, false);
+            dead();
+            return;
+        case OP_BR_IF:
+            count();
+            pop(1);
+            branch((uint32_t)in.imm, true);
+            end_run();
+            return;
+        case OP_BR_TABLE:
+        {
+            count();
+            pop(1);
+            emit(I_BR_TABLE, (uint32_t)(in.targets.size() - 1));
+            for (uint32_t depth : in.targets)
+                branch(depth, false);
+            dead();
+            return;
+        }
+        case OP_RETURN:
+            count();
+            pop(out_.results);
+            emit(I_RETURN);
+            dead();
+            return;
+        case OP_CALL:
+        case OP_CALL_INDIRECT:
+        {
+            count();
+            const FuncType *t;
+            if (op == OP_CALL)
+            {
+                if ((uint64_t)in.imm >= m_.func_count())
+                    fail("call to unknown function");
+                t = &m_.func_type((uint32_t)in.imm);
+                pop((uint32_t)t->params.size());
+                if (m_.is_import((uint32_t)in.imm))
+                    emit(I_CALL_HOST, (uint32_t)in.imm, inst_.host_signatures_[in.imm]);
+                else
+                    emit(I_CALL, (uint32_t)(in.imm - m_.imported_funcs()));
+            }
+            else
+            {
+                if ((uint64_t)in.imm >= m_.types.size() || m_.tables.empty())
+                    fail("bad call_indirect");
+                t = &m_.types[in.imm];
+                pop(1);
+                pop((uint32_t)t->params.size());
+                emit(I_CALL_INDIRECT, inst_.canonical_type((uint32_t)in.imm));
+            }
+            for (uint8_t r : t->results)
+                check_type(r, 0);
+            push((uint32_t)t->results.size());
+            // runs end at calls so a halt or trap in the callee leaves nothing charged
+            end_run();
+            return;
+        }
+        case OP_DROP:
+            count();
+            pop(1);
+            emit(I_DROP);
+            return;
+        case OP_SELECT:
+        case OP_SELECT_T:
+            count();
+            pop(3);
+            push(1);
+            emit(I_SELECT);
+            return;
+        case OP_LOCAL_GET:
+            count();
+            if ((uint64_t)in.imm >= out_.locals)
+                fail("bad local");
+            push(1);
+            if (Insn *p = previous(I_LOCAL_GET))
+            {
+                p->op = I_LOCAL_GET2;
+                p->b = (uint64_t)in.imm;
+                out_.rest.back() = run_count_;
+                return;
+            }
+            emit(I_LOCAL_GET, (uint32_t)in.imm);
+            return;
+        case OP_LOCAL_SET:
+        case OP_LOCAL_TEE:
+            count();
+            if ((uint64_t)in.imm >= out_.locals)
+                fail("bad local");
+            pop(1);
+            if (op == OP_LOCAL_TEE)
+                push(1);
+            emit(op == OP_LOCAL_SET ? I_LOCAL_SET : I_LOCAL_TEE, (uint32_t)in.imm);
+            return;
+        case OP_GLOBAL_GET:
+        case OP_GLOBAL_SET:
+            count();
+            if ((uint64_t)in.imm >= m_.globals.size())
+                fail("bad global (imported globals are not supported)");
+            if (op == OP_GLOBAL_GET)
+                push(1);
+            else
+                pop(1);
+            emit(op == OP_GLOBAL_GET ? I_GLOBAL_GET : I_GLOBAL_SET, (uint32_t)in.imm);
+            return;
+        case OP_I32_CONST:
+        case OP_I64_CONST:
+            count();
+            push(1);
+            emit(I_CONST, 0, op == OP_I32_CONST ? (uint64_t)(uint32_t)in.imm : (uint64_t)in.imm);
+            return;
+        case OP_MEMORY_SIZE:
+        case OP_MEMORY_GROW:
+            count();
+            need_memory();
+            if (op == OP_MEMORY_GROW)
+                pop(1);
+            push(1);
+            emit(op == OP_MEMORY_SIZE ? I_MEMORY_SIZE : I_MEMORY_GROW);
+            return;
+        case OP_MEMORY_INIT:
+            count();
+            need_memory();
+            if ((uint64_t)in.imm >= m_.data.size())
+                fail("bad data segment");
+            pop(3);
+            emit(I_MEMORY_INIT, (uint32_t)in.imm);
+            return;
+        case OP_DATA_DROP:
+            count();
+            if ((uint64_t)in.imm >= m_.data.size())
+                fail("bad data segment");
+            emit(I_DATA_DROP, (uint32_t)in.imm);
+            return;
+        case OP_MEMORY_COPY:
+        case OP_MEMORY_FILL:
+            count();
+            need_memory();
+            pop(3);
+            emit(op == OP_MEMORY_COPY ? I_MEMORY_COPY : I_MEMORY_FILL);
+            return;
+        default:
+            break;
+        }
+
+        uint8_t index = op < 256 ? simple_table.index[op] : 0;
+        if (!index)
+            fail("unsupported instruction " + opcode_name(op));
+        const Simple &s = SIMPLE[index - 1];
+        count();
+        pop(s.pops);
+        push(s.pushes);
+        if (in.is_load() || in.is_store())
+        {
+            need_memory();
+            if (s.op == I_I32_LOAD)
+                if (Insn *p = previous(I_LOCAL_GET))
+                {
+                    p->op = I_I32_LOAD_LOCAL;
+                    p->b = (uint32_t)in.imm;
+                    out_.rest.back() = run_count_;
+                    return;
+                }
+            emit(s.op, (uint32_t)in.imm);
+            return;
+        }
+        // constant + add: pointer arithmetic and counters
+        if (s.op == I_I32_ADD || s.op == I_I64_ADD)
+            if (Insn *p = previous(I_CONST))
+            {
+                p->op = s.op == I_I32_ADD ? I_I32_ADDI : I_I64_ADDI;
+                out_.rest.back() = run_count_;
+                return;
+            }
+        emit(s.op);
+    }
+
+    void need_memory() const
+    {
+        if (m_.memories.empty())
+            fail("memory access without a memory");
+    }
+
+    static constexpr uint32_t NONE = ~0U;
+
+    const Instance &inst_;
+    const Module &m_;
+    const wasm::Function &src_;
+    Function &out_;
+    std::vector<Ctrl> ctrl_;
+    uint32_t height_ = 0;
+    bool live_ = true;
+    bool new_run_ = true;
+    uint32_t run_start_ = NONE;
+    uint32_t run_count_ = 0;
+    size_t at_ = 0;
+};
+
+uint32_t Instance::canonical_type(uint32_t type) const
+{
+    for (uint32_t i = 0; i < type; ++i)
+        if (same_type(module_.types[i], module_.types[type]))
+            return i;
+    return type;
+}
+
+uint64_t Instance::eval_const(const std::vector<uint8_t> &expr) const
+{
+    Reader r(expr.data(), expr.size());
+    uint8_t op = r.u8();
+    uint64_t v;
+    switch (op)
+    {
+    case OP_I32_CONST:
+        v = (uint32_t)r.s32();
+        break;
+    case OP_I64_CONST:
+        v = (uint64_t)r.s64();
+        break;
+    case OP_GLOBAL_GET:
+    {
+        uint32_t g = r.u32();
+        if (g >= globals_.size())
+            throw ParseError("constant expression reads an unknown global", 0);
+        v = globals_[g];
+        break;
+    }
+    default:
+        throw ParseError("unsupported constant expression", 0);
+    }
+    if (r.u8() != OP_END)
+        throw ParseError("unsupported constant expression", 0);
+    return v;
+}
+
+Instance::Instance(const Module &module, const Imports &imports) : module_(module)
+{
+    for (uint32_t i = 0; i < module.imports.size(); ++i)
+    {
+        const Import &im = module.imports[i];
+        if (im.kind != KIND_FUNC)
+            throw std::runtime_error("unsupported import " + im.module + "." + im.name +
+                                     ": only functions can be imported");
+        const FuncType &t = module.types.at(im.type);
+        if (t.results.size() > 1)
+            throw std::runtime_error("import " + im.name + " returns more than one value");
+        const HostBinding *b = imports.find(im.module, im.name);
+        if (!b)
+        {
+            if (!imports.fallback().func)
+                throw std::runtime_error("unbound import " + im.module + "." + im.name);
+            b = &imports.fallback();
+        }
+        hosts_.push_back(*b);
+        import_index_.push_back(i);
+        // CALL_HOST immediate: parameter count, result count, 64 bit result
+        bool wide = !t.results.empty() && t.results[0] == VT_I64;
+        host_signatures_.push_back(t.params.size() | t.results.size() << 8 | (uint64_t)wide << 16);
+    }
+    for (uint32_t f = 0; f < module.func_count(); ++f)
+        func_types_.push_back(canonical_type(module.func_type_index(f)));
+
+    if (module.memories.size() > 1)
+        throw ParseError("more than one memory", 0);
+    if (!module.memories.empty())
+    {
+        const Limits &l = module.memories[0];
+        max_pages_ = l.max ? std::min<uint32_t>(*l.max, MAX_PAGES) : MAX_PAGES;
+        memory_.assign((size_t)l.min * PAGE_SIZE, 0);
+    }
+
+    for (const Global &g : module.globals)
+    {
+        if (g.type != VT_I32 && g.type != VT_I64)
+            throw ParseError("unsupported global type", 0);
+        globals_.push_back(eval_const(g.init));
+    }
+
+    if (!module.tables.empty())
+        table_.assign(module.tables[0].limits.min, NO_FUNC);
+    for (const Element &e : module.elements)
+    {
+        if (e.table != 0 || table_.empty())
+            throw ParseError("element segment for an unknown table", 0);
+        uint64_t at = (uint32_t)eval_const(e.offset);
+        if (at + e.funcs.size() > table_.size())
+            throw ParseError("element segment out of bounds", 0);
+        for (uint32_t f : e.funcs)
+            table_[at++] = f;
+    }
+
+    for (const Data &d : module.data)
+    {
+        dropped_data_.push_back(false);
+        if (d.passive)
+            continue;
+        uint64_t at = (uint32_t)eval_const(d.offset);
+        if (at + d.bytes.size() > memory_.size())
+            throw ParseError("data segment out of bounds", 0);
+        std::memcpy(memory_.data() + at, d.bytes.data(), d.bytes.size());
+    }
+
+    functions_.resize(module.functions.size());
+    for (uint32_t i = 0; i < module.functions.size(); ++i)
+        Compiler(*this, module.functions[i], module.imported_funcs() + i, functions_[i]).compile();
+    link();
+
+    initial_memory_ = memory_;
+    initial_globals_ = globals_;
+    dirty_.assign((memory_.size() >> DIRTY_SHIFT) + 1, 0);
+    stack_.resize(STACK_SLOTS);
+    frames_.resize(MAX_FRAMES);
+
+    if (module.start)
+    {
+        Result r = call(*module.start, nullptr, 0);
+        if (r.status != Status::OK)
+            throw std::runtime_error("start function failed: " + r.trap);
+        initial_memory_ = memory_;
+        initial_globals_ = globals_;
+        std::fill(dirty_.begin(), dirty_.end(), 0);
+    }
+}
+
+Instance::~Instance() = default;
+
+size_t Instance::code_size() const
+{
+    size_t n = 0;
+    for (const Function &f : functions_)
+        n += f.code.size();
+    return n;
+}
+
+void Instance::touch(uint64_t ptr, uint64_t len)
+{
+    if (len == 0)
+        return;
+    for (uint64_t p = ptr >> DIRTY_SHIFT; p <= (ptr + len - 1) >> DIRTY_SHIFT; ++p)
+        dirty_[p] = 1;
+}
+
+void Instance::reset()
+{
+    size_t size = initial_memory_.size();
+    if (memory_.size() != size)
+        memory_.resize(size);
+    for (size_t p = 0; p < dirty_.size(); ++p)
+        if (dirty_[p])
+        {
+            size_t at = p << DIRTY_SHIFT;
+            if (at < size)
+                std::memcpy(memory_.data() + at, initial_memory_.data() + at,
+                            std::min<size_t>(size - at, (size_t)1 << DIRTY_SHIFT));
+        }
+    dirty_.assign((size >> DIRTY_SHIFT) + 1, 0);
+    globals_ = initial_globals_;
+    std::fill(dropped_data_.begin(), dropped_data_.end(), false);
+}
+
+Result Instance::call(const std::string &export_name, const uint64_t *args, size_t nargs, uint64_t fuel)
+{
+    std::optional<uint32_t> f = module_.find_export(export_name);
+    if (!f)
+    {
+        Result r;
+        r.status = Status::TRAP;
+        r.trap = "no exported function " + export_name;
+        return r;
+    }
+    return call(*f, args, nargs, fuel);
+}
+
+Result Instance::call(uint32_t func, const uint64_t *args, size_t nargs, uint64_t fuel)
+{
+    Result r;
+    if (func >= module_.func_count() || nargs != module_.func_type(func).params.size())
+    {
+        r.status = Status::TRAP;
+        r.trap = "bad function or argument count";
+        return r;
+    }
+    halted_ = false;
+    if (module_.is_import(func))
+    {
+        current_import_ = func;
+        r.host_calls = 1;
+        const HostBinding &h = hosts_[func];
+        r.value = (uint64_t)h.func(*this, h.user, args);
+        if (halted_)
+        {
+            r.status = Status::HALTED;
+            r.value = halt_value_;
+        }
+        return r;
+    }
+    return run(func, args, nargs, fuel);
+}
+
+#if WASM_THREADED
+#define CASE(name) L_##name:
+#define DISPATCH() goto *pc->label
+#else
+#define CASE(name) case I_##name:
+#define DISPATCH() goto dispatch
+#endif
+#define NEXT()                                                                                                         \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        ++pc;                                                                                                          \
+        DISPATCH();                                                                                                    \
+    } while (0)
+#define TRAP(why)                                                                                                      \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        trap = why;                                                                                                    \
+        goto trapped;                                                                                                  \
+    } while (0)
+
+// effective address of an access of `size` bytes, traps when out of bounds
+#define ADDRESS(ea, base, size)                                                                                        \
+    uint64_t ea = (uint64_t)(uint32_t)(base) + pc->a;                                                                  \
+    if (ea + (size) > mem_size)                                                                                        \
+    TRAP("out of bounds memory access")
+
+#define LOAD(type, ctype, convert)                                                                                     \
+    {                                                                                                                  \
+        ADDRESS(ea, sp[-1], sizeof(ctype));                                                                  \
+        ctype v;                                                                                                       \
+        std::memcpy(&v, mem + ea, sizeof(ctype));                                                                      \
+        sp[-1] = convert(v);                                                                                           \
+        NEXT();                                                                                                        \
+    }
+
+#define STORE(ctype)                                                                                                   \
+    {                                                                                                                  \
+        sp -= 2;                                                                                                       \
+        ADDRESS(ea, sp[0], sizeof(ctype));                                                                   \
+        ctype v = (ctype)sp[1];                                                                                        \
+        std::memcpy(mem + ea, &v, sizeof(ctype));                                                                      \
+        dirty[ea >> DIRTY_SHIFT] = 1;                                                                                  \
+        dirty[(ea + sizeof(ctype) - 1) >> DIRTY_SHIFT] = 1;                                                            \
+        NEXT();                                                                                                        \
+    }
+
+#define BIN32(expr)                                                                                                    \
+    {                                                                                                                  \
+        uint32_t b = (uint32_t)sp[-1], a = (uint32_t)sp[-2];                                                           \
+        (void)a, (void)b;                                                                                              \
+        --sp;                                                                                                          \
+        sp[-1] = (uint32_t)(expr);                                                                                     \
+        NEXT();                                                                                                        \
+    }
+#define BIN64(expr)                                                                                                    \
+    {                                                                                                                  \
+        uint64_t b = sp[-1], a = sp[-2];                                                                               \
+        (void)a, (void)b;                                                                                              \
+        --sp;                                                                                                          \
+        sp[-1] = (uint64_t)(expr);                                                                                     \
+        NEXT();                                                                                                        \
+    }
+#define UN32(expr)                                                                                                     \
+    {                                                                                                                  \
+        uint32_t a = (uint32_t)sp[-1];                                                                                 \
+        sp[-1] = (uint32_t)(expr);                                                                                     \
+        NEXT();                                                                                                        \
+    }
+#define UN64(expr)                                                                                                     \
+    {                                                                                                                  \
+        uint64_t a = sp[-1];                                                                                           \
+        sp[-1] = (uint64_t)(expr);                                                                                     \
+        NEXT();                                                                                                        \
+    }
+
+void Instance::link()
+{
+#if WASM_THREADED
+    // run() hands out its label table when called with no function
+    run(~0U, nullptr, 0, 0);
+#endif
+}
+
+Result Instance::run(uint32_t func, const uint64_t *args, size_t nargs, uint64_t fuel)
+{
+#if WASM_THREADED
+#define WASM_LABEL(name) &&L_##name,
+    static const void *const labels[] = {WASM_OPS(WASM_LABEL)};
+#undef WASM_LABEL
+    if (func == ~0U)
+    {
+        for (Function &f : functions_)
+            for (Insn &in : f.code)
+                in.label = labels[in.op];
+        return {};
+    }
+#endif
+
+    Result result;
+    const Function *fn = &functions_[func - module_.imported_funcs()];
+    uint64_t *const stack_end = stack_.data() + stack_.size();
+    uint64_t *fp = stack_.data();
+    std::memcpy(fp, args, nargs * sizeof(uint64_t));
+    std::memset(fp + fn->params, 0, (fn->locals - fn->params) * sizeof(uint64_t));
+    uint64_t *sp = fp + fn->locals;
+    const Insn *pc = fn->code.data();
+    size_t depth = 0;
+    uint64_t used = 0;
+    const char *trap = nullptr;
+    uint8_t *mem = memory_.data();
+    uint64_t mem_size = memory_.size();
+    uint8_t *dirty = dirty_.data();
+    const Function *callee;
+    uint32_t host;
+    uint64_t signature;
+
+    DISPATCH();
+#if !WASM_THREADED
+dispatch:
+    switch ((Op)pc->op)
+    {
+#endif
+
+    CASE(CHARGE)
+    {
+        if (fuel - used < pc->a)
+        {
+            result.status = Status::OUT_OF_FUEL;
+            goto done;
+        }
+        used += pc->a;
+        NEXT();
+    }
+    CASE(UNREACHABLE)
+    TRAP("unreachable executed");
+    CASE(JUMP)
+    {
+        pc += (int32_t)pc->a;
+        DISPATCH();
+    }
+    CASE(BR)
+    {
+    branch:
+        uint32_t arity = (uint32_t)pc->b;
+        uint64_t *dst = fp + (pc->b >> 32);
+        if (arity)
+            std::memmove(dst, sp - arity, arity * sizeof(uint64_t));
+        sp = dst + arity;
+        pc += (int32_t)pc->a;
+        DISPATCH();
+    }
+    CASE(BR_IF)
+    {
+        if ((uint32_t)*--sp)
+            goto branch;
+        NEXT();
+    }
+    CASE(BR_IF_NOMOVE)
+    {
+        if ((uint32_t)*--sp)
+        {
+            pc += (int32_t)pc->a;
+            DISPATCH();
+        }
+        NEXT();
+    }
+    CASE(BR_UNLESS)
+    {
+        if (!(uint32_t)*--sp)
+        {
+            pc += (int32_t)pc->a;
+            DISPATCH();
+        }
+        NEXT();
+    }
+    CASE(BR_TABLE)
+    {
+        uint32_t i = (uint32_t)*--sp;
+        if (i > pc->a)
+            i = pc->a;
+        pc += 1 + i;
+        DISPATCH();
+    }
+    CASE(RETURN)
+    {
+        uint32_t n = fn->results;
+        if (n)
+            std::memmove(fp, sp - n, n * sizeof(uint64_t));
+        sp = fp + n;
+        if (depth == 0)
+        {
+            result.value = n ? fp[0] : 0;
+            goto done;
+        }
+        Frame &f = frames_[--depth];
+        pc = f.pc;
+        fp = f.fp;
+        fn = f.fn;
+        DISPATCH();
+    }
+    CASE(CALL)
+    {
+        callee = &functions_[pc->a];
+    call:
+        uint64_t *callee_fp = sp - callee->params;
+        if (depth == MAX_FRAMES || callee_fp + callee->max_height > stack_end)
+            TRAP("call stack exhausted");
+        frames_[depth++] = {pc + 1, fp, fn};
+        std::memset(callee_fp + callee->params, 0, (callee->locals - callee->params) * sizeof(uint64_t));
+        fp = callee_fp;
+        sp = fp + callee->locals;
+        fn = callee;
+        pc = fn->code.data();
+        DISPATCH();
+    }
+    CASE(CALL_HOST)
+    {
+        host = pc->a;
+        signature = pc->b;
+    call_host:
+        sp -= signature & 0xFF;
+        current_import_ = host;
+        ++result.host_calls;
+        const HostBinding &h = hosts_[host];
+        int64_t v = h.func(*this, h.user, sp);
+        if (signature & 0xFF00)
+            *sp++ = (signature & 0x10000) ? (uint64_t)v : (uint32_t)v;
+        if (halted_)
+        {
+            result.status = Status::HALTED;
+            result.value = halt_value_;
+            goto done;
+        }
+        // host functions may write memory but never resize it
+        NEXT();
+    }
+    CASE(CALL_INDIRECT)
+    {
+        uint32_t i = (uint32_t)*--sp;
+        if (i >= table_.size() || table_[i] == NO_FUNC)
+            TRAP("undefined table element");
+        uint32_t target = (uint32_t)table_[i];
+        if (func_types_[target] != pc->a)
+            TRAP("indirect call signature mismatch");
+        if (module_.is_import(target))
+        {
+            host = target;
+            signature = host_signatures_[target];
+            goto call_host;
+        }
+        callee = &functions_[target - module_.imported_funcs()];
+        goto call;
+    }
+    CASE(DROP)
+    {
+        --sp;
+        NEXT();
+    }
+    CASE(SELECT)
+    {
+        sp -= 2;
+        if (!(uint32_t)sp[1])
+            sp[-1] = sp[0];
+        NEXT();
+    }
+    CASE(LOCAL_GET)
+    {
+        *sp++ = fp[pc->a];
+        NEXT();
+    }
+    CASE(LOCAL_GET2)
+    {
+        sp[0] = fp[pc->a];
+        sp[1] = fp[pc->b];
+        sp += 2;
+        NEXT();
+    }
+    CASE(LOCAL_SET)
+    {
+        fp[pc->a] = *--sp;
+        NEXT();
+    }
+    CASE(LOCAL_TEE)
+    {
+        fp[pc->a] = sp[-1];
+        NEXT();
+    }
+    CASE(GLOBAL_GET)
+    {
+        *sp++ = globals_[pc->a];
+        NEXT();
+    }
+    CASE(GLOBAL_SET)
+    {
+        globals_[pc->a] = *--sp;
+        NEXT();
+    }
+    CASE(I32_LOAD)
+    LOAD(i32, uint32_t, (uint64_t))
+    CASE(I32_LOAD_LOCAL)
+    {
+        // local.get a; i32.load offset b
+        uint64_t ea = (uint64_t)(uint32_t)fp[pc->a] + pc->b;
+        if (ea + 4 > mem_size)
+            TRAP("out of bounds memory access");
+        uint32_t v;
+        std::memcpy(&v, mem + ea, 4);
+        *sp++ = v;
+        NEXT();
+    }
+    CASE(I64_LOAD)
+    LOAD(i64, uint64_t, (uint64_t))
+    CASE(I32_LOAD8_S)
+    LOAD(i32, int8_t, (uint32_t)(int32_t))
+    CASE(I32_LOAD8_U)
+    LOAD(i32, uint8_t, (uint64_t))
+    CASE(I32_LOAD16_S)
+    LOAD(i32, int16_t, (uint32_t)(int32_t))
+    CASE(I32_LOAD16_U)
+    LOAD(i32, uint16_t, (uint64_t))
+    CASE(I64_LOAD8_S)
+    LOAD(i64, int8_t, (uint64_t)(int64_t))
+    CASE(I64_LOAD8_U)
+    LOAD(i64, uint8_t, (uint64_t))
+    CASE(I64_LOAD16_S)
+    LOAD(i64, int16_t, (uint64_t)(int64_t))
+    CASE(I64_LOAD16_U)
+    LOAD(i64, uint16_t, (uint64_t))
+    CASE(I64_LOAD32_S)
+    LOAD(i64, int32_t, (uint64_t)(int64_t))
+    CASE(I64_LOAD32_U)
+    LOAD(i64, uint32_t, (uint64_t))
+    CASE(I32_STORE)
+    STORE(uint32_t)
+    CASE(I64_STORE)
+    STORE(uint64_t)
+    CASE(I32_STORE8)
+    STORE(uint8_t)
+    CASE(I32_STORE16)
+    STORE(uint16_t)
+    CASE(I64_STORE8)
+    STORE(uint8_t)
+    CASE(I64_STORE16)
+    STORE(uint16_t)
+    CASE(I64_STORE32)
+    STORE(uint32_t)
+    CASE(MEMORY_SIZE)
+    {
+        *sp++ = mem_size / PAGE_SIZE;
+        NEXT();
+    }
+    CASE(MEMORY_GROW)
+    {
+        uint32_t delta = (uint32_t)sp[-1];
+        uint64_t pages = mem_size / PAGE_SIZE;
+        if (pages + delta > max_pages_)
+            sp[-1] = 0xFFFFFFFFU;
+        else
+        {
+            memory_.resize((pages + delta) * PAGE_SIZE, 0);
+            dirty_.resize((memory_.size() >> DIRTY_SHIFT) + 1, 0);
+            mem = memory_.data();
+            mem_size = memory_.size();
+            dirty = dirty_.data();
+            sp[-1] = (uint32_t)pages;
+        }
+        NEXT();
+    }
+    CASE(MEMORY_INIT)
+    {
+        sp -= 3;
+        uint64_t dst = (uint32_t)sp[0], src = (uint32_t)sp[1], n = (uint32_t)sp[2];
+        const Data &d = module_.data[pc->a];
+        uint64_t avail = dropped_data_[pc->a] ? 0 : d.bytes.size();
+        if (src + n > avail || dst + n > mem_size)
+            TRAP("out of bounds memory.init");
+        if (n)
+        {
+            std::memcpy(mem + dst, d.bytes.data() + src, n);
+            touch(dst, n);
+        }
+        NEXT();
+    }
+    CASE(DATA_DROP)
+    {
+        dropped_data_[pc->a] = true;
+        NEXT();
+    }
+    CASE(MEMORY_COPY)
+    {
+        sp -= 3;
+        uint64_t dst = (uint32_t)sp[0], src = (uint32_t)sp[1], n = (uint32_t)sp[2];
+        if (src + n > mem_size || dst + n > mem_size)
+            TRAP("out of bounds memory.copy");
+        if (n)
+        {
+            std::memmove(mem + dst, mem + src, n);
+            touch(dst, n);
+        }
+        NEXT();
+    }
+    CASE(MEMORY_FILL)
+    {
+        sp -= 3;
+        uint64_t dst = (uint32_t)sp[0], n = (uint32_t)sp[2];
+        if (dst + n > mem_size)
+            TRAP("out of bounds memory.fill");
+        if (n)
+        {
+            std::memset(mem + dst, (uint8_t)sp[1], n);
+            touch(dst, n);
+        }
+        NEXT();
+    }
+    CASE(CONST)
+    {
+        *sp++ = pc->b;
+        NEXT();
+    }
+    CASE(I32_ADDI)
+    UN32(a + (uint32_t)pc->b)
+    CASE(I64_ADDI)
+    UN64(a + pc->b)
+    CASE(I32_EQZ)
+    UN32(a == 0)
+    CASE(I32_EQ)
+    BIN32(a == b)
+    CASE(I32_NE)
+    BIN32(a != b)
+    CASE(I32_LT_S)
+    BIN32((int32_t)a < (int32_t)b)
+    CASE(I32_LT_U)
+    BIN32(a < b)
+    CASE(I32_GT_S)
+    BIN32((int32_t)a > (int32_t)b)
+    CASE(I32_GT_U)
+    BIN32(a > b)
+    CASE(I32_LE_S)
+    BIN32((int32_t)a <= (int32_t)b)
+    CASE(I32_LE_U)
+    BIN32(a <= b)
+    CASE(I32_GE_S)
+    BIN32((int32_t)a >= (int32_t)b)
+    CASE(I32_GE_U)
+    BIN32(a >= b)
+    CASE(I64_EQZ)
+    UN64(a == 0)
+    CASE(I64_EQ)
+    BIN64(a == b)
+    CASE(I64_NE)
+    BIN64(a != b)
+    CASE(I64_LT_S)
+    BIN64((int64_t)a < (int64_t)b)
+    CASE(I64_LT_U)
+    BIN64(a < b)
+    CASE(I64_GT_S)
+    BIN64((int64_t)a > (int64_t)b)
+    CASE(I64_GT_U)
+    BIN64(a > b)
+    CASE(I64_LE_S)
+    BIN64((int64_t)a <= (int64_t)b)
+    CASE(I64_LE_U)
+    BIN64(a <= b)
+    CASE(I64_GE_S)
+    BIN64((int64_t)a >= (int64_t)b)
+    CASE(I64_GE_U)
+    BIN64(a >= b)
+    CASE(I32_CLZ)
+    UN32(a ? __builtin_clz(a) : 32)
+    CASE(I32_CTZ)
+    UN32(a ? __builtin_ctz(a) : 32)
+    CASE(I32_POPCNT)
+    UN32(__builtin_popcount(a))
+    CASE(I32_ADD)
+    BIN32(a + b)
+    CASE(I32_SUB)
+    BIN32(a - b)
+    CASE(I32_MUL)
+    BIN32(a * b)
+    CASE(I32_DIV_S)
+    {
+        int32_t b = (int32_t)sp[-1], a = (int32_t)sp[-2];
+        if (b == 0)
+            TRAP("integer divide by zero");
+        if (a == INT32_MIN && b == -1)
+            TRAP("integer overflow");
+        --sp;
+        sp[-1] = (uint32_t)(a / b);
+        NEXT();
+    }
+    CASE(I32_DIV_U)
+    {
+        uint32_t b = (uint32_t)sp[-1], a = (uint32_t)sp[-2];
+        if (b == 0)
+            TRAP("integer divide by zero");
+        --sp;
+        sp[-1] = a / b;
+        NEXT();
+    }
+    CASE(I32_REM_S)
+    {
+        int32_t b = (int32_t)sp[-1], a = (int32_t)sp[-2];
+        if (b == 0)
+            TRAP("integer divide by zero");
+        --sp;
+        sp[-1] = b == -1 ? 0 : (uint32_t)(a % b);
+        NEXT();
+    }
+    CASE(I32_REM_U)
+    {
+        uint32_t b = (uint32_t)sp[-1], a = (uint32_t)sp[-2];
+        if (b == 0)
+            TRAP("integer divide by zero");
+        --sp;
+        sp[-1] = a % b;
+        NEXT();
+    }
+    CASE(I32_AND)
+    BIN32(a & b)
+    CASE(I32_OR)
+    BIN32(a | b)
+    CASE(I32_XOR)
+    BIN32(a ^ b)
+    CASE(I32_SHL)
+    BIN32(a << (b & 31))
+    CASE(I32_SHR_S)
+    BIN32((int32_t)a >> (b & 31))
+    CASE(I32_SHR_U)
+    BIN32(a >> (b & 31))
+    CASE(I32_ROTL)
+    BIN32((a << (b & 31)) | (a >> ((32 - (b & 31)) & 31)))
+    CASE(I32_ROTR)
+    BIN32((a >> (b & 31)) | (a << ((32 - (b & 31)) & 31)))
+    CASE(I64_CLZ)
+    UN64(a ? __builtin_clzll(a) : 64)
+    CASE(I64_CTZ)
+    UN64(a ? __builtin_ctzll(a) : 64)
+    CASE(I64_POPCNT)
+    UN64(__builtin_popcountll(a))
+    CASE(I64_ADD)
+    BIN64(a + b)
+    CASE(I64_SUB)
+    BIN64(a - b)
+    CASE(I64_MUL)
+    BIN64(a * b)
+    CASE(I64_DIV_S)
+    {
+        int64_t b = (int64_t)sp[-1], a = (int64_t)sp[-2];
+        if (b == 0)
+            TRAP("integer divide by zero");
+        if (a == INT64_MIN && b == -1)
+            TRAP("integer overflow");
+        --sp;
+        sp[-1] = (uint64_t)(a / b);
+        NEXT();
+    }
+    CASE(I64_DIV_U)
+    {
+        uint64_t b = sp[-1], a = sp[-2];
+        if (b == 0)
+            TRAP("integer divide by zero");
+        --sp;
+        sp[-1] = a / b;
+        NEXT();
+    }
+    CASE(I64_REM_S)
+    {
+        int64_t b = (int64_t)sp[-1], a = (int64_t)sp[-2];
+        if (b == 0)
+            TRAP("integer divide by zero");
+        --sp;
+        sp[-1] = b == -1 ? 0 : (uint64_t)(a % b);
+        NEXT();
+    }
+    CASE(I64_REM_U)
+    {
+        uint64_t b = sp[-1], a = sp[-2];
+        if (b == 0)
+            TRAP("integer divide by zero");
+        --sp;
+        sp[-1] = a % b;
+        NEXT();
+    }
+    CASE(I64_AND)
+    BIN64(a & b)
+    CASE(I64_OR)
+    BIN64(a | b)
+    CASE(I64_XOR)
+    BIN64(a ^ b)
+    CASE(I64_SHL)
+    BIN64(a << (b & 63))
+    CASE(I64_SHR_S)
+    BIN64((int64_t)a >> (b & 63))
+    CASE(I64_SHR_U)
+    BIN64(a >> (b & 63))
+    CASE(I64_ROTL)
+    BIN64((a << (b & 63)) | (a >> ((64 - (b & 63)) & 63)))
+    CASE(I64_ROTR)
+    BIN64((a >> (b & 63)) | (a << ((64 - (b & 63)) & 63)))
+    CASE(I32_WRAP_I64)
+    UN64((uint32_t)a)
+    CASE(I64_EXTEND_I32_S)
+    UN64((int64_t)(int32_t)a)
+    CASE(I64_EXTEND_I32_U)
+    UN64((uint32_t)a)
+    CASE(I32_EXTEND8_S)
+    UN32((int32_t)(int8_t)a)
+    CASE(I32_EXTEND16_S)
+    UN32((int32_t)(int16_t)a)
+    CASE(I64_EXTEND8_S)
+    UN64((int64_t)(int8_t)a)
+    CASE(I64_EXTEND16_S)
+    UN64((int64_t)(int16_t)a)
+    CASE(I64_EXTEND32_S)
+    UN64((int64_t)(int32_t)a)
+
+#if !WASM_THREADED
+    }
+#endif
+
+trapped:
+    result.status = Status::TRAP;
+    result.trap = trap;
+    // the rest of the run was charged but not executed
+    used -= fn->rest[pc - fn->code.data()];
+done:
+    result.instructions = used;
+    return result;
+}
+
+} // namespace wasm
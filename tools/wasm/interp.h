@@ -0,0 +1,154 @@
+/**
+ * Embedded interpreter for hook modules.
+ *
+ * Instance compiles every function body once into a flat stream of
+ * pre-decoded instructions: immediates are decoded, branch targets and stack
+ * heights resolved, block/end/nop dropped. The stream is run with threaded
+ * dispatch (computed goto) when built with GCC or clang, a switch otherwise.
+ *
+ * Metering counts every executed instruction of the original body, structured
+ * instructions and end included, as the ledger does; a branch lands after the
+ * end it targets (or on the first instruction of a loop body), so that end is
+ * not counted. The count is charged once per straight-line run of
+ * instructions; runs end at every call, so only a trap can leave one early,
+ * and the charge is then corrected. When the fuel limit is reached the call
+ * stops with OUT_OF_FUEL at the start of the run that would exceed it.
+ *
+ * Only the integer subset is supported: SetHook rejects modules using floating
+ * point, and so does the compiler here. Imports are functions bound by name to
+ * host callbacks; a host callback may halt the instance (accept, rollback).
+ */
+
+#ifndef WASM_INTERP_H
+#define WASM_INTERP_H
+
+#include "module.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wasm
+{
+
+class Instance;
+
+// host functions get the call arguments as raw 64 bit slots (i32 zero-extended)
+using HostFunc = int64_t (*)(Instance &instance, void *user, const uint64_t *args);
+
+struct HostBinding
+{
+    std::string module;
+    std::string name;
+    HostFunc func = nullptr;
+    void *user = nullptr;
+};
+
+class Imports
+{
+public:
+    void bind(const std::string &module, const std::string &name, HostFunc func, void *user = nullptr);
+    // called for imports with no binding, nullptr to make those an instantiation error
+    void fallback(HostFunc func, void *user = nullptr);
+
+    const HostBinding *find(const std::string &module, const std::string &name) const;
+    const HostBinding &fallback() const { return fallback_; }
+    const std::vector<HostBinding> &bindings() const { return bindings_; }
+
+private:
+    std::vector<HostBinding> bindings_;
+    HostBinding fallback_;
+};
+
+enum class Status
+{
+    OK,          // returned normally
+    HALTED,      // a host function called halt()
+    TRAP,        // see Result::trap
+    OUT_OF_FUEL,
+};
+
+struct Result
+{
+    Status status = Status::OK;
+    uint64_t value = 0;        // first result, or the halt value
+    uint64_t instructions = 0; // executed, as metered
+    uint64_t host_calls = 0;   // imported functions called
+    std::string trap;
+};
+
+class Instance
+{
+public:
+    static constexpr uint32_t PAGE_SIZE = 65536;
+    static constexpr uint32_t MAX_PAGES = 65536;
+    static constexpr size_t STACK_SLOTS = 1 << 16;
+    static constexpr size_t MAX_FRAMES = 1024;
+
+    // compiles the module and runs its initializers; throws ParseError for
+    // malformed or unsupported code and std::runtime_error for unbound imports
+    Instance(const Module &module, const Imports &imports);
+    ~Instance();
+    Instance(const Instance &) = delete;
+    Instance &operator=(const Instance &) = delete;
+
+    Result call(uint32_t func, const uint64_t *args, size_t nargs, uint64_t fuel = UINT64_MAX);
+    Result call(const std::string &export_name, const uint64_t *args, size_t nargs, uint64_t fuel = UINT64_MAX);
+
+    // restores memory and globals to their state after instantiation; only
+    // pages written since the last reset are copied
+    void reset();
+
+    // for host functions: stops the running call with Status::HALTED
+    void halt(uint64_t value)
+    {
+        halted_ = true;
+        halt_value_ = value;
+    }
+    uint8_t *memory() { return memory_.data(); }
+    size_t memory_size() const { return memory_.size(); }
+    // [ptr, ptr + len) is inside memory; host writes must also call touch()
+    bool in_bounds(uint64_t ptr, uint64_t len) const { return ptr + len <= memory_.size(); }
+    void touch(uint64_t ptr, uint64_t len);
+    // name of the import a host function was bound for, for the fallback
+    const std::string &import_name(uint32_t func) const { return module_.imports[import_index_[func]].name; }
+    uint32_t current_import() const { return current_import_; }
+
+    const Module &module() const { return module_; }
+    // length of the compiled instruction stream of every function, for reports
+    size_t code_size() const;
+
+private:
+    struct Insn;
+    struct Function;
+    struct Frame;
+    class Compiler;
+
+    uint32_t canonical_type(uint32_t type) const;
+    uint64_t eval_const(const std::vector<uint8_t> &expr) const;
+    Result run(uint32_t func, const uint64_t *args, size_t nargs, uint64_t fuel);
+    // with threaded dispatch, stores each instruction's handler address
+    void link();
+
+    const Module &module_;
+    std::vector<Function> functions_; // defined functions
+    std::vector<HostBinding> hosts_;  // imported functions
+    std::vector<uint32_t> import_index_;
+    std::vector<uint64_t> host_signatures_;
+    std::vector<uint32_t> func_types_;     // function index -> canonical type id
+    std::vector<int64_t> table_;           // table 0: function index or -1
+    std::vector<uint8_t> memory_, initial_memory_;
+    std::vector<uint8_t> dirty_; // one byte per 4k page of memory_
+    uint32_t max_pages_ = MAX_PAGES;
+    std::vector<uint64_t> globals_, initial_globals_;
+    std::vector<bool> dropped_data_;
+    std::vector<uint64_t> stack_;
+    std::vector<Frame> frames_;
+    bool halted_ = false;
+    uint64_t halt_value_ = 0;
+    uint32_t current_import_ = 0;
+};
+
+} // namespace wasm
+
+#endif
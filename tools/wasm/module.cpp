@@ -0,0 +1,693 @@
+#include "module.h"
+
+#include <algorithm>
+
+namespace wasm
+{
+
+ParseError::ParseError(const std::string &what, size_t offset)
+    : std::runtime_error(what + " at offset " + std::to_string(offset)), offset(offset)
+{
+}
+
+uint8_t Reader::u8()
+{
+    if (pos >= size)
+        throw ParseError("unexpected end of data", pos);
+    return data[pos++];
+}
+
+uint32_t Reader::u32()
+{
+    uint64_t v = u64();
+    if (v > UINT32_MAX)
+        throw ParseError("u32 out of range", pos);
+    return (uint32_t)v;
+}
+
+uint64_t Reader::u64()
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 70; shift += 7)
+    {
+        uint8_t b = u8();
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+            return v;
+    }
+    throw ParseError("LEB128 too long", pos);
+}
+
+int32_t Reader::s32()
+{
+    return (int32_t)s64();
+}
+
+int64_t Reader::s64()
+{
+    int64_t v = 0;
+    int shift = 0;
+    uint8_t b;
+    do
+    {
+        if (shift >= 70)
+            throw ParseError("LEB128 too long", pos);
+        b = u8();
+        v |= (int64_t)((uint64_t)(b & 0x7F) << shift);
+        shift += 7;
+    } while (b & 0x80);
+    if (shift < 64 && (b & 0x40))
+        v |= (int64_t)(~0ULL << shift);
+    return v;
+}
+
+uint32_t Reader::fixed32()
+{
+    const uint8_t *p = bytes(4);
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+uint64_t Reader::fixed64()
+{
+    uint64_t lo = fixed32();
+    return lo | (uint64_t)fixed32() << 32;
+}
+
+std::string Reader::name()
+{
+    uint32_t n = u32();
+    const uint8_t *p = bytes(n);
+    return std::string((const char *)p, n);
+}
+
+const uint8_t *Reader::bytes(size_t n)
+{
+    if (n > size - pos)
+        throw ParseError("unexpected end of data", pos);
+    const uint8_t *p = data + pos;
+    pos += n;
+    return p;
+}
+
+void Writer::u32(uint32_t v)
+{
+    do
+    {
+        uint8_t b = v & 0x7F;
+        v >>= 7;
+        out.push_back(v ? (b | 0x80) : b);
+    } while (v);
+}
+
+void Writer::s64(int64_t v)
+{
+    for (;;)
+    {
+        uint8_t b = v & 0x7F;
+        v >>= 7;
+        if ((v == 0 && !(b & 0x40)) || (v == -1 && (b & 0x40)))
+        {
+            out.push_back(b);
+            return;
+        }
+        out.push_back(b | 0x80);
+    }
+}
+
+void Writer::name(const std::string &s)
+{
+    u32((uint32_t)s.size());
+    bytes((const uint8_t *)s.data(), s.size());
+}
+
+void Writer::sized(const std::vector<uint8_t> &b)
+{
+    u32((uint32_t)b.size());
+    bytes(b);
+}
+
+namespace
+{
+
+Limits read_limits(Reader &r)
+{
+    Limits l;
+    uint8_t flags = r.u8();
+    if (flags > 1)
+        throw ParseError("unsupported limits flags", r.pos - 1);
+    l.min = r.u32();
+    if (flags == 1)
+        l.max = r.u32();
+    return l;
+}
+
+void write_limits(Writer &w, const Limits &l)
+{
+    w.u8(l.max ? 1 : 0);
+    w.u32(l.min);
+    if (l.max)
+        w.u32(*l.max);
+}
+
+// constant expressions are copied as raw bytes up to and including their end
+std::vector<uint8_t> read_const_expr(Reader &r)
+{
+    size_t start = r.pos;
+    for (;;)
+    {
+        uint8_t op = r.u8();
+        switch (op)
+        {
+        case 0x0B:
+            return std::vector<uint8_t>(r.data + start, r.data + r.pos);
+        case 0x41:
+            r.s32();
+            break;
+        case 0x42:
+            r.s64();
+            break;
+        case 0x43:
+            r.bytes(4);
+            break;
+        case 0x44:
+            r.bytes(8);
+            break;
+        case 0x23:
+        case 0xD2:
+            r.u32();
+            break;
+        case 0xD0:
+            r.u8();
+            break;
+        default:
+            throw ParseError("unsupported constant expression opcode", r.pos - 1);
+        }
+    }
+}
+
+} // namespace
+
+Module Module::parse(const std::vector<uint8_t> &bin)
+{
+    Module m;
+    Reader r(bin.data(), bin.size());
+    if (r.fixed32() != 0x6D736100)
+        throw ParseError("not a wasm module", 0);
+    if (r.fixed32() != 1)
+        throw ParseError("unsupported wasm version", 4);
+
+    std::vector<uint32_t> func_types;
+    uint8_t last_id = 0;
+    while (!r.eof())
+    {
+        size_t header = r.pos;
+        uint8_t id = r.u8();
+        uint32_t len = r.u32();
+        size_t end = r.pos + len;
+        if (end > r.size)
+            throw ParseError("section runs past end of module", header);
+        if (id > SEC_DATA_COUNT)
+            throw ParseError("unknown section id " + std::to_string(id), header);
+        if (id != SEC_CUSTOM)
+        {
+            // data count sits between element and code
+            uint8_t order = id == SEC_DATA_COUNT ? (uint8_t)SEC_ELEMENT : id;
+            if (order < last_id || (order == last_id && id != SEC_DATA_COUNT))
+                throw ParseError("section out of order", header);
+            last_id = order;
+        }
+        m.section_sizes[id] += end - header;
+        Reader s(bin.data(), end);
+        s.pos = r.pos;
+
+        switch (id)
+        {
+        case SEC_CUSTOM:
+        {
+            Custom c;
+            c.name = s.name();
+            c.data.assign(bin.data() + s.pos, bin.data() + end);
+            s.pos = end;
+            m.customs.push_back(std::move(c));
+            break;
+        }
+        case SEC_TYPE:
+            for (uint32_t n = s.u32(); n > 0; --n)
+            {
+                if (s.u8() != 0x60)
+                    throw ParseError("expected func type", s.pos - 1);
+                FuncType t;
+                for (uint32_t k = s.u32(); k > 0; --k)
+                    t.params.push_back(s.u8());
+                for (uint32_t k = s.u32(); k > 0; --k)
+                    t.results.push_back(s.u8());
+                m.types.push_back(std::move(t));
+            }
+            break;
+        case SEC_IMPORT:
+            for (uint32_t n = s.u32(); n > 0; --n)
+            {
+                Import im;
+                im.module = s.name();
+                im.name = s.name();
+                im.kind = s.u8();
+                switch (im.kind)
+                {
+                case KIND_FUNC:
+                    im.type = s.u32();
+                    break;
+                case KIND_TABLE:
+                    im.table.type = s.u8();
+                    im.table.limits = read_limits(s);
+                    break;
+                case KIND_MEMORY:
+                    im.memory = read_limits(s);
+                    break;
+                case KIND_GLOBAL:
+                    im.global.type = s.u8();
+                    im.global.mut = s.u8() != 0;
+                    break;
+                default:
+                    throw ParseError("unknown import kind", s.pos - 1);
+                }
+                m.imports.push_back(std::move(im));
+            }
+            break;
+        case SEC_FUNCTION:
+            for (uint32_t n = s.u32(); n > 0; --n)
+                func_types.push_back(s.u32());
+            break;
+        case SEC_TABLE:
+            for (uint32_t n = s.u32(); n > 0; --n)
+            {
+                Table t;
+                t.type = s.u8();
+                t.limits = read_limits(s);
+                m.tables.push_back(t);
+            }
+            break;
+        case SEC_MEMORY:
+            for (uint32_t n = s.u32(); n > 0; --n)
+                m.memories.push_back(read_limits(s));
+            break;
+        case SEC_GLOBAL:
+            for (uint32_t n = s.u32(); n > 0; --n)
+            {
+                Global g;
+                g.type = s.u8();
+                g.mut = s.u8() != 0;
+                g.init = read_const_expr(s);
+                m.globals.push_back(std::move(g));
+            }
+            break;
+        case SEC_EXPORT:
+            for (uint32_t n = s.u32(); n > 0; --n)
+            {
+                Export e;
+                e.name = s.name();
+                e.kind = s.u8();
+                e.index = s.u32();
+                m.exports.push_back(std::move(e));
+            }
+            break;
+        case SEC_START:
+            m.start = s.u32();
+            break;
+        case SEC_ELEMENT:
+            for (uint32_t n = s.u32(); n > 0; --n)
+            {
+                Element e;
+                uint32_t flags = s.u32();
+                if (flags == 0)
+                    e.offset = read_const_expr(s);
+                else if (flags == 2)
+                {
+                    e.table = s.u32();
+                    e.offset = read_const_expr(s);
+                    if (s.u8() != 0)
+                        throw ParseError("unsupported element kind", s.pos - 1);
+                }
+                else
+                    throw ParseError("unsupported element segment flags", s.pos - 1);
+                for (uint32_t k = s.u32(); k > 0; --k)
+                    e.funcs.push_back(s.u32());
+                m.elements.push_back(std::move(e));
+            }
+            break;
+        case SEC_DATA_COUNT:
+            m.data_count = s.u32();
+            break;
+        case SEC_CODE:
+        {
+            uint32_t n = s.u32();
+            if (n != func_types.size())
+                throw ParseError("function and code section sizes differ", s.pos);
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                Function f;
+                f.type = func_types[i];
+                uint32_t size = s.u32();
+                size_t body_end = s.pos + size;
+                if (body_end > end)
+                    throw ParseError("function body runs past section", s.pos);
+                for (uint32_t k = s.u32(); k > 0; --k)
+                {
+                    uint32_t count = s.u32();
+                    f.locals.emplace_back(count, s.u8());
+                }
+                f.offset = s.pos;
+                f.body.assign(bin.data() + s.pos, bin.data() + body_end);
+                s.pos = body_end;
+                m.functions.push_back(std::move(f));
+            }
+            break;
+        }
+        case SEC_DATA:
+            for (uint32_t n = s.u32(); n > 0; --n)
+            {
+                Data d;
+                uint32_t flags = s.u32();
+                if (flags == 1)
+                    d.passive = true;
+                else
+                {
+                    if (flags == 2)
+                        d.memory = s.u32();
+                    else if (flags != 0)
+                        throw ParseError("unsupported data segment flags", s.pos - 1);
+                    d.offset = read_const_expr(s);
+                }
+                uint32_t size = s.u32();
+                const uint8_t *p = s.bytes(size);
+                d.bytes.assign(p, p + size);
+                m.data.push_back(std::move(d));
+            }
+            break;
+        }
+        if (s.pos != end)
+            throw ParseError(std::string("trailing bytes in ") + section_name(id) + " section", s.pos);
+        r.pos = end;
+    }
+    if (m.functions.size() != func_types.size())
+        throw ParseError("function section without code section", r.pos);
+    return m;
+}
+
+std::vector<uint8_t> Module::serialize() const
+{
+    Writer w;
+    w.bytes({0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00});
+    auto section = [&w](uint8_t id, const Writer &s) {
+        w.u8(id);
+        w.sized(s.out);
+    };
+
+    if (!types.empty())
+    {
+        Writer s;
+        s.u32((uint32_t)types.size());
+        for (const FuncType &t : types)
+        {
+            s.u8(0x60);
+            s.sized(t.params);
+            s.sized(t.results);
+        }
+        section(SEC_TYPE, s);
+    }
+    if (!imports.empty())
+    {
+        Writer s;
+        s.u32((uint32_t)imports.size());
+        for (const Import &im : imports)
+        {
+            s.name(im.module);
+            s.name(im.name);
+            s.u8(im.kind);
+            switch (im.kind)
+            {
+            case KIND_FUNC:
+                s.u32(im.type);
+                break;
+            case KIND_TABLE:
+                s.u8(im.table.type);
+                write_limits(s, im.table.limits);
+                break;
+            case KIND_MEMORY:
+                write_limits(s, im.memory);
+                break;
+            case KIND_GLOBAL:
+                s.u8(im.global.type);
+                s.u8(im.global.mut ? 1 : 0);
+                break;
+            }
+        }
+        section(SEC_IMPORT, s);
+    }
+    if (!functions.empty())
+    {
+        Writer s;
+        s.u32((uint32_t)functions.size());
+        for (const Function &f : functions)
+            s.u32(f.type);
+        section(SEC_FUNCTION, s);
+    }
+    if (!tables.empty())
+    {
+        Writer s;
+        s.u32((uint32_t)tables.size());
+        for (const Table &t : tables)
+        {
+            s.u8(t.type);
+            write_limits(s, t.limits);
+        }
+        section(SEC_TABLE, s);
+    }
+    if (!memories.empty())
+    {
+        Writer s;
+        s.u32((uint32_t)memories.size());
+        for (const Limits &l : memories)
+            write_limits(s, l);
+        section(SEC_MEMORY, s);
+    }
+    if (!globals.empty())
+    {
+        Writer s;
+        s.u32((uint32_t)globals.size());
+        for (const Global &g : globals)
+        {
+            s.u8(g.type);
+            s.u8(g.mut ? 1 : 0);
+            s.bytes(g.init);
+        }
+        section(SEC_GLOBAL, s);
+    }
+    if (!exports.empty())
+    {
+        Writer s;
+        s.u32((uint32_t)exports.size());
+        for (const Export &e : exports)
+        {
+            s.name(e.name);
+            s.u8(e.kind);
+            s.u32(e.index);
+        }
+        section(SEC_EXPORT, s);
+    }
+    if (start)
+    {
+        Writer s;
+        s.u32(*start);
+        section(SEC_START, s);
+    }
+    if (!elements.empty())
+    {
+        Writer s;
+        s.u32((uint32_t)elements.size());
+        for (const Element &e : elements)
+        {
+            if (e.table == 0)
+                s.u32(0);
+            else
+            {
+                s.u32(2);
+                s.u32(e.table);
+            }
+            s.bytes(e.offset);
+            if (e.table != 0)
+                s.u8(0);
+            s.u32((uint32_t)e.funcs.size());
+            for (uint32_t f : e.funcs)
+                s.u32(f);
+        }
+        section(SEC_ELEMENT, s);
+    }
+    if (data_count)
+    {
+        Writer s;
+        s.u32(*data_count);
+        section(SEC_DATA_COUNT, s);
+    }
+    if (!functions.empty())
+    {
+        Writer s;
+        s.u32((uint32_t)functions.size());
+        for (const Function &f : functions)
+        {
+            Writer b;
+            b.u32((uint32_t)f.locals.size());
+            for (const auto &[count, type] : f.locals)
+            {
+                b.u32(count);
+                b.u8(type);
+            }
+            b.bytes(f.body);
+            s.sized(b.out);
+        }
+        section(SEC_CODE, s);
+    }
+    if (!data.empty())
+    {
+        Writer s;
+        s.u32((uint32_t)data.size());
+        for (const Data &d : data)
+        {
+            if (d.passive)
+                s.u32(1);
+            else if (d.memory != 0)
+            {
+                s.u32(2);
+                s.u32(d.memory);
+            }
+            else
+                s.u32(0);
+            if (!d.passive)
+                s.bytes(d.offset);
+            s.sized(d.bytes);
+        }
+        section(SEC_DATA, s);
+    }
+    for (const Custom &c : customs)
+    {
+        Writer s;
+        s.name(c.name);
+        s.bytes(c.data);
+        section(SEC_CUSTOM, s);
+    }
+    return w.out;
+}
+
+uint32_t Module::imported_funcs() const
+{
+    return (uint32_t)std::count_if(imports.begin(), imports.end(),
+                                   [](const Import &im) { return im.kind == KIND_FUNC; });
+}
+
+uint32_t Module::imported_globals() const
+{
+    return (uint32_t)std::count_if(imports.begin(), imports.end(),
+                                   [](const Import &im) { return im.kind == KIND_GLOBAL; });
+}
+
+const Import &Module::func_import(uint32_t func) const
+{
+    for (const Import &im : imports)
+        if (im.kind == KIND_FUNC && func-- == 0)
+            return im;
+    throw std::out_of_range("function " + std::to_string(func) + " is not an import");
+}
+
+uint32_t Module::func_type_index(uint32_t func) const
+{
+    uint32_t n = imported_funcs();
+    if (func < n)
+        return func_import(func).type;
+    return functions.at(func - n).type;
+}
+
+std::optional<uint32_t> Module::find_export(const std::string &name, uint8_t kind) const
+{
+    for (const Export &e : exports)
+        if (e.kind == kind && e.name == name)
+            return e.index;
+    return std::nullopt;
+}
+
+std::optional<uint32_t> Module::find_import(const std::string &name) const
+{
+    uint32_t index = 0;
+    for (const Import &im : imports)
+    {
+        if (im.kind != KIND_FUNC)
+            continue;
+        if (im.name == name)
+            return index;
+        ++index;
+    }
+    return std::nullopt;
+}
+
+std::vector<std::string> Module::function_names() const
+{
+    std::vector<std::string> names(func_count());
+    for (const Custom &c : customs)
+    {
+        if (c.name != "name")
+            continue;
+        try
+        {
+            Reader r(c.data.data(), c.data.size());
+            while (!r.eof())
+            {
+                uint8_t sub = r.u8();
+                uint32_t len = r.u32();
+                size_t end = r.pos + len;
+                if (sub == 1)
+                {
+                    for (uint32_t n = r.u32(); n > 0; --n)
+                    {
+                        uint32_t index = r.u32();
+                        std::string name = r.name();
+                        if (index < names.size())
+                            names[index] = name;
+                    }
+                }
+                r.pos = end;
+            }
+        }
+        catch (const ParseError &)
+        {
+            // names are best effort
+        }
+    }
+    uint32_t i = 0;
+    for (const Import &im : imports)
+        if (im.kind == KIND_FUNC)
+        {
+            if (names[i].empty())
+                names[i] = im.name;
+            ++i;
+        }
+    for (const Export &e : exports)
+        if (e.kind == KIND_FUNC && e.index < names.size() && names[e.index].empty())
+            names[e.index] = e.name;
+    return names;
+}
+
+std::string Module::func_name(uint32_t func) const
+{
+    if (names_cache_.size() != func_count())
+        names_cache_ = function_names();
+    if (func < names_cache_.size() && !names_cache_[func].empty())
+        return names_cache_[func];
+    return "func[" + std::to_string(func) + "]";
+}
+
+const char *section_name(uint8_t id)
+{
+    static const char *names[] = {"custom", "type", "import", "function", "table", "memory", "global",
+                                  "export", "start", "element", "code", "data", "datacount"};
+    return id <= SEC_DATA_COUNT ? names[id] : "unknown";
+}
+
+} // namespace wasm
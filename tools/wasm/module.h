@@ -0,0 +1,211 @@
+/**
+ * Minimal WebAssembly module model used by the hook tools.
+ *
+ * Parses and re-serializes the MVP binary format (plus the bulk memory,
+ * sign extension and saturating conversion opcodes clang emits). Function
+ * bodies are kept as raw expression bytes, see instr.h for decoding them.
+ */
+
+#ifndef WASM_MODULE_H
+#define WASM_MODULE_H
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace wasm
+{
+
+enum Section : uint8_t
+{
+    SEC_CUSTOM = 0,
+    SEC_TYPE = 1,
+    SEC_IMPORT = 2,
+    SEC_FUNCTION = 3,
+    SEC_TABLE = 4,
+    SEC_MEMORY = 5,
+    SEC_GLOBAL = 6,
+    SEC_EXPORT = 7,
+    SEC_START = 8,
+    SEC_ELEMENT = 9,
+    SEC_CODE = 10,
+    SEC_DATA = 11,
+    SEC_DATA_COUNT = 12,
+};
+
+enum ExternalKind : uint8_t
+{
+    KIND_FUNC = 0,
+    KIND_TABLE = 1,
+    KIND_MEMORY = 2,
+    KIND_GLOBAL = 3,
+};
+
+enum ValType : uint8_t
+{
+    VT_I32 = 0x7F,
+    VT_I64 = 0x7E,
+    VT_F32 = 0x7D,
+    VT_F64 = 0x7C,
+    VT_FUNCREF = 0x70,
+    VT_EXTERNREF = 0x6F,
+};
+
+struct ParseError : std::runtime_error
+{
+    ParseError(const std::string &what, size_t offset);
+    size_t offset;
+};
+
+struct Reader
+{
+    const uint8_t *data;
+    size_t size;
+    size_t pos = 0;
+
+    Reader(const uint8_t *data, size_t size) : data(data), size(size) {}
+
+    bool eof() const { return pos >= size; }
+    uint8_t u8();
+    uint32_t u32();
+    uint64_t u64();
+    int32_t s32();
+    int64_t s64();
+    uint32_t fixed32();
+    uint64_t fixed64();
+    std::string name();
+    const uint8_t *bytes(size_t n);
+};
+
+struct Writer
+{
+    std::vector<uint8_t> out;
+
+    void u8(uint8_t v) { out.push_back(v); }
+    void u32(uint32_t v);
+    void s64(int64_t v);
+    void name(const std::string &s);
+    void bytes(const std::vector<uint8_t> &b) { out.insert(out.end(), b.begin(), b.end()); }
+    void bytes(const uint8_t *p, size_t n) { out.insert(out.end(), p, p + n); }
+    // writes a u32 length prefix followed by the buffer
+    void sized(const std::vector<uint8_t> &b);
+};
+
+struct FuncType
+{
+    std::vector<uint8_t> params;
+    std::vector<uint8_t> results;
+};
+
+struct Limits
+{
+    uint32_t min = 0;
+    std::optional<uint32_t> max;
+};
+
+struct Table
+{
+    uint8_t type = VT_FUNCREF;
+    Limits limits;
+};
+
+struct Global
+{
+    uint8_t type = VT_I32;
+    bool mut = false;
+    std::vector<uint8_t> init; // constant expression, including the final end
+};
+
+struct Import
+{
+    std::string module;
+    std::string name;
+    uint8_t kind = KIND_FUNC;
+    uint32_t type = 0; // KIND_FUNC
+    Table table;       // KIND_TABLE
+    Limits memory;     // KIND_MEMORY
+    Global global;     // KIND_GLOBAL, init is empty
+};
+
+struct Export
+{
+    std::string name;
+    uint8_t kind = KIND_FUNC;
+    uint32_t index = 0;
+};
+
+// only active funcref segments with expression-free function lists (flags 0 and 2)
+struct Element
+{
+    uint32_t table = 0;
+    std::vector<uint8_t> offset;
+    std::vector<uint32_t> funcs;
+};
+
+struct Data
+{
+    bool passive = false;
+    uint32_t memory = 0;
+    std::vector<uint8_t> offset;
+    std::vector<uint8_t> bytes;
+};
+
+struct Function
+{
+    uint32_t type = 0;
+    std::vector<std::pair<uint32_t, uint8_t>> locals; // (count, type) runs
+    std::vector<uint8_t> body;                        // expression, including the final end
+    size_t offset = 0;                                // of the body in the parsed binary
+};
+
+struct Custom
+{
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+struct Module
+{
+    std::vector<FuncType> types;
+    std::vector<Import> imports;
+    std::vector<Function> functions; // defined functions only
+    std::vector<Table> tables;
+    std::vector<Limits> memories;
+    std::vector<Global> globals;
+    std::vector<Export> exports;
+    std::optional<uint32_t> start;
+    std::vector<Element> elements;
+    std::vector<Data> data;
+    std::optional<uint32_t> data_count;
+    std::vector<Custom> customs;
+    // section id -> encoded size in the parsed binary, for reporting
+    size_t section_sizes[13] = {};
+
+    static Module parse(const std::vector<uint8_t> &bin);
+    std::vector<uint8_t> serialize() const;
+
+    uint32_t imported_funcs() const;
+    uint32_t imported_globals() const;
+    uint32_t func_count() const { return imported_funcs() + (uint32_t)functions.size(); }
+    bool is_import(uint32_t func) const { return func < imported_funcs(); }
+    const Import &func_import(uint32_t func) const;
+    uint32_t func_type_index(uint32_t func) const;
+    const FuncType &func_type(uint32_t func) const { return types.at(func_type_index(func)); }
+    std::optional<uint32_t> find_export(const std::string &name, uint8_t kind = KIND_FUNC) const;
+    std::optional<uint32_t> find_import(const std::string &name) const;
+    // names from the "name" custom section, index -> name
+    std::vector<std::string> function_names() const;
+    // "name" if known, otherwise "func[<index>]"
+    std::string func_name(uint32_t func) const;
+
+private:
+    mutable std::vector<std::string> names_cache_;
+};
+
+const char *section_name(uint8_t id);
+
+} // namespace wasm
+
+#endif
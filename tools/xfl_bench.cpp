@@ -0,0 +1,235 @@
+/**
+ * xfl_bench - cross-checks and times the XFL engine in tools/host/xfl
+ *
+ * Checks the float_* functions against fixed vectors worked out by hand from
+ * rippled's rules (truncating division and mulratio, normalization of short and
+ * long mantissas, underflow to zero, OVERFLOW, IOUAmount's collapse of tiny sums
+ * and the error codes), then runs each batch_* kernel and its scalar call over N
+ * random values, some of them invalid, verifies they agree and prints operations
+ * per second for both.
+ *
+ * Build: g++ -std=c++17 -O2 -march=native -Ilib -Itools tools/xfl_bench.cpp tools/host/xfl.cpp tools/host/util.cpp -o build/xfl_bench
+ * Usage: xfl_bench [-n COUNT] [-s SEED]
+ *
+ * Exit status is 0 when every check passes, 1 otherwise.
+ */
+
+#include "host/util.h"
+#include "host/xfl.h"
+
+#include "error.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace xfl;
+
+namespace
+{
+
+// the XFL bits of mantissa * 10^exponent, the mantissa already normalized
+constexpr int64_t F(uint64_t mantissa, int32_t exponent, bool negative = false)
+{
+    return (int64_t)((negative ? 0 : 1ULL << 62) | (uint64_t)(exponent + 97) << 54 | mantissa);
+}
+
+constexpr int64_t THREE = F(3000000000000000ULL, -15);
+constexpr int64_t TENTH = F(1000000000000000ULL, -16);
+constexpr int64_t PRICE = F(1234500000000000ULL, -13); // 123.45
+constexpr int64_t LARGEST = F(MAX_MANTISSA, MAX_EXPONENT);
+constexpr int64_t SMALLEST = F(MIN_MANTISSA, MIN_EXPONENT);
+
+static_assert(ONE == F(MIN_MANTISSA, -15), "float_one is 1e15 * 10^-15");
+
+struct Vector
+{
+    const char *name;
+    int64_t (*call)();
+    int64_t expected;
+};
+
+const Vector VECTORS[] = {
+    // normalization
+    {"set 1", [] { return float_set(0, 1); }, ONE},
+    {"set 0", [] { return float_set(5, 0); }, 0},
+    {"set -1", [] { return float_set(0, -1); }, F(MIN_MANTISSA, -15, true)},
+    {"set 123.45", [] { return float_set(-2, 12345); }, PRICE},
+    {"set 17 digits truncates", [] { return float_set(0, 12345678901234567LL); }, F(1234567890123456ULL, 1)},
+    {"set INT64_MIN", [] { return float_set(0, INT64_MIN); }, F(9223372036854775ULL, 3, true)},
+    {"set 1e16 carries", [] { return float_set(0, 10000000000000000LL); }, F(MIN_MANTISSA, 1)},
+    {"set largest", [] { return float_set(80, (int64_t)MAX_MANTISSA); }, LARGEST},
+    {"set above range", [] { return float_set(81, (int64_t)MIN_MANTISSA); }, OVERFLOW},
+    {"set smallest", [] { return float_set(-81, 1); }, SMALLEST},
+    {"set underflow", [] { return float_set(-82, 1); }, 0},
+    // division truncates, the last long division digit is lost to normalization
+    {"1/3", [] { return float_divide(ONE, THREE); }, F(3333333333333330ULL, -16)},
+    {"2/3", [] { return float_divide(F(2000000000000000ULL, -15), THREE); }, F(6666666666666660ULL, -16)},
+    {"-6/3", [] { return float_divide(F(6000000000000000ULL, -15, true), THREE); }, F(2000000000000000ULL, -15, true)},
+    {"x/1", [] { return float_divide(PRICE, ONE); }, PRICE},
+    {"0/3", [] { return float_divide(0, THREE); }, 0},
+    {"1/0", [] { return float_divide(ONE, 0); }, DIVISION_BY_ZERO},
+    {"invert 3", [] { return float_invert(THREE); }, F(3333333333333330ULL, -16)},
+    // mulratio keeps 18 digits before truncating, so it does not lose the last one
+    {"mulratio 1/3", [] { return float_mulratio(ONE, 0, 1, 3); }, F(3333333333333333ULL, -16)},
+    {"mulratio 1/3 up", [] { return float_mulratio(ONE, 1, 1, 3); }, F(3333333333333334ULL, -16)},
+    {"mulratio exact up", [] { return float_mulratio(THREE, 1, 2, 3); }, F(2000000000000000ULL, -15)},
+    {"mulratio /0", [] { return float_mulratio(ONE, 0, 1, 0); }, DIVISION_BY_ZERO},
+    // multiply truncates the 32 digit product
+    {"(1/3)*3", [] { return float_multiply(F(3333333333333330ULL, -16), THREE); }, F(9999999999999990ULL, -16)},
+    {"-1*3", [] { return float_multiply(F(MIN_MANTISSA, -15, true), THREE); }, F(3000000000000000ULL, -15, true)},
+    {"largest*10", [] { return float_multiply(LARGEST, F(MIN_MANTISSA, -14)); }, OVERFLOW},
+    {"smallest/10", [] { return float_multiply(SMALLEST, TENTH); }, 0},
+    // IOUAmount addition: aligned by truncation, |mantissa| <= 10 collapses to zero
+    {"1+(-1)", [] { return float_sum(ONE, float_negate(ONE)); }, 0},
+    {"sum carries", [] { return float_sum(F(MAX_MANTISSA, -15), F(MIN_MANTISSA, -30)); }, F(MIN_MANTISSA, -14)},
+    {"1+1e-20", [] { return float_sum(ONE, F(MIN_MANTISSA, -35)); }, ONE},
+    {"1-0.999999999999999", [] { return float_sum(ONE, F(9999999999999990ULL, -16, true)); }, 0},
+    {"0.1+0.2", [] { return float_sum(TENTH, F(2000000000000000ULL, -16)); }, F(3000000000000000ULL, -16)},
+    // int, compare and fields
+    {"int 123.45", [] { return float_int(PRICE, 0, 0); }, 123},
+    {"int 123.45 2dp", [] { return float_int(PRICE, 2, 0); }, 12345},
+    {"int -1", [] { return float_int(float_negate(ONE), 0, 0); }, CANT_RETURN_NEGATIVE},
+    {"int -1 abs", [] { return float_int(float_negate(ONE), 0, 1); }, 1},
+    {"int 16dp", [] { return float_int(ONE, 16, 0); }, INVALID_ARGUMENT},
+    {"int 1e20", [] { return float_int(F(MIN_MANTISSA, 5), 0, 0); }, TOO_BIG},
+    {"int 0.1", [] { return float_int(TENTH, 0, 0); }, 0},
+    {"divide < mulratio", [] { return float_compare(float_invert(THREE), float_mulratio(ONE, 0, 1, 3), COMPARE_LESS); },
+     1},
+    {"-1 < 0", [] { return float_compare(float_negate(ONE), 0, COMPARE_LESS); }, 1},
+    {"compare all", [] { return float_compare(ONE, ONE, 7); }, INVALID_ARGUMENT},
+    {"negate 0", [] { return float_negate(0); }, 0},
+    {"mantissa", [] { return float_mantissa(PRICE); }, 1234500000000000LL},
+    {"exponent", [] { return float_exponent(PRICE); }, -13},
+    {"exponent_set 81", [] { return float_exponent_set(ONE, 81); }, EXPONENT_OVERSIZED},
+    {"mantissa_set 1e16", [] { return float_mantissa_set(ONE, 10000000000000000LL); }, MANTISSA_OVERSIZED},
+    {"mantissa_set 5", [] { return float_mantissa_set(ONE, 5); }, MANTISSA_UNDERSIZED},
+    {"short mantissa invalid", [] { return float_sum(F(5, 0), ONE); }, INVALID_FLOAT},
+    {"negative int64 invalid", [] { return float_multiply(-1, ONE); }, INVALID_FLOAT},
+};
+
+int64_t random_float(std::mt19937_64 &rng)
+{
+    if (rng() % 16 == 0)
+        return 0;
+    uint64_t mantissa = MIN_MANTISSA + rng() % (MAX_MANTISSA - MIN_MANTISSA + 1);
+    int32_t exponent = -30 + (int32_t)(rng() % 60);
+    return F(mantissa, exponent, rng() % 2);
+}
+
+// now and then a value that fails validation, to cover the invalid lanes
+int64_t random_input(std::mt19937_64 &rng)
+{
+    switch (rng() % 32)
+    {
+    case 0:
+        return -(int64_t)(rng() >> 1);
+    case 1:
+        return F(rng() % MIN_MANTISSA, 0);
+    case 2:
+        return F(MIN_MANTISSA, MAX_EXPONENT + 1 + (int32_t)(rng() % 20));
+    }
+    return random_float(rng);
+}
+
+// a batch kernel and the scalar call it must agree with, element by element
+struct Kernel
+{
+    const char *name;
+    void (*batch)(const int64_t *a, const int64_t *b, int64_t *out, size_t n);
+    int64_t (*scalar)(int64_t a, int64_t b);
+};
+
+const Kernel KERNELS[] = {
+    {"valid", [](const int64_t *a, const int64_t *, int64_t *out, size_t n) { batch_valid(a, out, n); },
+     [](int64_t a, int64_t) { return (int64_t)is_valid(a); }},
+    {"negate", [](const int64_t *a, const int64_t *, int64_t *out, size_t n) { batch_negate(a, out, n); },
+     [](int64_t a, int64_t) { return float_negate(a); }},
+    {"sign", [](const int64_t *a, const int64_t *, int64_t *out, size_t n) { batch_sign(a, out, n); },
+     [](int64_t a, int64_t) { return float_sign(a); }},
+    {"mantissa", [](const int64_t *a, const int64_t *, int64_t *out, size_t n) { batch_mantissa(a, out, n); },
+     [](int64_t a, int64_t) { return float_mantissa(a); }},
+    {"exponent", [](const int64_t *a, const int64_t *, int64_t *out, size_t n) { batch_exponent(a, out, n); },
+     [](int64_t a, int64_t) { return float_exponent(a); }},
+    {"compare <", [](const int64_t *a, const int64_t *b, int64_t *out, size_t n) {
+         batch_compare(a, b, COMPARE_LESS, out, n);
+     },
+     [](int64_t a, int64_t b) { return float_compare(a, b, COMPARE_LESS); }},
+    {"compare >=", [](const int64_t *a, const int64_t *b, int64_t *out, size_t n) {
+         batch_compare(a, b, COMPARE_GREATER | COMPARE_EQUAL, out, n);
+     },
+     [](int64_t a, int64_t b) { return float_compare(a, b, COMPARE_GREATER | COMPARE_EQUAL); }},
+    {"compare !=", [](const int64_t *a, const int64_t *b, int64_t *out, size_t n) {
+         batch_compare(a, b, COMPARE_LESS | COMPARE_GREATER, out, n);
+     },
+     [](int64_t a, int64_t b) { return float_compare(a, b, COMPARE_LESS | COMPARE_GREATER); }},
+};
+
+void report(const char *name, size_t n, double secs)
+{
+    std::printf("%-24s %10.2f M/s %10.1f ns\n", name, n / secs / 1e6, secs * 1e9 / n);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t n = 1000000;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "-n") && i + 1 < argc)
+            n = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-s") && i + 1 < argc)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [-n COUNT] [-s SEED]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int failures = 0;
+    for (const Vector &v : VECTORS)
+    {
+        int64_t got = v.call();
+        if (got != v.expected)
+        {
+            std::printf("%s: got %lld, expected %lld\n", v.name, (long long)got, (long long)v.expected);
+            ++failures;
+        }
+    }
+
+    // b repeats a now and then so that compare sees equal pairs
+    std::mt19937_64 rng(seed);
+    std::vector<int64_t> a(n), b(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        a[i] = random_input(rng);
+        b[i] = rng() % 8 == 0 ? a[i] : random_input(rng);
+    }
+
+    std::vector<int64_t> one_by_one(n), batched(n);
+    std::printf("%zu values\n", n);
+    for (const Kernel &k : KERNELS)
+    {
+        std::string name = k.name;
+        report(("scalar " + name).c_str(), n, util::seconds([&] {
+                   for (size_t i = 0; i < n; ++i)
+                       one_by_one[i] = k.scalar(a[i], b[i]);
+               }));
+        report(("batch " + name).c_str(), n, util::seconds([&] { k.batch(a.data(), b.data(), batched.data(), n); }));
+        size_t mismatches = 0;
+        for (size_t i = 0; i < n; ++i)
+            mismatches += one_by_one[i] != batched[i];
+        if (mismatches)
+        {
+            std::printf("FAILED: %zu batch/scalar %s mismatches\n", mismatches, k.name);
+            ++failures;
+        }
+    }
+    return failures ? 1 : 0;
+}